@@ -28,6 +28,7 @@
 #include <iomanip>
 #include <chrono>
 #include <filesystem>
+#include <cstring>
 
 #include <GL/wglew.h>
 
@@ -190,6 +191,20 @@ void RenderingManager::Display ()
     curr_vol_renderer->SetOutdated();
   }
 
+  // Replace the preview volume if the full resolution volume is ready
+  if (m_data_mgr.UpdateProgressiveVolume())
+  {
+    UpdateDataAndResetCurrentVRMode();
+    curr_vol_renderer->SetOutdated();
+  }
+
+  // Replace the current volume by the latest in-situ frame, if any
+  if (m_data_mgr.UpdateInSituVolume())
+  {
+    UpdateDataAndResetCurrentVRMode();
+    curr_vol_renderer->SetOutdated();
+  }
+
   // Build ImgGui interface
   if (m_imgui_render_ui) SetImGuiInterface();
 
@@ -380,7 +395,9 @@ void RenderingManager::CloseFunc ()
 
 void RenderingManager::IdleFunc ()
 {
-  if (m_idle_rendering)
+  // Keep redrawing while the full resolution volume is being read
+  //  or while in-situ frames are being received
+  if (m_idle_rendering || m_data_mgr.IsLoadingFullVolume() || m_data_mgr.IsInSituIngestRunning())
   {
 #ifdef ALWAYS_OUTDATE_THE_CURRENT_VR_RENDERER
     curr_vol_renderer->SetOutdated();
@@ -1081,6 +1098,115 @@ void RenderingManager::SetImGuiInterface ()
                                                         , m_data_mgr.GetCurrentStructuredVolume()->GetScaleY()
                                                         , m_data_mgr.GetCurrentStructuredVolume()->GetScaleZ());
         }
+
+        if (ImGui::CollapsingHeader("Dataset Catalog###DataManagerDatasetCatalog"))
+        {
+          if (m_data_mgr.GetDatasetCatalog() && m_data_mgr.GetDatasetCatalog()->IsRefreshing())
+            ImGui::Text("- Indexing datasets...");
+
+          std::vector<std::string>& ui_strgrid_names = m_data_mgr.GetUINameDatasetList();
+          for (int i = 0; i < (int)ui_strgrid_names.size(); i++)
+          {
+            vis::DatasetCatalogEntry entry;
+            if (m_data_mgr.GetDatasetCatalogEntry(i, &entry) && entry.width > 0)
+              ImGui::BulletText("%s: %d %d %d, %s, %.1f MB", ui_strgrid_names[i].c_str(),
+                entry.width, entry.height, entry.depth, entry.type.c_str(), double(entry.file_size) / (1024.0 * 1024.0));
+            else if (m_data_mgr.GetDatasetCatalogEntry(i, &entry))
+              ImGui::BulletText("%s: %.1f MB", ui_strgrid_names[i].c_str(), double(entry.file_size) / (1024.0 * 1024.0));
+            else
+              ImGui::BulletText("%s: not indexed", ui_strgrid_names[i].c_str());
+          }
+        }
+
+        if (ImGui::CollapsingHeader("Shared Memory###DataManagerSharedMemory"))
+        {
+          ImGui::InputText("Segment###SharedMemorySegmentName", m_shared_segment_name, sizeof(m_shared_segment_name));
+          if (ImGui::Button("Publish###SharedMemoryPublish"))
+          {
+            m_data_mgr.PublishCurrentVolume(std::string(m_shared_segment_name));
+          }
+          ImGui::SameLine();
+          if (ImGui::Button("Attach###SharedMemoryAttach"))
+          {
+            m_data_mgr.AttachSharedVolume(std::string(m_shared_segment_name));
+            UpdateDataAndResetCurrentVRMode();
+          }
+          if (m_data_mgr.IsSharedVolumePublished()) ImGui::BulletText("Publishing current volume");
+          if (m_data_mgr.IsSharedVolumeAttached()) ImGui::BulletText("Attached to shared volume");
+        }
+
+        if (ImGui::CollapsingHeader("Export###DataManagerExport"))
+        {
+          ImGui::InputText("Path Prefix###ExportPathPrefix", m_export_path_prefix, sizeof(m_export_path_prefix));
+          std::vector<std::string> v_list = m_data_mgr.GetExportVolumeStrList();
+          ImGui::Combo("Volume###ExportVolume", &m_export_volume, vector_getter, static_cast<void*>(&v_list), v_list.size());
+          std::vector<std::string> f_list = m_data_mgr.GetExportFormatStrList();
+          ImGui::Combo("Format###ExportFormat", &m_export_format, vector_getter, static_cast<void*>(&f_list), f_list.size());
+          if (ImGui::Button("Export###ExportCurrentVolume"))
+          {
+            m_data_mgr.ExportCurrentVolume(std::string(m_export_path_prefix),
+              (vis::DataManager::EXPORT_FORMAT)m_export_format, (vis::DataManager::EXPORT_VOLUME)m_export_volume);
+          }
+        }
+
+        if (ImGui::CollapsingHeader("In-Situ Ingest###DataManagerInSituIngest"))
+        {
+          ImGui::InputText("Ring Buffer###InSituSegmentName", m_insitu_segment_name, sizeof(m_insitu_segment_name));
+          if (!m_data_mgr.IsInSituIngestRunning())
+          {
+            if (ImGui::Button("Start Ingest###InSituStartIngest"))
+              m_data_mgr.StartInSituIngest(std::string(m_insitu_segment_name));
+          }
+          else if (ImGui::Button("Stop Ingest###InSituStopIngest"))
+          {
+            m_data_mgr.StopInSituIngest();
+          }
+
+          if (m_data_mgr.IsInSituIngestRunning())
+          {
+            vis::InSituIngestStats stats = m_data_mgr.GetInSituIngestStats();
+            ImGui::BulletText("Frames: %llu received, %llu displayed, %llu dropped",
+              stats.frames_received, stats.frames_displayed, stats.frames_dropped);
+            ImGui::BulletText("Last Frame: %llu", stats.last_frame_id);
+            ImGui::BulletText("Latency: %.2f ms (avg %.2f, max %.2f)", stats.last_latency, stats.average_latency, stats.max_latency);
+            ImGui::BulletText("Upload: %.2f ms", m_data_mgr.GetInSituUploadTime());
+            ImGui::BulletText("Throughput: %.1f frames/s, %.1f MB/s",
+              stats.received_frames_per_second, stats.received_megabytes_per_second);
+          }
+
+          ImGui::Text("Local Producer Stand-In");
+          ImGui::SliderInt("Size###InSituStandInSize", &m_insitu_stand_in_size, 16, 512);
+          ImGui::SliderFloat("Frames/s###InSituStandInFPS", &m_insitu_stand_in_fps, 0.0f, 120.0f);
+          if (!m_data_mgr.IsInSituProducerStandInRunning())
+          {
+            if (ImGui::Button("Start Producer###InSituStartProducer"))
+              m_data_mgr.StartInSituProducerStandIn(std::string(m_insitu_segment_name), m_insitu_stand_in_size,
+                m_insitu_stand_in_size, m_insitu_stand_in_size, m_insitu_stand_in_fps);
+          }
+          else
+          {
+            if (ImGui::Button("Stop Producer###InSituStopProducer"))
+              m_data_mgr.StopInSituProducerStandIn();
+            ImGui::BulletText("Pushed Frames: %llu", m_data_mgr.GetInSituProducerStandInFrames());
+          }
+        }
+
+        if (ImGui::CollapsingHeader("Progressive Loading###DataManagerProgressiveLoading"))
+        {
+          bool progressive_loading = m_data_mgr.IsProgressiveLoadingEnabled();
+          int preview_stride = m_data_mgr.GetPreviewStride();
+          bool preview_average = m_data_mgr.IsPreviewAveraged();
+          bool changed = ImGui::Checkbox("Load Preview First###ProgressiveLoadingEnabled", &progressive_loading);
+          changed |= ImGui::SliderInt("Stride###ProgressiveLoadingStride", &preview_stride, 2, 16);
+          changed |= ImGui::Checkbox("Average Blocks###ProgressiveLoadingAverage", &preview_average);
+          if (changed) m_data_mgr.SetProgressiveLoading(progressive_loading, preview_stride, preview_average);
+
+          if (m_data_mgr.IsCurrentVolumePreview())
+            ImGui::BulletText("Preview: %.2f ms (loading full volume...)", m_data_mgr.GetPreviewLoadTime());
+          else if (m_data_mgr.GetPreviewLoadTime() > 0.0)
+            ImGui::BulletText("Preview: %.2f ms", m_data_mgr.GetPreviewLoadTime());
+          ImGui::BulletText("Full Resolution: %.2f ms", m_data_mgr.GetFullLoadTime());
+        }
         
         if (ImGui::CollapsingHeader("Gradient Volume###DataManagerGradientVolume"))
         {
@@ -1096,6 +1222,42 @@ void RenderingManager::SetImGuiInterface ()
               UpdateDataAndResetCurrentVRMode();
             }
           }
+
+          bool encoded_gradients = m_data_mgr.IsEncodedGradients();
+          if (ImGui::Checkbox("Encoded Gradients (Octahedral)###DataManagerEncodedGradients", &encoded_gradients))
+          {
+            m_data_mgr.SetEncodedGradients(encoded_gradients);
+            m_data_mgr.UpdateStructuredGradientTexture();
+            UpdateDataAndResetCurrentVRMode();
+          }
+
+          ImGui::Checkbox("Density x Gradient Histogram###DataManagerDensityGradientHistogram", &m_show_density_gradient_histogram);
+          if (m_show_density_gradient_histogram)
+          {
+            vis::DensityGradientHistogram* dg_histogram = m_data_mgr.GetDensityGradientHistogram();
+            if (dg_histogram)
+            {
+              ImGui::BulletText("Bins: %d x %d", dg_histogram->GetNumberOfDensityBins(), dg_histogram->GetNumberOfGradientBins());
+              ImGui::BulletText("Max Gradient Magnitude: %.4f", dg_histogram->GetMaxGradientMagnitude());
+              ImGui::BulletText("Gradient Magnitudes: %.2f ms", dg_histogram->GetGradientMagnitudeTime());
+              ImGui::BulletText("Histogram: %.2f ms", dg_histogram->GetHistogramTime());
+
+              // Marginal histograms in log scale
+              const std::vector<unsigned int>& d_hist = dg_histogram->GetDensityHistogram();
+              const std::vector<unsigned int>& g_hist = dg_histogram->GetGradientHistogram();
+              std::vector<float> d_log(d_hist.size()), g_log(g_hist.size());
+              for (size_t i = 0; i < d_hist.size(); i++) d_log[i] = log10f(1.0f + (float)d_hist[i]);
+              for (size_t i = 0; i < g_hist.size(); i++) g_log[i] = log10f(1.0f + (float)g_hist[i]);
+              ImGui::PlotHistogram("###DensityHistogramPlot", d_log.data(), (int)d_log.size(), 0,
+                "Density (log)", 0.0f, FLT_MAX, ImVec2(0, 60));
+              ImGui::PlotHistogram("###GradientMagnitudeHistogramPlot", g_log.data(), (int)g_log.size(), 0,
+                "Gradient Magnitude (log)", 0.0f, FLT_MAX, ImVec2(0, 60));
+            }
+            else if (m_data_mgr.IsComputingDensityGradientHistogram())
+            {
+              ImGui::BulletText("Computing...");
+            }
+          }
         }
       }
     }
@@ -1126,6 +1288,34 @@ void RenderingManager::SetImGuiInterface ()
         UpdateDataAndResetCurrentVRMode();
       }
     }
+    ImGui::Separator();
+    if (ImGui::CollapsingHeader("Derived Data Cache###DataManagerDerivedDataCache"))
+    {
+      vis::DerivedDataCache* ddcache = m_data_mgr.GetDerivedDataCache();
+      bool enabled = ddcache->IsEnabled();
+      if (ImGui::Checkbox("Enabled###DerivedDataCacheEnabled", &enabled))
+        ddcache->SetEnabled(enabled);
+      ImGui::BulletText("%s", ddcache->GetDirectory().c_str());
+      ImGui::BulletText("Size: %.1f / %.1f MB", double(ddcache->GetSize()) / (1024.0 * 1024.0),
+        double(ddcache->GetMaxSize()) / (1024.0 * 1024.0));
+      ImGui::BulletText("Hits: %llu, Misses: %llu", ddcache->GetNumberOfHits(), ddcache->GetNumberOfMisses());
+      if (ImGui::Button("Clear###DerivedDataCacheClear"))
+        ddcache->Clear();
+    }
+    if (ImGui::CollapsingHeader("Derived Resources###DataManagerDerivedResources"))
+    {
+      vis::DerivedResourceRegistry* registry = m_data_mgr.GetDerivedResourceRegistry();
+      ImGui::BulletText("Memory: %.1f / %.1f MB", double(registry->GetMemorySize()) / (1024.0 * 1024.0),
+        double(registry->GetMemoryBudget()) / (1024.0 * 1024.0));
+      ImGui::BulletText("Hits: %llu, Misses: %llu", registry->GetNumberOfHits(), registry->GetNumberOfMisses());
+      for (int i = 0; i < registry->GetNumberOfResources(); i++)
+      {
+        ImGui::BulletText("%s: %d refs, %.1f MB", registry->GetResourceName(i).c_str(),
+          registry->GetNumberOfReferences(i), double(registry->GetResourceMemorySize(i)) / (1024.0 * 1024.0));
+      }
+      if (ImGui::Button("Destroy Unreferenced###DerivedResourcesDestroyUnreferenced"))
+        registry->DestroyUnreferenced();
+    }
     ImGui::End();
   }
 
@@ -1261,6 +1451,14 @@ RenderingManager::RenderingManager ()
   m_ts_window_ms = -1;
 
   m_imgui_data_window     = true;
+  strcpy(m_shared_segment_name, "cppvolrend_volume");
+  strcpy(m_insitu_segment_name, "cppvolrend_insitu");
+  m_insitu_stand_in_size = 128;
+  m_insitu_stand_in_fps = 10.0f;
+  strcpy(m_export_path_prefix, "exported_volume");
+  m_export_format = (int)vis::DataManager::EXPORT_FORMAT::PVM_DDS_FILE;
+  m_export_volume = (int)vis::DataManager::EXPORT_VOLUME::CURRENT_VOLUME;
+  m_show_density_gradient_histogram = false;
 
   m_imgui_renderer_window = true;
 }
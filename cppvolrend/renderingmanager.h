@@ -148,6 +148,14 @@ private:
   double m_ts_window_ms;
 
   bool m_imgui_data_window;
+  char m_shared_segment_name[64];
+  char m_insitu_segment_name[64];
+  int m_insitu_stand_in_size;
+  float m_insitu_stand_in_fps;
+  char m_export_path_prefix[256];
+  int m_export_format;
+  int m_export_volume;
+  bool m_show_density_gradient_histogram;
 
   bool m_imgui_renderer_window;
 
@@ -33,7 +33,7 @@ RayCasting1Pass::~RayCasting1Pass ()
 
 void RayCasting1Pass::Clean ()
 {
-  if (m_glsl_transfer_function) delete m_glsl_transfer_function;
+  if (m_glsl_transfer_function) m_ext_data_manager->ReleaseDerivedResource(m_glsl_transfer_function);
   m_glsl_transfer_function = nullptr;
 
   DestroyRenderingPass();
@@ -52,7 +52,7 @@ bool RayCasting1Pass::Init (int swidth, int sheight)
   if (IsBuilt()) Clean();
 
   if (m_ext_data_manager->GetCurrentVolumeTexture() == nullptr) return false;
-  m_glsl_transfer_function = m_ext_data_manager->GetCurrentTransferFunction()->GenerateTexture_1D_RGBt();
+  m_glsl_transfer_function = m_ext_data_manager->AcquireTransferFunctionTexture();
   
   // Create Rendering Buffers and Shaders
   CreateRenderingPass();
@@ -73,7 +73,7 @@ void RC1PConeLightGroundTruthSteps::Clean ()
   if (m_tex_gt_state) delete m_tex_gt_state;
   m_tex_gt_state = nullptr;
 
-  if (m_tex_transfer_function) delete m_tex_transfer_function;
+  if (m_tex_transfer_function) m_ext_data_manager->ReleaseDerivedResource(m_tex_transfer_function);
   m_tex_transfer_function = nullptr;
 
   if (m_occ_tex_raysampled_vectors) delete m_occ_tex_raysampled_vectors;
@@ -96,7 +96,7 @@ bool RC1PConeLightGroundTruthSteps::Init (int shader_width, int shader_height)
   if (IsBuilt()) Clean();
 
   if (m_ext_data_manager->GetCurrentVolumeTexture() == nullptr) return false;
-  m_tex_transfer_function = m_ext_data_manager->GetCurrentTransferFunction()->GenerateTexture_1D_RGBt();
+  m_tex_transfer_function = m_ext_data_manager->AcquireTransferFunctionTexture();
 
   CreateIntegrationPass();
   gl::ExitOnGLError("RC1PCPURenderer: Error on creating rendering pass.");
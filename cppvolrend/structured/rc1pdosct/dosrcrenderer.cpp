@@ -15,6 +15,7 @@
 #include <vis_utils/camera.h>
 
 #include <volvis_utils/utils.h>
+#include <volvis_utils/preprocessinggraph.h>
 #include <math_utils/utils.h>
 
 #include <gl_utils/sphere.h>
@@ -38,6 +39,7 @@ RC1PConeTracingDirOcclusionShading::RC1PConeTracingDirOcclusionShading ()
   // Extinction Coefficient Volume
   bind_volume_of_gaussians = true;
   glsl_ext_coef_volume = nullptr;
+  build_ext_coef_volume_on_cpu = false;
 
   // Cone Occlusion
   bind_cone_occlusion_vars = true;
@@ -76,7 +78,7 @@ RC1PConeTracingDirOcclusionShading::~RC1PConeTracingDirOcclusionShading ()
 
 void RC1PConeTracingDirOcclusionShading::Clean ()
 {
-  if (m_glsl_transfer_function) delete m_glsl_transfer_function;
+  if (m_glsl_transfer_function) m_ext_data_manager->ReleaseDerivedResource(m_glsl_transfer_function);
   m_glsl_transfer_function = nullptr;
 
   // Light cache texture and shader
@@ -103,7 +105,7 @@ bool RC1PConeTracingDirOcclusionShading::Init (int swidth, int sheight)
   if (IsBuilt()) Clean();
 
   if (m_ext_data_manager->GetCurrentVolumeTexture() == nullptr) return false;
-  m_glsl_transfer_function = m_ext_data_manager->GetCurrentTransferFunction()->GenerateTexture_1D_RGBt();
+  m_glsl_transfer_function = m_ext_data_manager->AcquireTransferFunctionTexture();
 
   CreateRenderingPass();
   gl::ExitOnGLError("Error on Preparing Models and Shaders");
@@ -370,7 +372,19 @@ void RC1PConeTracingDirOcclusionShading::SetImGuiComponents ()
     SetOutdated();
   }
   ImGui::EndGroup();
-  //ImGui::Text("Generation Time: %.4f", (float)time_vol_generator);
+  if (ImGui::Checkbox("Build on CPU", &build_ext_coef_volume_on_cpu))
+  {
+    GenerateExtCoefVolume();
+  }
+  if (build_ext_coef_volume_on_cpu)
+    ImGui::Text("Generation Time: %.2f ms", (float)time_vol_generator);
+  if (ImGui::Button("Compare with CPU Reference"))
+  {
+    ext_coef_vol_gen.BuildMipMappedLevels(m_ext_data_manager->GetCurrentStructuredVolume(),
+      m_ext_data_manager->GetCurrentTransferFunction(),
+      glm::vec3(m_ext_data_manager->GetCurrentStructuredVolume()->GetScale()));
+    ext_coef_vol_gen.CompareLevelsWithTexture(glsl_ext_coef_volume);
+  }
   ImGui::PopID();
 
   ImGui::PushID("Cone Occlusion Data");
@@ -749,10 +763,46 @@ void RC1PConeTracingDirOcclusionShading::GenerateExtCoefVolume ()
   GLuint64 startTime, stopTime;
   unsigned int queryID[2];
 
-  glsl_ext_coef_volume = ext_coef_vol_gen.BuildMipMappedTexture(
-    m_ext_data_manager->GetCurrentVolumeTexture(),
-    m_ext_data_manager->GetCurrentTransferFunction()->GenerateTexture_1D_RGBA(),
-    glm::vec3(m_ext_data_manager->GetCurrentStructuredVolume()->GetScale()));
+  vis::StructuredGridVolume* vol = m_ext_data_manager->GetCurrentStructuredVolume();
+  vis::TransferFunction* tf = m_ext_data_manager->GetCurrentTransferFunction();
+
+  // Shared with the other renderers: key hashes the volume, the extinction of
+  //  the transfer function and the pyramid parameters (0 if any is unknown)
+  unsigned long long key = 0;
+  if (tf->GetExtinctionHash() != 0 && vol->GetContentHash() != 0)
+  {
+    glm::ivec3 custom_res = ext_coef_vol_gen.GetCustomExtCoefVolumeResolution();
+    int params[5] = { ext_coef_vol_gen.IsUsingCustomExtCoefVolumeResolution() ? 1 : 0,
+                      custom_res.x, custom_res.y, custom_res.z, build_ext_coef_volume_on_cpu ? 1 : 0 };
+    float sigma0 = ext_coef_vol_gen.GetBaseLevelGaussianSigma0();
+    key = vis::PreProcessingGraph::HashValue(tf->GetExtinctionHash(), vol->GetContentHash());
+    key = vis::PreProcessingGraph::HashBytes(params, sizeof(params), key);
+    key = vis::PreProcessingGraph::HashValue(sigma0, key);
+  }
+
+  bool built = false;
+  glsl_ext_coef_volume = m_ext_data_manager->GetDerivedResourceRegistry()->Acquire<gl::Texture3D>(
+    "Extinction Coefficient Pyramid", key,
+    [&] (size_t* memory_size) -> gl::Texture3D* {
+      gl::Texture3D* tex3d = nullptr;
+      if (build_ext_coef_volume_on_cpu)
+      {
+        ext_coef_vol_gen.BuildMipMappedLevels(vol, tf, glm::vec3(vol->GetScale()));
+        tex3d = ext_coef_vol_gen.GenerateTextureFromLevels();
+        time_vol_generator = ext_coef_vol_gen.GetLevelsBuildTime();
+      }
+      else
+      {
+        tex3d = ext_coef_vol_gen.BuildMipMappedTexture(m_ext_data_manager->GetCurrentVolumeTexture(),
+          tf->GenerateTexture_1D_RGBA(), glm::vec3(vol->GetScale()));
+      }
+      // R16F, mipmap levels add up to 1/7 of the base level
+      if (tex3d)
+        *memory_size = size_t(tex3d->GetWidth()) * tex3d->GetHeight() * tex3d->GetDepth() * sizeof(GLhalf) * 8 / 7;
+      built = true;
+      return tex3d;
+    });
+  if (!built) time_vol_generator = 0.0;
 
   // request binding of extinction coefficient volume
   bind_volume_of_gaussians = true;
@@ -765,7 +815,7 @@ void RC1PConeTracingDirOcclusionShading::GenerateExtCoefVolume ()
 
 void RC1PConeTracingDirOcclusionShading::DestroyExtCoefVolume ()
 {
-  if (glsl_ext_coef_volume) delete glsl_ext_coef_volume;
+  m_ext_data_manager->ReleaseDerivedResource(glsl_ext_coef_volume);
   glsl_ext_coef_volume = nullptr;
 
   gl::ExitOnGLError("Could not destroy gaussian data!");
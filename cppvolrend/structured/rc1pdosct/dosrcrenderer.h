@@ -77,6 +77,8 @@ protected:
   ExtinctionCoefficientVolume ext_coef_vol_gen;
   gl::Texture3D* glsl_ext_coef_volume;
   double time_vol_generator;
+  // Build the levels with the CPU reference instead of compute shaders
+  bool build_ext_coef_volume_on_cpu;
 
   //////////////////////////////////////////
   // Cone Lighting Parameters
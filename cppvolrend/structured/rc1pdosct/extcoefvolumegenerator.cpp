@@ -6,8 +6,138 @@
 #include <glm/gtc/quaternion.hpp>
 
 #include <gl_utils/computeshader.h>
+#include <volvis_utils/utils.h>
+
+#include <algorithm>
+#include <chrono>
+
+// Taps of the Gaussian filter of a level along one axis: each output value
+//  takes 7 samples spaced by "sigma" around its voxel center, linearly
+//  interpolated (clamp to edge) from the "n_in" input values, and zero outside
+//  the grid. Output o uses taps [first[o], first[o + 1]).
+// . weights are normalized per axis: the normalization of the 3D kernel is
+//   the product of the axes sums (same as the compute shaders)
+static void GaussianLevelTaps (int n_in, int n_out, float grid_size, float sigma,
+                               std::vector<int>& first, std::vector<int>& index, std::vector<float>& weight)
+{
+  const int vtk = 3;
+  float wk[2 * vtk + 1];
+  float sum_wk = 0.0f;
+  for (int k = -vtk; k <= vtk; k++)
+  {
+    float fk = float(k) * sigma;
+    wk[k + vtk] = glm::exp(-(fk * fk) / (2.0f * sigma * sigma));
+    sum_wk += wk[k + vtk];
+  }
+
+  first.assign(n_out + 1, 0);
+  index.clear();
+  weight.clear();
+  float out_voxel_size = grid_size / float(n_out);
+  for (int o = 0; o < n_out; o++)
+  {
+    first[o] = (int)index.size();
+    for (int k = -vtk; k <= vtk; k++)
+    {
+      float u = ((float(o) + 0.5f) * out_voxel_size + float(k) * sigma) / grid_size;
+      if (u < 0.0f || u > 1.0f) continue;
+
+      float t = u * float(n_in) - 0.5f;
+      int i0 = (int)glm::floor(t);
+      float f = t - float(i0);
+      index.push_back(std::min(std::max(i0, 0), n_in - 1));
+      weight.push_back(wk[k + vtk] * (1.0f - f) / sum_wk);
+      index.push_back(std::min(std::max(i0 + 1, 0), n_in - 1));
+      weight.push_back(wk[k + vtk] * f / sum_wk);
+    }
+  }
+  first[n_out] = (int)index.size();
+}
+
+// Gaussian filter of a level along "axis", from "in" (in_res) to "out" (in_res
+//  with n_out values along the axis)
+static void GaussianLevelPass (const float* in, glm::ivec3 in_res, int axis, int n_out,
+                               float grid_size, float sigma, float* out)
+{
+  std::vector<int> first, index;
+  std::vector<float> weight;
+  GaussianLevelTaps(in_res[axis], n_out, grid_size, sigma, first, index, weight);
+
+  glm::ivec3 out_res = in_res;
+  out_res[axis] = n_out;
+  const size_t in_slice = size_t(in_res.x) * size_t(in_res.y);
+  const size_t out_slice = size_t(out_res.x) * size_t(out_res.y);
+
+  if (axis == 0)
+  {
+#pragma omp parallel for schedule(static)
+    for (int z = 0; z < out_res.z; z++)
+    {
+      for (int y = 0; y < out_res.y; y++)
+      {
+        const float* in_row = in + size_t(z) * in_slice + size_t(y) * in_res.x;
+        float* out_row = out + size_t(z) * out_slice + size_t(y) * out_res.x;
+        for (int o = 0; o < n_out; o++)
+        {
+          float sum = 0.0f;
+          for (int t = first[o]; t < first[o + 1]; t++)
+            sum += weight[t] * in_row[index[t]];
+          out_row[o] = sum;
+        }
+      }
+    }
+  }
+  // y and z: whole rows (x) are accumulated
+  else if (axis == 1)
+  {
+#pragma omp parallel for schedule(static)
+    for (int z = 0; z < out_res.z; z++)
+    {
+      for (int o = 0; o < n_out; o++)
+      {
+        float* out_row = out + size_t(z) * out_slice + size_t(o) * out_res.x;
+        std::fill(out_row, out_row + out_res.x, 0.0f);
+        for (int t = first[o]; t < first[o + 1]; t++)
+        {
+          const float* in_row = in + size_t(z) * in_slice + size_t(index[t]) * in_res.x;
+          for (int x = 0; x < out_res.x; x++)
+            out_row[x] += weight[t] * in_row[x];
+        }
+      }
+    }
+  }
+  else
+  {
+#pragma omp parallel for schedule(static)
+    for (int o = 0; o < n_out; o++)
+    {
+      float* out_sl = out + size_t(o) * out_slice;
+      std::fill(out_sl, out_sl + out_slice, 0.0f);
+      for (int t = first[o]; t < first[o + 1]; t++)
+      {
+        const float* in_sl = in + size_t(index[t]) * in_slice;
+        for (size_t i = 0; i < out_slice; i++)
+          out_sl[i] += weight[t] * in_sl[i];
+      }
+    }
+  }
+}
+
+// Gaussian filtered level of resolution out_res from "in" (in_res)
+static void GaussianLevel (const float* in, glm::ivec3 in_res, glm::ivec3 out_res,
+                           glm::vec3 grid_size, float sigma, std::vector<float>& out)
+{
+  std::vector<float> pass_x(size_t(out_res.x) * size_t(in_res.y) * size_t(in_res.z));
+  std::vector<float> pass_y(size_t(out_res.x) * size_t(out_res.y) * size_t(in_res.z));
+  out.resize(size_t(out_res.x) * size_t(out_res.y) * size_t(out_res.z));
+
+  GaussianLevelPass(in, in_res, 0, out_res.x, grid_size.x, sigma, pass_x.data());
+  GaussianLevelPass(pass_x.data(), glm::ivec3(out_res.x, in_res.y, in_res.z), 1, out_res.y, grid_size.y, sigma, pass_y.data());
+  GaussianLevelPass(pass_y.data(), glm::ivec3(out_res.x, out_res.y, in_res.z), 2, out_res.z, grid_size.z, sigma, out.data());
+}
 
 ExtinctionCoefficientVolume::ExtinctionCoefficientVolume ()
+  : levels_build_time(0.0)
 {
   SetBaseLevelGaussianSigma0(1.0f);
   UseCustomExtCoefVolumeResolution(true);
@@ -89,6 +219,147 @@ glm::ivec3* ExtinctionCoefficientVolume::GetCustomExtCoefVolumeResolutionPtr ()
   return (&base_level_volume_resolution);
 }
 
+bool ExtinctionCoefficientVolume::BuildMipMappedLevels (vis::StructuredGridVolume* vol, vis::TransferFunction* tf,
+                                                        glm::vec3 volume_voxel_size)
+{
+  DestroyMipMappedLevels();
+  if (!vol || !tf) return false;
+
+  auto t0 = std::chrono::steady_clock::now();
+
+  glm::ivec3 vol_res(vol->GetWidth(), vol->GetHeight(), vol->GetDepth());
+  glm::vec3 VolumeGridSize = glm::vec3(vol_res) * volume_voxel_size;
+  glm::ivec3 base_res = IsUsingCustomExtCoefVolumeResolution() ? GetCustomExtCoefVolumeResolution() : vol_res;
+  base_res = glm::max(base_res, glm::ivec3(1));
+
+  ////////////////////////////////////////////////////////////////////////////////////
+  // 1. Opacity of each voxel
+  size_t n_voxels = size_t(vol_res.x) * size_t(vol_res.y) * size_t(vol_res.z);
+  std::vector<float> opacity(n_voxels);
+  vis::ComputeExtinctionVolume(vol, tf, opacity.data());
+#pragma omp parallel for schedule(static)
+  for (int z = 0; z < vol_res.z; z++)
+  {
+    float* slice = opacity.data() + size_t(z) * size_t(vol_res.x) * size_t(vol_res.y);
+    for (size_t i = 0; i < size_t(vol_res.x) * size_t(vol_res.y); i++)
+      slice[i] = 1.0f - glm::exp(-slice[i]);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////
+  // 2. Base level and mipmap levels (same sizes of glGenerateMipmap), each one
+  //    filtering the previous level with sigma_i = sigma_0 * 2^i
+  level_resolutions.push_back(base_res);
+  level_data.push_back(std::vector<float>());
+  GaussianLevel(opacity.data(), vol_res, base_res, VolumeGridSize, GetBaseLevelGaussianSigma0(), level_data[0]);
+
+  for (int i = 1; level_resolutions[i - 1] != glm::ivec3(1); i++)
+  {
+    glm::ivec3 res = glm::max(glm::ivec3(base_res.x >> i, base_res.y >> i, base_res.z >> i), glm::ivec3(1));
+    level_resolutions.push_back(res);
+    level_data.push_back(std::vector<float>());
+    GaussianLevel(level_data[i - 1].data(), level_resolutions[i - 1], res, VolumeGridSize,
+                  GetBaseLevelGaussianSigma0() * glm::pow(2.0f, (float)i), level_data[i]);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////
+  // 3. Transform opacities back to extinction coefficients
+  for (int i = 0; i < (int)level_data.size(); i++)
+  {
+    float* data = level_data[i].data();
+    int n = (int)level_data[i].size();
+#pragma omp parallel for schedule(static)
+    for (int k = 0; k < n; k++)
+      data[k] = -1.0f * glm::log(1.0f - data[k]);
+  }
+
+  levels_build_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  std::cout << "ExtinctionCoefficientVolume: " << (int)level_data.size() - 1 << " computed mipmap levels on CPU ("
+            << levels_build_time << " ms)..." << std::endl;
+  return true;
+}
+
+void ExtinctionCoefficientVolume::DestroyMipMappedLevels ()
+{
+  level_resolutions.clear();
+  level_data.clear();
+}
+
+int ExtinctionCoefficientVolume::GetNumberOfLevels ()
+{
+  return (int)level_data.size();
+}
+
+glm::ivec3 ExtinctionCoefficientVolume::GetLevelResolution (int level)
+{
+  return level_resolutions[level];
+}
+
+const float* ExtinctionCoefficientVolume::GetLevelData (int level)
+{
+  return level_data[level].data();
+}
+
+double ExtinctionCoefficientVolume::GetLevelsBuildTime ()
+{
+  return levels_build_time;
+}
+
+gl::Texture3D* ExtinctionCoefficientVolume::GenerateTextureFromLevels ()
+{
+  if (level_data.empty()) return nullptr;
+
+  gl::Texture3D* tex3d = new gl::Texture3D(level_resolutions[0]);
+  tex3d->GenerateTexture(GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, true);
+  tex3d->SetData((GLvoid*)level_data[0].data(), GL_R16F, GL_RED, GL_FLOAT);
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_3D, tex3d->GetTextureID());
+  for (int i = 1; i < (int)level_data.size(); i++)
+  {
+    glTexImage3D(GL_TEXTURE_3D, i, GL_R16F, level_resolutions[i].x, level_resolutions[i].y, level_resolutions[i].z,
+                 0, GL_RED, GL_FLOAT, (GLvoid*)level_data[i].data());
+  }
+  glBindTexture(GL_TEXTURE_3D, 0);
+
+  gl::ExitOnGLError("ExtinctionCoefficientVolume: Error after uploading the computed levels.");
+  return tex3d;
+}
+
+void ExtinctionCoefficientVolume::CompareLevelsWithTexture (gl::Texture3D* tex3d)
+{
+  if (!tex3d || level_data.empty()) return;
+  printf("Started  -> Compare Extinction Coefficient Volume\n");
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_3D, tex3d->GetTextureID());
+  for (int i = 0; i < (int)level_data.size(); i++)
+  {
+    int wd, ht, dp;
+    glGetTexLevelParameteriv(GL_TEXTURE_3D, i, GL_TEXTURE_WIDTH,  &wd);
+    glGetTexLevelParameteriv(GL_TEXTURE_3D, i, GL_TEXTURE_HEIGHT, &ht);
+    glGetTexLevelParameteriv(GL_TEXTURE_3D, i, GL_TEXTURE_DEPTH,  &dp);
+    if (glm::ivec3(wd, ht, dp) != level_resolutions[i])
+    {
+      printf("  - Level %d: texture size [%d, %d, %d] differs\n", i, wd, ht, dp);
+      continue;
+    }
+
+    std::vector<float> tex_data(level_data[i].size());
+    glGetTexImage(GL_TEXTURE_3D, i, GL_RED, GL_FLOAT, (GLvoid*)tex_data.data());
+
+    double max_error = 0.0, max_value = 0.0;
+    for (size_t k = 0; k < tex_data.size(); k++)
+    {
+      max_error = std::max(max_error, (double)glm::abs(tex_data[k] - level_data[i][k]));
+      max_value = std::max(max_value, (double)level_data[i][k]);
+    }
+    printf("  - Level %d [%d, %d, %d]: max error %g, max value %g\n", i, wd, ht, dp, max_error, max_value);
+  }
+  glBindTexture(GL_TEXTURE_3D, 0);
+
+  printf("Finished -> Compare Extinction Coefficient Volume\n");
+}
+
 gl::Texture3D* ExtinctionCoefficientVolume::GenerateExtinctionCoefficientVolumeSameSize (gl::Texture3D* tex_vol, gl::Texture1D* ttf, glm::vec3 voxel_size)
 {
   gl::Texture3D* tex3d = nullptr;
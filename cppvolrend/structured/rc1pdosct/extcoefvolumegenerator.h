@@ -1,6 +1,12 @@
 /**
  * Class that computes the Extinction Coefficient Volume using GLSL compute shader.
  *
+ * BuildMipMappedLevels is the CPU reference of BuildMipMappedTexture: each level
+ *   is the Gaussian filtered opacity of the previous one (7 samples per axis,
+ *   spaced by sigma_i = sigma_0 * 2^i), computed as three separable passes in
+ *   parallel, transformed back to extinction coefficients at the end. The
+ *   levels are kept and can be uploaded with GenerateTextureFromLevels.
+ *
  * Author: Leonardo Quatrin Campagnolo
  * campagnolo.lq@gmail.com
  *
@@ -42,6 +48,29 @@ public:
   void SetCustomExtCoefVolumeResolution (int v_w, int v_h, int v_d);
   glm::ivec3* GetCustomExtCoefVolumeResolutionPtr ();
 
+  // CPU reference (no GL calls), using the same sigma_0 and resolution options
+  // . the transfer function is applied at the voxels (GetExtN), then the
+  //   opacity is linearly interpolated: same as the GPU when the base level
+  //   samples fall at voxel centers (same size with sigma_0 multiple of the
+  //   voxel size), without the half-texel offset of the 1D texture lookup
+  bool BuildMipMappedLevels (vis::StructuredGridVolume* vol, vis::TransferFunction* tf,
+                             glm::vec3 volume_voxel_size);
+  void DestroyMipMappedLevels ();
+
+  int GetNumberOfLevels ();
+  glm::ivec3 GetLevelResolution (int level);
+  // Extinction coefficients of "level" (width * height * depth values)
+  const float* GetLevelData (int level);
+  // Time of the last BuildMipMappedLevels, in milliseconds
+  double GetLevelsBuildTime ();
+
+  // R16F texture with the computed levels as mipmaps
+  gl::Texture3D* GenerateTextureFromLevels ();
+
+  // Prints the max error of each mipmap level of "tex3d" against the computed
+  //  levels (reads the texture back)
+  void CompareLevelsWithTexture (gl::Texture3D* tex3d);
+
 protected:
 
 private:
@@ -55,6 +84,10 @@ private:
 
   bool map_specific_volume_resolution;
   glm::ivec3 base_level_volume_resolution;
+
+  std::vector<glm::ivec3> level_resolutions;
+  std::vector<std::vector<float>> level_data;
+  double levels_build_time;
 };
 
 #endif
\ No newline at end of file
@@ -12,6 +12,8 @@
 #include <gl_utils/computeshader.h>
 
 #include <random>
+#include <chrono>
+#include <algorithm>
 
 /////////////////////////////////
 // public functions
@@ -20,7 +22,20 @@ RC1PExtinctionBasedShading::RC1PExtinctionBasedShading ()
   : m_glsl_transfer_function(nullptr)
   , m_u_step_size(0.5f)
   , m_apply_gradient_shading(false)
+  , st_w(0), st_h(0), st_d(0)
   , glsl_sat3d_tex(nullptr)
+  , m_sat_build_time(0.0)
+  , m_sat_extinction_hash(0)
+  , m_sat_volume_hash(0)
+  , m_use_ambient_occlusion_volume(false)
+  , ao_w(0), ao_h(0), ao_d(0)
+  , glsl_ambient_occlusion_tex(nullptr)
+  , m_ao_volume_shells(0)
+  , m_ao_volume_radius(0.0f)
+  , m_ao_volume_build_time(0.0)
+  , m_compute_light_cache_on_cpu(false)
+  , m_cpu_sat(nullptr)
+  , m_upload_cpu_light_cache(true)
   , transfer_function_changed(false)
 {
 
@@ -59,7 +74,7 @@ RC1PExtinctionBasedShading::~RC1PExtinctionBasedShading ()
 
 void RC1PExtinctionBasedShading::Clean ()
 {
-  if (m_glsl_transfer_function) delete m_glsl_transfer_function;
+  if (m_glsl_transfer_function) m_ext_data_manager->ReleaseDerivedResource(m_glsl_transfer_function);
   m_glsl_transfer_function = nullptr;
 
   m_pre_illum_str_vol.DestroyLightCacheTexture();
@@ -83,17 +98,62 @@ void RC1PExtinctionBasedShading::ReloadShaders ()
 
 bool RC1PExtinctionBasedShading::Init (int swidth, int sheight)
 {
+  // The extinction SAT depends only on the volume and on the extinction of the
+  //  transfer function: it is kept when only the colors changed
+  gl::Texture3D* kept_sat3d_tex = nullptr;
+  vis::SummedAreaTable3D<float>* kept_cpu_sat = nullptr;
+  gl::Texture3D* kept_ambient_occlusion_tex = nullptr;
+  if (IsBuilt() && glsl_sat3d_tex != nullptr && IsSummedAreaTableUpToDate())
+  {
+    kept_sat3d_tex = glsl_sat3d_tex;
+    glsl_sat3d_tex = nullptr;
+    kept_cpu_sat = m_cpu_sat;
+    m_cpu_sat = nullptr;
+    kept_ambient_occlusion_tex = glsl_ambient_occlusion_tex;
+    glsl_ambient_occlusion_tex = nullptr;
+  }
+
   if (IsBuilt()) Clean();
 
-  if (m_ext_data_manager->GetCurrentVolumeTexture() == nullptr) return false;
-  m_glsl_transfer_function = m_ext_data_manager->GetCurrentTransferFunction()->GenerateTexture_1D_RGBt();
+  if (m_ext_data_manager->GetCurrentVolumeTexture() == nullptr)
+  {
+    if (kept_sat3d_tex) m_ext_data_manager->ReleaseDerivedResource(kept_sat3d_tex);
+    if (kept_cpu_sat)
+    {
+      m_ext_data_manager->ReleaseDerivedResource(kept_cpu_sat);
+      m_cpu_light_cache.SetSummedAreaTable(nullptr, glm::vec3(1.0f));
+    }
+    if (kept_ambient_occlusion_tex) delete kept_ambient_occlusion_tex;
+    return false;
+  }
+  m_glsl_transfer_function = m_ext_data_manager->AcquireTransferFunctionTexture();
 
-  // Summed Area Table Dimensions 3D
-  st_w = m_ext_data_manager->GetCurrentStructuredVolume()->GetWidth();
-  st_h = m_ext_data_manager->GetCurrentStructuredVolume()->GetHeight();
-  st_d = m_ext_data_manager->GetCurrentStructuredVolume()->GetDepth();
-  glsl_sat3d_tex = GenerateExtinctionSAT3DTex(m_ext_data_manager->GetCurrentStructuredVolume(),
-                                              m_ext_data_manager->GetCurrentTransferFunction());
+  if (kept_sat3d_tex)
+  {
+    glsl_sat3d_tex = kept_sat3d_tex;
+    m_cpu_sat = kept_cpu_sat;
+    glsl_ambient_occlusion_tex = kept_ambient_occlusion_tex;
+  }
+  else
+  {
+    // Default resolutions, set only at the first volume: afterwards the user
+    //  values are kept, clamped to each volume
+    if (st_w <= 0 || st_h <= 0 || st_d <= 0)
+    {
+      // Summed Area Table Dimensions 3D
+      st_w = m_ext_data_manager->GetCurrentStructuredVolume()->GetWidth();
+      st_h = m_ext_data_manager->GetCurrentStructuredVolume()->GetHeight();
+      st_d = m_ext_data_manager->GetCurrentStructuredVolume()->GetDepth();
+    }
+    if (ao_w <= 0 || ao_h <= 0 || ao_d <= 0)
+    {
+      // Ambient occlusion is smooth: half resolution is usually enough
+      ao_w = std::max(1, st_w / 2);
+      ao_h = std::max(1, st_h / 2);
+      ao_d = std::max(1, st_d / 2);
+    }
+    AcquireSummedAreaTable();
+  }
 
   // Get the current Diagonal of the Volume
   vis::StructuredGridVolume* vold = m_ext_data_manager->GetCurrentStructuredVolume();
@@ -105,6 +165,7 @@ bool RC1PExtinctionBasedShading::Init (int swidth, int sheight)
   dir_cone_max_distance = 0.75f * Dv;
   
   m_pre_illum_str_vol.GenerateLightCacheTexture();
+  m_upload_cpu_light_cache = true;
 
   CreateRenderingPass();
   gl::ExitOnGLError("Error on Preparing Models and Shaders");
@@ -135,6 +196,9 @@ bool RC1PExtinctionBasedShading::Update (vis::Camera* camera)
   }
   else // image space
   {
+    if (m_use_ambient_occlusion_volume && apply_ambient_occlusion)
+      UpdateAmbientOcclusionVolume();
+
     cp_shader_rendering->Bind();
 
     cp_shader_rendering->SetUniformTexture3D("TexVolumeSAT3D", glsl_sat3d_tex->GetTextureID(), 4);
@@ -146,6 +210,8 @@ bool RC1PExtinctionBasedShading::Update (vis::Camera* camera)
     cp_shader_rendering->BindUniform("u_sat_height");
     cp_shader_rendering->SetUniform("u_sat_depth", (int)glsl_sat3d_tex->GetDepth());
     cp_shader_rendering->BindUniform("u_sat_depth");
+    cp_shader_rendering->SetUniform("SATCellScales", GetSATCellScales());
+    cp_shader_rendering->BindUniform("SATCellScales");
 
     // Ambient Occlusion
     cp_shader_rendering->SetUniform("AmbOccShells", ambient_occlusion_shells);
@@ -154,6 +220,15 @@ bool RC1PExtinctionBasedShading::Update (vis::Camera* camera)
     cp_shader_rendering->SetUniform("AmbOccRadius", ambient_occlusion_radius);
     cp_shader_rendering->BindUniform("AmbOccRadius");
 
+    bool use_ao_volume = m_use_ambient_occlusion_volume && glsl_ambient_occlusion_tex != nullptr;
+    cp_shader_rendering->SetUniform("UseAmbientOcclusionVolume", use_ao_volume ? 1 : 0);
+    cp_shader_rendering->BindUniform("UseAmbientOcclusionVolume");
+    if (use_ao_volume)
+    {
+      cp_shader_rendering->SetUniformTexture3D("TexVolumeAmbientOcclusion", glsl_ambient_occlusion_tex->GetTextureID(), 5);
+      cp_shader_rendering->BindUniform("TexVolumeAmbientOcclusion");
+    }
+
     // Directional Shadows
     cp_shader_rendering->SetUniform("DirSdwConeSamples", dir_shadow_cone_samples);
     cp_shader_rendering->BindUniform("DirSdwConeSamples");
@@ -338,6 +413,31 @@ void RC1PExtinctionBasedShading::SetImGuiComponents ()
   {
     SetOutdated();
   }
+  if (ret_lc.x || ret_lc.y)
+    m_upload_cpu_light_cache = true;
+
+  if (m_pre_illum_str_vol.IsActive())
+  {
+    ImGui::PushID("CPU Light Cache");
+    if (ImGui::Checkbox("Compute Light Cache on CPU", &m_compute_light_cache_on_cpu))
+    {
+      m_cpu_light_cache.Invalidate();
+      m_upload_cpu_light_cache = true;
+      SetOutdated();
+    }
+    if (m_compute_light_cache_on_cpu)
+    {
+      float light_tolerance = m_cpu_light_cache.GetLightTolerance();
+      ImGui::Text("Light Tolerance (degrees)");
+      if (ImGui::DragFloat("###CPULightCacheLightTolerance", &light_tolerance, 0.05f, 0.0f, 45.0f))
+      {
+        m_cpu_light_cache.SetLightTolerance(light_tolerance);
+        SetOutdated();
+      }
+      ImGui::Text("  Last Update: %.2f ms", m_cpu_light_cache.GetUpdateTime());
+    }
+    ImGui::PopID();
+  }
 
   ImGui::PushID("Extinction Coefficient Summed Area Table 3D");
   ImGui::Text("- Extinction Coefficient SAT3D Resolution:");
@@ -348,11 +448,20 @@ void RC1PExtinctionBasedShading::SetImGuiComponents ()
   if (ImGui::Button("Update SAT3D Resolution"))
   {
     DestroySummedAreaTable();
-    glsl_sat3d_tex = GenerateExtinctionSAT3DTex(m_ext_data_manager->GetCurrentStructuredVolume(),
-                                                m_ext_data_manager->GetCurrentTransferFunction());
+    AcquireSummedAreaTable();
 
     SetOutdated();
   }
+  if (glsl_sat3d_tex)
+  {
+    ImGui::Text("  %.1f MB, %.2f ms", double(glsl_sat3d_tex->GetWidth()) * glsl_sat3d_tex->GetHeight()
+      * glsl_sat3d_tex->GetDepth() * sizeof(GLfloat) / (1024.0 * 1024.0), m_sat_build_time);
+  }
+  if (ImGui::Button("Evaluate SAT3D Error"))
+  {
+    vis::BenchmarkReducedExtinctionSAT(m_ext_data_manager->GetCurrentStructuredVolume(),
+                                       m_ext_data_manager->GetCurrentTransferFunction(), st_w, st_h, st_d);
+  }
   ImGui::EndGroup();
   ImGui::PopID();
 
@@ -375,6 +484,32 @@ void RC1PExtinctionBasedShading::SetImGuiComponents ()
     {
       SetOutdated();
     }
+
+    if (!m_pre_illum_str_vol.IsActive())
+    {
+      if (ImGui::Checkbox("Precomputed Occlusion Volume", &m_use_ambient_occlusion_volume))
+      {
+        SetOutdated();
+      }
+      if (m_use_ambient_occlusion_volume)
+      {
+        ImGui::BeginGroup();
+        ImGui::InputInt("###OcclusionVolumeW", &ao_w);
+        ImGui::InputInt("###OcclusionVolumeH", &ao_h);
+        ImGui::InputInt("###OcclusionVolumeD", &ao_d);
+        if (ImGui::Button("Update Occlusion Volume Resolution"))
+        {
+          DestroyAmbientOcclusionVolume();
+          SetOutdated();
+        }
+        if (glsl_ambient_occlusion_tex)
+        {
+          ImGui::Text("  %.1f MB, %.2f ms", double(glsl_ambient_occlusion_tex->GetWidth()) * glsl_ambient_occlusion_tex->GetHeight()
+            * glsl_ambient_occlusion_tex->GetDepth() * sizeof(GLfloat) / (1024.0 * 1024.0), m_ao_volume_build_time);
+        }
+        ImGui::EndGroup();
+      }
+    }
   }
   ImGui::PopID();
 
@@ -440,6 +575,12 @@ void RC1PExtinctionBasedShading::FillParameterSpace(ParameterSpace& pspace)
 /////////////////////////////////
 void RC1PExtinctionBasedShading::PreComputeLightCache (vis::Camera* camera)
 {
+  if (m_compute_light_cache_on_cpu)
+  {
+    PreComputeLightCacheOnCPU(camera);
+    return;
+  }
+
   vis::StructuredGridVolume* vol = m_ext_data_manager->GetCurrentStructuredVolume();
 
   // Initialize compute shader
@@ -492,6 +633,10 @@ void RC1PExtinctionBasedShading::PreComputeLightCache (vis::Camera* camera)
   cp_lightcache_shader->SetUniform("VolumeScaledSizes", volssize);
   cp_lightcache_shader->BindUniform("VolumeScaledSizes");
 
+  // Upload SAT cell sizes
+  cp_lightcache_shader->SetUniform("SATCellScales", GetSATCellScales());
+  cp_lightcache_shader->BindUniform("SATCellScales");
+
   // Ambient Occlusion
   cp_lightcache_shader->SetUniform("AmbOccShells", ambient_occlusion_shells);
   cp_lightcache_shader->BindUniform("AmbOccShells");
@@ -554,6 +699,83 @@ void RC1PExtinctionBasedShading::PreComputeLightCache (vis::Camera* camera)
   gl::ExitOnGLError("ERROR: After SetData");
 }
 
+void RC1PExtinctionBasedShading::PreComputeLightCacheOnCPU (vis::Camera* camera)
+{
+  vis::StructuredGridVolume* vol = m_ext_data_manager->GetCurrentStructuredVolume();
+
+  // The CPU copy of the SAT is only kept while computing on CPU
+  if (m_cpu_sat == nullptr)
+  {
+    DestroySummedAreaTable();
+    AcquireSummedAreaTable();
+  }
+
+  gl::Texture3D* tex_light_cache = m_pre_illum_str_vol.GetLightCacheTexturePointer();
+  glm::ivec3 lc_resolution(tex_light_cache->GetWidth(), tex_light_cache->GetHeight(), tex_light_cache->GetDepth());
+
+  m_cpu_light_cache.SetVolume(glm::ivec3(vol->GetWidth(), vol->GetHeight(), vol->GetDepth()), glm::vec3(vol->GetScale()));
+  m_cpu_light_cache.SetResolution(lc_resolution);
+  m_cpu_light_cache.SetAmbientOcclusion(apply_ambient_occlusion, ambient_occlusion_shells, ambient_occlusion_radius);
+  m_cpu_light_cache.SetDirectionalShadows(apply_directional_shadows, (float)(dir_shadow_cone_angle * glm::pi<double>() / 180.0),
+                                          dir_shadow_sample_interval, dir_shadow_initial_step,
+                                          dir_shadow_user_interface_weight, dir_cone_max_distance);
+  m_cpu_light_cache.SetLight(type_of_shadow, m_ext_rendering_parameters->GetBlinnPhongLightingPosition(),
+                             m_ext_rendering_parameters->GetBlinnPhongLightSourceCameraForward());
+
+  int n_tiles = m_cpu_light_cache.Update();
+  if (n_tiles > 0 || m_upload_cpu_light_cache)
+  {
+    glBindTexture(GL_TEXTURE_3D, tex_light_cache->GetTextureID());
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, lc_resolution.x, lc_resolution.y, lc_resolution.z,
+                    GL_RG, GL_FLOAT, m_cpu_light_cache.GetData());
+    glBindTexture(GL_TEXTURE_3D, 0);
+    m_upload_cpu_light_cache = false;
+  }
+
+  gl::ExitOnGLError("ERROR: After PreComputeLightCacheOnCPU");
+}
+
+void RC1PExtinctionBasedShading::UpdateAmbientOcclusionVolume ()
+{
+  vis::StructuredGridVolume* vol = m_ext_data_manager->GetCurrentStructuredVolume();
+
+  // Baked from the CPU copy of the SAT
+  if (m_cpu_sat == nullptr)
+  {
+    DestroySummedAreaTable();
+    AcquireSummedAreaTable();
+  }
+
+  if (glsl_ambient_occlusion_tex != nullptr
+    && m_ao_volume_shells == ambient_occlusion_shells && m_ao_volume_radius == ambient_occlusion_radius)
+    return;
+
+  DestroyAmbientOcclusionVolume();
+
+  auto t0 = std::chrono::steady_clock::now();
+
+  ao_w = std::max(1, std::min(ao_w, (int)vol->GetWidth()));
+  ao_h = std::max(1, std::min(ao_h, (int)vol->GetHeight()));
+  ao_d = std::max(1, std::min(ao_d, (int)vol->GetDepth()));
+
+  m_cpu_light_cache.SetVolume(glm::ivec3(vol->GetWidth(), vol->GetHeight(), vol->GetDepth()), glm::vec3(vol->GetScale()));
+  m_cpu_light_cache.SetAmbientOcclusion(true, ambient_occlusion_shells, ambient_occlusion_radius);
+
+  GLfloat* data_ao = new GLfloat[size_t(ao_w) * size_t(ao_h) * size_t(ao_d)];
+  m_cpu_light_cache.BakeAmbientOcclusion(glm::ivec3(ao_w, ao_h, ao_d), data_ao);
+
+  glsl_ambient_occlusion_tex = new gl::Texture3D(ao_w, ao_h, ao_d);
+  glsl_ambient_occlusion_tex->GenerateTexture(GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+  glsl_ambient_occlusion_tex->SetData((GLvoid*)data_ao, GL_R32F, GL_RED, GL_FLOAT);
+
+  delete[] data_ao;
+
+  m_ao_volume_shells = ambient_occlusion_shells;
+  m_ao_volume_radius = ambient_occlusion_radius;
+  m_ao_volume_build_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  gl::ExitOnGLError("ERROR: After UpdateAmbientOcclusionVolume");
+}
+
 void RC1PExtinctionBasedShading::CreateRenderingPass ()
 {
   glm::vec3 vol_resolution = glm::vec3(m_ext_data_manager->GetCurrentStructuredVolume()->GetWidth(),
@@ -617,107 +839,74 @@ void RC1PExtinctionBasedShading::DestroyRenderingShaders ()
 void RC1PExtinctionBasedShading::DestroySummedAreaTable ()
 {
   if (glsl_sat3d_tex != nullptr)
-    delete glsl_sat3d_tex;
+    m_ext_data_manager->ReleaseDerivedResource(glsl_sat3d_tex);
   glsl_sat3d_tex = nullptr;
+
+  // A SAT kept by Init is moved out of m_cpu_sat before Clean: the CPU light
+  //  cache keeps it, and its tiles, as they only depend on the extinction
+  if (m_cpu_sat != nullptr)
+  {
+    m_ext_data_manager->ReleaseDerivedResource(m_cpu_sat);
+    m_cpu_light_cache.SetSummedAreaTable(nullptr, glm::vec3(1.0f));
+  }
+  m_cpu_sat = nullptr;
+
+  // Baked from the SAT
+  DestroyAmbientOcclusionVolume();
 }
 
-gl::Texture3D* RC1PExtinctionBasedShading::GenerateExtinctionSAT3DTex (vis::StructuredGridVolume* vol, vis::TransferFunction* tf)
+void RC1PExtinctionBasedShading::DestroyAmbientOcclusionVolume ()
 {
-  // 1
-   // First, sample the initial "grid" and build SAT
-  int sat_w = (vol->GetWidth() + 2);
-  int sat_h = (vol->GetHeight() + 2);
-  int sat_d = (vol->GetDepth() + 2);
-  
-  double min_value = +9999;
-  double max_value = -9999;
+  if (glsl_ambient_occlusion_tex != nullptr)
+    delete glsl_ambient_occlusion_tex;
+  glsl_ambient_occlusion_tex = nullptr;
+}
 
-  vis::SummedAreaTable3D<double> sat3d(sat_w, sat_h, sat_d);
-  for (int x = 0; x < sat_w; x++)
-  {
-    for (int y = 0; y < sat_h; y++)
-    {
-      for (int z = 0; z < sat_d; z++)
-      {
-        double val;
-        // Adding borders to handle precision issues
-        //
-        // 0 0 0 0 0 0     0 S S S S S
-        // 0         0     0         S
-        // 0         0 --> 0         S
-        // 0         0     0         S
-        // 0 0 0 0 0 0     0 0 0 0 0 0
-        //
-        if (x == 0 || y == 0 || z == 0 || x == sat_w - 1 || y == sat_h - 1 || z == sat_d - 1)
-          val = 0.0f;
-        else
-        {
-          val = tf->GetExtN(vol->GetNormalizedSample(x - 1, y - 1, z - 1));
-          min_value = std::min(min_value, val);
-          max_value = std::max(max_value, val);
-        }
-        sat3d.SetValue(val, x, y, z);
-      }
-    }
-  }
-  sat3d.BuildSAT();
-  printf("SAT min %.2lf max %.2lf\n", min_value, max_value);
-
-  //for (int x = 0; x < sat_w; x++)
-  //{
-  //  for (int y = 0; y < sat_h; y++)
-  //  {
-  //    for (int z = 0; z < sat_d; z++)
-  //    {
-  //      double val;
-  //      if (x == 0 || y == 0 || z == 0 || x == sat_w - 1 || y == sat_h - 1 || z == sat_d - 1)
-  //        val = 0.0f;
-  //      else
-  //      {
-  //        val = tf->GetExtN(vol->GetNormalizedSample(x - 1, y - 1, z - 1));
-  //
-  //        double V1 = sat3d.GetValue(x    , y    , z    );
-  //        double V2 = sat3d.GetValue(x - 1, y    , z    );
-  //        double V3 = sat3d.GetValue(x    , y    , z - 1);
-  //        double V4 = sat3d.GetValue(x - 1, y    , z - 1);
-  //
-  //        double V5 = sat3d.GetValue(x    , y - 1, z    );
-  //        double V6 = sat3d.GetValue(x - 1, y - 1, z    );
-  //        double V7 = sat3d.GetValue(x    , y - 1, z - 1);
-  //        double V8 = sat3d.GetValue(x - 1, y - 1, z - 1);
-  //
-  //        double val_sat = (V1 - V2 - V3 + V4 - V5 + V6 + V7 - V8);
-  //        if (fabs(val_sat - val) > 0.001f)
-  //        {
-  //          std::cout << "diffffff: " << val << " " << val_sat << std::endl;
-  //        }
-  //      }
-  //    }
-  //  }
-  //}
-
-  // 2
-  // Then, we must create and generate the 3D texture
-  double* sat_data = sat3d.GetData();
-  GLfloat* data_sat = new GLfloat[sat_w * sat_h * sat_d];
-  for (int x = 0; x < sat_w; x++)
-  {
-    for (int y = 0; y < sat_h; y++)
-    {
-      for (int z = 0; z < sat_d; z++)
-      {
-        int id = x + y * sat_w + z * sat_w * sat_h;
-        data_sat[id] = (GLfloat)sat_data[id];// / double(x * y * z);
-      }
-    }
-  }
+bool RC1PExtinctionBasedShading::IsSummedAreaTableUpToDate ()
+{
+  vis::StructuredGridVolume* vol = m_ext_data_manager->GetCurrentStructuredVolume();
+  if (!vol) return false;
+
+  // Hash 0: the transfer function cannot tell if its extinction changed
+  unsigned long long ext_hash = m_ext_data_manager->GetCurrentTransferFunction()->GetExtinctionHash();
+  return ext_hash != 0 && ext_hash == m_sat_extinction_hash
+      && vol->GetContentHash() == m_sat_volume_hash;
+}
+
+glm::vec3 RC1PExtinctionBasedShading::GetSATCellScales ()
+{
+  // SAT texture has a 1-cell border on each side
+  vis::StructuredGridVolume* vol = m_ext_data_manager->GetCurrentStructuredVolume();
+  return glm::vec3(vol->GetWidth()  * vol->GetScaleX() / float(glsl_sat3d_tex->GetWidth()  - 2),
+                   vol->GetHeight() * vol->GetScaleY() / float(glsl_sat3d_tex->GetHeight() - 2),
+                   vol->GetDepth()  * vol->GetScaleZ() / float(glsl_sat3d_tex->GetDepth()  - 2));
+}
 
-  gl::Texture3D* tex3d_sat = new gl::Texture3D(sat_w, sat_h, sat_d);
-  tex3d_sat->GenerateTexture(GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
-  tex3d_sat->SetData((GLvoid*)data_sat, GL_R32F, GL_RED, GL_FLOAT);
+void RC1PExtinctionBasedShading::AcquireSummedAreaTable ()
+{
+  auto t0 = std::chrono::steady_clock::now();
+  vis::StructuredGridVolume* vol = m_ext_data_manager->GetCurrentStructuredVolume();
+  vis::TransferFunction* tf = m_ext_data_manager->GetCurrentTransferFunction();
 
-  delete[] data_sat;
+  // SAT resolution: [st_w, st_h, st_d] cells, each one with the mean extinction
+  //  of the voxels it covers (box filter)
+  st_w = std::max(1, std::min(st_w, (int)vol->GetWidth()));
+  st_h = std::max(1, std::min(st_h, (int)vol->GetHeight()));
+  st_d = std::max(1, std::min(st_d, (int)vol->GetDepth()));
+
+  // Both shared with the other renderers: when the CPU SAT is needed, the
+  //  texture is uploaded from it instead of computed again
+  if (m_compute_light_cache_on_cpu || m_use_ambient_occlusion_volume)
+  {
+    if (m_cpu_sat != nullptr) m_ext_data_manager->ReleaseDerivedResource(m_cpu_sat);
+    m_cpu_sat = m_ext_data_manager->AcquireExtinctionSAT(st_w, st_h, st_d);
+    m_cpu_light_cache.SetSummedAreaTable(m_cpu_sat, glm::vec3(vol->GetWidth()  * vol->GetScaleX() / float(st_w),
+                                                              vol->GetHeight() * vol->GetScaleY() / float(st_h),
+                                                              vol->GetDepth()  * vol->GetScaleZ() / float(st_d)));
+  }
+  glsl_sat3d_tex = m_ext_data_manager->AcquireExtinctionSAT3DTex(st_w, st_h, st_d, m_cpu_sat);
 
-  gl::ExitOnGLError("volrend/utils.cpp - GenerateExtinctionSAT3DTex()");
-  return tex3d_sat;
+  m_sat_build_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  m_sat_extinction_hash = tf->GetExtinctionHash();
+  m_sat_volume_hash = vol->GetContentHash();
 }
\ No newline at end of file
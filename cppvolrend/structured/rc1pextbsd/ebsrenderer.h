@@ -38,6 +38,8 @@
 #include "../../volrenderbase.h"
 #include "../../utils/preillumination.h"
 
+#include "extinctionlightcache.h"
+
 #include "imgui.h"
 #include "imgui_impl_glut.h"
 #include "imgui_impl_opengl2.h"
@@ -77,10 +79,34 @@ protected:
   PreIlluminationStructuredVolume m_pre_illum_str_vol;
   gl::ComputeShader* cp_lightcache_shader;
   virtual void PreComputeLightCache (vis::Camera* camera);
+
+  // Light cache computed on CPU, with a CPU copy of the SAT: only the
+  //  outdated tiles are recomputed and uploaded
+  bool m_compute_light_cache_on_cpu;
+  ExtinctionLightCache m_cpu_light_cache;
+  vis::SummedAreaTable3D<float>* m_cpu_sat;
+  bool m_upload_cpu_light_cache;
+  void PreComputeLightCacheOnCPU (vis::Camera* camera);
   
   // Summed Area Table 3D using Extinction Coefficients
+  // . [st_w, st_h, st_d] cells, up to the volume resolution
   int st_w, st_h, st_d;
   gl::Texture3D* glsl_sat3d_tex;
+  double m_sat_build_time;
+  // Transfer function extinction and volume content hashes of the current SAT
+  unsigned long long m_sat_extinction_hash;
+  unsigned long long m_sat_volume_hash;
+
+  // Ambient occlusion baked on CPU from the SAT, fetched by the image space
+  //  mode instead of querying all shells at each sample
+  // . [ao_w, ao_h, ao_d] cells, rebuilt only with the SAT or the shells/radius
+  bool m_use_ambient_occlusion_volume;
+  int ao_w, ao_h, ao_d;
+  gl::Texture3D* glsl_ambient_occlusion_tex;
+  int m_ao_volume_shells;
+  float m_ao_volume_radius;
+  double m_ao_volume_build_time;
+  void UpdateAmbientOcclusionVolume ();
 
   // Rendering shaders
   gl::ComputeShader* cp_shader_rendering;
@@ -91,8 +117,13 @@ protected:
 private:
   void DestroyRenderingShaders ();
   void DestroySummedAreaTable ();
+  void DestroyAmbientOcclusionVolume ();
 
-  gl::Texture3D* GenerateExtinctionSAT3DTex (vis::StructuredGridVolume* vol, vis::TransferFunction* tf);
+  // Shared extinction SAT (vis::GenerateExtinctionSAT3DTex) of [st_w, st_h, st_d]
+  //  cells, and its CPU copy if needed
+  void AcquireSummedAreaTable ();
+  bool IsSummedAreaTableUpToDate ();
+  glm::vec3 GetSATCellScales ();
 
   gl::Texture1D* m_glsl_transfer_function;
 
@@ -0,0 +1,410 @@
+#include "extinctionlightcache.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <chrono>
+
+ExtinctionLightCache::ExtinctionLightCache ()
+  : sat(nullptr)
+  , sat_cell_scales(1.0f)
+  , volume_dimensions(0)
+  , volume_scales(1.0f)
+  , resolution(0)
+  , apply_ambient_occlusion(true)
+  , ambient_occlusion_shells(15)
+  , ambient_occlusion_radius(1.0f)
+  , apply_directional_shadows(true)
+  , dir_shadow_cone_angle(glm::radians(1.0f))
+  , dir_shadow_sample_interval(2.0f)
+  , dir_shadow_initial_step(2.0f)
+  , dir_shadow_user_interface_weight(1.0f)
+  , dir_cone_max_distance(0.0f)
+  , type_of_shadow(0)
+  , light_pos(0.0f)
+  , light_forward(0.0f, 0.0f, -1.0f)
+  , light_tolerance(0.0f)
+  , n_tiles(0)
+  , update_time(0.0)
+{
+}
+
+ExtinctionLightCache::~ExtinctionLightCache ()
+{
+}
+
+void ExtinctionLightCache::SetSummedAreaTable (vis::SummedAreaTable3D<float>* _sat, glm::vec3 cell_scales)
+{
+  // The SAT may be rebuilt in place: always recompute
+  sat = _sat;
+  sat_cell_scales = cell_scales;
+  Invalidate();
+}
+
+void ExtinctionLightCache::SetVolume (glm::ivec3 dimensions, glm::vec3 scales)
+{
+  if (dimensions == volume_dimensions && scales == volume_scales) return;
+
+  volume_dimensions = dimensions;
+  volume_scales = scales;
+  Invalidate();
+}
+
+void ExtinctionLightCache::SetResolution (glm::ivec3 _resolution)
+{
+  _resolution = glm::max(_resolution, glm::ivec3(0));
+  if (_resolution == resolution) return;
+
+  resolution = _resolution;
+  light_cache.assign(size_t(resolution.x) * size_t(resolution.y) * size_t(resolution.z) * 2, 1.0f);
+
+  n_tiles = (resolution + glm::ivec3(EXTINCTION_LIGHT_CACHE_TILE_SIZE - 1)) / EXTINCTION_LIGHT_CACHE_TILE_SIZE;
+  int n = n_tiles.x * n_tiles.y * n_tiles.z;
+  tile_ambient_occlusion_outdated.assign(n, true);
+  tile_shadow_outdated.assign(n, true);
+  tile_light_direction.assign(n, glm::vec3(0.0f));
+  tile_skipped_updates.assign(n, 0);
+}
+
+void ExtinctionLightCache::SetAmbientOcclusion (bool apply, int shells, float radius)
+{
+  if (apply == apply_ambient_occlusion && shells == ambient_occlusion_shells && radius == ambient_occlusion_radius)
+    return;
+
+  apply_ambient_occlusion = apply;
+  ambient_occlusion_shells = shells;
+  ambient_occlusion_radius = radius;
+  tile_ambient_occlusion_outdated.assign(tile_ambient_occlusion_outdated.size(), true);
+}
+
+void ExtinctionLightCache::SetDirectionalShadows (bool apply, float cone_angle, float sample_interval, float initial_step,
+                                                  float user_interface_weight, float cone_max_distance)
+{
+  if (apply == apply_directional_shadows && cone_angle == dir_shadow_cone_angle
+   && sample_interval == dir_shadow_sample_interval && initial_step == dir_shadow_initial_step
+   && user_interface_weight == dir_shadow_user_interface_weight && cone_max_distance == dir_cone_max_distance)
+    return;
+
+  apply_directional_shadows = apply;
+  dir_shadow_cone_angle = cone_angle;
+  dir_shadow_sample_interval = sample_interval;
+  dir_shadow_initial_step = initial_step;
+  dir_shadow_user_interface_weight = user_interface_weight;
+  dir_cone_max_distance = cone_max_distance;
+  tile_shadow_outdated.assign(tile_shadow_outdated.size(), true);
+}
+
+void ExtinctionLightCache::SetLight (int _type_of_shadow, glm::vec3 _light_pos, glm::vec3 _light_forward)
+{
+  if (_type_of_shadow != type_of_shadow)
+    tile_shadow_outdated.assign(tile_shadow_outdated.size(), true);
+
+  // Light movements are checked per tile in Update
+  type_of_shadow = _type_of_shadow;
+  light_pos = _light_pos;
+  light_forward = _light_forward;
+}
+
+void ExtinctionLightCache::SetLightTolerance (float degrees)
+{
+  light_tolerance = glm::max(degrees, 0.0f);
+}
+
+float ExtinctionLightCache::GetLightTolerance ()
+{
+  return light_tolerance;
+}
+
+void ExtinctionLightCache::Invalidate ()
+{
+  tile_ambient_occlusion_outdated.assign(tile_ambient_occlusion_outdated.size(), true);
+  tile_shadow_outdated.assign(tile_shadow_outdated.size(), true);
+}
+
+int ExtinctionLightCache::Update ()
+{
+  if (sat == nullptr || light_cache.empty()) return 0;
+
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+  // Outdated tiles
+  float cos_tolerance = glm::cos(glm::radians(light_tolerance));
+  std::vector<int> tiles;
+  std::vector<int> tile_flags;
+  for (int tz = 0; tz < n_tiles.z; tz++)
+  {
+    for (int ty = 0; ty < n_tiles.y; ty++)
+    {
+      for (int tx = 0; tx < n_tiles.x; tx++)
+      {
+        int t = tx + ty * n_tiles.x + tz * n_tiles.x * n_tiles.y;
+        bool shadow_outdated = tile_shadow_outdated[t];
+        if (!shadow_outdated && apply_directional_shadows)
+        {
+          glm::ivec3 c0 = glm::ivec3(tx, ty, tz) * EXTINCTION_LIGHT_CACHE_TILE_SIZE;
+          glm::ivec3 c1 = glm::min(c0 + EXTINCTION_LIGHT_CACHE_TILE_SIZE, resolution);
+          glm::vec3 tile_center = (GetCellPosition(c0.x, c0.y, c0.z) + GetCellPosition(c1.x - 1, c1.y - 1, c1.z - 1)) * 0.5f;
+          glm::vec3 light_dir = GetLightDirection(tile_center);
+          if (light_dir != tile_light_direction[t])
+          {
+            tile_skipped_updates[t]++;
+            shadow_outdated = glm::dot(light_dir, tile_light_direction[t]) < cos_tolerance
+                           || tile_skipped_updates[t] >= EXTINCTION_LIGHT_CACHE_MAX_SKIPPED_UPDATES;
+          }
+        }
+
+        if (tile_ambient_occlusion_outdated[t] || shadow_outdated)
+        {
+          tiles.push_back(t);
+          tile_flags.push_back((tile_ambient_occlusion_outdated[t] ? 1 : 0) | (shadow_outdated ? 2 : 0));
+        }
+      }
+    }
+  }
+
+  int n_updated = (int)tiles.size();
+#pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < n_updated; i++)
+    ComputeTile(tiles[i], (tile_flags[i] & 1) != 0, (tile_flags[i] & 2) != 0);
+
+  for (int i = 0; i < n_updated; i++)
+  {
+    tile_ambient_occlusion_outdated[tiles[i]] = false;
+    tile_shadow_outdated[tiles[i]] = false;
+  }
+
+  update_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  return n_updated;
+}
+
+bool ExtinctionLightCache::BakeAmbientOcclusion (glm::ivec3 ao_resolution, float* ambient_occlusion)
+{
+  if (sat == nullptr || ao_resolution.x <= 0 || ao_resolution.y <= 0 || ao_resolution.z <= 0)
+    return false;
+
+  glm::vec3 cell_size = volume_scales * (glm::vec3(volume_dimensions) / glm::vec3(ao_resolution));
+
+  int n_rows = ao_resolution.y * ao_resolution.z;
+#pragma omp parallel for schedule(dynamic)
+  for (int r = 0; r < n_rows; r++)
+  {
+    int y = r % ao_resolution.y;
+    int z = r / ao_resolution.y;
+    float* row = ambient_occlusion + size_t(r) * ao_resolution.x;
+    for (int x = 0; x < ao_resolution.x; x++)
+      row[x] = ExtinctionAmbientOcclusion((glm::vec3(x, y, z) + 0.5f) * cell_size);
+  }
+
+  return true;
+}
+
+glm::ivec3 ExtinctionLightCache::GetResolution ()
+{
+  return resolution;
+}
+
+const float* ExtinctionLightCache::GetData ()
+{
+  return light_cache.data();
+}
+
+int ExtinctionLightCache::GetNumberOfTiles ()
+{
+  return n_tiles.x * n_tiles.y * n_tiles.z;
+}
+
+double ExtinctionLightCache::GetUpdateTime ()
+{
+  return update_time;
+}
+
+float ExtinctionLightCache::ExtinctionAmbientOcclusion (glm::vec3 tex_pos)
+{
+  // Evaluate Sh0
+  float SAT_Sh0 = EvaluateSAT3D(tex_pos - ambient_occlusion_radius * volume_scales,
+                                tex_pos + ambient_occlusion_radius * volume_scales);
+
+  float rsh0 = ambient_occlusion_radius;
+  float tSh0 = SAT_Sh0 * (1.0f / (rsh0 * rsh0));
+
+  // Evaluate Shi
+  float SAT_Shi = SAT_Sh0;
+  float tshi = tSh0;
+  for (int ith_shell = 1; ith_shell < ambient_occlusion_shells; ith_shell++)
+  {
+    float rshi_1 = ambient_occlusion_radius * float(ith_shell + 1);
+
+    float SAT_Shi_1 = EvaluateSAT3D(tex_pos - rshi_1 * volume_scales,
+                                    tex_pos + rshi_1 * volume_scales);
+
+    tshi = tshi + (SAT_Shi_1 - SAT_Shi) * (1.0f / (rshi_1 * rshi_1));
+    SAT_Shi = SAT_Shi_1;
+  }
+
+  float rshi = ambient_occlusion_radius * float(ambient_occlusion_shells);
+
+  float W_A = 1.0f / (rshi * rshi);
+  float Stau = W_A * tshi;
+  return glm::exp(-Stau);
+}
+
+float ExtinctionLightCache::ExtinctionDirectionalShadows (glm::vec3 tex_pos, glm::vec3 cone_vec)
+{
+  glm::vec3 abscvec = glm::abs(cone_vec);
+
+  float Stau = 0.0f;
+  // Z AXIS
+  if (abscvec.z > abscvec.x && abscvec.z > abscvec.y)
+    Stau = ConeAxis(tex_pos, cone_vec, 2, 0, 1);
+  // Y AXIS
+  else if (abscvec.y > abscvec.x)
+    Stau = ConeAxis(tex_pos, cone_vec, 1, 0, 2);
+  // X AXIS
+  else
+    Stau = ConeAxis(tex_pos, cone_vec, 0, 1, 2);
+
+  return glm::exp(-Stau);
+}
+
+float ExtinctionLightCache::ConeAxis (glm::vec3 pos, glm::vec3 cone_vec, int m, int a1, int a2)
+{
+  float Stau = 0.0f;
+
+  glm::vec3 volume_scaled_sizes = glm::vec3(volume_dimensions) * volume_scales;
+  glm::vec3 min_vol_position = volume_scales * 0.5f;
+  glm::vec3 max_vol_position = volume_scaled_sizes - volume_scales * 0.5f;
+
+  // Check the direction of the axis (positive or negative)
+  float signal = 1.0f;
+  if (cone_vec[m] < 0.0f) signal = -1.0f;
+
+  // Projected vectors into the secondary planes, as [secondary axis, main axis]
+  glm::vec2 proj_1 = glm::normalize(glm::vec2(cone_vec[a1], cone_vec[m]));
+  glm::vec2 proj_2 = glm::normalize(glm::vec2(cone_vec[a2], cone_vec[m]));
+
+  // cos and sin of cone aperture angle
+  float p_cs = glm::cos(dir_shadow_cone_angle);
+  float p_sn = glm::sin(dir_shadow_cone_angle);
+
+  float n_cs = glm::cos(-dir_shadow_cone_angle);
+  float n_sn = glm::sin(-dir_shadow_cone_angle);
+
+  // projected vectors, rotated by the cone aperture angle in each plane
+  glm::vec2 pj_11 = glm::normalize(glm::vec2(proj_1.x * n_cs - proj_1.y * n_sn, proj_1.x * n_sn + proj_1.y * n_cs));
+  glm::vec2 pj_12 = glm::normalize(glm::vec2(proj_1.x * p_cs - proj_1.y * p_sn, proj_1.x * p_sn + proj_1.y * p_cs));
+
+  glm::vec2 pj_21 = glm::normalize(glm::vec2(proj_2.x * n_cs - proj_2.y * n_sn, proj_2.x * n_sn + proj_2.y * n_cs));
+  glm::vec2 pj_22 = glm::normalize(glm::vec2(proj_2.x * p_cs - proj_2.y * p_sn, proj_2.x * p_sn + proj_2.y * p_cs));
+
+  // step for each cone sample = number of voxels to step * signal * voxel scale
+  float sample_interval = dir_shadow_sample_interval * signal * volume_scales[m];
+  // number of voxels to step * signal * voxel scale
+  float m_pos = dir_shadow_initial_step * signal * volume_scales[m];
+
+  while ((m_pos / cone_vec[m]) < dir_cone_max_distance
+    && (pos[m] + (m_pos + sample_interval) > min_vol_position[m] &&
+        pos[m] + (m_pos + sample_interval) < max_vol_position[m]))
+  {
+    float m_mean = glm::abs(m_pos + sample_interval * 0.5f);
+
+    float p_11 = pj_11.x * (m_mean / glm::abs(pj_11.y));
+    float p_12 = pj_12.x * (m_mean / glm::abs(pj_12.y));
+
+    float p_21 = pj_21.x * (m_mean / glm::abs(pj_21.y));
+    float p_22 = pj_22.x * (m_mean / glm::abs(pj_22.y));
+
+    float s1_0 = glm::min(p_11, p_12); float s1_1 = glm::max(p_11, p_12);
+    float s2_0 = glm::min(p_21, p_22); float s2_1 = glm::max(p_21, p_22);
+
+    // Get the interval, compute the ceil, than subtract by the current interval that
+    //   we have before. Then, we will know how much we need to add on each direction.
+    float s1diff = glm::abs(s1_1 - s1_0) / volume_scales[a1];
+    float s2diff = glm::abs(s2_1 - s2_0) / volume_scales[a2];
+    float s1s = (glm::ceil(s1diff) - s1diff) * 0.5f;
+    float s2s = (glm::ceil(s2diff) - s2diff) * 0.5f;
+
+    // add the differences on each direction
+    s1_0 = s1_0 - s1s * volume_scales[a1];  s1_1 = s1_1 + s1s * volume_scales[a1];
+    s2_0 = s2_0 - s2s * volume_scales[a2];  s2_1 = s2_1 + s2s * volume_scales[a2];
+
+    glm::vec3 p1, p2;
+    p1[m] = glm::min(m_pos, m_pos + sample_interval);
+    p2[m] = glm::max(m_pos, m_pos + sample_interval);
+    p1[a1] = s1_0; p2[a1] = s1_1;
+    p1[a2] = s2_0; p2[a2] = s2_1;
+
+    Stau += EvaluateShadowSAT3D(pos + p1, pos + p2);
+
+    m_pos = m_pos + sample_interval;
+  }
+
+  return Stau;
+}
+
+float ExtinctionLightCache::EvaluateSAT3D (glm::vec3 p1, glm::vec3 p2)
+{
+  // offset based on the added border
+  glm::vec3 volume_scaled_sizes = glm::vec3(volume_dimensions) * volume_scales;
+  glm::vec3 min_sat_position = sat_cell_scales * 0.5f;
+  glm::vec3 max_sat_position = volume_scaled_sizes + sat_cell_scales * 1.5f;
+  p1 = glm::clamp(p1 + sat_cell_scales, min_sat_position, max_sat_position);
+  p2 = glm::clamp(p2 + sat_cell_scales, min_sat_position, max_sat_position);
+
+  // Same as the linear filtered SAT texture: texel coordinates + 0.5
+  glm::vec3 x1 = p1 / sat_cell_scales + 0.5f;
+  glm::vec3 x2 = p2 / sat_cell_scales + 0.5f;
+  return sat->QueryFractional(x1.x, x1.y, x1.z, x2.x, x2.y, x2.z);
+}
+
+float ExtinctionLightCache::EvaluateShadowSAT3D (glm::vec3 p1, glm::vec3 p2)
+{
+  // Compute the query size
+  float volquery = (glm::abs(p1.x - p2.x) / volume_scales.x)
+                 * (glm::abs(p1.y - p2.y) / volume_scales.y)
+                 * (glm::abs(p1.z - p2.z) / volume_scales.z);
+
+  // return the normalized result
+  return (EvaluateSAT3D(p1, p2) / volquery) * dir_shadow_user_interface_weight;
+}
+
+glm::vec3 ExtinctionLightCache::GetCellPosition (int x, int y, int z)
+{
+  return (glm::vec3(x, y, z) + 0.5f) * (volume_scales * (glm::vec3(volume_dimensions) / glm::vec3(resolution)));
+}
+
+glm::vec3 ExtinctionLightCache::GetLightDirection (glm::vec3 tex_pos)
+{
+  if (type_of_shadow == 0)
+    return glm::normalize(light_pos - (tex_pos - glm::vec3(volume_dimensions) * volume_scales * 0.5f));
+  return glm::normalize(light_forward);
+}
+
+void ExtinctionLightCache::ComputeTile (int tile, bool ambient_occlusion, bool shadow)
+{
+  glm::ivec3 t(tile % n_tiles.x, (tile / n_tiles.x) % n_tiles.y, tile / (n_tiles.x * n_tiles.y));
+  glm::ivec3 c0 = t * EXTINCTION_LIGHT_CACHE_TILE_SIZE;
+  glm::ivec3 c1 = glm::min(c0 + EXTINCTION_LIGHT_CACHE_TILE_SIZE, resolution);
+
+  if (shadow)
+  {
+    glm::vec3 tile_center = (GetCellPosition(c0.x, c0.y, c0.z) + GetCellPosition(c1.x - 1, c1.y - 1, c1.z - 1)) * 0.5f;
+    tile_light_direction[tile] = GetLightDirection(tile_center);
+    tile_skipped_updates[tile] = 0;
+  }
+
+  for (int z = c0.z; z < c1.z; z++)
+  {
+    for (int y = c0.y; y < c1.y; y++)
+    {
+      for (int x = c0.x; x < c1.x; x++)
+      {
+        float* cell = light_cache.data() + (x + size_t(y) * resolution.x + size_t(z) * resolution.x * resolution.y) * 2;
+        glm::vec3 tex_pos = GetCellPosition(x, y, z);
+
+        if (ambient_occlusion)
+          cell[0] = apply_ambient_occlusion ? ExtinctionAmbientOcclusion(tex_pos) : 1.0f;
+        if (shadow)
+          cell[1] = apply_directional_shadows ? ExtinctionDirectionalShadows(tex_pos, GetLightDirection(tex_pos)) : 1.0f;
+      }
+    }
+  }
+}
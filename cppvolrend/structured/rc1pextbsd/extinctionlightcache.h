@@ -0,0 +1,122 @@
+/**
+ * CPU computation of the light cache of the Extinction-based Shading.
+ *
+ * Same evaluation of lightcachecomputation.comp (ambient occlusion shells
+ *   and directional cone shadows, both queried in the extinction SAT), over
+ *   tiles of 8x8x8 cells computed in parallel. Does not depend on OpenGL:
+ *   caches can be precomputed without a context and uploaded later.
+ *
+ * Update recomputes only the outdated tiles:
+ * . SAT, volume or resolution changed: everything
+ * . Ambient occlusion parameters: ambient occlusion of all tiles
+ * . Shadow parameters: shadows of all tiles
+ * . Light moved: shadows of the tiles where the light direction (at the tile
+ *   center) changed more than the light tolerance since their last update,
+ *   or changed by less during EXTINCTION_LIGHT_CACHE_MAX_SKIPPED_UPDATES
+ *   updates (so small movements are not kept stale after the light stops)
+ *
+ * BakeAmbientOcclusion evaluates only the ambient occlusion, at any
+ *   resolution: it is view and light independent, so the image space mode
+ *   fetches it instead of querying all shells at each sample.
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#ifndef EXTINCTION_BASED_SHADING_CPU_LIGHT_CACHE_H
+#define EXTINCTION_BASED_SHADING_CPU_LIGHT_CACHE_H
+
+#include <vis_utils/summedareatable.h>
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#define EXTINCTION_LIGHT_CACHE_TILE_SIZE 8
+// Max updates that skip a tile whose light direction changed within the tolerance
+#define EXTINCTION_LIGHT_CACHE_MAX_SKIPPED_UPDATES 8
+
+class ExtinctionLightCache
+{
+public:
+  ExtinctionLightCache ();
+  ~ExtinctionLightCache ();
+
+  // Extinction SAT (not owned) with a 1-cell border and sums in voxel units,
+  //  as vis::ComputeExtinctionSAT (with its offset set), and the size of its cells
+  void SetSummedAreaTable (vis::SummedAreaTable3D<float>* sat, glm::vec3 cell_scales);
+  void SetVolume (glm::ivec3 dimensions, glm::vec3 scales);
+  void SetResolution (glm::ivec3 resolution);
+
+  void SetAmbientOcclusion (bool apply, int shells, float radius);
+  // cone_angle in radians
+  void SetDirectionalShadows (bool apply, float cone_angle, float sample_interval, float initial_step,
+                              float user_interface_weight, float cone_max_distance);
+  // type_of_shadow: 0 - point light at light_pos, 1 - directional light along light_forward
+  void SetLight (int type_of_shadow, glm::vec3 light_pos, glm::vec3 light_forward);
+  // Change of the light direction (degrees) kept before recomputing shadows
+  void SetLightTolerance (float degrees);
+  float GetLightTolerance ();
+
+  void Invalidate ();
+
+  // Recompute the outdated tiles, returns the number of recomputed tiles
+  int Update ();
+
+  // Ambient occlusion of [ao_resolution] cells over the volume (same cell
+  //  positions of the light cache, x fastest), computed in parallel
+  bool BakeAmbientOcclusion (glm::ivec3 ao_resolution, float* ambient_occlusion);
+
+  glm::ivec3 GetResolution ();
+  // Ambient occlusion and shadow of each cell (RG, x fastest)
+  const float* GetData ();
+  int GetNumberOfTiles ();
+  // Time of the last Update, in milliseconds
+  double GetUpdateTime ();
+
+protected:
+  float ExtinctionAmbientOcclusion (glm::vec3 tex_pos);
+  float ExtinctionDirectionalShadows (glm::vec3 tex_pos, glm::vec3 cone_vec);
+  // Cone marching along the main axis "m" of cone_vec, with secondary axes a1 and a2
+  float ConeAxis (glm::vec3 pos, glm::vec3 cone_vec, int m, int a1, int a2);
+  float EvaluateSAT3D (glm::vec3 p1, glm::vec3 p2);
+  float EvaluateShadowSAT3D (glm::vec3 p1, glm::vec3 p2);
+
+  glm::vec3 GetCellPosition (int x, int y, int z);
+  glm::vec3 GetLightDirection (glm::vec3 tex_pos);
+  void ComputeTile (int tile, bool ambient_occlusion, bool shadow);
+
+private:
+  vis::SummedAreaTable3D<float>* sat;
+  glm::vec3 sat_cell_scales;
+  glm::ivec3 volume_dimensions;
+  glm::vec3 volume_scales;
+  glm::ivec3 resolution;
+
+  bool apply_ambient_occlusion;
+  int ambient_occlusion_shells;
+  float ambient_occlusion_radius;
+
+  bool apply_directional_shadows;
+  float dir_shadow_cone_angle;
+  float dir_shadow_sample_interval;
+  float dir_shadow_initial_step;
+  float dir_shadow_user_interface_weight;
+  float dir_cone_max_distance;
+
+  int type_of_shadow;
+  glm::vec3 light_pos;
+  glm::vec3 light_forward;
+  float light_tolerance;
+
+  std::vector<float> light_cache;
+  glm::ivec3 n_tiles;
+  std::vector<bool> tile_ambient_occlusion_outdated;
+  std::vector<bool> tile_shadow_outdated;
+  // Light direction at the tile center of the last shadow computation
+  std::vector<glm::vec3> tile_light_direction;
+  // Updates skipped since the light direction of the tile changed
+  std::vector<int> tile_skipped_updates;
+
+  double update_time;
+};
+
+#endif
@@ -1,5 +1,63 @@
 #include "preprocessingstages.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+// Integral from 0 to (i + f) of the piecewise constant "values" (n cells, zero
+//  outside), with "prefix_sums" of n + 1 values
+static double CellIntegral (const double* values, const double* prefix_sums, int n, int i, double f)
+{
+  if (i < 0) return 0.0;
+  if (i >= n) return prefix_sums[n];
+  return prefix_sums[i] + f * values[i];
+}
+
+static void ComputePrefixSums (const double* values, double* prefix_sums, int n)
+{
+  prefix_sums[0] = 0.0;
+  for (int i = 0; i < n; i++)
+    prefix_sums[i + 1] = prefix_sums[i] + values[i];
+}
+
+// Box filter of fractional width "b" (in cells), centered at each cell
+static void FractionalBoxFilter (const double* in, double* prefix_sums, double* out, int n, double b)
+{
+  ComputePrefixSums(in, prefix_sums, n);
+
+  double lo = 0.5 - 0.5 * b, hi = 0.5 + 0.5 * b;
+  int ilo = (int)glm::floor(lo), ihi = (int)glm::floor(hi);
+  double flo = lo - (double)ilo, fhi = hi - (double)ihi;
+  for (int x = 0; x < n; x++)
+    out[x] = (CellIntegral(in, prefix_sums, n, x + ihi, fhi) - CellIntegral(in, prefix_sums, n, x + ilo, flo)) / b;
+}
+
+// Variance of the discrete kernel of FractionalBoxFilter
+static double FractionalBoxVariance (double b)
+{
+  double h = 0.5 * b;
+  if (h <= 0.5) return 0.0;
+
+  // "f" fully covered cells at each side, and the coverage "p" of the next one
+  double f = glm::floor(h - 0.5);
+  double p = h - (f + 0.5);
+  return (f * (f + 1.0) * (2.0 * f + 1.0) / 3.0 + 2.0 * (f + 1.0) * (f + 1.0) * p) / b;
+}
+
+// Width of the box filter that, applied "n_passes" times, has variance stddev^2
+static double FractionalBoxWidth (double stddev, int n_passes)
+{
+  double variance = stddev * stddev / (double)n_passes;
+  double b0 = 1.0, b1 = glm::sqrt(12.0 * variance) + 3.0;
+  for (int it = 0; it < 64; it++)
+  {
+    double b = 0.5 * (b0 + b1);
+    if (FractionalBoxVariance(b) < variance) b0 = b;
+    else b1 = b;
+  }
+  return 0.5 * (b0 + b1);
+}
+
 VCTPreProcessing::VCTPreProcessing ()
 {
   use_glsl_to_precompute_data = false;
@@ -7,11 +65,122 @@ VCTPreProcessing::VCTPreProcessing ()
   glsl_supervoxel_meanstddev = nullptr;
   glsl_preintegration_lookup = nullptr;
 
+  maximum_standard_deviation = 0.0;
+  supervoxel_max_density = 255.0;
+  preintegration_max_density = 255.0;
+  preintegration_max_stddev = 1.0;
+
+  max_preintegration_table_width = 4096;
+  max_preintegration_table_height = 1024;
+
+  derived_data_cache = nullptr;
+
+  input_volume = nullptr;
+  input_transfer_function = nullptr;
+  preintegration_table_width = 0;
+  preintegration_table_height = 0;
+
   tree_spr_voxel.clear();
+
+  // Super voxels: normalized volume values
+  int node_supervoxels = graph.AddNode("Super Voxels", {},
+    [this] () -> unsigned long long {
+      if (input_volume == nullptr || input_volume->GetContentHash() == 0) return 0;
+      return vis::PreProcessingGraph::HashValue(supervoxel_max_density, input_volume->GetContentHash());
+    },
+    [this] () { return BuildSuperVoxels(); },
+    [this] () { DestroySuperVoxels(); },
+    [this] () {
+      size_t n = 0;
+      for (int i = 0; i < (int)tree_spr_voxel.size(); i++)
+        n += size_t(tree_spr_voxel[i]->dim.x) * tree_spr_voxel[i]->dim.y * tree_spr_voxel[i]->dim.z;
+      return n * sizeof(SuperVoxelLevel::SuperVoxel);
+    }, true);
+
+  // Mipmapped RG16F texture of the super voxels
+  graph.AddNode("Super Voxel Texture", { node_supervoxels }, nullptr,
+    [this] () { return UploadSuperVoxels(); },
+    [this] () { DestroySuperVoxelTexture(); },
+    [this] () {
+      size_t n = 0;
+      for (int i = 0; i < (int)tree_spr_voxel.size(); i++)
+        n += size_t(tree_spr_voxel[i]->dim.x) * tree_spr_voxel[i]->dim.y * tree_spr_voxel[i]->dim.z;
+      return n * 2 * sizeof(GLhalf);
+    });
+
+  // Preintegration table: transfer function opacity and super voxel max standard deviation
+  int node_preintegration_values = graph.AddNode("Pre Integration Table", { node_supervoxels },
+    [this] () -> unsigned long long {
+      // Hash 0: the transfer function cannot tell if its opacity changed
+      unsigned long long tf_hash = input_transfer_function ? input_transfer_function->GetExtinctionHash() : 0;
+      if (tf_hash == 0) return 0;
+      unsigned long long key = vis::PreProcessingGraph::HashValue(tf_hash);
+      key = vis::PreProcessingGraph::HashValue(max_preintegration_table_width, key);
+      return vis::PreProcessingGraph::HashValue(max_preintegration_table_height, key);
+    },
+    [this] () { return BuildPreIntegrationValues(); },
+    [this] () { DestroyPreIntegrationValues(); },
+    [this] () { return preintegration_values.size() * sizeof(float); }, true);
+
+  graph.AddNode("Pre Integration Texture", { node_preintegration_values }, nullptr,
+    [this] () { return UploadPreIntegrationTable(); },
+    [this] () { DestroyPreIntegrationTable(); },
+    [this] () { return size_t(preintegration_table_width) * preintegration_table_height * sizeof(GLhalf); });
 }
 
 VCTPreProcessing::~VCTPreProcessing()
 {
+  // Before the members used by the nodes are destroyed
+  graph.DestroyAll();
+}
+
+bool VCTPreProcessing::PreProcess (vis::StructuredGridVolume* vol, vis::TransferFunction* tf)
+{
+  input_volume = vol;
+  input_transfer_function = tf;
+  bool ret = graph.EvaluateAll();
+  if (graph.GetLastEvaluateBuilds() > 0)
+    graph.PrintReport();
+  return ret;
+}
+
+void VCTPreProcessing::DestroyOutdated (vis::StructuredGridVolume* vol, vis::TransferFunction* tf)
+{
+  input_volume = vol;
+  input_transfer_function = tf;
+  graph.DestroyOutdated();
+}
+
+vis::PreProcessingGraph* VCTPreProcessing::GetGraph ()
+{
+  return &graph;
+}
+
+void VCTPreProcessing::DestroySuperVoxels ()
+{
+  for (int i = 0; i < tree_spr_voxel.size(); i++)
+    delete tree_spr_voxel[i];
+  tree_spr_voxel.clear();
+}
+
+void VCTPreProcessing::DestroySuperVoxelTexture ()
+{
+  if (glsl_supervoxel_meanstddev != nullptr)
+    delete glsl_supervoxel_meanstddev;
+  glsl_supervoxel_meanstddev = nullptr;
+}
+
+void VCTPreProcessing::DestroyPreIntegrationValues ()
+{
+  preintegration_values.clear();
+  preintegration_values.shrink_to_fit();
+}
+
+void VCTPreProcessing::DestroyPreIntegrationTable ()
+{
+  if (glsl_preintegration_lookup != nullptr)
+    delete glsl_preintegration_lookup;
+  glsl_preintegration_lookup = nullptr;
 }
 
 double VCTPreProcessing::GetMeanFromSuperVoxel (int lvl, int lw, int lh, int ld, int vw, int vh, int vd)
@@ -32,8 +201,11 @@ double VCTPreProcessing::GetStdDevFromSuperVoxel (int lvl, int lw, int lh, int l
   return tree_spr_voxel[lvl]->sv_data[x + (y * vw) + (z * vw * vh)].stdv;
 }
 
-void VCTPreProcessing::PreProcessSuperVoxels (vis::StructuredGridVolume* vol)
+bool VCTPreProcessing::BuildSuperVoxels ()
 {
+  vis::StructuredGridVolume* vol = input_volume;
+  if (vol == nullptr) return false;
+
   if (use_glsl_to_precompute_data)
   {
     //glsl_supervoxel_meanstddev = GLSLPreComputeSuperVoxels();
@@ -44,14 +216,26 @@ void VCTPreProcessing::PreProcessSuperVoxels (vis::StructuredGridVolume* vol)
   int h = vol->GetHeight();
   int d = vol->GetDepth();
 
-  tree_spr_voxel.push_back(new SuperVoxelLevel(glm::ivec3(w, h, d)));
+  unsigned long long cache_key = 0;
+  if (derived_data_cache && derived_data_cache->IsEnabled() && vol->GetContentHash() != 0)
+  {
+    cache_key = vis::DerivedDataCache::GetKey("vct_super_voxels", 1,
+      vis::PreProcessingGraph::HashValue(supervoxel_max_density, vol->GetContentHash()));
+    if (LoadCachedSuperVoxels(cache_key))
+    {
+      printf("Super Voxels Read From The Derived Data Cache! Maximum Standard Deviation %g\n", maximum_standard_deviation);
+      return true;
+    }
+  }
+
+  AllocateSuperVoxelLevels(w, h, d);
   for (int x = 0; x < w; x++)
   {
     for (int y = 0; y < h; y++)
     {
       for (int z = 0; z < d; z++)
       {
-        tree_spr_voxel[0]->sv_data[x + (y * w) + (z * w * h)].mean = vol->GetNormalizedSample(x,y,z) * 255.0;
+        tree_spr_voxel[0]->sv_data[x + (y * w) + (z * w * h)].mean = vol->GetNormalizedSample(x,y,z) * supervoxel_max_density;
         tree_spr_voxel[0]->sv_data[x + (y * w) + (z * w * h)].stdv = 0.0;
       }
     }
@@ -68,8 +252,6 @@ void VCTPreProcessing::PreProcessSuperVoxels (vis::StructuredGridVolume* vol)
   d = d / 2;
   while (w * h * d >= 1)
   {
-    tree_spr_voxel.push_back(new SuperVoxelLevel(glm::ivec3(w, h, d)));
-
     for (int iw = 0; iw < w; iw++)
     {
       for (int ih = 0; ih < h; ih++)
@@ -119,7 +301,75 @@ void VCTPreProcessing::PreProcessSuperVoxels (vis::StructuredGridVolume* vol)
     d = d / 2;
   }
 
-  glsl_supervoxel_meanstddev = new gl::Texture3D(vol->GetWidth(), vol->GetHeight(), vol->GetDepth());
+  maximum_standard_deviation = max_stddev;
+  printf("Super Voxels Computed! Maximum Standard Deviation %g\n", max_stddev);
+
+  // Max standard deviation, then the levels from the finest
+  if (cache_key != 0)
+  {
+    std::vector<const void*> buffers(1, &maximum_standard_deviation);
+    std::vector<unsigned long long> sizes(1, sizeof(double));
+    for (int i = 0; i < (int)tree_spr_voxel.size(); i++)
+    {
+      buffers.push_back(tree_spr_voxel[i]->sv_data);
+      sizes.push_back((unsigned long long)tree_spr_voxel[i]->dim.x * tree_spr_voxel[i]->dim.y * tree_spr_voxel[i]->dim.z
+        * sizeof(SuperVoxelLevel::SuperVoxel));
+    }
+    derived_data_cache->Store("vct_super_voxels", cache_key, buffers, sizes);
+  }
+  return true;
+}
+
+void VCTPreProcessing::AllocateSuperVoxelLevels (int w, int h, int d)
+{
+  tree_spr_voxel.push_back(new SuperVoxelLevel(glm::ivec3(w, h, d)));
+  w = w / 2;
+  h = h / 2;
+  d = d / 2;
+  while (w * h * d >= 1)
+  {
+    tree_spr_voxel.push_back(new SuperVoxelLevel(glm::ivec3(w, h, d)));
+    w = w / 2;
+    h = h / 2;
+    d = d / 2;
+  }
+}
+
+bool VCTPreProcessing::LoadCachedSuperVoxels (unsigned long long cache_key)
+{
+  vis::DerivedDataCacheEntry entry;
+  if (!derived_data_cache->Load("vct_super_voxels", cache_key, &entry)) return false;
+
+  AllocateSuperVoxelLevels(input_volume->GetWidth(), input_volume->GetHeight(), input_volume->GetDepth());
+
+  unsigned long long size = sizeof(double);
+  for (int i = 0; i < (int)tree_spr_voxel.size(); i++)
+    size += (unsigned long long)tree_spr_voxel[i]->dim.x * tree_spr_voxel[i]->dim.y * tree_spr_voxel[i]->dim.z
+      * sizeof(SuperVoxelLevel::SuperVoxel);
+  if (entry.GetSize() != size)
+  {
+    DestroySuperVoxels();
+    return false;
+  }
+
+  const unsigned char* data = static_cast<const unsigned char*>(entry.GetData());
+  memcpy(&maximum_standard_deviation, data, sizeof(double));
+  data += sizeof(double);
+  for (int i = 0; i < (int)tree_spr_voxel.size(); i++)
+  {
+    size_t level_size = size_t(tree_spr_voxel[i]->dim.x) * tree_spr_voxel[i]->dim.y * tree_spr_voxel[i]->dim.z
+      * sizeof(SuperVoxelLevel::SuperVoxel);
+    memcpy(tree_spr_voxel[i]->sv_data, data, level_size);
+    data += level_size;
+  }
+  return true;
+}
+
+bool VCTPreProcessing::UploadSuperVoxels ()
+{
+  int mm_level = (int)tree_spr_voxel.size();
+
+  glsl_supervoxel_meanstddev = new gl::Texture3D(tree_spr_voxel[0]->dim.x, tree_spr_voxel[0]->dim.y, tree_spr_voxel[0]->dim.z);
   glsl_supervoxel_meanstddev->GenerateTexture(GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, true);
 
   // Set the data of each mipmap level to then update to glsl shader
@@ -140,8 +390,8 @@ void VCTPreProcessing::PreProcessSuperVoxels (vis::StructuredGridVolume* vol)
     delete[] sdata;
   }
 
-  maximum_standard_deviation = max_stddev;
-  printf("Super Voxels Computed! Maximum Standard Deviation %g\n", max_stddev);
+  gl::ExitOnGLError("ERROR: After UploadSuperVoxels");
+  return true;
 }
 
 double VCTPreProcessing::GaussianEvaluation (double x, double mean, double stddev)
@@ -172,33 +422,217 @@ double VCTPreProcessing::OpacityGaussianEvaluation (double mean, double stddev,
   return SumG;
 }
 
-void VCTPreProcessing::PreProcessPreIntegrationTable (vis::StructuredGridVolume* vol, vis::TransferFunction* tf)
+bool VCTPreProcessing::BuildPreIntegrationValues ()
 {
+  if (input_volume == nullptr || input_transfer_function == nullptr) return false;
+
   if (use_glsl_to_precompute_data)
   {
     //glsl_preintegration_lookup = GLSLPreComputePreIntegrationTable();
   }
 
+  int w, h;
+  GetPreIntegrationTableSize(input_volume, &w, &h);
+  preintegration_table_width = w;
+  preintegration_table_height = h;
+
+  preintegration_max_density = supervoxel_max_density;
+  preintegration_max_stddev = glm::max(glm::ceil(maximum_standard_deviation), 1.0);
+
+  // The table depends on the volume only through its max density and the
+  //  max standard deviation of the super voxels
+  unsigned long long cache_key = 0;
+  if (derived_data_cache && derived_data_cache->IsEnabled() && input_transfer_function->GetExtinctionHash() != 0)
+  {
+    double inputs[3] = { input_volume->GetMaxDensity(), maximum_standard_deviation, supervoxel_max_density };
+    int dims[2] = { w, h };
+    unsigned long long key = vis::PreProcessingGraph::HashValue(input_transfer_function->GetExtinctionHash());
+    key = vis::PreProcessingGraph::HashBytes(inputs, sizeof(inputs), key);
+    cache_key = vis::DerivedDataCache::GetKey("vct_preintegration_table", 1, vis::PreProcessingGraph::HashBytes(dims, sizeof(dims), key));
+    if (LoadCachedPreIntegrationValues(cache_key, w, h))
+    {
+      printf("Pre Integration Table Read From The Derived Data Cache! %d x %d\n", w, h);
+      return true;
+    }
+  }
+
+  preintegration_values.resize(size_t(w) * size_t(h));
+  BuildPreIntegrationTable(input_volume, input_transfer_function, w, h, preintegration_values.data());
+
+  printf("Pre Integration Table Computed! %d x %d\n", w, h);
+
+  if (cache_key != 0)
+    derived_data_cache->Store("vct_preintegration_table", cache_key, preintegration_values.data(),
+      preintegration_values.size() * sizeof(float));
+  return true;
+}
+
+bool VCTPreProcessing::LoadCachedPreIntegrationValues (unsigned long long cache_key, int table_w, int table_h)
+{
+  vis::DerivedDataCacheEntry entry;
+  if (!derived_data_cache->Load("vct_preintegration_table", cache_key, &entry)
+    || entry.GetSize() != size_t(table_w) * size_t(table_h) * sizeof(float))
+    return false;
+
+  const float* values = static_cast<const float*>(entry.GetData());
+  preintegration_values.assign(values, values + size_t(table_w) * size_t(table_h));
+  return true;
+}
+
+bool VCTPreProcessing::UploadPreIntegrationTable ()
+{
+  glsl_preintegration_lookup = new gl::Texture2D(preintegration_table_width, preintegration_table_height);
+  glsl_preintegration_lookup->GenerateTexture(GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+  glsl_preintegration_lookup->SetData(preintegration_values.data(), GL_R16F, GL_RED, GL_FLOAT);
+
+  gl::ExitOnGLError("ERROR: After SetData");
+  return true;
+}
+
+void VCTPreProcessing::GetPreIntegrationTableSize (vis::StructuredGridVolume* vol, int* table_w, int* table_h)
+{
+  int n_densities = (int)glm::ceil(vol->GetMaxDensity());
+  int n_stddevs = glm::max((int)glm::ceil(maximum_standard_deviation), 1);
+
+  *table_w = glm::min(n_densities, max_preintegration_table_width);
+  *table_h = glm::min(n_stddevs, max_preintegration_table_height);
+}
+
+void VCTPreProcessing::BuildPreIntegrationTable (vis::StructuredGridVolume* vol, vis::TransferFunction* tf,
+                                                 int table_w, int table_h, float* table, int n_box_passes)
+{
+  double dens_val = vol->GetMaxDensity();
+  int n_densities = (int)glm::ceil(dens_val);
+  int n_stddevs = glm::max((int)glm::ceil(maximum_standard_deviation), 1);
+
+  // Transfer function density units per super voxel unit (1 for 8-bit volumes)
+  double density_scale = dens_val / supervoxel_max_density;
+  // Density range of each column, in transfer function densities
+  double column_width = (double)n_densities / (double)table_w;
+
+  tf->GetOpc(0.0, dens_val);
+  double* opacity = new double[n_densities];
+  for (int i = 0; i < n_densities; i++)
+    opacity[i] = (double)tf->GetOpc(i, dens_val);
+
+#pragma omp parallel for schedule(dynamic)
+  for (int ih = 0; ih < table_h; ih++)
+  {
+    // Texel centers map to (ih + 0.5) * range / size - 0.5, as the shader lookup
+    double stddev = ((ih + 0.5) * (double)n_stddevs / (double)table_h - 0.5) * density_scale;
+
+    // Gaussian-weighted mean of the opacity, normalized by the sum of the
+    //  weights inside [0, n_densities): both are filtered with zero padding
+    double b = 0.0;
+    int pad = 0;
+    if (stddev > 0.0001)
+    {
+      b = FractionalBoxWidth(stddev, n_box_passes);
+      pad = n_box_passes * ((int)glm::ceil(0.5 * b) + 1) + 1;
+    }
+    int n = n_densities + 2 * pad;
+
+    double* num = new double[n];
+    double* den = new double[n];
+    double* tmp = new double[n];
+    double* prefix_sums = new double[n + 1];
+
+    std::fill(num, num + n, 0.0);
+    std::fill(den, den + n, 0.0);
+    std::copy(opacity, opacity + n_densities, num + pad);
+    std::fill(den + pad, den + pad + n_densities, 1.0);
+
+    if (pad > 0)
+    {
+      for (int p = 0; p < n_box_passes; p++)
+      {
+        FractionalBoxFilter(num, prefix_sums, tmp, n, b);
+        std::swap(num, tmp);
+        FractionalBoxFilter(den, prefix_sums, tmp, n, b);
+        std::swap(den, tmp);
+      }
+    }
+
+    double* row = tmp;
+    for (int i = 0; i < n_densities; i++)
+      row[i] = num[pad + i] / den[pad + i];
+
+    float* out = table + size_t(ih) * table_w;
+    if (table_w == n_densities)
+    {
+      for (int iw = 0; iw < table_w; iw++)
+        out[iw] = (float)row[iw];
+    }
+    else
+    {
+      // Reduced table: mean of the filtered opacity in the range of each column
+      ComputePrefixSums(row, prefix_sums, n_densities);
+      for (int iw = 0; iw < table_w; iw++)
+      {
+        double center = ((iw + 0.5) * supervoxel_max_density / (double)table_w - 0.5) * density_scale + 0.5;
+        double lo = glm::clamp(center - 0.5 * column_width, 0.0, (double)n_densities);
+        double hi = glm::clamp(center + 0.5 * column_width, 0.0, (double)n_densities);
+        int ilo = (int)glm::floor(lo), ihi = (int)glm::floor(hi);
+        out[iw] = (hi > lo) ? (float)((CellIntegral(row, prefix_sums, n_densities, ihi, hi - ihi)
+                                     - CellIntegral(row, prefix_sums, n_densities, ilo, lo - ilo)) / (hi - lo))
+                            : (float)row[glm::min(ilo, n_densities - 1)];
+      }
+    }
+
+    delete[] num;
+    delete[] den;
+    delete[] tmp;
+    delete[] prefix_sums;
+  }
+
+  delete[] opacity;
+}
+
+void VCTPreProcessing::BuildPreIntegrationTableReference (vis::StructuredGridVolume* vol, vis::TransferFunction* tf, float* table)
+{
   double dens_val = vol->GetMaxDensity();
   int w = glm::ceil(dens_val);
-  int h = glm::ceil(maximum_standard_deviation);
+  int h = glm::max((int)glm::ceil(maximum_standard_deviation), 1);
 
-  GLfloat* preintegrationvalues = new GLfloat[w * h];
   for (int iw = 0; iw < w; iw++)
   {
     for (int ih = 0; ih < h; ih++)
     {
-      preintegrationvalues[iw + (ih * w)] = (float)OpacityGaussianEvaluation(iw, ih, vol, tf);
+      table[iw + (ih * w)] = (float)OpacityGaussianEvaluation(iw, ih, vol, tf);
     }
   }
+}
 
-  glsl_preintegration_lookup = new gl::Texture2D(w, h);
-  glsl_preintegration_lookup->GenerateTexture(GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
-  glsl_preintegration_lookup->SetData(preintegrationvalues, GL_R16F, GL_RED, GL_FLOAT);
+double VCTPreProcessing::ComparePreIntegrationTableWithReference (vis::StructuredGridVolume* vol, vis::TransferFunction* tf)
+{
+  int w, h;
+  GetPreIntegrationTableSize(vol, &w, &h);
+  if (w != (int)glm::ceil(vol->GetMaxDensity()) || h != glm::max((int)glm::ceil(maximum_standard_deviation), 1))
+  {
+    printf("Pre Integration Table: reduced table, no reference to compare\n");
+    return -1.0;
+  }
 
-  delete[] preintegrationvalues;
+  float* table = new float[w * h];
+  float* reference = new float[w * h];
 
-  gl::ExitOnGLError("ERROR: After SetData");
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  BuildPreIntegrationTable(vol, tf, w, h, table);
+  std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+  BuildPreIntegrationTableReference(vol, tf, reference);
+  std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+  double max_error = 0.0;
+  for (int i = 0; i < w * h; i++)
+    max_error = glm::max(max_error, (double)glm::abs(table[i] - reference[i]));
+
+  printf("Pre Integration Table %d x %d: prefix sums %.2f ms, reference %.2f ms, max error %g\n", w, h,
+    std::chrono::duration<double, std::milli>(t1 - t0).count(),
+    std::chrono::duration<double, std::milli>(t2 - t1).count(), max_error);
+
+  delete[] table;
+  delete[] reference;
+  return max_error;
 }
 
 gl::Texture3D* VCTPreProcessing::GLSLPreComputeSuperVoxels ()
@@ -20,6 +20,8 @@
 #include <volvis_utils/reader.h>
 #include <volvis_utils/utils.h>
 #include <volvis_utils/structuredgridvolume.h>
+#include <volvis_utils/preprocessinggraph.h>
+#include <volvis_utils/deriveddatacache.h>
 
 #include <gl_utils/arrayobject.h>
 #include <gl_utils/bufferobject.h>
@@ -40,28 +42,39 @@ public:
 
   void Destroy()
   {
-    if (glsl_supervoxel_meanstddev != nullptr)
-      delete glsl_supervoxel_meanstddev;
-    glsl_supervoxel_meanstddev = nullptr;
-
-    if (glsl_preintegration_lookup != nullptr)
-      delete glsl_preintegration_lookup;
-    glsl_preintegration_lookup = nullptr;
-
-    for (int i = 0; i < tree_spr_voxel.size(); i++)
-      delete tree_spr_voxel[i];
-    tree_spr_voxel.clear();
+    graph.DestroyAll();
   }
 
+  // Pre processing graph:
+  //  super voxels (volume) --> super voxel texture
+  //                        \-> preintegration table (transfer function opacity) --> preintegration texture
+  // Rebuilds only the nodes whose inputs changed for "vol" and "tf"
+  bool PreProcess (vis::StructuredGridVolume* vol, vis::TransferFunction* tf);
+  // Destroy only the data that must be recomputed for "vol" and "tf"
+  void DestroyOutdated (vis::StructuredGridVolume* vol, vis::TransferFunction* tf);
+  vis::PreProcessingGraph* GetGraph ();
+
   double GetMeanFromSuperVoxel (int lvl, int lw, int lh, int ld, int vw, int vh, int vd);
   double GetStdDevFromSuperVoxel (int lvl, int lw, int lh, int ld, int vw, int vh, int vd);
 
-  void PreProcessSuperVoxels (vis::StructuredGridVolume* vol);
-
   double GaussianEvaluation (double x, double mean, double stddev);
   double OpacityGaussianEvaluation (double mean, double stddev, vis::StructuredGridVolume* vol, vis::TransferFunction* tf);
 
-  void PreProcessPreIntegrationTable (vis::StructuredGridVolume* vol, vis::TransferFunction* tf);
+  // Preintegration table from prefix sums of the transfer function opacity:
+  //  each row is the opacity filtered by "n_box_passes" box filters (fractional
+  //  width, same variance of the Gaussian), in O(max density) per row, and
+  //  rows are computed in parallel.
+  // . table_w x table_h entries, smaller than max density x max std dev for
+  //   reduced tables (16-bit): each column averages the filtered opacity of
+  //   its density range
+  void BuildPreIntegrationTable (vis::StructuredGridVolume* vol, vis::TransferFunction* tf,
+                                 int table_w, int table_h, float* table, int n_box_passes = 3);
+  // Same table with OpacityGaussianEvaluation (full tables only)
+  void BuildPreIntegrationTableReference (vis::StructuredGridVolume* vol, vis::TransferFunction* tf, float* table);
+  // Max absolute difference between both builders, -1 for reduced tables
+  double ComparePreIntegrationTableWithReference (vis::StructuredGridVolume* vol, vis::TransferFunction* tf);
+
+  void GetPreIntegrationTableSize (vis::StructuredGridVolume* vol, int* table_w, int* table_h);
 
   bool use_glsl_to_precompute_data;
   gl::Texture3D* glsl_supervoxel_meanstddev;
@@ -69,6 +82,22 @@ public:
 
   double maximum_standard_deviation;
 
+  // Super voxel means are normalized values * supervoxel_max_density
+  double supervoxel_max_density;
+
+  // Density and standard deviation ranges of the preintegration table lookup:
+  //  texture coordinates are (value + 0.5) / range
+  double preintegration_max_density;
+  double preintegration_max_stddev;
+
+  // Table sizes above these are reduced (16-bit volumes)
+  int max_preintegration_table_width;
+  int max_preintegration_table_height;
+
+  // If not null, super voxels and preintegration tables computed at previous
+  //  runs are read from it
+  vis::DerivedDataCache* derived_data_cache;
+
   class SuperVoxelLevel
   {
   public:
@@ -98,6 +127,28 @@ public:
   std::vector<SuperVoxelLevel*> tree_spr_voxel;
 
 protected:
+  // Graph nodes
+  bool BuildSuperVoxels ();
+  bool UploadSuperVoxels ();
+  bool BuildPreIntegrationValues ();
+  bool UploadPreIntegrationTable ();
+  void DestroySuperVoxels ();
+  void DestroySuperVoxelTexture ();
+  void DestroyPreIntegrationValues ();
+  void DestroyPreIntegrationTable ();
+
+  // Super voxel levels from the level 0 dimensions, without values
+  void AllocateSuperVoxelLevels (int w, int h, int d);
+  bool LoadCachedSuperVoxels (unsigned long long cache_key);
+  bool LoadCachedPreIntegrationValues (unsigned long long cache_key, int table_w, int table_h);
+
+  vis::PreProcessingGraph graph;
+  vis::StructuredGridVolume* input_volume;
+  vis::TransferFunction* input_transfer_function;
+
+  std::vector<float> preintegration_values;
+  int preintegration_table_width;
+  int preintegration_table_height;
 
 private:
   gl::Texture3D* GLSLPreComputeSuperVoxels();
@@ -29,6 +29,7 @@ RC1PVoxelConeTracingSGPU::RC1PVoxelConeTracingSGPU ()
   , cp_shader_rendering(nullptr)
   , m_u_step_size(0.5f)
   , m_apply_gradient_shading(false)
+  , m_keep_up_to_date_pre_processing(false)
 {
   apply_ambient_occlusion      = true;
 
@@ -60,7 +61,7 @@ RC1PVoxelConeTracingSGPU::~RC1PVoxelConeTracingSGPU ()
 
 void RC1PVoxelConeTracingSGPU::Clean ()
 {
-  if (m_glsl_transfer_function) delete m_glsl_transfer_function;
+  if (m_glsl_transfer_function) m_ext_data_manager->ReleaseDerivedResource(m_glsl_transfer_function);
   m_glsl_transfer_function = nullptr;
 
   m_pre_illum_str_vol.DestroyLightCacheTexture();
@@ -69,7 +70,10 @@ void RC1PVoxelConeTracingSGPU::Clean ()
     delete cp_lightcache_shader;
   cp_lightcache_shader = nullptr;
 
-  pre_processing.Destroy();
+  if (m_keep_up_to_date_pre_processing)
+    pre_processing.DestroyOutdated(m_ext_data_manager->GetCurrentStructuredVolume(), m_ext_data_manager->GetCurrentTransferFunction());
+  else
+    pre_processing.Destroy();
 
   DestroyRenderingShaders();
 
@@ -85,14 +89,21 @@ void RC1PVoxelConeTracingSGPU::ReloadShaders ()
 
 bool RC1PVoxelConeTracingSGPU::Init (int swidth, int sheight)
 {
-  if (IsBuilt()) Clean();
+  // Super voxels depend only on the volume, and the preintegration table on
+  //  the transfer function opacity: both are kept while still valid
+  if (IsBuilt())
+  {
+    m_keep_up_to_date_pre_processing = true;
+    Clean();
+    m_keep_up_to_date_pre_processing = false;
+  }
 
   if (m_ext_data_manager->GetCurrentVolumeTexture() == nullptr) return false;
-  m_glsl_transfer_function = m_ext_data_manager->GetCurrentTransferFunction()->GenerateTexture_1D_RGBt();
+  m_glsl_transfer_function = m_ext_data_manager->AcquireTransferFunctionTexture();
 
   // Pre Processing stage to compute supervoxels and preintegration table
-  pre_processing.PreProcessSuperVoxels(m_ext_data_manager->GetCurrentStructuredVolume());
-  pre_processing.PreProcessPreIntegrationTable(m_ext_data_manager->GetCurrentStructuredVolume(), m_ext_data_manager->GetCurrentTransferFunction());
+  pre_processing.derived_data_cache = m_ext_data_manager->GetDerivedDataCache();
+  pre_processing.PreProcess(m_ext_data_manager->GetCurrentStructuredVolume(), m_ext_data_manager->GetCurrentTransferFunction());
 
   m_pre_illum_str_vol.GenerateLightCacheTexture();
 
@@ -163,10 +174,10 @@ bool RC1PVoxelConeTracingSGPU::Update (vis::Camera* camera)
     cp_shader_rendering->SetUniform("ConeNumberOfSamples", cone_number_of_samples);
     cp_shader_rendering->BindUniform("ConeNumberOfSamples");
 
-    cp_shader_rendering->SetUniform("VolumeMaxDensity", (float)m_ext_data_manager->GetCurrentStructuredVolume()->GetMaxDensity());
+    cp_shader_rendering->SetUniform("VolumeMaxDensity", (float)pre_processing.preintegration_max_density);
     cp_shader_rendering->BindUniform("VolumeMaxDensity");
 
-    cp_shader_rendering->SetUniform("VolumeMaxStandardDeviation", (float)pre_processing.maximum_standard_deviation);
+    cp_shader_rendering->SetUniform("VolumeMaxStandardDeviation", (float)pre_processing.preintegration_max_stddev);
     cp_shader_rendering->BindUniform("VolumeMaxStandardDeviation");
   }
 
@@ -385,6 +396,31 @@ void RC1PVoxelConeTracingSGPU::SetImGuiComponents ()
     SetOutdated();
   }
   ImGui::PopID();
+
+  ImGui::PushID("Pre Integration Table");
+  ImGui::Text("- Pre Integration Table");
+  if (pre_processing.glsl_preintegration_lookup)
+  {
+    ImGui::Text("%d x %d", (int)pre_processing.glsl_preintegration_lookup->GetWidth(),
+      (int)pre_processing.glsl_preintegration_lookup->GetHeight());
+  }
+  if (ImGui::Button("Compare with Numerical Integration"))
+  {
+    pre_processing.ComparePreIntegrationTableWithReference(m_ext_data_manager->GetCurrentStructuredVolume(),
+      m_ext_data_manager->GetCurrentTransferFunction());
+  }
+  ImGui::PopID();
+
+  ImGui::PushID("Pre Processing Graph");
+  ImGui::Text("- Pre Processing");
+  vis::PreProcessingGraph* graph = pre_processing.GetGraph();
+  for (int i = 0; i < graph->GetNumberOfNodes(); i++)
+  {
+    ImGui::Text("  %s: %.2f ms, %.1f MB (%d builds)", graph->GetNodeName(i).c_str(), graph->GetBuildTime(i),
+      double(graph->GetMemorySize(i)) / (1024.0 * 1024.0), graph->GetNumberOfBuilds(i));
+  }
+  ImGui::Text("  Last Update: %d builds, %.2f ms", graph->GetLastEvaluateBuilds(), graph->GetLastEvaluateTime());
+  ImGui::PopID();
 }
 
 /////////////////////////////////
@@ -481,10 +517,10 @@ void RC1PVoxelConeTracingSGPU::PreComputeLightCache (vis::Camera* camera)
   cp_lightcache_shader->SetUniform("ConeNumberOfSamples", cone_number_of_samples);
   cp_lightcache_shader->BindUniform("ConeNumberOfSamples");
 
-  cp_lightcache_shader->SetUniform("VolumeMaxDensity", (float)vol->GetMaxDensity());
+  cp_lightcache_shader->SetUniform("VolumeMaxDensity", (float)pre_processing.preintegration_max_density);
   cp_lightcache_shader->BindUniform("VolumeMaxDensity");
 
-  cp_lightcache_shader->SetUniform("VolumeMaxStandardDeviation", (float)pre_processing.maximum_standard_deviation);
+  cp_lightcache_shader->SetUniform("VolumeMaxStandardDeviation", (float)pre_processing.preintegration_max_stddev);
   cp_lightcache_shader->BindUniform("VolumeMaxStandardDeviation");
 
   // Upload light position
@@ -96,6 +96,8 @@ private:
   // Preprocessing class 
   // . Compute supervoxels and pre integration table
   VCTPreProcessing pre_processing;
+  // Clean keeps the pre processed data of the current volume/transfer function
+  bool m_keep_up_to_date_pre_processing;
 
   //////////////////////////////////////////
   // Lighting Parameters
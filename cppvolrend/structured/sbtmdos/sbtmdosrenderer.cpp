@@ -54,7 +54,7 @@ SBTMDirectionalOcclusionShading::~SBTMDirectionalOcclusionShading ()
 
 void SBTMDirectionalOcclusionShading::Clean ()
 {
-  if (m_glsl_transfer_function) delete m_glsl_transfer_function;
+  if (m_glsl_transfer_function) m_ext_data_manager->ReleaseDerivedResource(m_glsl_transfer_function);
   m_glsl_transfer_function = nullptr;
 
   if (ps_shader_rendering)
@@ -82,7 +82,7 @@ bool SBTMDirectionalOcclusionShading::Init (int swidth, int sheight)
   if (IsBuilt()) Clean();
 
   if (m_ext_data_manager->GetCurrentVolumeTexture() == nullptr) return false;
-  m_glsl_transfer_function = m_ext_data_manager->GetCurrentTransferFunction()->GenerateTexture_1D_RGBt();
+  m_glsl_transfer_function = m_ext_data_manager->AcquireTransferFunctionTexture();
 
   shader_width = swidth;
   shader_height = sheight;
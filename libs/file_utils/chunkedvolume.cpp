@@ -0,0 +1,516 @@
+#include "chunkedvolume.h"
+
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+#include <omp.h>
+
+#define CVOL_VERSION (1)
+#define CVOL_HEADER_SIZE (4 + 4 + 3 * 4 + 4 + 4 + 3 * 8 + 4)
+#define CVOL_INDEX_ENTRY_SIZE (8 + 4 + 4)
+#define CVOL_BITPACK_GROUP (64)
+
+// Values are stored in memory using the host byte order (little endian)
+static inline uint32_t LoadValue (const unsigned char* p, unsigned int bytes_per_voxel)
+{
+  uint32_t v = 0;
+  for (unsigned int b = 0; b < bytes_per_voxel; b++)
+    v |= uint32_t(p[b]) << (8 * b);
+  return v;
+}
+
+static inline void StoreValue (unsigned char* p, uint32_t v, unsigned int bytes_per_voxel)
+{
+  for (unsigned int b = 0; b < bytes_per_voxel; b++)
+    p[b] = (unsigned char)((v >> (8 * b)) & 0xFF);
+}
+
+static inline void WriteVarint (std::vector<unsigned char>& out, uint64_t v)
+{
+  while (v >= 0x80)
+  {
+    out.push_back((unsigned char)(v & 0x7F) | 0x80);
+    v >>= 7;
+  }
+  out.push_back((unsigned char)v);
+}
+
+static inline bool ReadVarint (const unsigned char* in, size_t n_bytes, size_t* pos, uint64_t* v)
+{
+  *v = 0;
+  for (unsigned int shift = 0; shift < 64; shift += 7)
+  {
+    if (*pos >= n_bytes) return false;
+    unsigned char b = in[(*pos)++];
+    *v |= uint64_t(b & 0x7F) << shift;
+    if ((b & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+template<typename T>
+static inline void WriteField (std::ofstream& f, T v)
+{
+  f.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template<typename T>
+static inline bool ReadField (std::ifstream& f, T* v)
+{
+  return (bool)f.read(reinterpret_cast<char*>(v), sizeof(T));
+}
+
+ChunkedVolumeFile::ChunkedVolumeFile ()
+  : m_width(0), m_height(0), m_depth(0)
+  , m_bytes_per_voxel(0)
+  , m_chunk_size(0)
+  , m_scalex(1.0), m_scaley(1.0), m_scalez(1.0)
+  , m_nchunks_x(0), m_nchunks_y(0), m_nchunks_z(0)
+{
+}
+
+ChunkedVolumeFile::~ChunkedVolumeFile ()
+{
+  Close();
+}
+
+bool ChunkedVolumeFile::Write (const char* file_name, const void* data,
+                               unsigned int width, unsigned int height, unsigned int depth,
+                               unsigned int bytes_per_voxel,
+                               double scalex, double scaley, double scalez,
+                               unsigned int chunk_size)
+{
+  if (data == NULL || width == 0 || height == 0 || depth == 0 || chunk_size == 0 ||
+     (bytes_per_voxel != 1 && bytes_per_voxel != 2 && bytes_per_voxel != 4))
+  {
+    std::cout << "ChunkedVolumeFile: invalid volume to write" << std::endl;
+    return false;
+  }
+
+  unsigned int ncx = (width  + chunk_size - 1) / chunk_size;
+  unsigned int ncy = (height + chunk_size - 1) / chunk_size;
+  unsigned int ncz = (depth  + chunk_size - 1) / chunk_size;
+  int n_chunks = int(ncx * ncy * ncz);
+
+  const unsigned char* in_data = static_cast<const unsigned char*>(data);
+  std::vector<std::vector<unsigned char>> encoded(n_chunks);
+  std::vector<uint32_t> codecs(n_chunks);
+
+  // Encode chunks in parallel
+#pragma omp parallel for schedule(dynamic)
+  for (int c = 0; c < n_chunks; c++)
+  {
+    unsigned int cx = c % ncx, cy = (c / ncx) % ncy, cz = c / (ncx * ncy);
+    unsigned int x0 = cx * chunk_size, y0 = cy * chunk_size, z0 = cz * chunk_size;
+    unsigned int cw = std::min(chunk_size, width - x0);
+    unsigned int ch = std::min(chunk_size, height - y0);
+    unsigned int cd = std::min(chunk_size, depth - z0);
+
+    std::vector<unsigned char> chunk_data(size_t(cw) * ch * cd * bytes_per_voxel);
+    for (unsigned int z = 0; z < cd; z++)
+    {
+      for (unsigned int y = 0; y < ch; y++)
+      {
+        size_t src = (size_t(x0) + size_t(y0 + y) * width + size_t(z0 + z) * width * height) * bytes_per_voxel;
+        size_t dst = (size_t(y) * cw + size_t(z) * cw * ch) * bytes_per_voxel;
+        memcpy(&chunk_data[dst], &in_data[src], size_t(cw) * bytes_per_voxel);
+      }
+    }
+
+    EncodeChunk(chunk_data.data(), size_t(cw) * ch * cd, bytes_per_voxel, encoded[c], &codecs[c]);
+  }
+
+  std::ofstream f(file_name, std::ios::out | std::ios::binary);
+  if (!f.is_open())
+  {
+    std::cout << "ChunkedVolumeFile: opening .cvol file failed" << std::endl;
+    return false;
+  }
+
+  f.write("CVOL", 4);
+  WriteField<uint32_t>(f, CVOL_VERSION);
+  WriteField<uint32_t>(f, width);
+  WriteField<uint32_t>(f, height);
+  WriteField<uint32_t>(f, depth);
+  WriteField<uint32_t>(f, bytes_per_voxel);
+  WriteField<uint32_t>(f, chunk_size);
+  WriteField<double>(f, scalex);
+  WriteField<double>(f, scaley);
+  WriteField<double>(f, scalez);
+  WriteField<uint32_t>(f, uint32_t(n_chunks));
+
+  uint64_t offset = CVOL_HEADER_SIZE + uint64_t(n_chunks) * CVOL_INDEX_ENTRY_SIZE;
+  for (int c = 0; c < n_chunks; c++)
+  {
+    WriteField<uint64_t>(f, offset);
+    WriteField<uint32_t>(f, uint32_t(encoded[c].size()));
+    WriteField<uint32_t>(f, codecs[c]);
+    offset += encoded[c].size();
+  }
+
+  for (int c = 0; c < n_chunks; c++)
+    f.write(reinterpret_cast<const char*>(encoded[c].data()), std::streamsize(encoded[c].size()));
+
+  bool ok = f.good();
+  f.close();
+
+  if (!ok) std::cout << "ChunkedVolumeFile: writing .cvol file failed" << std::endl;
+  return ok;
+}
+
+bool ChunkedVolumeFile::Open (const char* file_name)
+{
+  Close();
+
+  m_file.open(file_name, std::ios::in | std::ios::binary);
+  if (!m_file.is_open())
+  {
+    std::cout << "ChunkedVolumeFile: opening .cvol file failed" << std::endl;
+    return false;
+  }
+
+  char magic[4];
+  uint32_t version = 0, n_chunks = 0;
+  bool ok = (bool)m_file.read(magic, 4) && memcmp(magic, "CVOL", 4) == 0;
+  ok = ok && ReadField(m_file, &version) && version == CVOL_VERSION;
+  ok = ok && ReadField(m_file, &m_width) && ReadField(m_file, &m_height) && ReadField(m_file, &m_depth);
+  ok = ok && ReadField(m_file, &m_bytes_per_voxel) && ReadField(m_file, &m_chunk_size);
+  ok = ok && ReadField(m_file, &m_scalex) && ReadField(m_file, &m_scaley) && ReadField(m_file, &m_scalez);
+  ok = ok && ReadField(m_file, &n_chunks);
+  ok = ok && m_chunk_size > 0 && (m_bytes_per_voxel == 1 || m_bytes_per_voxel == 2 || m_bytes_per_voxel == 4);
+
+  if (ok)
+  {
+    m_nchunks_x = (m_width  + m_chunk_size - 1) / m_chunk_size;
+    m_nchunks_y = (m_height + m_chunk_size - 1) / m_chunk_size;
+    m_nchunks_z = (m_depth  + m_chunk_size - 1) / m_chunk_size;
+    ok = (n_chunks == m_nchunks_x * m_nchunks_y * m_nchunks_z);
+  }
+
+  if (ok)
+  {
+    m_index.resize(n_chunks);
+    for (uint32_t c = 0; c < n_chunks && ok; c++)
+    {
+      ok = ReadField(m_file, &m_index[c].offset)
+        && ReadField(m_file, &m_index[c].size)
+        && ReadField(m_file, &m_index[c].codec);
+    }
+  }
+
+  if (!ok)
+  {
+    std::cout << "ChunkedVolumeFile: invalid .cvol header" << std::endl;
+    Close();
+  }
+  return ok;
+}
+
+void ChunkedVolumeFile::Close ()
+{
+  if (m_file.is_open()) m_file.close();
+  m_index.clear();
+  m_width = m_height = m_depth = 0;
+  m_nchunks_x = m_nchunks_y = m_nchunks_z = 0;
+}
+
+bool ChunkedVolumeFile::IsOpen ()
+{
+  return m_file.is_open();
+}
+
+void ChunkedVolumeFile::GetDimensions (unsigned int* width, unsigned int* height, unsigned int* depth)
+{
+  *width = m_width;
+  *height = m_height;
+  *depth = m_depth;
+}
+
+void ChunkedVolumeFile::GetScale (double* sx, double* sy, double* sz)
+{
+  *sx = m_scalex;
+  *sy = m_scaley;
+  *sz = m_scalez;
+}
+
+unsigned int ChunkedVolumeFile::GetBytesPerVoxel ()
+{
+  return m_bytes_per_voxel;
+}
+
+unsigned int ChunkedVolumeFile::GetChunkSize ()
+{
+  return m_chunk_size;
+}
+
+void ChunkedVolumeFile::GetNumberOfChunks (unsigned int* ncx, unsigned int* ncy, unsigned int* ncz)
+{
+  *ncx = m_nchunks_x;
+  *ncy = m_nchunks_y;
+  *ncz = m_nchunks_z;
+}
+
+void ChunkedVolumeFile::GetChunkDimensions (unsigned int cx, unsigned int cy, unsigned int cz,
+                                            unsigned int* cw, unsigned int* ch, unsigned int* cd)
+{
+  *cw = std::min(m_chunk_size, m_width  - cx * m_chunk_size);
+  *ch = std::min(m_chunk_size, m_height - cy * m_chunk_size);
+  *cd = std::min(m_chunk_size, m_depth  - cz * m_chunk_size);
+}
+
+const ChunkedVolumeFile::ChunkEntry& ChunkedVolumeFile::GetChunkEntry (unsigned int cx, unsigned int cy, unsigned int cz)
+{
+  return m_index[cx + cy * m_nchunks_x + cz * m_nchunks_x * m_nchunks_y];
+}
+
+unsigned long long ChunkedVolumeFile::GetCompressedSize ()
+{
+  unsigned long long total = CVOL_HEADER_SIZE + m_index.size() * CVOL_INDEX_ENTRY_SIZE;
+  for (size_t c = 0; c < m_index.size(); c++)
+    total += m_index[c].size;
+  return total;
+}
+
+bool ChunkedVolumeFile::ReadChunk (unsigned int cx, unsigned int cy, unsigned int cz, void* out_data)
+{
+  if (!IsOpen() || cx >= m_nchunks_x || cy >= m_nchunks_y || cz >= m_nchunks_z) return false;
+
+  unsigned int chunk_id = cx + cy * m_nchunks_x + cz * m_nchunks_x * m_nchunks_y;
+  std::vector<unsigned char> bytes;
+  if (!ReadChunkBytes(chunk_id, bytes)) return false;
+
+  unsigned int cw, ch, cd;
+  GetChunkDimensions(cx, cy, cz, &cw, &ch, &cd);
+
+  return DecodeChunk(bytes.data(), bytes.size(), m_index[chunk_id].codec, size_t(cw) * ch * cd,
+                     m_bytes_per_voxel, static_cast<unsigned char*>(out_data));
+}
+
+bool ChunkedVolumeFile::IsRegionValid (unsigned int x0, unsigned int y0, unsigned int z0,
+                                       unsigned int x1, unsigned int y1, unsigned int z1)
+{
+  return IsOpen() && x0 < x1 && y0 < y1 && z0 < z1 && x1 <= m_width && y1 <= m_height && z1 <= m_depth;
+}
+
+bool ChunkedVolumeFile::ReadRegion (unsigned int x0, unsigned int y0, unsigned int z0,
+                                    unsigned int x1, unsigned int y1, unsigned int z1, void* out_data)
+{
+  if (out_data == nullptr || !IsRegionValid(x0, y0, z0, x1, y1, z1))
+    return false;
+
+  unsigned int rw = x1 - x0, rh = y1 - y0;
+  unsigned int cs = m_chunk_size;
+
+  // Read the compressed bytes of the intersected chunks
+  std::vector<unsigned int> chunk_list;
+  for (unsigned int cz = z0 / cs; cz <= (z1 - 1) / cs; cz++)
+    for (unsigned int cy = y0 / cs; cy <= (y1 - 1) / cs; cy++)
+      for (unsigned int cx = x0 / cs; cx <= (x1 - 1) / cs; cx++)
+        chunk_list.push_back(cx + cy * m_nchunks_x + cz * m_nchunks_x * m_nchunks_y);
+
+  std::vector<std::vector<unsigned char>> chunk_bytes(chunk_list.size());
+  for (size_t i = 0; i < chunk_list.size(); i++)
+    if (!ReadChunkBytes(chunk_list[i], chunk_bytes[i])) return false;
+
+  // Decode chunks in parallel, each chunk writes a disjoint part of the region
+  unsigned char* out = static_cast<unsigned char*>(out_data);
+  bool ok = true;
+#pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < int(chunk_list.size()); i++)
+  {
+    unsigned int chunk_id = chunk_list[i];
+    unsigned int cx = chunk_id % m_nchunks_x;
+    unsigned int cy = (chunk_id / m_nchunks_x) % m_nchunks_y;
+    unsigned int cz = chunk_id / (m_nchunks_x * m_nchunks_y);
+
+    unsigned int cw, ch, cd;
+    GetChunkDimensions(cx, cy, cz, &cw, &ch, &cd);
+
+    std::vector<unsigned char> chunk_data(size_t(cw) * ch * cd * m_bytes_per_voxel);
+    if (!DecodeChunk(chunk_bytes[i].data(), chunk_bytes[i].size(), m_index[chunk_id].codec,
+                     size_t(cw) * ch * cd, m_bytes_per_voxel, chunk_data.data()))
+    {
+#pragma omp critical
+      ok = false;
+      continue;
+    }
+    std::vector<unsigned char>().swap(chunk_bytes[i]);
+
+    // Copy the intersection between chunk and region
+    unsigned int bx0 = std::max(x0, cx * cs), bx1 = std::min(x1, cx * cs + cw);
+    unsigned int by0 = std::max(y0, cy * cs), by1 = std::min(y1, cy * cs + ch);
+    unsigned int bz0 = std::max(z0, cz * cs), bz1 = std::min(z1, cz * cs + cd);
+    for (unsigned int z = bz0; z < bz1; z++)
+    {
+      for (unsigned int y = by0; y < by1; y++)
+      {
+        size_t src = (size_t(bx0 - cx * cs) + size_t(y - cy * cs) * cw + size_t(z - cz * cs) * cw * ch) * m_bytes_per_voxel;
+        size_t dst = (size_t(bx0 - x0) + size_t(y - y0) * rw + size_t(z - z0) * rw * rh) * m_bytes_per_voxel;
+        memcpy(&out[dst], &chunk_data[src], size_t(bx1 - bx0) * m_bytes_per_voxel);
+      }
+    }
+  }
+
+  if (!ok) std::cout << "ChunkedVolumeFile: decoding .cvol chunk failed" << std::endl;
+  return ok;
+}
+
+bool ChunkedVolumeFile::ReadVolume (void* out_data)
+{
+  return ReadRegion(0, 0, 0, m_width, m_height, m_depth, out_data);
+}
+
+bool ChunkedVolumeFile::ReadChunkBytes (unsigned int chunk_id, std::vector<unsigned char>& bytes)
+{
+  const ChunkEntry& entry = m_index[chunk_id];
+  bytes.resize(entry.size);
+
+  m_file.clear();
+  m_file.seekg(std::streamoff(entry.offset), std::ios::beg);
+  if (!m_file.read(reinterpret_cast<char*>(bytes.data()), std::streamsize(entry.size)))
+  {
+    std::cout << "ChunkedVolumeFile: reading .cvol chunk failed" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void ChunkedVolumeFile::EncodeChunk (const unsigned char* chunk_data, size_t n_voxels, unsigned int bytes_per_voxel,
+                                     std::vector<unsigned char>& out_bytes, uint32_t* out_codec)
+{
+  // RLE
+  std::vector<unsigned char> rle;
+  for (size_t i = 0; i < n_voxels;)
+  {
+    uint32_t v = LoadValue(&chunk_data[i * bytes_per_voxel], bytes_per_voxel);
+    size_t run = 1;
+    while (i + run < n_voxels && LoadValue(&chunk_data[(i + run) * bytes_per_voxel], bytes_per_voxel) == v)
+      run++;
+
+    WriteVarint(rle, run);
+    for (unsigned int b = 0; b < bytes_per_voxel; b++)
+      rle.push_back((unsigned char)((v >> (8 * b)) & 0xFF));
+    i += run;
+  }
+
+  // Delta + zigzag + bitpack
+  std::vector<unsigned char> dbp;
+  uint32_t prev = 0;
+  uint64_t zz[CVOL_BITPACK_GROUP];
+  for (size_t g = 0; g < n_voxels; g += CVOL_BITPACK_GROUP)
+  {
+    size_t count = std::min(size_t(CVOL_BITPACK_GROUP), n_voxels - g);
+    uint64_t zz_or = 0;
+    for (size_t k = 0; k < count; k++)
+    {
+      uint32_t v = LoadValue(&chunk_data[(g + k) * bytes_per_voxel], bytes_per_voxel);
+      int64_t d = int64_t(v) - int64_t(prev);
+      zz[k] = (uint64_t(d) << 1) ^ uint64_t(d >> 63);
+      zz_or |= zz[k];
+      prev = v;
+    }
+
+    unsigned int bits = 0;
+    while (bits < 64 && (zz_or >> bits) != 0) bits++;
+    dbp.push_back((unsigned char)bits);
+
+    uint64_t acc = 0;
+    unsigned int n_acc = 0;
+    for (size_t k = 0; k < count && bits > 0; k++)
+    {
+      acc |= zz[k] << n_acc;
+      n_acc += bits;
+      while (n_acc >= 8)
+      {
+        dbp.push_back((unsigned char)(acc & 0xFF));
+        acc >>= 8;
+        n_acc -= 8;
+      }
+    }
+    if (n_acc > 0) dbp.push_back((unsigned char)(acc & 0xFF));
+  }
+
+  // Keep the smallest representation
+  size_t raw_size = n_voxels * bytes_per_voxel;
+  if (rle.size() < raw_size && rle.size() <= dbp.size())
+  {
+    out_bytes.swap(rle);
+    *out_codec = CODEC::RLE;
+  }
+  else if (dbp.size() < raw_size)
+  {
+    out_bytes.swap(dbp);
+    *out_codec = CODEC::DELTA_BITPACK;
+  }
+  else
+  {
+    out_bytes.assign(chunk_data, chunk_data + raw_size);
+    *out_codec = CODEC::RAW;
+  }
+}
+
+bool ChunkedVolumeFile::DecodeChunk (const unsigned char* in_bytes, size_t n_bytes, uint32_t codec,
+                                     size_t n_voxels, unsigned int bytes_per_voxel, unsigned char* chunk_data)
+{
+  if (codec == CODEC::RAW)
+  {
+    if (n_bytes != n_voxels * bytes_per_voxel) return false;
+    memcpy(chunk_data, in_bytes, n_bytes);
+    return true;
+  }
+  else if (codec == CODEC::RLE)
+  {
+    size_t pos = 0;
+    for (size_t i = 0; i < n_voxels;)
+    {
+      uint64_t run;
+      if (!ReadVarint(in_bytes, n_bytes, &pos, &run)) return false;
+      if (run == 0 || run > n_voxels - i || pos + bytes_per_voxel > n_bytes) return false;
+
+      uint32_t v = LoadValue(&in_bytes[pos], bytes_per_voxel);
+      pos += bytes_per_voxel;
+      for (uint64_t r = 0; r < run; r++, i++)
+        StoreValue(&chunk_data[i * bytes_per_voxel], v, bytes_per_voxel);
+    }
+    return true;
+  }
+  else if (codec == CODEC::DELTA_BITPACK)
+  {
+    size_t pos = 0;
+    uint32_t prev = 0;
+    for (size_t g = 0; g < n_voxels; g += CVOL_BITPACK_GROUP)
+    {
+      size_t count = std::min(size_t(CVOL_BITPACK_GROUP), n_voxels - g);
+      if (pos >= n_bytes) return false;
+
+      unsigned int bits = in_bytes[pos++];
+      size_t group_bytes = (count * bits + 7) / 8;
+      if (bits > 33 || pos + group_bytes > n_bytes) return false;
+
+      uint64_t mask = (bits == 0) ? 0 : ((uint64_t(1) << bits) - 1);
+      uint64_t acc = 0;
+      unsigned int n_acc = 0;
+      size_t bpos = pos;
+      for (size_t k = 0; k < count; k++)
+      {
+        while (n_acc < bits)
+        {
+          acc |= uint64_t(in_bytes[bpos++]) << n_acc;
+          n_acc += 8;
+        }
+        uint64_t zz = acc & mask;
+        acc >>= bits;
+        n_acc -= bits;
+
+        int64_t d = int64_t(zz >> 1) ^ -int64_t(zz & 1);
+        uint32_t v = uint32_t(int64_t(prev) + d);
+        StoreValue(&chunk_data[(g + k) * bytes_per_voxel], v, bytes_per_voxel);
+        prev = v;
+      }
+      pos += group_bytes;
+    }
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,120 @@
+/**
+ * Chunked volume file (.cvol)
+ *
+ * The volume is split into fixed size chunks (chunk_size^3 voxels, border
+ *   chunks are clipped) and each chunk is compressed independently. The
+ *   chunk offset index is stored after the header, so chunks can be read
+ *   and decoded in any order (parallel decode, out-of-core paging and
+ *   region of interest reads).
+ *
+ * File layout (little endian):
+ *   <MAGIC>            char[4]  "CVOL"
+ *   <VERSION>          uint32
+ *   <WIDTH HEIGHT DEPTH> uint32[3]
+ *   <BYTES PER VOXEL>  uint32   (1, 2 or 4)
+ *   <CHUNK SIZE>       uint32
+ *   <SCALE X Y Z>      double[3]
+ *   <NUMBER OF CHUNKS> uint32
+ *   <INDEX>            { uint64 offset, uint32 size, uint32 codec } per chunk
+ *   ...CHUNK DATA...
+ *
+ * Chunks are ordered as cx + cy * nchunks_x + cz * nchunks_x * nchunks_y,
+ *   voxels inside each chunk as x + y * cw + z * cw * ch.
+ *
+ * Each chunk is stored with the smallest of the codecs:
+ *   . RAW           : uncompressed values
+ *   . RLE           : <run length varint> <value> pairs
+ *   . DELTA_BITPACK : zigzag encoded difference to the previous voxel, packed
+ *                     in groups of 64 values, each group with its own bit width
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#ifndef FILE_UTILS_CHUNKED_VOLUME_H
+#define FILE_UTILS_CHUNKED_VOLUME_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class ChunkedVolumeFile
+{
+public:
+  enum CODEC : unsigned int
+  {
+    RAW           = 0,
+    RLE           = 1,
+    DELTA_BITPACK = 2,
+  };
+
+  struct ChunkEntry
+  {
+    uint64_t offset;
+    uint32_t size;
+    uint32_t codec;
+  };
+
+  ChunkedVolumeFile ();
+  ~ChunkedVolumeFile ();
+
+  // Write "data" (x + y * width + z * width * height ordering) as a chunked volume file.
+  // . bytes_per_voxel must be 1, 2 or 4, chunks are encoded in parallel.
+  static bool Write (const char* file_name, const void* data,
+                     unsigned int width, unsigned int height, unsigned int depth,
+                     unsigned int bytes_per_voxel,
+                     double scalex = 1.0, double scaley = 1.0, double scalez = 1.0,
+                     unsigned int chunk_size = 64);
+
+  // Read header and chunk index, the chunk data is only read on demand
+  bool Open (const char* file_name);
+  void Close ();
+  bool IsOpen ();
+
+  void GetDimensions (unsigned int* width, unsigned int* height, unsigned int* depth);
+  void GetScale (double* sx, double* sy, double* sz);
+  unsigned int GetBytesPerVoxel ();
+  unsigned int GetChunkSize ();
+  void GetNumberOfChunks (unsigned int* ncx, unsigned int* ncy, unsigned int* ncz);
+  void GetChunkDimensions (unsigned int cx, unsigned int cy, unsigned int cz,
+                           unsigned int* cw, unsigned int* ch, unsigned int* cd);
+  const ChunkEntry& GetChunkEntry (unsigned int cx, unsigned int cy, unsigned int cz);
+  unsigned long long GetCompressedSize ();
+
+  // Decode a single chunk into "out_data", with cw * ch * cd voxels
+  bool ReadChunk (unsigned int cx, unsigned int cy, unsigned int cz, void* out_data);
+
+  // Non empty region [x0, x1) x [y0, y1) x [z0, z1) inside the volume
+  bool IsRegionValid (unsigned int x0, unsigned int y0, unsigned int z0,
+                      unsigned int x1, unsigned int y1, unsigned int z1);
+
+  // Read the region [x0, x1) x [y0, y1) x [z0, z1) into "out_data", with
+  //   (x1 - x0) * (y1 - y0) * (z1 - z0) voxels. Only the chunks that
+  //   intersect the region are read, and they are decoded in parallel.
+  bool ReadRegion (unsigned int x0, unsigned int y0, unsigned int z0,
+                   unsigned int x1, unsigned int y1, unsigned int z1, void* out_data);
+
+  // Read the whole volume into "out_data", with width * height * depth voxels
+  bool ReadVolume (void* out_data);
+
+protected:
+  bool ReadChunkBytes (unsigned int chunk_id, std::vector<unsigned char>& bytes);
+
+  static void EncodeChunk (const unsigned char* chunk_data, size_t n_voxels, unsigned int bytes_per_voxel,
+                           std::vector<unsigned char>& out_bytes, uint32_t* out_codec);
+  static bool DecodeChunk (const unsigned char* in_bytes, size_t n_bytes, uint32_t codec,
+                           size_t n_voxels, unsigned int bytes_per_voxel, unsigned char* chunk_data);
+
+private:
+  std::ifstream m_file;
+
+  unsigned int m_width, m_height, m_depth;
+  unsigned int m_bytes_per_voxel;
+  unsigned int m_chunk_size;
+  double m_scalex, m_scaley, m_scalez;
+
+  unsigned int m_nchunks_x, m_nchunks_y, m_nchunks_z;
+  std::vector<ChunkEntry> m_index;
+};
+
+#endif
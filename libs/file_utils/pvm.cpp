@@ -12,6 +12,9 @@
 #include <cstdlib>
 #include <cstring>
 #include <cerrno>
+#include <vector>
+
+#include <omp.h>
 
 #define DDS_MAXSTR (256)
 
@@ -20,6 +23,9 @@
 
 #define DDS_RL (7)
 
+// minimum number of bytes of each segment encoded in parallel
+#define DDS_MINSEGMENT (1<<16)
+
 Pvm::Pvm (const char *file_name)
 {
   std::string filename(file_name);
@@ -622,356 +628,407 @@ unsigned char* DDSV3::readRAWfile (const char *filename, unsigned int *bytes)
   return(data);
 }
 
-/*
-inline void DDS_writebits(unsigned int value,unsigned int bits)
+// write bits into the Differential Data Stream
+void DDSV3::DDS_writebits (unsigned int value, unsigned int bits)
 {
-  value&=DDS_shiftl(1,bits)-1;
-  
-  if (DDS_bufsize+bits<32)
+  value &= DDSV3::DDS_shiftl(1, bits) - 1;
+
+  if (DDS_bufsize + bits < 32)
   {
-    DDS_buffer=DDS_shiftl(DDS_buffer,bits)|value;
-    DDS_bufsize+=bits;
+    DDS_buffer = DDSV3::DDS_shiftl(DDS_buffer, bits) | value;
+    DDS_bufsize += bits;
   }
   else
   {
-    DDS_buffer=DDS_shiftl(DDS_buffer,32-DDS_bufsize);
-    DDS_bufsize-=32-bits;
-    DDS_buffer|=DDS_shiftr(value,DDS_bufsize);
-  
-    if (DDS_cachepos+4>DDS_cachesize)
-    if (DDS_cache==NULL)
-    {
-      if ((DDS_cache=(unsigned char *)malloc(DDS_BLOCKSIZE))==NULL) MEMERROR();
-      DDS_cachesize=DDS_BLOCKSIZE;
-    }
-    else
+    DDS_buffer = DDSV3::DDS_shiftl(DDS_buffer, 32 - DDS_bufsize);
+    DDS_bufsize -= 32 - bits;
+    DDS_buffer |= DDSV3::DDS_shiftr(value, DDS_bufsize);
+
+    if (DDS_cachepos + 4 > DDS_cachesize)
     {
-      if ((DDS_cache=(unsigned char *)realloc(DDS_cache,DDS_cachesize+DDS_BLOCKSIZE))==NULL) MEMERROR();
-      DDS_cachesize+=DDS_BLOCKSIZE;
+      if (DDS_cache == NULL)
+      {
+        if ((DDS_cache = (unsigned char*)malloc(DDS_BLOCKSIZE)) == NULL) MEMERROR();
+        DDS_cachesize = DDS_BLOCKSIZE;
+      }
+      else
+      {
+        if ((DDS_cache = (unsigned char*)realloc(DDS_cache, DDS_cachesize + DDS_BLOCKSIZE)) == NULL) MEMERROR();
+        DDS_cachesize += DDS_BLOCKSIZE;
+      }
     }
-    
-    if (DDS_ISINTEL) DDS_swapuint(&DDS_buffer);
-    *((unsigned int *)&DDS_cache[DDS_cachepos])=DDS_buffer;
-    DDS_cachepos+=4;
-    
-    DDS_buffer=value&(DDS_shiftl(1,DDS_bufsize)-1);
+
+    if (DDS_ISINTEL) DDSV3::DDS_swapuint(&DDS_buffer);
+    *((unsigned int *)&DDS_cache[DDS_cachepos]) = DDS_buffer;
+    DDS_cachepos += 4;
+
+    DDS_buffer = value & (DDSV3::DDS_shiftl(1, DDS_bufsize) - 1);
   }
 }
 
-inline void DDS_flushbits()
+void DDSV3::DDS_flushbits ()
 {
   unsigned int bufsize;
-  
-  bufsize=DDS_bufsize;
-  
-  if (bufsize>0)
+
+  bufsize = DDS_bufsize;
+
+  if (bufsize > 0)
   {
-    DDS_writebits(0,32-bufsize);
-    DDS_cachepos-=(32-bufsize)/8;
+    DDS_writebits(0, 32 - bufsize);
+    DDS_cachepos -= (32 - bufsize) / 8;
   }
 }
 
-inline void DDS_savebits(unsigned char **data,unsigned int *size)
+void DDSV3::DDS_savebits (unsigned char** data, unsigned int* size)
 {
-  *data=DDS_cache;
-  *size=DDS_cachepos;
+  *data = DDS_cache;
+  *size = DDS_cachepos;
 }
 
 // encode a Differential Data Stream
-void DDS_encode (unsigned char *data,unsigned int bytes,unsigned int skip,unsigned int strip,
-                 unsigned char **chunk,unsigned int *size,
-                 unsigned int block=0)
+// . if "segments" > 1, the stream is split into independent segments, which
+//   are encoded in parallel and then concatenated. The predictor of each
+//   segment starts from the original data before the segment, so the output
+//   is a regular stream, read by DDS_decode.
+void DDSV3::DDS_encode (unsigned char* data, unsigned int bytes, unsigned int skip, unsigned int strip,
+                        unsigned char** chunk, unsigned int* size,
+                        unsigned int block, unsigned int segments)
 {
   int i;
-  
+
   unsigned char lookup[256];
-  
-  unsigned char *ptr1,*ptr2;
-  
-  int pre1,pre2,
-  act1,act2,
-  tmp1,tmp2;
-  
-  unsigned int cnt,cnt1,cnt2;
-  int bits,bits1,bits2;
-  
-  if (bytes<1) ERRORMSG();
-  
-  if (skip<1 || skip>4) skip=1;
-  if (strip<1 || strip>65536) strip=1;
-  
-  DDS_deinterleave(data,bytes,skip,block);
-  
-  for (i=-128; i<128; i++)
+
+  int bits;
+
+  if (bytes < 1) ERRORMSG();
+
+  if (skip < 1 || skip > 4) skip = 1;
+  if (strip < 1 || strip > 65536) strip = 1;
+
+  DDS_deinterleave(data, bytes, skip, block);
+
+  for (i = -128; i < 128; i++)
   {
-  if (i<=0)
-  for (bits=0; (1<<bits)/2<-i; bits++);
-  else
-  for (bits=0; (1<<bits)/2<=i; bits++);
-  
-  lookup[i+128]=bits;
+    if (i <= 0)
+      for (bits = 0; (1 << bits) / 2 < -i; bits++);
+    else
+      for (bits = 0; (1 << bits) / 2 <= i; bits++);
+
+    lookup[i + 128] = bits;
   }
-  
+
   DDS_initbuffer();
-  
+
   DDS_clearbits();
-  
-  DDS_writebits(skip-1,2);
-  DDS_writebits(strip-1,16);
-  
-  ptr1=ptr2=data;
-  pre1=pre2=0;
-  
-  cnt=cnt1=cnt2=0;
-  bits=bits1=bits2=0;
-  
-  while (cnt++<bytes)
-  {
-  tmp1=*ptr1;
-  if (strip==1 || ptr1-strip<=data) act1=tmp1-pre1;
-  else act1=tmp1-pre1-*(ptr1-strip)+*(ptr1-strip-1);
-  pre1=tmp1;
-  ptr1++;
-  
-  while (act1<-128) act1+=256;
-  while (act1>127) act1-=256;
-  
-  bits=lookup[act1+128];
-  
-  bits=DDS_decode(DDS_code(bits));
-  
-  if (cnt1==0)
-  {
-  cnt1++;
-  bits1=bits;
-  continue;
-  }
-  
-  if (cnt1<(1<<DDS_RL)-1 && bits==bits1)
-  {
-  cnt1++;
-  continue;
-  }
-  
-  if (cnt1+cnt2<(1<<DDS_RL) && (cnt1+cnt2)*max(bits1,bits2)<cnt1*bits1+cnt2*bits2+DDS_RL+3)
-  {
-  cnt2+=cnt1;
-  if (bits1>bits2) bits2=bits1;
-  }
-  else
-  {
-  DDS_writebits(cnt2,DDS_RL);
-  DDS_writebits(DDS_code(bits2),3);
-  
-  while (cnt2-->0)
-  {
-  tmp2=*ptr2;
-  if (strip==1 || ptr2-strip<=data) act2=tmp2-pre2;
-  else act2=tmp2-pre2-*(ptr2-strip)+*(ptr2-strip-1);
-  pre2=tmp2;
-  ptr2++;
-  
-  while (act2<-128) act2+=256;
-  while (act2>127) act2-=256;
-  
-  DDS_writebits(act2+(1<<bits2)/2,bits2);
-  }
-  
-  cnt2=cnt1;
-  bits2=bits1;
-  }
-  
-  cnt1=1;
-  bits1=bits;
-  }
-  
-  if (cnt1+cnt2<(1<<DDS_RL) && (cnt1+cnt2)*max(bits1,bits2)<cnt1*bits1+cnt2*bits2+DDS_RL+3)
+
+  DDS_writebits(skip - 1, 2);
+  DDS_writebits(strip - 1, 16);
+
+  if (segments < 1) segments = 1;
+  if (bytes / segments < DDS_MINSEGMENT) segments = glm::max(bytes / DDS_MINSEGMENT, 1u);
+
+  if (segments == 1)
   {
-  cnt2+=cnt1;
-  if (bits1>bits2) bits2=bits1;
+    DDS_encoderuns(data, 0, bytes, strip, lookup);
   }
   else
   {
-  DDS_writebits(cnt2,DDS_RL);
-  DDS_writebits(DDS_code(bits2),3);
-  
-  while (cnt2-->0)
-  {
-  tmp2=*ptr2;
-  if (strip==1 || ptr2-strip<=data) act2=tmp2-pre2;
-  else act2=tmp2-pre2-*(ptr2-strip)+*(ptr2-strip-1);
-  pre2=tmp2;
-  ptr2++;
-  
-  while (act2<-128) act2+=256;
-  while (act2>127) act2-=256;
-  
-  DDS_writebits(act2+(1<<bits2)/2,bits2);
-  }
-  
-  cnt2=cnt1;
-  bits2=bits1;
-  }
-  
-  if (cnt2!=0)
-  {
-  DDS_writebits(cnt2,DDS_RL);
-  DDS_writebits(DDS_code(bits2),3);
-  
-  while (cnt2-->0)
-  {
-  tmp2=*ptr2;
-  if (strip==1 || ptr2-strip<=data) act2=tmp2-pre2;
-  else act2=tmp2-pre2-*(ptr2-strip)+*(ptr2-strip-1);
-  pre2=tmp2;
-  ptr2++;
-  
-  while (act2<-128) act2+=256;
-  while (act2>127) act2-=256;
-  
-  DDS_writebits(act2+(1<<bits2)/2,bits2);
-  }
+    unsigned int segment_bytes = (bytes + segments - 1) / segments;
+    std::vector<DDSV3> encoders(segments);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int s = 0; s < (int)segments; s++)
+    {
+      unsigned int begin = glm::min(s * segment_bytes, bytes);
+      unsigned int end = glm::min(begin + segment_bytes, bytes);
+
+      encoders[s].DDS_initbuffer();
+      encoders[s].DDS_clearbits();
+      if (begin < end) encoders[s].DDS_encoderuns(data, begin, end, strip, lookup);
+    }
+
+    for (unsigned int s = 0; s < segments; s++)
+    {
+      DDS_appendbits(&encoders[s]);
+      if (encoders[s].DDS_cache) free(encoders[s].DDS_cache);
+      encoders[s].DDS_clearbits();
+    }
   }
-  
+
   DDS_flushbits();
-  DDS_savebits(chunk,size);
-  
-  DDS_interleave(data,bytes,skip,block);
+  DDS_savebits(chunk, size);
+
+  DDS_interleave(data, bytes, skip, block);
 }
 
 // write a RAW file
-void writeRAWfile(const char *filename,unsigned char *data,unsigned int bytes,BOOLINT nofree)
+bool DDSV3::writeRAWfile (const char* filename, unsigned char* data, unsigned int bytes, bool nofree)
 {
-  FILE *file;
+  FILE* file;
+  errno_t err;
 
-  if (bytes<1) ERRORMSG();
+  bool ret = true;
 
-  if ((file=fopen(filename,"wb"))==NULL) IOERROR();
-  if (fwrite(data,1,bytes,file)!=bytes) IOERROR();
+  if (bytes < 1) ERRORMSG();
 
-  fclose(file);
+  if ((err = fopen_s(&file, filename, "wb")) != 0) ret = false;
+  else
+  {
+    if (fwrite(data, 1, bytes, file) != bytes) ret = false;
+    fclose(file);
+  }
 
   if (!nofree) free(data);
+
+  return(ret);
 }
 
 // write a Differential Data Stream
-void writeDDSfile(const char *filename,unsigned char *data,unsigned int bytes,unsigned int skip,unsigned int strip,BOOLINT nofree)
+bool DDSV3::writeDDSfile (const char* filename, unsigned char* data, unsigned int bytes,
+                          unsigned int skip, unsigned int strip, bool nofree, unsigned int segments)
 {
-  int version=1;
+  int version = 1;
 
-  FILE *file;
+  FILE* file;
+  errno_t err;
 
-  unsigned char *chunk;
+  unsigned char* chunk;
   unsigned int size;
 
-  if (bytes<1) ERRORMSG();
+  bool ret = true;
 
-  if (bytes>DDS_INTERLEAVE) version=2;
+  if (bytes < 1) ERRORMSG();
 
-  if ((file=fopen(filename,"wb"))==NULL) IOERROR();
-  fprintf(file,"%s",(version==1)?DDS_ID:DDS_ID2);
+  if (bytes > DDS_INTERLEAVE) version = 2;
 
-  DDS_encode(data,bytes,skip,strip,&chunk,&size,version==1?0:DDS_INTERLEAVE);
+  if ((err = fopen_s(&file, filename, "wb")) != 0)
+  {
+    if (!nofree) free(data);
+    return(false);
+  }
+  fprintf(file, "%s", (version == 1) ? DDS_ID : DDS_ID2);
 
-  if (chunk!=NULL)
+  DDS_encode(data, bytes, skip, strip, &chunk, &size, version == 1 ? 0 : DDS_INTERLEAVE, segments);
+
+  if (chunk != NULL)
   {
-  if (fwrite(chunk,size,1,file)!=1) IOERROR();
-  free(chunk);
+    if (fwrite(chunk, size, 1, file) != 1) ret = false;
+    free(chunk);
   }
 
   fclose(file);
 
   if (!nofree) free(data);
+
+  return(ret);
 }
 
-// write an optionally compressed PNM image
-void writePNMimage(const char *filename,unsigned char *image,unsigned int width,unsigned int height,unsigned int components,BOOLINT dds)
+// write an optionally compressed PVM volume
+bool DDSV3::writePVMvolume (const char* filename, unsigned char* volume,
+                            unsigned int width, unsigned int height, unsigned int depth,
+                            unsigned int components,
+                            float scalex, float scaley, float scalez,
+                            unsigned char* description,
+                            unsigned char* courtesy,
+                            unsigned char* parameter,
+                            unsigned char* comment,
+                            bool dds, unsigned int segments)
 {
   char str[DDS_MAXSTR];
 
-  unsigned char *data;
+  unsigned char* data;
+
+  unsigned int len1 = 1, len2 = 1, len3 = 1, len4 = 1;
+  unsigned int hlen, vbytes, bytes;
 
-  if (width<1 || height<1) ERRORMSG();
+  bool version3 = false;
 
-  switch (components)
+  if (width < 1 || height < 1 || depth < 1 || components < 1) ERRORMSG();
+
+  if (description == NULL && courtesy == NULL && parameter == NULL && comment == NULL)
+  {
+    if (scalex == 1.0f && scaley == 1.0f && scalez == 1.0f)
+      snprintf(str, DDS_MAXSTR, "PVM\n%d %d %d\n%d\n", width, height, depth, components);
+    else
+      snprintf(str, DDS_MAXSTR, "PVM2\n%d %d %d\n%g %g %g\n%d\n", width, height, depth, scalex, scaley, scalez, components);
+  }
+  else
   {
-  case 1: snprintf(str,DDS_MAXSTR,"P5\n%d %d\n255\n",width,height); break;
-  case 2: snprintf(str,DDS_MAXSTR,"P5\n%d %d\n32767\n",width,height); break;
-  case 3: snprintf(str,DDS_MAXSTR,"P6\n%d %d\n255\n",width,height); break;
-  default: ERRORMSG();
+    version3 = true;
+    snprintf(str, DDS_MAXSTR, "PVM3\n%d %d %d\n%g %g %g\n%d\n", width, height, depth, scalex, scaley, scalez, components);
+
+    if (description != NULL) len1 = strlen((char*)description) + 1;
+    if (courtesy != NULL) len2 = strlen((char*)courtesy) + 1;
+    if (parameter != NULL) len3 = strlen((char*)parameter) + 1;
+    if (comment != NULL) len4 = strlen((char*)comment) + 1;
   }
 
-  if ((data=(unsigned char *)malloc(strlen(str)+width*height*components))==NULL) MEMERROR();
+  hlen = strlen(str);
+  vbytes = width * height * depth * components;
+  bytes = hlen + vbytes;
+  if (version3) bytes += len1 + len2 + len3 + len4;
+
+  if ((data = (unsigned char*)malloc(bytes)) == NULL) MEMERROR();
+
+  memcpy(data, str, hlen);
+  memcpy(data + hlen, volume, vbytes);
+
+  if (version3)
+  {
+    if (description == NULL) *(data + hlen + vbytes) = '\0';
+    else memcpy(data + hlen + vbytes, description, len1);
+
+    if (courtesy == NULL) *(data + hlen + vbytes + len1) = '\0';
+    else memcpy(data + hlen + vbytes + len1, courtesy, len2);
+
+    if (parameter == NULL) *(data + hlen + vbytes + len1 + len2) = '\0';
+    else memcpy(data + hlen + vbytes + len1 + len2, parameter, len3);
 
-  memcpy(data,str,strlen(str));
-  memcpy(data+strlen(str),image,width*height*components);
+    if (comment == NULL) *(data + hlen + vbytes + len1 + len2 + len3) = '\0';
+    else memcpy(data + hlen + vbytes + len1 + len2 + len3, comment, len4);
+  }
 
-  if (dds) writeDDSfile(filename,data,strlen(str)+width*height*components,components,width);
-  else writeRAWfile(filename,data,strlen(str)+width*height*components);
+  if (dds) return(writeDDSfile(filename, data, bytes, components, width, false, segments));
+  return(writeRAWfile(filename, data, bytes));
 }
 
-// write a compressed PVM volume
-void writePVMvolume(const char *filename,unsigned char *volume,
-unsigned int width,unsigned int height,unsigned int depth,unsigned int components,
-float scalex,float scaley,float scalez,
-unsigned char *description,
-unsigned char *courtesy,
-unsigned char *parameter,
-unsigned char *comment)
+// encode the runs of data[begin, end), predicting from the bytes before "begin"
+void DDSV3::DDS_encoderuns (unsigned char* data, unsigned int begin, unsigned int end,
+                            unsigned int strip, const unsigned char* lookup)
 {
-  char str[DDS_MAXSTR];
+  unsigned char *ptr1, *ptr2;
 
-  unsigned char *data;
+  int pre1, pre2,
+      act1,
+      tmp1;
 
-  unsigned int len1=1,len2=1,len3=1,len4=1;
+  unsigned int cnt, cnt1, cnt2;
+  int bits, bits1, bits2;
 
-  if (width<1 || height<1 || depth<1 || components<1) ERRORMSG();
+  ptr1 = ptr2 = data + begin;
+  pre1 = pre2 = (begin > 0) ? data[begin - 1] : 0;
 
-  if (description==NULL && courtesy==NULL && parameter==NULL && comment==NULL)
-  if (scalex==1.0f && scaley==1.0f && scalez==1.0f)
-  snprintf(str,DDS_MAXSTR,"PVM\n%d %d %d\n%d\n",width,height,depth,components);
-  else
-  snprintf(str,DDS_MAXSTR,"PVM2\n%d %d %d\n%g %g %g\n%d\n",width,height,depth,scalex,scaley,scalez,components);
-  else
-  snprintf(str,DDS_MAXSTR,"PVM3\n%d %d %d\n%g %g %g\n%d\n",width,height,depth,scalex,scaley,scalez,components);
+  cnt = begin;
+  cnt1 = cnt2 = 0;
+  bits = bits1 = bits2 = 0;
 
-  if (description==NULL && courtesy==NULL && parameter==NULL && comment==NULL)
+  while (cnt++ < end)
   {
-  if ((data=(unsigned char *)malloc(strlen(str)+width*height*depth*components))==NULL) MEMERROR();
+    tmp1 = *ptr1;
+    if (strip == 1 || ptr1 - strip <= data) act1 = tmp1 - pre1;
+    else act1 = tmp1 - pre1 - *(ptr1 - strip) + *(ptr1 - strip - 1);
+    pre1 = tmp1;
+    ptr1++;
+
+    while (act1 < -128) act1 += 256;
+    while (act1 > 127) act1 -= 256;
+
+    bits = lookup[act1 + 128];
+
+    bits = DDSV3::DDS_decode(DDSV3::DDS_code(bits));
 
-  memcpy(data,str,strlen(str));
-  memcpy(data+strlen(str),volume,width*height*depth*components);
+    if (cnt1 == 0)
+    {
+      cnt1++;
+      bits1 = bits;
+      continue;
+    }
+
+    if (cnt1 < (1 << DDS_RL) - 1 && bits == bits1)
+    {
+      cnt1++;
+      continue;
+    }
 
-  writeDDSfile(filename,data,strlen(str)+width*height*depth*components,components,width);
+    if (cnt1 + cnt2 < (1 << DDS_RL) && (cnt1 + cnt2)*glm::max(bits1, bits2) < cnt1*bits1 + cnt2*bits2 + DDS_RL + 3)
+    {
+      cnt2 += cnt1;
+      if (bits1 > bits2) bits2 = bits1;
+    }
+    else
+    {
+      DDS_writerun(data, &ptr2, &pre2, cnt2, bits2, strip);
+
+      cnt2 = cnt1;
+      bits2 = bits1;
+    }
+
+    cnt1 = 1;
+    bits1 = bits;
+  }
+
+  if (cnt1 + cnt2 < (1 << DDS_RL) && (cnt1 + cnt2)*glm::max(bits1, bits2) < cnt1*bits1 + cnt2*bits2 + DDS_RL + 3)
+  {
+    cnt2 += cnt1;
+    if (bits1 > bits2) bits2 = bits1;
   }
   else
   {
-  if (description!=NULL) len1=strlen((char *)description)+1;
-  if (courtesy!=NULL) len2=strlen((char *)courtesy)+1;
-  if (parameter!=NULL) len3=strlen((char *)parameter)+1;
-  if (comment!=NULL) len4=strlen((char *)comment)+1;
+    DDS_writerun(data, &ptr2, &pre2, cnt2, bits2, strip);
 
-  if ((data=(unsigned char *)malloc(strlen(str)+width*height*depth*components+len1+len2+len3+len4))==NULL) MEMERROR();
+    cnt2 = cnt1;
+    bits2 = bits1;
+  }
 
-  memcpy(data,str,strlen(str));
-  memcpy(data+strlen(str),volume,width*height*depth*components);
+  if (cnt2 != 0)
+    DDS_writerun(data, &ptr2, &pre2, cnt2, bits2, strip);
+}
 
-  if (description==NULL) *(data+strlen(str)+width*height*depth*components)='\0';
-  else memcpy(data+strlen(str)+width*height*depth*components,description,len1);
+// write a run of "cnt" differences with "bits" bits each
+void DDSV3::DDS_writerun (unsigned char* data, unsigned char** ptr, int* pre,
+                          unsigned int cnt, int bits, unsigned int strip)
+{
+  int tmp, act;
 
-  if (courtesy==NULL) *(data+strlen(str)+width*height*depth*components+len1)='\0';
-  else memcpy(data+strlen(str)+width*height*depth*components+len1,courtesy,len2);
+  DDS_writebits(cnt, DDS_RL);
+  DDS_writebits(DDSV3::DDS_code(bits), 3);
 
-  if (parameter==NULL) *(data+strlen(str)+width*height*depth*components+len1+len2)='\0';
-  else memcpy(data+strlen(str)+width*height*depth*components+len1+len2,parameter,len3);
+  while (cnt-- > 0)
+  {
+    tmp = **ptr;
+    if (strip == 1 || *ptr - strip <= data) act = tmp - *pre;
+    else act = tmp - *pre - *(*ptr - strip) + *(*ptr - strip - 1);
+    *pre = tmp;
+    (*ptr)++;
 
-  if (comment==NULL) *(data+strlen(str)+width*height*depth*components+len1+len2+len3)='\0';
-  else memcpy(data+strlen(str)+width*height*depth*components+len1+len2+len3,comment,len4);
+    while (act < -128) act += 256;
+    while (act > 127) act -= 256;
 
-  writeDDSfile(filename,data,strlen(str)+width*height*depth*components+len1+len2+len3+len4,components,width);
+    DDS_writebits(act + (1 << bits) / 2, bits);
   }
 }
 
+// append the (not flushed) bits written by another encoder
+void DDSV3::DDS_appendbits (DDSV3* encoder)
+{
+  unsigned int i, value, shift;
+
+  // reserve space for all words of the encoder
+  if (DDS_cachepos + encoder->DDS_cachepos + 4 > DDS_cachesize)
+  {
+    DDS_cachesize = ((DDS_cachepos + encoder->DDS_cachepos + 4) / DDS_BLOCKSIZE + 1) * DDS_BLOCKSIZE;
+    if ((DDS_cache = (unsigned char*)realloc(DDS_cache, DDS_cachesize)) == NULL) MEMERROR();
+  }
+
+  // complete words are shifted by the pending bits of this stream
+  shift = DDS_bufsize;
+  for (i = 0; i + 4 <= encoder->DDS_cachepos; i += 4)
+  {
+    value = *((unsigned int *)&encoder->DDS_cache[i]);
+    if (DDS_ISINTEL) DDSV3::DDS_swapuint(&value);
+
+    unsigned int word = DDSV3::DDS_shiftl(DDS_buffer, 32 - shift) | DDSV3::DDS_shiftr(value, shift);
+    DDS_buffer = value & (DDSV3::DDS_shiftl(1, shift) - 1);
+
+    if (DDS_ISINTEL) DDSV3::DDS_swapuint(&word);
+    *((unsigned int *)&DDS_cache[DDS_cachepos]) = word;
+    DDS_cachepos += 4;
+  }
+
+  if (encoder->DDS_bufsize > 0) DDS_writebits(encoder->DDS_buffer, encoder->DDS_bufsize);
+}
+
+/*
 // check a file
 int checkfile(const char *filename)
 {
@@ -308,6 +308,36 @@ public:
   unsigned char* readRAWfiled (FILE *file, unsigned int *bytes);
   unsigned char* readRAWfile (const char *filename, unsigned int *bytes);
 
+  // PVM/DDS writer (8/16 bits):
+  // . "segments" > 1 encodes the Differential Data Stream in parallel
+  void DDS_writebits (unsigned int value, unsigned int bits);
+  void DDS_flushbits ();
+  void DDS_savebits (unsigned char** data, unsigned int* size);
+
+  void DDS_encode (unsigned char* data, unsigned int bytes,
+                   unsigned int skip, unsigned int strip,
+                   unsigned char** chunk, unsigned int* size,
+                   unsigned int block = 0,
+                   unsigned int segments = 1);
+
+  bool writeRAWfile (const char* filename, unsigned char* data, unsigned int bytes, bool nofree = false);
+
+  bool writeDDSfile (const char* filename, unsigned char* data, unsigned int bytes,
+                     unsigned int skip = 0, unsigned int strip = 0,
+                     bool nofree = false,
+                     unsigned int segments = 1);
+
+  bool writePVMvolume (const char* filename, unsigned char* volume,
+                       unsigned int width, unsigned int height, unsigned int depth,
+                       unsigned int components = 1,
+                       float scalex = 1.0f, float scaley = 1.0f, float scalez = 1.0f,
+                       unsigned char* description = NULL,
+                       unsigned char* courtesy = NULL,
+                       unsigned char* parameter = NULL,
+                       unsigned char* comment = NULL,
+                       bool dds = true,
+                       unsigned int segments = 1);
+
 
   unsigned char* DDS_cache;
   unsigned int DDS_cachepos, DDS_cachesize;
@@ -320,21 +350,15 @@ protected:
   const char* DDS_ID = "DDS v3d\n";
   const char* DDS_ID2 = "DDS v3e\n";
 
-private:
-
-  /*void writeDDSfile(const char *filename,unsigned char *data,unsigned int bytes,unsigned int skip=0,unsigned int strip=0,BOOLINT nofree=FALSE);
+  void DDS_encoderuns (unsigned char* data, unsigned int begin, unsigned int end,
+                       unsigned int strip, const unsigned char* lookup);
+  void DDS_writerun (unsigned char* data, unsigned char** ptr, int* pre,
+                     unsigned int cnt, int bits, unsigned int strip);
+  void DDS_appendbits (DDSV3* encoder);
 
-  void writeRAWfile(const char *filename,unsigned char *data,unsigned int bytes,BOOLINT nofree=FALSE);
-
-  void writePNMimage(const char *filename,unsigned char *image,unsigned int width,unsigned int height,unsigned int components,BOOLINT dds=FALSE);
+private:
 
-  void writePVMvolume(const char *filename,unsigned char *volume,
-  unsigned int width,unsigned int height,unsigned int depth,unsigned int components=1,
-  float scalex=1.0f,float scaley=1.0f,float scalez=1.0f,
-  unsigned char *description=NULL,
-  unsigned char *courtesy=NULL,
-  unsigned char *parameter=NULL,
-  unsigned char *comment=NULL);
+  /*void writePNMimage(const char *filename,unsigned char *image,unsigned int width,unsigned int height,unsigned int components,BOOLINT dds=FALSE);
 
   int checkfile(const char *filename);
   unsigned int checksum(unsigned char *data,unsigned int bytes);
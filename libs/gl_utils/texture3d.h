@@ -18,6 +18,9 @@ namespace gl
     , GLint wrap_s_param, GLint wrap_t_param, GLint wrap_r_param, bool generatemipmap = false);
 
     bool SetData (GLvoid* data, GLint internalformat, GLenum format, GLenum type);
+    // Update a region of a texture already allocated by SetData
+    bool SetSubData (GLvoid* data, int x, int y, int z, int width, int height, int depth,
+                     GLenum format, GLenum type);
 
     GLuint GetTextureID ();
 
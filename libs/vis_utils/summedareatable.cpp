@@ -1,4 +1,70 @@
 #include "summedareatable.h"
 
+#include <algorithm>
+
 namespace vis
-{}
\ No newline at end of file
+{
+  void BuildFloatSummedAreaTable3D (float* data, unsigned int w, unsigned int h, unsigned int d,
+                                    float offset)
+  {
+    const int sw = (int)w, sh = (int)h, sd = (int)d;
+    const size_t slice_size = size_t(w)*size_t(h);
+
+    // Prefix sums of the previous slice and of the current one
+    double* prev = new double[slice_size];
+    double* curr = new double[slice_size];
+    std::fill(prev, prev + slice_size, 0.0);
+
+    for (int z = 0; z < sd; z++)
+    {
+      float* slice = data + size_t(z) * slice_size;
+
+      // x
+#pragma omp parallel for schedule(static)
+      for (int y = 0; y < sh; y++)
+      {
+        const float* in = slice + size_t(y) * sw;
+        double* out = curr + size_t(y) * sw;
+        double sum = 0.0;
+        for (int x = 0; x < sw; x++)
+        {
+          sum += (double)in[x] - (double)offset;
+          out[x] = sum;
+        }
+      }
+
+      // y, in blocks of columns
+#pragma omp parallel for schedule(static)
+      for (int x0 = 0; x0 < sw; x0 += 256)
+      {
+        int x1 = std::min(x0 + 256, sw);
+        for (int y = 1; y < sh; y++)
+        {
+          double* row = curr + size_t(y) * sw;
+          const double* prev_row = row - sw;
+          for (int x = x0; x < x1; x++)
+            row[x] += prev_row[x];
+        }
+      }
+
+      // z
+#pragma omp parallel for schedule(static)
+      for (int y = 0; y < sh; y++)
+      {
+        double* row = curr + size_t(y) * sw;
+        const double* prev_row = prev + size_t(y) * sw;
+        float* out = slice + size_t(y) * sw;
+        for (int x = 0; x < sw; x++)
+        {
+          row[x] += prev_row[x];
+          out[x] = (float)row[x];
+        }
+      }
+
+      std::swap(prev, curr);
+    }
+
+    delete[] prev;
+    delete[] curr;
+  }
+}
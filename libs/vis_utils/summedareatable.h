@@ -30,6 +30,7 @@ the SAT at non-integer locations if necessary.
 #include <cassert>
 #include <cstdio>
 #include <cmath>
+#include <algorithm>
 
 #include <gl_utils/texture2d.h>
 #include <gl_utils/texture3d.h>
@@ -38,6 +39,9 @@ the SAT at non-integer locations if necessary.
 #define USE_OMP
 #include <omp.h>
 
+// Minimum number of boxes of a batched query to use OpenMP threads
+#define SUMMED_AREA_TABLE_PARALLEL_QUERIES 4096
+
 namespace vis
 {
   template<typename T>
@@ -173,15 +177,20 @@ namespace vis
   {
   public:
     SummedAreaTable3D (unsigned int _w, unsigned int _h, unsigned int _d)
-      : w(_w), h(_h), d(_d)
+      : w(_w), h(_h), d(_d), offset(0.0)
     {
-      data = new T[w*h*d];
+      data = new T[size_t(w)*size_t(h)*size_t(d)];
       zero = T(0);
-  
-      for (int x = 0; x < w; x++)
-        for (int y = 0; y < h; y++)
-          for (int z = 0; z < d; z++)
-            SetValue((T)zero, x, y, z);
+
+      // Zero-fill in memory order
+      size_t slice_size = size_t(w)*size_t(h);
+#pragma omp parallel for
+      for (int z = 0; z < (int)d; z++)
+      {
+        T* slice = data + size_t(z) * slice_size;
+        for (size_t i = 0; i < slice_size; i++)
+          slice[i] = zero;
+      }
     }
   
     ~SummedAreaTable3D ()
@@ -196,9 +205,22 @@ namespace vis
       return data;
     }
 
+    // Value subtracted from each value before the sums (see
+    //  BuildFloatSummedAreaTable3D): Query, GetPrefixSum and QueryFractional
+    //  add it back for each value they cover, GetValue does not
+    void SetOffset (double _offset)
+    {
+      offset = _offset;
+    }
+
+    double GetOffset ()
+    {
+      return offset;
+    }
+
     void SetValue (T val, int x, int y, int z)
     {
-      data[x + (w * y) + (w * h * z)] = val;
+      data[x + (w * y) + (size_t(w) * h * z)] = val;
     }
   
     T GetValue (int x, int y, int z)
@@ -209,70 +231,132 @@ namespace vis
       if (y >= h) y = h - 1;
       if (z >= d) z = d - 1;
   
-      return data[x + (w * y) + (w * h * z)];
+      return data[x + (w * y) + (size_t(w) * h * z)];
+    }
+
+    // Sum of the values inside [x0, x1] x [y0, y1] x [z0, z1]
+    T Query (int x0, int y0, int z0, int x1, int y1, int z1)
+    {
+      x0 = x0 - 1;
+      y0 = y0 - 1;
+      z0 = z0 - 1;
+
+      // Values covered, with the same clamping of GetValue
+      double n_values = double(std::min(std::max(x1, -1), (int)w - 1) - std::min(std::max(x0, -1), (int)w - 1))
+                      * double(std::min(std::max(y1, -1), (int)h - 1) - std::min(std::max(y0, -1), (int)h - 1))
+                      * double(std::min(std::max(z1, -1), (int)d - 1) - std::min(std::max(z0, -1), (int)d - 1));
+
+      return GetValue(x1, y1, z1)
+           - GetValue(x0, y1, z1) - GetValue(x1, y0, z1) - GetValue(x1, y1, z0)
+           + GetValue(x0, y0, z1) + GetValue(x0, y1, z0) + GetValue(x1, y0, z0)
+           - GetValue(x0, y0, z0) + T(offset * n_values);
+    }
+
+    // Prefix sum of [0, x) x [0, y) x [0, z) in continuous coordinates, where
+    //  value (i, j, k) covers [i, i + 1) x [j, j + 1) x [k, k + 1): trilinear
+    //  interpolation of the SAT, exact for partially covered values.
+    // Same as the linear filtered SAT texture of the shaders (1-voxel zero
+    //  border, clamp to edge): a world position p is at x = p / VolumeScales + 0.5
+    T GetPrefixSum (double x, double y, double z)
+    {
+      return T(GetPrefixSumDouble(x, y, z));
+    }
+
+    // GetPrefixSum without the conversion to T: box sums are combined in double
+    double GetPrefixSumDouble (double x, double y, double z)
+    {
+      x = std::min(std::max(x, 0.0), double(w));
+      y = std::min(std::max(y, 0.0), double(h));
+      z = std::min(std::max(z, 0.0), double(d));
+
+      int ix = (int)x, iy = (int)y, iz = (int)z;
+      double fx = x - double(ix), fy = y - double(iy), fz = z - double(iz);
+
+      // Prefix sum at the integer corner (i, j, k) is GetValue(i - 1, j - 1, k - 1)
+      double c00 = (double)GetValue(ix - 1, iy - 1, iz - 1) * (1.0 - fx) + (double)GetValue(ix, iy - 1, iz - 1) * fx;
+      double c10 = (double)GetValue(ix - 1, iy    , iz - 1) * (1.0 - fx) + (double)GetValue(ix, iy    , iz - 1) * fx;
+      double c01 = (double)GetValue(ix - 1, iy - 1, iz    ) * (1.0 - fx) + (double)GetValue(ix, iy - 1, iz    ) * fx;
+      double c11 = (double)GetValue(ix - 1, iy    , iz    ) * (1.0 - fx) + (double)GetValue(ix, iy    , iz    ) * fx;
+
+      double c0 = c00 * (1.0 - fy) + c10 * fy;
+      double c1 = c01 * (1.0 - fy) + c11 * fy;
+      return c0 * (1.0 - fz) + c1 * fz + offset * x * y * z;
+    }
+
+    // Sum of the values inside [x0, x1) x [y0, y1) x [z0, z1), in the
+    //  continuous coordinates of GetPrefixSum
+    T QueryFractional (double x0, double y0, double z0, double x1, double y1, double z1)
+    {
+      return T(GetPrefixSumDouble(x1, y1, z1)
+             - GetPrefixSumDouble(x0, y1, z1) - GetPrefixSumDouble(x1, y0, z1) - GetPrefixSumDouble(x1, y1, z0)
+             + GetPrefixSumDouble(x0, y0, z1) + GetPrefixSumDouble(x0, y1, z0) + GetPrefixSumDouble(x1, y0, z0)
+             - GetPrefixSumDouble(x0, y0, z0));
+    }
+
+    // Batched queries, "boxes" has 6 values per box: x0, y0, z0, x1, y1, z1
+    // . Large batches are split between threads (each box is independent)
+    void Query (int n_boxes, const int* boxes, T* sums)
+    {
+#pragma omp parallel for schedule(static) if (n_boxes > SUMMED_AREA_TABLE_PARALLEL_QUERIES)
+      for (int i = 0; i < n_boxes; i++)
+      {
+        const int* b = boxes + size_t(i) * 6;
+        sums[i] = Query(b[0], b[1], b[2], b[3], b[4], b[5]);
+      }
+    }
+
+    void QueryFractional (int n_boxes, const double* boxes, T* sums)
+    {
+#pragma omp parallel for schedule(static) if (n_boxes > SUMMED_AREA_TABLE_PARALLEL_QUERIES)
+      for (int i = 0; i < n_boxes; i++)
+      {
+        const double* b = boxes + size_t(i) * 6;
+        sums[i] = QueryFractional(b[0], b[1], b[2], b[3], b[4], b[5]);
+      }
     }
     
     // 2010 - Real-time ambient occlusion and halos with Summed Area Tables
-    // TODO:
-    // . Use #pragma omp parallel for
+    // Computed as three separable prefix sums (x, y and then z), each one
+    //  reading a single previous value per voxel:
+    // . x and y: slices are independent, computed in parallel
+    // . z: rows of consecutive slices are added, in parallel over y
     virtual void BuildSAT ()
     {
+      const int sw = (int)w, sh = (int)h, sd = (int)d;
+      const size_t slice_size = size_t(w)*size_t(h);
+
       //////////////////////////////////////////////////////////////
-      // 1 - First Step
-      SetValue(GetValue(0, 0, 0), 0, 0, 0);
-  
-      //////////////////////////////////////////////////////////////
-      // 2 - Second Step
-      for (int x = 1; x < w; x++)
-        SetValue(GetValue(x - 1, 0, 0) + GetValue(x, 0, 0), x, 0, 0);
-      for (int y = 1; y < h; y++)
-        SetValue(GetValue(0, y - 1, 0) + GetValue(0, y, 0), 0, y, 0);
-      for (int z = 1; z < d; z++)
-        SetValue(GetValue(0, 0, z - 1) + GetValue(0, 0, z), 0, 0, z);
-  
-      //////////////////////////////////////////////////////////////
-      // 3 - Third Step
-      for (int x = 1; x < w; x++)
-        for (int z = 1; z < d; z++)
-          SetValue(GetValue(x - 1, 0, z) +
-                   GetValue(x, 0, z - 1) -
-                   GetValue(x - 1, 0, z - 1) +
-                   GetValue(x, 0, z),
-                   x, 0, z);
-      for (int x = 1; x < w; x++)
-        for (int y = 1; y < h; y++)
-          SetValue(GetValue(x - 1, y, 0) +
-                   GetValue(x, y - 1, 0) - 
-                   GetValue(x - 1, y - 1, 0) +
-                   GetValue(x, y, 0),
-                   x, y, 0);
-      for (int y = 1; y < h; y++)
-        for (int z = 1; z < d; z++)
-          SetValue(GetValue(0, y - 1, z) + 
-                   GetValue(0, y, z - 1) - 
-                   GetValue(0, y - 1, z - 1) + 
-                   GetValue(0, y, z),
-                   0, y, z);
+      // 1 - Prefix sums along x and y of each slice
+#pragma omp parallel for schedule(static)
+      for (int z = 0; z < sd; z++)
+      {
+        T* slice = data + size_t(z) * slice_size;
+        for (int y = 0; y < sh; y++)
+        {
+          T* row = slice + size_t(y) * sw;
+          for (int x = 1; x < sw; x++)
+            row[x] += row[x - 1];
+        }
+        for (int y = 1; y < sh; y++)
+        {
+          T* row = slice + size_t(y) * sw;
+          const T* prev_row = row - sw;
+          for (int x = 0; x < sw; x++)
+            row[x] += prev_row[x];
+        }
+      }
 
       //////////////////////////////////////////////////////////////
-      // 4 - Fourth Step
-      for (int x = 1; x < w; x++)
+      // 2 - Prefix sums along z
+#pragma omp parallel for schedule(static)
+      for (int y = 0; y < sh; y++)
       {
-        for (int y = 1; y < h; y++)
+        for (int z = 1; z < sd; z++)
         {
-          for (int z = 1; z < d; z++)
-          {
-            T val = GetValue(x, y, z)
-                  + GetValue(x - 1, y - 1, z - 1)
-                  + GetValue(x, y, z - 1)
-                  + GetValue(x, y - 1, z)
-                  + GetValue(x - 1, y, z)
-                  - GetValue(x - 1, y - 1, z)
-                  - GetValue(x, y - 1, z - 1)
-                  - GetValue(x - 1, y, z - 1);
-  
-            SetValue(val, x, y, z);
-          }
+          T* row = data + size_t(z) * slice_size + size_t(y) * sw;
+          const T* prev_row = row - slice_size;
+          for (int x = 0; x < sw; x++)
+            row[x] += prev_row[x];
         }
       }
     }
@@ -298,9 +382,22 @@ namespace vis
   protected:
     T* data;
     T zero;
+    double offset;
 
   private:
   };
+
+  // Builds in place the summed-area table of the w * h * d float values of
+  //  "data", accumulating in double (only two slices of doubles are kept).
+  //  Each result is rounded to float once.
+  // . offset: subtracted from each value before the sums. With the mean value,
+  //   the sums stay close to zero instead of growing up to the total, and box
+  //   sums far from the origin do not lose the float precision of the large
+  //   prefix sums: they are the stored box sum + offset * number of values.
+  //   The correction is linear in each axis, so it is exact for trilinear
+  //   filtered fetches too (SummedAreaTable3D::SetOffset).
+  void BuildFloatSummedAreaTable3D (float* data, unsigned int w, unsigned int h, unsigned int d,
+                                    float offset = 0.0f);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,360 @@
+/**
+ * cubicsplinevolume.cpp
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#include <volvis_utils/cubicsplinevolume.h>
+
+#include <vis_utils/filters/bspline3.hpp>
+#include <vis_utils/filters/omoms3.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+namespace vis
+{
+  // Pre-factored LU decompositions of the digital filters, same values of
+  //  CardinalBspline3::digital_filter and CardinalOMOMS3::digital_filter
+  static const float BSPLINE3_LU[8] = { .2f, .26315789f, .26760563f,
+    .26792453f, .26794742f, .26794907f, .26794918f, .26794919f };
+  static const float OMOMS3_LU[9] = { .23529412f, .33170732f, .34266611f,
+    .34395774f, .34411062f, .34412872f, .34413087f, .34413112f, .34413115f };
+
+  // Mirror extension: -1 -> 0, n -> n - 1
+  static inline int MirrorIndex (int i, int n)
+  {
+    if (i >= 0 && i < n) return i;
+    int period = 2 * n;
+    i = i % period;
+    if (i < 0) i += period;
+    return i < n ? i : period - 1 - i;
+  }
+
+  template<typename T>
+  static void CopyNormalizedValues (const T* values, float scale, size_t slice_size, int depth, float* coefficients)
+  {
+#pragma omp parallel for
+    for (int z = 0; z < depth; z++)
+    {
+      const T* in = values + size_t(z) * slice_size;
+      float* out = coefficients + size_t(z) * slice_size;
+      for (size_t i = 0; i < slice_size; i++)
+        out[i] = (float)in[i] * scale;
+    }
+  }
+
+  // Solve "length" rows of "row_width" consecutive values (row i starting at
+  //  plane + i * row_stride) in place, as vis::linear_solve does for a single
+  //  sequence, then multiply by the kernel integral (normalized kernel).
+  //  Requires length > m.
+  static void LinearSolveRows (const float* L, int m, float integral,
+                               float* plane, int length, int row_width, size_t row_stride)
+  {
+    const float L_inf = L[m - 1], v_inv = L_inf / (1.f + L_inf);
+
+    // Forward pass: solve Lc0 = f
+    for (int i = 1; i < length; i++)
+    {
+      float l = L[std::min(i, m) - 1];
+      float* row = plane + size_t(i) * row_stride;
+      const float* prev_row = row - row_stride;
+      for (int x = 0; x < row_width; x++)
+        row[x] -= l * prev_row[x];
+    }
+
+    // Reverse pass: solve Uc = c0
+    float* last_row = plane + size_t(length - 1) * row_stride;
+    for (int x = 0; x < row_width; x++)
+      last_row[x] *= v_inv;
+    for (int i = length - 2; i >= 0; i--)
+    {
+      float l = i >= m - 1 ? L_inf : L[i];
+      float* row = plane + size_t(i) * row_stride;
+      const float* next_row = row + row_stride;
+      for (int x = 0; x < row_width; x++)
+        row[x] = l * (row[x] - next_row[x]);
+    }
+
+    for (int i = 0; i < length; i++)
+    {
+      float* row = plane + size_t(i) * row_stride;
+      for (int x = 0; x < row_width; x++)
+        row[x] *= integral;
+    }
+  }
+
+  // Sequences with at most m values are grown by reflection inside the
+  //  kernel digital filter
+  static void DigitalFilterShortRows (const KernelBase<4, float>& k, float integral,
+                                      float* plane, int length, int row_width, size_t row_stride)
+  {
+    std::vector<float> f(length);
+    for (int x = 0; x < row_width; x++)
+    {
+      for (int i = 0; i < length; i++)
+        f[i] = plane[size_t(i) * row_stride + x];
+      k.digital_filter(f);
+      for (int i = 0; i < length; i++)
+        plane[size_t(i) * row_stride + x] = f[i] * integral;
+    }
+  }
+
+  static void FilterRows (IMAGE_FILTER_KERNEL kernel, float* plane, int length, int row_width, size_t row_stride)
+  {
+    if (kernel == IMAGE_FILTER_KERNEL::K4_CARDINAL_OMOMS3)
+    {
+      CardinalOMOMS3 k;
+      if (length > 9) LinearSolveRows(OMOMS3_LU, 9, k.integral(), plane, length, row_width, row_stride);
+      else DigitalFilterShortRows(k, k.integral(), plane, length, row_width, row_stride);
+    }
+    else
+    {
+      CardinalBspline3 k;
+      if (length > 8) LinearSolveRows(BSPLINE3_LU, 8, k.integral(), plane, length, row_width, row_stride);
+      else DigitalFilterShortRows(k, k.integral(), plane, length, row_width, row_stride);
+    }
+  }
+
+  bool ComputeCubicSplineCoefficients (StructuredGridVolume* vol, float* coefficients, IMAGE_FILTER_KERNEL kernel)
+  {
+    if (!vol || !vol->GetArrayData() || !coefficients) return false;
+    if (kernel != IMAGE_FILTER_KERNEL::K4_CARDINAL_BSPLINE_3 && kernel != IMAGE_FILTER_KERNEL::K4_CARDINAL_OMOMS3)
+      return false;
+
+    int width = (int)vol->GetWidth();
+    int height = (int)vol->GetHeight();
+    int depth = (int)vol->GetDepth();
+    size_t slice_size = size_t(width) * size_t(height);
+    void* values = vol->GetArrayData();
+
+    // Same normalization as GetNormalizedSample
+    DataStorageSize dss = vol->GetDataStorageSize();
+    if (dss == DataStorageSize::_8_BITS)
+      CopyNormalizedValues(static_cast<const unsigned char*>(values), (float)(1.0 / (256.0 - 1.0)), slice_size, depth, coefficients);
+    else if (dss == DataStorageSize::_16_BITS)
+      CopyNormalizedValues(static_cast<const unsigned short*>(values), (float)(1.0 / (65536.0 - 1.0)), slice_size, depth, coefficients);
+    else if (dss == DataStorageSize::_NORMALIZED_F)
+      CopyNormalizedValues(static_cast<const float*>(values), 1.0f, slice_size, depth, coefficients);
+    else if (dss == DataStorageSize::_NORMALIZED_D)
+      CopyNormalizedValues(static_cast<const double*>(values), 1.0f, slice_size, depth, coefficients);
+    else
+      return false;
+
+    // x: each row is a sequence
+    // y: rows of a slice are filtered together, as sequences of rows
+#pragma omp parallel for schedule(dynamic)
+    for (int z = 0; z < depth; z++)
+    {
+      float* slice = coefficients + size_t(z) * slice_size;
+      for (int y = 0; y < height; y++)
+        FilterRows(kernel, slice + size_t(y) * width, width, 1, 1);
+      FilterRows(kernel, slice, height, width, size_t(width));
+    }
+
+    // z: for each y, rows of consecutive slices
+#pragma omp parallel for schedule(dynamic)
+    for (int y = 0; y < height; y++)
+      FilterRows(kernel, coefficients + size_t(y) * width, depth, width, slice_size);
+
+    return true;
+  }
+
+  CubicSplineVolume::CubicSplineVolume ()
+    : m_width(0)
+    , m_height(0)
+    , m_depth(0)
+    , m_kernel(IMAGE_FILTER_KERNEL::K4_CARDINAL_BSPLINE_3)
+    , m_coefficients(nullptr)
+    , m_prefilter_time(0.0)
+  {
+  }
+
+  CubicSplineVolume::~CubicSplineVolume ()
+  {
+    Destroy();
+  }
+
+  bool CubicSplineVolume::Build (StructuredGridVolume* vol, IMAGE_FILTER_KERNEL kernel)
+  {
+    Destroy();
+    if (!vol || !vol->GetArrayData()) return false;
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+    float* coefficients = new float[size_t(vol->GetWidth()) * size_t(vol->GetHeight()) * size_t(vol->GetDepth())];
+    if (!ComputeCubicSplineCoefficients(vol, coefficients, kernel))
+    {
+      delete[] coefficients;
+      return false;
+    }
+
+    m_width = (int)vol->GetWidth();
+    m_height = (int)vol->GetHeight();
+    m_depth = (int)vol->GetDepth();
+    m_kernel = kernel;
+    m_coefficients = coefficients;
+
+    m_prefilter_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return true;
+  }
+
+  void CubicSplineVolume::Destroy ()
+  {
+    if (m_coefficients) delete[] m_coefficients;
+    m_coefficients = nullptr;
+    m_width = m_height = m_depth = 0;
+  }
+
+  bool CubicSplineVolume::IsBuilt ()
+  {
+    return m_coefficients != nullptr;
+  }
+
+  int CubicSplineVolume::GetWidth ()
+  {
+    return m_width;
+  }
+
+  int CubicSplineVolume::GetHeight ()
+  {
+    return m_height;
+  }
+
+  int CubicSplineVolume::GetDepth ()
+  {
+    return m_depth;
+  }
+
+  IMAGE_FILTER_KERNEL CubicSplineVolume::GetKernel ()
+  {
+    return m_kernel;
+  }
+
+  const float* CubicSplineVolume::GetCoefficients ()
+  {
+    return m_coefficients;
+  }
+
+  size_t CubicSplineVolume::GetMemorySize ()
+  {
+    return size_t(m_width) * size_t(m_height) * size_t(m_depth) * sizeof(float);
+  }
+
+  double CubicSplineVolume::GetPrefilterTime ()
+  {
+    return m_prefilter_time;
+  }
+
+  double CubicSplineVolume::GetInterpolatedValue (double x, double y, double z)
+  {
+    if (!m_coefficients) return 0.0;
+
+    glm::dvec3 p(x, y, z);
+    glm::dvec3 i = glm::floor(p);
+    glm::dvec3 t = p - i;
+
+    double wx[4], wy[4], wz[4];
+    GetWeights(t.x, wx);
+    GetWeights(t.y, wy);
+    GetWeights(t.z, wz);
+
+    // Each pair of weights becomes a single linear fetch between the two
+    //  coefficients: g0 at h0 in [i - 1, i], g1 at h1 in [i + 1, i + 2]
+    glm::dvec3 g0(wx[0] + wx[1], wy[0] + wy[1], wz[0] + wz[1]);
+    glm::dvec3 g1(wx[2] + wx[3], wy[2] + wy[3], wz[2] + wz[3]);
+    glm::dvec3 h0 = i - 1.0 + glm::dvec3(wx[1], wy[1], wz[1]) / g0;
+    glm::dvec3 h1 = i + 1.0 + glm::dvec3(wx[3], wy[3], wz[3]) / g1;
+
+    double v0 = g0.x * GetTrilinearCoefficient(h0.x, h0.y, h0.z) + g1.x * GetTrilinearCoefficient(h1.x, h0.y, h0.z);
+    double v1 = g0.x * GetTrilinearCoefficient(h0.x, h1.y, h0.z) + g1.x * GetTrilinearCoefficient(h1.x, h1.y, h0.z);
+    double v2 = g0.x * GetTrilinearCoefficient(h0.x, h0.y, h1.z) + g1.x * GetTrilinearCoefficient(h1.x, h0.y, h1.z);
+    double v3 = g0.x * GetTrilinearCoefficient(h0.x, h1.y, h1.z) + g1.x * GetTrilinearCoefficient(h1.x, h1.y, h1.z);
+
+    return g0.z * (g0.y * v0 + g1.y * v1) + g1.z * (g0.y * v2 + g1.y * v3);
+  }
+
+  double CubicSplineVolume::SampleValue (glm::dvec3 tex_coord)
+  {
+    return GetInterpolatedValue(tex_coord.x * m_width - 0.5, tex_coord.y * m_height - 0.5, tex_coord.z * m_depth - 0.5);
+  }
+
+  double CubicSplineVolume::GetInterpolatedValueReference (double x, double y, double z)
+  {
+    if (!m_coefficients) return 0.0;
+
+    glm::dvec3 p(x, y, z);
+    glm::ivec3 i = glm::ivec3(glm::floor(p));
+    glm::dvec3 t = p - glm::floor(p);
+
+    double wx[4], wy[4], wz[4];
+    GetWeights(t.x, wx);
+    GetWeights(t.y, wy);
+    GetWeights(t.z, wz);
+
+    double value = 0.0;
+    for (int c = 0; c < 4; c++)
+      for (int b = 0; b < 4; b++)
+        for (int a = 0; a < 4; a++)
+          value += wx[a] * wy[b] * wz[c] * GetCoefficient(i.x - 1 + a, i.y - 1 + b, i.z - 1 + c);
+
+    return value;
+  }
+
+  double CubicSplineVolume::GetCoefficient (int x, int y, int z)
+  {
+    x = MirrorIndex(x, m_width);
+    y = MirrorIndex(y, m_height);
+    z = MirrorIndex(z, m_depth);
+    return (double)m_coefficients[x + size_t(y) * m_width + size_t(z) * m_width * m_height];
+  }
+
+  double CubicSplineVolume::GetTrilinearCoefficient (double x, double y, double z)
+  {
+    glm::dvec3 p(x, y, z);
+    glm::dvec3 f = glm::floor(p);
+    glm::dvec3 d = p - f;
+    glm::ivec3 p0 = glm::ivec3(f);
+
+    int x0 = MirrorIndex(p0.x, m_width), x1 = MirrorIndex(p0.x + 1, m_width);
+    int y0 = MirrorIndex(p0.y, m_height), y1 = MirrorIndex(p0.y + 1, m_height);
+    int z0 = MirrorIndex(p0.z, m_depth), z1 = MirrorIndex(p0.z + 1, m_depth);
+
+    size_t slice_size = size_t(m_width) * size_t(m_height);
+    const float* s0 = m_coefficients + size_t(z0) * slice_size;
+    const float* s1 = m_coefficients + size_t(z1) * slice_size;
+    size_t r0 = size_t(y0) * m_width, r1 = size_t(y1) * m_width;
+
+    double c00 = s0[r0 + x0] + (s0[r0 + x1] - s0[r0 + x0]) * d.x;
+    double c10 = s0[r1 + x0] + (s0[r1 + x1] - s0[r1 + x0]) * d.x;
+    double c01 = s1[r0 + x0] + (s1[r0 + x1] - s1[r0 + x0]) * d.x;
+    double c11 = s1[r1 + x0] + (s1[r1 + x1] - s1[r1 + x0]) * d.x;
+
+    double c0 = c00 + (c10 - c00) * d.y;
+    double c1 = c01 + (c11 - c01) * d.y;
+    return c0 + (c1 - c0) * d.z;
+  }
+
+  // Kernel pieces are scaled by the kernel integral:
+  //  w[0] = K(t + 1), w[1] = K(t), w[2] = K(1 - t), w[3] = K(2 - t)
+  void CubicSplineVolume::GetWeights (double t, double w[4])
+  {
+    float u = (float)t;
+    if (m_kernel == IMAGE_FILTER_KERNEL::K4_CARDINAL_OMOMS3)
+    {
+      w[0] = OMOMS3Pieces::k0(1.0f - u) / 5.25;
+      w[1] = OMOMS3Pieces::k1(1.0f - u) / 5.25;
+      w[2] = OMOMS3Pieces::k1(u) / 5.25;
+      w[3] = OMOMS3Pieces::k0(u) / 5.25;
+    }
+    else
+    {
+      w[0] = Bspline3Pieces::k0(1.0f - u) / 6.0;
+      w[1] = Bspline3Pieces::k1(1.0f - u) / 6.0;
+      w[2] = Bspline3Pieces::k1(u) / 6.0;
+      w[3] = Bspline3Pieces::k0(u) / 6.0;
+    }
+  }
+}
@@ -0,0 +1,82 @@
+/**
+ * cubicsplinevolume.h
+ *
+ * Cubic spline representation of a structured volume (cardinal B-spline or
+ *   O-MOMS), used for tricubic reconstruction of the scalar field.
+ *
+ * Build converts the normalized voxel values into spline coefficients with
+ *   the recursive digital filter of the kernel (same pre-factored LU
+ *   decomposition of CardinalBspline3/CardinalOMOMS3, vis_utils/filters),
+ *   applied in parallel along x, y and z. Borders use mirror extension
+ *   (half-sample symmetric), as GeneralizedSampling.
+ *
+ * The coefficients are sampled as in "Fast Third-Order Texture Filtering"
+ *   (Sigg and Hadwiger, GPU Gems 2): the 4x4x4 weighted coefficients are
+ *   evaluated with 8 trilinear fetches. On the GPU, the same is done with
+ *   GenerateCubicSplineCoefficientTexture (linear filtering, mirrored repeat).
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#ifndef VOL_VIS_UTILS_CUBIC_SPLINE_VOLUME_H
+#define VOL_VIS_UTILS_CUBIC_SPLINE_VOLUME_H
+
+#include <volvis_utils/structuredgridvolume.h>
+#include <vis_utils/filters/utils.hpp>
+
+#include <glm/glm.hpp>
+
+namespace vis
+{
+  // Spline coefficients of the normalized values of "vol", "coefficients"
+  //  must have width * height * depth values
+  // . kernel: K4_CARDINAL_BSPLINE_3 or K4_CARDINAL_OMOMS3
+  bool ComputeCubicSplineCoefficients (StructuredGridVolume* vol, float* coefficients,
+                                       IMAGE_FILTER_KERNEL kernel = IMAGE_FILTER_KERNEL::K4_CARDINAL_BSPLINE_3);
+
+  class CubicSplineVolume
+  {
+  public:
+    CubicSplineVolume ();
+    ~CubicSplineVolume ();
+
+    bool Build (StructuredGridVolume* vol, IMAGE_FILTER_KERNEL kernel = IMAGE_FILTER_KERNEL::K4_CARDINAL_BSPLINE_3);
+    void Destroy ();
+
+    bool IsBuilt ();
+    int GetWidth ();
+    int GetHeight ();
+    int GetDepth ();
+    IMAGE_FILTER_KERNEL GetKernel ();
+    const float* GetCoefficients ();
+    size_t GetMemorySize ();
+    // Time of the last Build, in milliseconds
+    double GetPrefilterTime ();
+
+    // Tricubic reconstruction at voxel coordinates (voxel centers at integer
+    //  positions), with 8 trilinear fetches
+    double GetInterpolatedValue (double x, double y, double z);
+    // Same as a texture fetch: texture coordinates in [0, 1]
+    double SampleValue (glm::dvec3 tex_coord);
+
+    // Direct evaluation of the 4x4x4 weighted coefficients, used as reference
+    double GetInterpolatedValueReference (double x, double y, double z);
+
+  protected:
+    double GetCoefficient (int x, int y, int z);
+    double GetTrilinearCoefficient (double x, double y, double z);
+    // Normalized kernel weights of the 4 coefficients around a sample at
+    //  fractional position t, between the 2nd and 3rd coefficients
+    void GetWeights (double t, double w[4]);
+
+    int m_width, m_height, m_depth;
+    IMAGE_FILTER_KERNEL m_kernel;
+    float* m_coefficients;
+    double m_prefilter_time;
+
+  private:
+
+  };
+}
+
+#endif
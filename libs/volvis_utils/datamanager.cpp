@@ -10,10 +10,14 @@
 #include <gl_utils/computeshader.h>
 #include <vis_utils/defines.h>
 #include <volvis_utils/utils.h>
+#include <volvis_utils/preprocessinggraph.h>
 
 
 #include <volvis_utils/reader.h>
 
+// Minimum interval between gradient regenerations of in-situ frames
+#define IN_SITU_GRADIENT_INTERVAL_MS 500.0
+
 namespace vis
 {
   DataManager::DataManager ()
@@ -27,6 +31,17 @@ namespace vis
     , curr_gradient_comp_model(DataManager::STRUCTURED_GRADIENT_TYPE::NONE_GRADIENT)
     , curr_gl_tex_structured_volume(nullptr)
     , curr_gl_tex_structured_gradient(nullptr)
+    , m_encoded_gradients(true)
+    , m_volume_changed(false)
+    , m_progressive_loading(false)
+    , m_preview_stride(4)
+    , m_preview_average(false)
+    , m_curr_volume_is_preview(false)
+    , m_cancel_full_volume_loader(false)
+    , m_preview_load_time(0.0)
+    , m_full_load_time(0.0)
+    , m_insitu_upload_time(0.0)
+    , m_curr_volume_is_insitu(false)
   {
     m_path_to_data = "";
 #ifdef USE_DATA_PROVIDER
@@ -50,6 +65,7 @@ namespace vis
   void DataManager::SetPathToData (std::string s_path_to_data)
   {
     m_path_to_data = s_path_to_data;
+    m_derived_data_cache.SetDirectory(m_path_to_data + "/#derived_data_cache");
   }
 
   vis::GRID_VOLUME_DATA_TYPE DataManager::GetInputVolumeDataType ()
@@ -84,8 +100,14 @@ namespace vis
     ui_dataset_names.clear();
     ui_transferf_names.clear();
 
+    // The start-up listing comes from the dataset catalog, while the list
+    //  it was built from does not change
     if (curr_vol_data_type == vis::GRID_VOLUME_DATA_TYPE::STRUCTURED)
-      ReadStructuredDatasetsFromRes();
+    {
+      m_dataset_catalog.Load(m_path_to_data + "/#catalog_structured_datasets");
+      if (!ReadStructuredDatasetsFromCatalog())
+        ReadStructuredDatasetsFromRes();
+    }
 #endif
 
     ReadTransferFunctionsFromRes();
@@ -95,6 +117,21 @@ namespace vis
       GenerateStructuredVolumeTexture();
     }
 
+#ifndef USE_DATA_PROVIDER
+    // Update the dataset catalog in background, after reading the first volume
+    if (curr_vol_data_type == vis::GRID_VOLUME_DATA_TYPE::STRUCTURED)
+    {
+      std::vector<std::string> dataset_paths;
+      std::vector<std::string> dataset_names;
+      for (int i = 0; i < (int)stored_structured_datasets.size(); i++)
+      {
+        dataset_paths.push_back(stored_structured_datasets[i].path);
+        dataset_names.push_back(stored_structured_datasets[i].name);
+      }
+      m_dataset_catalog.Refresh(m_path_to_data + "/#list_structured_datasets", dataset_paths, dataset_names);
+    }
+#endif
+
     vis::TransferFunctionReader tfr;
     curr_vr_transferfunction = tfr.ReadTransferFunction(stored_transfer_functions[GetCurrentTransferFunctionIndex()].path);
     curr_vr_transferfunction->SetName(stored_transfer_functions[GetCurrentTransferFunctionIndex()].name);
@@ -145,6 +182,25 @@ namespace vis
     return curr_uns_grid_volume;
   }
   
+  vis::DatasetCatalog* DataManager::GetDatasetCatalog ()
+  {
+#ifdef USE_DATA_PROVIDER
+    return nullptr;
+#else
+    return &m_dataset_catalog;
+#endif
+  }
+
+  bool DataManager::GetDatasetCatalogEntry (int id, vis::DatasetCatalogEntry* entry)
+  {
+#ifdef USE_DATA_PROVIDER
+    return false;
+#else
+    if (id < 0 || id >= stored_structured_datasets.size()) return false;
+    return m_dataset_catalog.GetEntry(stored_structured_datasets[id].path, entry);
+#endif
+  }
+
   vis::TransferFunction* DataManager::GetCurrentTransferFunction ()
   {
     return curr_vr_transferfunction;
@@ -207,15 +263,34 @@ namespace vis
   ////////////////////////////////////////////////////////////////////////
   void DataManager::DeleteVolumeData ()
   {
+    DiscardFullVolumeLoader();
+#ifndef USE_DATA_PROVIDER
+    WaitDatasetCatalogUpdate();
+#endif
+
     if (curr_vr_volume) delete curr_vr_volume;
     curr_vr_volume = nullptr;
 
+    // the attached volume is a view of the shared memory segment
+    m_shared_volume_attached.Release();
+    m_curr_volume_is_insitu = false;
+
+    DiscardDensityGradientHistogram();
+    m_volume_changed = true;
+
     if (curr_gl_tex_structured_volume) delete curr_gl_tex_structured_volume;
     curr_gl_tex_structured_volume = nullptr;
 
     DeleteGradientData();
   }
 
+  void DataManager::DiscardDensityGradientHistogram ()
+  {
+    if (m_density_gradient_histogram_task.valid())
+      m_density_gradient_histogram_task.get();
+    m_density_gradient_histogram.SetVolume(nullptr);
+  }
+
   void DataManager::DeleteGradientData ()
   {
     if (curr_gl_tex_structured_gradient) delete curr_gl_tex_structured_gradient;
@@ -270,6 +345,24 @@ namespace vis
     curr_volume_index = 0;
   }
 
+  bool DataManager::ReadStructuredDatasetsFromCatalog ()
+  {
+    std::vector<vis::DatasetCatalogEntry> entries;
+    if (!m_dataset_catalog.GetListedEntries(m_path_to_data + "/#list_structured_datasets", &entries))
+      return false;
+
+    std::cout << "Reading structured datasets from catalog..." << std::endl;
+    for (int i = 0; i < (int)entries.size(); i++)
+    {
+      stored_structured_datasets.push_back(DataReference(entries[i].path, entries[i].name));
+      std::cout << i << ": " << stored_structured_datasets[i].name << std::endl;
+      ui_dataset_names.push_back(stored_structured_datasets[i].name);
+    }
+
+    curr_volume_index = 0;
+    return true;
+  }
+
   void DataManager::ReadTransferFunctionsFromRes ()
   {
     std::string line;
@@ -306,17 +399,62 @@ namespace vis
     for (int i = 0; i < stored_transfer_functions.size(); i++)
       ui_transferf_names.push_back(stored_transfer_functions[i].name);
   }
+
+  void DataManager::UpdateDatasetCatalogEntry (std::string path, vis::StructuredGridVolume* vol)
+  {
+    WaitDatasetCatalogUpdate();
+
+    // The content hash is cached here: the gradient and SAT cache keys read it
+    //  on this thread while the statistics are computed
+    vol->GetContentHash();
+
+    vis::DatasetCatalog* catalog = &m_dataset_catalog;
+    m_dataset_catalog_task = std::async(std::launch::async, [catalog, path, vol]() {
+      catalog->UpdateEntry(path, vol);
+    });
+  }
+
+  void DataManager::WaitDatasetCatalogUpdate ()
+  {
+    if (m_dataset_catalog_task.valid())
+      m_dataset_catalog_task.get();
+  }
 #endif
 
   bool DataManager::GenerateStructuredVolumeTexture ()
   {
+    m_volume_load_start = std::chrono::steady_clock::now();
+    m_curr_volume_is_preview = false;
+
     // Read Volume
 #ifdef USE_DATA_PROVIDER
     curr_vr_volume = m_data_provider->LoadStructuredGrid(GetCurrentVolumeIndex());
 #else
     vis::VolumeReader vr;
-    curr_vr_volume = vr.ReadStructuredVolume(stored_structured_datasets[GetCurrentVolumeIndex()].path);
+    std::string volume_path = stored_structured_datasets[GetCurrentVolumeIndex()].path;
+    if (m_progressive_loading && m_preview_stride > 1 && vr.IsPreviewSupported(volume_path))
+    {
+      curr_vr_volume = vr.ReadStructuredVolumePreview(volume_path, m_preview_stride, m_preview_average);
+      if (curr_vr_volume)
+      {
+        m_curr_volume_is_preview = true;
+        // the full resolution volume is read in background
+        std::atomic<bool>* cancel = &m_cancel_full_volume_loader;
+        *cancel = false;
+        m_full_volume_loader = std::async(std::launch::async, [volume_path, cancel]() {
+          vis::VolumeReader bg_vr;
+          bg_vr.SetCancelFlag(cancel);
+          return bg_vr.ReadStructuredVolume(volume_path);
+        });
+      }
+    }
+    if (!curr_vr_volume)
+      curr_vr_volume = vr.ReadStructuredVolume(volume_path);
     curr_vr_volume->SetName(stored_structured_datasets[GetCurrentVolumeIndex()].name); 
+
+    // Hash and statistics of the catalog entry, from the full resolution volume
+    if (!m_curr_volume_is_preview)
+      UpdateDatasetCatalogEntry(volume_path, curr_vr_volume);
 #endif
 
     // Generate Volume Texture
@@ -326,18 +464,51 @@ namespace vis
     // Generate gradient, if enabled
     GenerateStructuredGradientTexture();
 
+    double load_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_volume_load_start).count();
+    if (m_curr_volume_is_preview)
+    {
+      m_preview_load_time = load_time;
+      m_full_load_time = 0.0;
+    }
+    else
+    {
+      m_preview_load_time = 0.0;
+      m_full_load_time = load_time;
+    }
+
     return true;
   }
 
+  void DataManager::DiscardFullVolumeLoader ()
+  {
+    if (m_full_volume_loader.valid())
+    {
+      // returns after the slab being read
+      m_cancel_full_volume_loader = true;
+      vis::StructuredGridVolume* full_volume = m_full_volume_loader.get();
+      if (full_volume) delete full_volume;
+    }
+    m_curr_volume_is_preview = false;
+  }
+
   bool DataManager::GenerateStructuredGradientTexture ()
   {
     if (curr_gradient_comp_model == STRUCTURED_GRADIENT_TYPE::SOBEL_FELDMAN_FILTER)
     {
-      curr_gl_tex_structured_gradient = vis::GenerateSobelFeldmanGradientTexture(curr_vr_volume);
+      if (m_encoded_gradients)
+        curr_gl_tex_structured_gradient = vis::GenerateEncodedGradientTexture(curr_vr_volume,
+          vis::GRADIENT_OPERATOR::SOBEL_FELDMAN, 16, 16, GetCurrentVolumeDerivedDataCache());
+      else
+        curr_gl_tex_structured_gradient = vis::GenerateSobelFeldmanGradientTexture(curr_vr_volume, GetCurrentVolumeDerivedDataCache());
     }
     else if (curr_gradient_comp_model == STRUCTURED_GRADIENT_TYPE::FINITE_DIFERENCES)
     {
-      curr_gl_tex_structured_gradient = vis::GenerateGradientTexture(curr_vr_volume);
+      // normalized central differences: unit gradients, without magnitudes
+      if (m_encoded_gradients)
+        curr_gl_tex_structured_gradient = vis::GenerateEncodedGradientTexture(curr_vr_volume,
+          vis::GRADIENT_OPERATOR::CENTRAL_DIFFERENCES, 16, 0, GetCurrentVolumeDerivedDataCache());
+      else
+        curr_gl_tex_structured_gradient = vis::GenerateGradientTexture(curr_vr_volume, 1, 0, true, -1, -1, -1, -1, -1, -1, GetCurrentVolumeDerivedDataCache());
     }
     else if (curr_gradient_comp_model == STRUCTURED_GRADIENT_TYPE::COMPUTE_SHADER_SOBEL)
     {
@@ -351,6 +522,13 @@ namespace vis
     return true;
   }
 
+  vis::DerivedDataCache* DataManager::GetCurrentVolumeDerivedDataCache ()
+  {
+    if (m_curr_volume_is_preview || m_curr_volume_is_insitu || m_shared_volume_attached.IsAttached())
+      return nullptr;
+    return &m_derived_data_cache;
+  }
+
   bool DataManager::PreviousVolume ()
   {
     if (curr_vol_data_type == vis::GRID_VOLUME_DATA_TYPE::STRUCTURED)
@@ -429,6 +607,304 @@ namespace vis
     return false;
   }
     
+  void DataManager::SetProgressiveLoading (bool enabled, int preview_stride, bool preview_average)
+  {
+    m_progressive_loading = enabled;
+    m_preview_stride = glm::max(preview_stride, 1);
+    m_preview_average = preview_average;
+  }
+
+  bool DataManager::IsProgressiveLoadingEnabled ()
+  {
+    return m_progressive_loading;
+  }
+
+  int DataManager::GetPreviewStride ()
+  {
+    return m_preview_stride;
+  }
+
+  bool DataManager::IsPreviewAveraged ()
+  {
+    return m_preview_average;
+  }
+
+  bool DataManager::IsCurrentVolumePreview ()
+  {
+    return m_curr_volume_is_preview;
+  }
+
+  bool DataManager::IsLoadingFullVolume ()
+  {
+    return m_full_volume_loader.valid();
+  }
+
+  bool DataManager::UpdateProgressiveVolume ()
+  {
+    if (!m_full_volume_loader.valid()) return false;
+    if (m_full_volume_loader.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+
+    vis::StructuredGridVolume* full_volume = m_full_volume_loader.get();
+    if (!full_volume)
+    {
+      printf("  - Full resolution volume could not be read, keeping preview\n");
+      return false;
+    }
+    full_volume->SetName(curr_vr_volume->GetName());
+#ifndef USE_DATA_PROVIDER
+    UpdateDatasetCatalogEntry(stored_structured_datasets[GetCurrentVolumeIndex()].path, full_volume);
+#endif
+
+    // Replace preview data
+    DiscardDensityGradientHistogram();
+    m_volume_changed = true;
+    delete curr_vr_volume;
+    curr_vr_volume = full_volume;
+
+    if (curr_gl_tex_structured_volume) delete curr_gl_tex_structured_volume;
+    curr_gl_tex_structured_volume = vis::GenerateRTexture(curr_vr_volume, 0, 0, 0, curr_vr_volume->GetWidth(),
+      curr_vr_volume->GetHeight(), curr_vr_volume->GetDepth());
+
+    m_curr_volume_is_preview = false;
+
+    DeleteGradientData();
+    GenerateStructuredGradientTexture();
+
+    m_full_load_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_volume_load_start).count();
+
+    return true;
+  }
+
+  double DataManager::GetPreviewLoadTime ()
+  {
+    return m_preview_load_time;
+  }
+
+  double DataManager::GetFullLoadTime ()
+  {
+    return m_full_load_time;
+  }
+    
+  bool DataManager::PublishCurrentVolume (std::string segment_name)
+  {
+    if (!curr_vr_volume) return false;
+
+    std::vector<vis::SharedVolumeSegment::DerivedBlock> derived_blocks;
+
+    // Read back the gradient texture, identified by the gradient type
+    GLfloat* gradient_values = nullptr;
+    if (curr_gl_tex_structured_gradient)
+    {
+      vis::SharedVolumeSegment::DerivedBlock gblock;
+      gblock.name = "gradient_" + std::to_string(GetCurrentGradientGenerationTypeID());
+      gblock.width = curr_gl_tex_structured_gradient->GetWidth();
+      gblock.height = curr_gl_tex_structured_gradient->GetHeight();
+      gblock.depth = curr_gl_tex_structured_gradient->GetDepth();
+      gblock.components = 3;
+      gblock.bytes = (unsigned long long)gblock.width * gblock.height * gblock.depth * 3 * sizeof(GLfloat);
+
+      gradient_values = new GLfloat[size_t(gblock.width) * gblock.height * gblock.depth * 3];
+      glBindTexture(GL_TEXTURE_3D, curr_gl_tex_structured_gradient->GetTextureID());
+      glGetTexImage(GL_TEXTURE_3D, 0, GL_RGB, GL_FLOAT, gradient_values);
+      glBindTexture(GL_TEXTURE_3D, 0);
+
+      gblock.data = gradient_values;
+      derived_blocks.push_back(gblock);
+    }
+
+    bool ret = m_shared_volume_publisher.Publish(segment_name, curr_vr_volume, derived_blocks);
+
+    if (gradient_values) delete[] gradient_values;
+    return ret;
+  }
+
+  bool DataManager::AttachSharedVolume (std::string segment_name)
+  {
+    if (curr_vol_data_type != vis::GRID_VOLUME_DATA_TYPE::STRUCTURED) return false;
+
+    DeleteVolumeData();
+    if (!m_shared_volume_attached.Attach(segment_name))
+    {
+      // keep the current dataset
+      GenerateStructuredVolumeTexture();
+      return false;
+    }
+
+    curr_vr_volume = m_shared_volume_attached.CreateVolumeView();
+    curr_vr_volume->SetName(segment_name);
+
+    curr_gl_tex_structured_volume = vis::GenerateRTexture(curr_vr_volume, 0, 0, 0, curr_vr_volume->GetWidth(),
+      curr_vr_volume->GetHeight(), curr_vr_volume->GetDepth());
+
+    // Use the published gradient if it was computed with the current gradient type
+    unsigned int gw, gh, gd, gc;
+    const void* gradient_values = m_shared_volume_attached.GetDerivedData(
+      "gradient_" + std::to_string(GetCurrentGradientGenerationTypeID()), &gw, &gh, &gd, &gc);
+    if (gradient_values && gc == 3 && gw == curr_vr_volume->GetWidth()
+     && gh == curr_vr_volume->GetHeight() && gd == curr_vr_volume->GetDepth())
+    {
+      curr_gl_tex_structured_gradient = new gl::Texture3D(gw, gh, gd);
+      curr_gl_tex_structured_gradient->GenerateTexture(GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+#ifdef USE_16F_INTERNAL_FORMAT
+      curr_gl_tex_structured_gradient->SetData((GLvoid*)gradient_values, GL_RGB16F, GL_RGB, GL_FLOAT);
+#else
+      curr_gl_tex_structured_gradient->SetData((GLvoid*)gradient_values, GL_RGB32F, GL_RGB, GL_FLOAT);
+#endif
+    }
+    else
+    {
+      GenerateStructuredGradientTexture();
+    }
+
+    return true;
+  }
+
+  bool DataManager::IsSharedVolumePublished ()
+  {
+    return m_shared_volume_publisher.IsPublisher();
+  }
+
+  bool DataManager::IsSharedVolumeAttached ()
+  {
+    return m_shared_volume_attached.IsAttached();
+  }
+
+  bool DataManager::ExportCurrentVolume (std::string path_prefix, EXPORT_FORMAT format, EXPORT_VOLUME volume)
+  {
+    if (!curr_vr_volume) return false;
+
+    vis::StructuredGridVolume* export_volume = curr_vr_volume;
+    if (volume == EXPORT_VOLUME::HALF_RESOLUTION_VOLUME)
+      export_volume = curr_vr_volume->CreateResampledVolume(glm::max(curr_vr_volume->GetWidth() / 2, 1u),
+        glm::max(curr_vr_volume->GetHeight() / 2, 1u), glm::max(curr_vr_volume->GetDepth() / 2, 1u));
+    else if (volume == EXPORT_VOLUME::FILTERED_VOLUME)
+      export_volume = curr_vr_volume->CreateFilteredVolume(1);
+    else if (volume == EXPORT_VOLUME::GRADIENT_MAGNITUDE_VOLUME)
+      export_volume = curr_vr_volume->CreateGradientMagnitudeVolume();
+    if (!export_volume) return false;
+
+    bool ret = false;
+    if (format == EXPORT_FORMAT::RAW_FILE)
+      ret = !export_volume->ExportRawFile(path_prefix).empty();
+    else if (format == EXPORT_FORMAT::PVM_FILE)
+      ret = export_volume->ExportPVMFile(path_prefix + ".pvm", false);
+    else if (format == EXPORT_FORMAT::PVM_DDS_FILE)
+      ret = export_volume->ExportPVMFile(path_prefix + ".pvm", true);
+
+    if (export_volume != curr_vr_volume) delete export_volume;
+    return ret;
+  }
+
+  std::vector<std::string> DataManager::GetExportFormatStrList ()
+  {
+    std::vector<std::string> ret;
+    ret.push_back("Raw");
+    ret.push_back("PVM");
+    ret.push_back("PVM (DDS)");
+    return ret;
+  }
+
+  std::vector<std::string> DataManager::GetExportVolumeStrList ()
+  {
+    std::vector<std::string> ret;
+    ret.push_back("Current Volume");
+    ret.push_back("Half Resolution");
+    ret.push_back("Filtered");
+    ret.push_back("Gradient Magnitude");
+    return ret;
+  }
+
+  void DataManager::StartInSituIngest (std::string segment_name)
+  {
+    m_insitu_ingest.Start(segment_name);
+  }
+
+  void DataManager::StopInSituIngest ()
+  {
+    m_insitu_ingest.Stop();
+  }
+
+  bool DataManager::IsInSituIngestRunning ()
+  {
+    return m_insitu_ingest.IsRunning();
+  }
+
+  bool DataManager::UpdateInSituVolume ()
+  {
+    if (curr_vol_data_type != vis::GRID_VOLUME_DATA_TYPE::STRUCTURED) return false;
+
+    vis::StructuredGridVolume* frame_volume = m_insitu_ingest.TakeLatestVolume();
+    if (!frame_volume) return false;
+
+    std::chrono::steady_clock::time_point upload_start = std::chrono::steady_clock::now();
+
+    // The gradient of the previous frame is kept while it has the same size
+    //  and was generated less than IN_SITU_GRADIENT_INTERVAL_MS ago
+    gl::Texture3D* prev_gradient = nullptr;
+    if (curr_gl_tex_structured_gradient && curr_vr_volume
+      && curr_vr_volume->GetWidth() == frame_volume->GetWidth()
+      && curr_vr_volume->GetHeight() == frame_volume->GetHeight()
+      && curr_vr_volume->GetDepth() == frame_volume->GetDepth()
+      && std::chrono::duration<double, std::milli>(upload_start - m_insitu_gradient_start).count() < IN_SITU_GRADIENT_INTERVAL_MS)
+    {
+      prev_gradient = curr_gl_tex_structured_gradient;
+      curr_gl_tex_structured_gradient = nullptr;
+    }
+
+    DeleteVolumeData();
+    curr_vr_volume = frame_volume;
+    m_curr_volume_is_preview = false;
+    m_curr_volume_is_insitu = true;
+
+    curr_gl_tex_structured_volume = vis::GenerateRTexture(curr_vr_volume, 0, 0, 0, curr_vr_volume->GetWidth(),
+      curr_vr_volume->GetHeight(), curr_vr_volume->GetDepth());
+    if (prev_gradient)
+    {
+      curr_gl_tex_structured_gradient = prev_gradient;
+    }
+    else
+    {
+      m_insitu_gradient_start = upload_start;
+      GenerateStructuredGradientTexture();
+    }
+
+    m_insitu_upload_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - upload_start).count();
+
+    return true;
+  }
+
+  vis::InSituIngestStats DataManager::GetInSituIngestStats ()
+  {
+    return m_insitu_ingest.GetStats();
+  }
+
+  double DataManager::GetInSituUploadTime ()
+  {
+    return m_insitu_upload_time;
+  }
+
+  bool DataManager::StartInSituProducerStandIn (std::string segment_name, unsigned int width, unsigned int height,
+                                                unsigned int depth, double frames_per_second)
+  {
+    return m_insitu_producer.Start(segment_name, vis::SyntheticVolumeGenerator::MODEL::GAUSSIAN_BLOBS,
+      width, height, depth, vis::DataStorageSize::_8_BITS, frames_per_second);
+  }
+
+  void DataManager::StopInSituProducerStandIn ()
+  {
+    m_insitu_producer.Stop();
+  }
+
+  bool DataManager::IsInSituProducerStandInRunning ()
+  {
+    return m_insitu_producer.IsRunning();
+  }
+
+  unsigned long long DataManager::GetInSituProducerStandInFrames ()
+  {
+    return m_insitu_producer.GetNumberOfPushedFrames();
+  }
+
   bool DataManager::PreviousTransferFunction ()
   {
     if (curr_transferfunction_index > 0)
@@ -496,6 +972,16 @@ namespace vis
     return false;
   }
   
+  void DataManager::SetEncodedGradients (bool encoded)
+  {
+    m_encoded_gradients = encoded;
+  }
+
+  bool DataManager::IsEncodedGradients ()
+  {
+    return m_encoded_gradients;
+  }
+
   bool DataManager::UpdateStructuredGradientTexture ()
   {
     DeleteGradientData();
@@ -611,6 +1097,147 @@ namespace vis
     return vlist;
   }
 
+  vis::DensityGradientHistogram* DataManager::GetDensityGradientHistogram ()
+  {
+    if (curr_vol_data_type != vis::GRID_VOLUME_DATA_TYPE::STRUCTURED || !curr_vr_volume
+      || !curr_vr_volume->GetArrayData()) return nullptr;
+
+    // The histogram is not touched while it is computed in background
+    if (m_density_gradient_histogram_task.valid())
+    {
+      if (m_density_gradient_histogram_task.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return nullptr;
+      m_density_gradient_histogram_task.get();
+    }
+
+    if (m_density_gradient_histogram.GetVolume() != curr_vr_volume)
+      m_density_gradient_histogram.SetVolume(curr_vr_volume);
+
+    // Both Sobel-Feldman types compute the same gradients
+    if (curr_gradient_comp_model == STRUCTURED_GRADIENT_TYPE::FINITE_DIFERENCES)
+      m_density_gradient_histogram.SetGradientOperator(vis::GRADIENT_OPERATOR::CENTRAL_DIFFERENCES);
+    else
+      m_density_gradient_histogram.SetGradientOperator(vis::GRADIENT_OPERATOR::SOBEL_FELDMAN);
+
+    if (!m_density_gradient_histogram.IsUpToDate())
+    {
+      vis::DensityGradientHistogram* dg_histogram = &m_density_gradient_histogram;
+      m_density_gradient_histogram_task = std::async(std::launch::async, [dg_histogram]() {
+        return dg_histogram->Update();
+      });
+      return nullptr;
+    }
+    return &m_density_gradient_histogram;
+  }
+
+  bool DataManager::IsComputingDensityGradientHistogram ()
+  {
+    return m_density_gradient_histogram_task.valid();
+  }
+
+  vis::DerivedDataCache* DataManager::GetDerivedDataCache ()
+  {
+    return &m_derived_data_cache;
+  }
+
+  vis::DerivedResourceRegistry* DataManager::GetDerivedResourceRegistry ()
+  {
+    return &m_derived_resources;
+  }
+
+  gl::Texture1D* DataManager::AcquireTransferFunctionTexture ()
+  {
+    DestroyOutdatedDerivedResources();
+    vis::TransferFunction* tf = GetCurrentTransferFunction();
+    if (!tf) return nullptr;
+
+    return m_derived_resources.Acquire<gl::Texture1D>("Transfer Function RGBt", tf->GetHash(),
+      [tf] (size_t* memory_size) -> gl::Texture1D* {
+        gl::Texture1D* tex = tf->GenerateTexture_1D_RGBt();
+        // RGBA16F
+        if (tex) *memory_size = size_t(tex->GetLength()) * 4 * sizeof(GLhalf);
+        return tex;
+      });
+  }
+
+  // Key of the extinction SAT of [cells] cells, clamped as GenerateExtinctionSAT3DTex
+  static unsigned long long GetExtinctionSATKey (vis::StructuredGridVolume* vol, vis::TransferFunction* tf,
+                                                 int* cells_w, int* cells_h, int* cells_d)
+  {
+    *cells_w = (*cells_w <= 0) ? (int)vol->GetWidth()  : std::min(*cells_w, (int)vol->GetWidth());
+    *cells_h = (*cells_h <= 0) ? (int)vol->GetHeight() : std::min(*cells_h, (int)vol->GetHeight());
+    *cells_d = (*cells_d <= 0) ? (int)vol->GetDepth()  : std::min(*cells_d, (int)vol->GetDepth());
+
+    // Hash 0: the transfer function cannot tell if its extinction changed
+    if (tf->GetExtinctionHash() == 0 || vol->GetContentHash() == 0) return 0;
+
+    int cells[3] = { *cells_w, *cells_h, *cells_d };
+    unsigned long long key = vis::PreProcessingGraph::HashValue(tf->GetExtinctionHash(), vol->GetContentHash());
+    return vis::PreProcessingGraph::HashBytes(cells, sizeof(cells), key);
+  }
+
+  vis::SummedAreaTable3D<float>* DataManager::AcquireExtinctionSAT (int cells_w, int cells_h, int cells_d)
+  {
+    DestroyOutdatedDerivedResources();
+    vis::StructuredGridVolume* vol = GetCurrentStructuredVolume();
+    vis::TransferFunction* tf = GetCurrentTransferFunction();
+    if (!vol || !tf) return nullptr;
+
+    unsigned long long key = GetExtinctionSATKey(vol, tf, &cells_w, &cells_h, &cells_d);
+
+    vis::DerivedDataCache* cache = GetCurrentVolumeDerivedDataCache();
+    return m_derived_resources.Acquire<vis::SummedAreaTable3D<float>>("Extinction SAT (CPU)", key,
+      [vol, tf, cells_w, cells_h, cells_d, cache] (size_t* memory_size) -> vis::SummedAreaTable3D<float>* {
+        vis::SummedAreaTable3D<float>* sat = new vis::SummedAreaTable3D<float>(cells_w + 2, cells_h + 2, cells_d + 2);
+        if (!vis::ComputeExtinctionSAT(vol, tf, cells_w, cells_h, cells_d, sat->GetData(), cache))
+        {
+          delete sat;
+          return nullptr;
+        }
+        sat->SetOffset(vis::GetExtinctionSATOffset(sat->GetData()));
+        *memory_size = size_t(sat->w) * sat->h * sat->d * sizeof(float);
+        return sat;
+      });
+  }
+
+  gl::Texture3D* DataManager::AcquireExtinctionSAT3DTex (int cells_w, int cells_h, int cells_d,
+                                                         vis::SummedAreaTable3D<float>* sat)
+  {
+    DestroyOutdatedDerivedResources();
+    vis::StructuredGridVolume* vol = GetCurrentStructuredVolume();
+    vis::TransferFunction* tf = GetCurrentTransferFunction();
+    if (!vol || !tf) return nullptr;
+
+    unsigned long long key = GetExtinctionSATKey(vol, tf, &cells_w, &cells_h, &cells_d);
+
+    vis::DerivedDataCache* cache = GetCurrentVolumeDerivedDataCache();
+    return m_derived_resources.Acquire<gl::Texture3D>("Extinction SAT", key,
+      [vol, tf, cells_w, cells_h, cells_d, cache, sat] (size_t* memory_size) -> gl::Texture3D* {
+        gl::Texture3D* tex = nullptr;
+        if (sat && sat->w == (unsigned int)cells_w + 2 && sat->h == (unsigned int)cells_h + 2 && sat->d == (unsigned int)cells_d + 2)
+          tex = vis::GenerateExtinctionSAT3DTex(sat);
+        else
+          tex = vis::GenerateExtinctionSAT3DTex(vol, tf, cells_w, cells_h, cells_d, cache);
+        // R32F
+        if (tex) *memory_size = size_t(tex->GetWidth()) * tex->GetHeight() * tex->GetDepth() * sizeof(GLfloat);
+        return tex;
+      });
+  }
+
+  void DataManager::ReleaseDerivedResource (void* resource)
+  {
+    m_derived_resources.Release(resource);
+  }
+
+  void DataManager::DestroyOutdatedDerivedResources ()
+  {
+    // The renderers release the resources of the previous volume before
+    //  requesting the ones of the new volume
+    if (!m_volume_changed) return;
+    m_derived_resources.DestroyUnreferenced();
+    m_volume_changed = false;
+  }
+
   std::vector<std::string>& DataManager::GetUINameDatasetList ()
   {
 #ifdef USE_DATA_PROVIDER
@@ -17,6 +17,29 @@
  * <path to file 5 from "path to resources"> <name of file 5 to be displayed in UI>
  * ... until eof
  *
+ * Progressive loading (disabled by default):
+ * . raw based formats are first read as a reduced preview, while the
+ *   full resolution volume is read in a background thread. The preview
+ *   is replaced at UpdateProgressiveVolume, after the full read finishes.
+ *
+ * In-situ ingest:
+ * . volumes streamed by another process through a shared memory ring buffer
+ *   (VolumeRingBuffer) are received in a background thread. The latest
+ *   received frame replaces the current volume at UpdateInSituVolume, older
+ *   frames are dropped.
+ *
+ * Derived data cache:
+ * . gradients and the preprocessing of the renderers are kept on disk at
+ *   "<path to data>/#derived_data_cache" (DerivedDataCache), so later runs
+ *   with the same volume and transfer function skip their computation.
+ *
+ * Derived resources:
+ * . gl resources derived from the current volume and transfer function are
+ *   requested by the renderers through a reference counted registry
+ *   (DerivedResourceRegistry), so renderers share them and keep them between
+ *   renderer switches, under a global memory budget. After a volume change,
+ *   the unreferenced resources are destroyed at the next request.
+ *
  * Leonardo Quatrin Campagnolo
  * . campagnolo.lq@gmail.com
 **/
@@ -24,14 +47,25 @@
 #define VOL_VIS_UTILS_DATA_MANAGER_H
 
 #include <iostream>
+#include <future>
+#include <chrono>
+#include <atomic>
 
 #include <volvis_utils/dataprovider.h>
+#include <volvis_utils/datasetcatalog.h>
+#include <volvis_utils/sharedvolume.h>
+#include <volvis_utils/insituingest.h>
+#include <volvis_utils/densitygradienthistogram.h>
+#include <volvis_utils/deriveddatacache.h>
+#include <volvis_utils/derivedresourceregistry.h>
 #include <volvis_utils/gridvolume.h>
 #include <volvis_utils/structuredgridvolume.h>
 #include <volvis_utils/unstructuredgridvolume.h>
 #include <volvis_utils/transferfunction.h>
 #include <volvis_utils/reader.h>
 
+#include <vis_utils/summedareatable.h>
+
 #include <gl_utils/texture3d.h>
 #include <gl_utils/texture1d.h>
 #include <gl_utils/computeshader.h>
@@ -68,6 +102,21 @@ namespace vis
       NONE_GRADIENT        = 3
     };
 
+    enum EXPORT_FORMAT : unsigned int {
+      RAW_FILE     = 0,
+      PVM_FILE     = 1,
+      PVM_DDS_FILE = 2,
+      NONE_FORMAT  = 3
+    };
+
+    enum EXPORT_VOLUME : unsigned int {
+      CURRENT_VOLUME            = 0,
+      HALF_RESOLUTION_VOLUME    = 1,
+      FILTERED_VOLUME           = 2,
+      GRADIENT_MAGNITUDE_VOLUME = 3,
+      NONE_VOLUME               = 4
+    };
+
     DataManager ();
     ~DataManager ();
 
@@ -86,6 +135,11 @@ namespace vis
     vis::StructuredGridVolume* GetCurrentStructuredVolume ();
     vis::UnstructuredGridVolume* GetCurrentUnstructuredVolume ();
 
+    // Metadata of the structured datasets, read from
+    //  "<path to data>/#catalog_structured_datasets"
+    vis::DatasetCatalog* GetDatasetCatalog ();
+    bool GetDatasetCatalogEntry (int id, vis::DatasetCatalogEntry* entry);
+
     int GetCurrentTransferFunctionIndex ();
     std::string GetCurrentTransferFunctionName ();
     vis::TransferFunction* GetCurrentTransferFunction ();
@@ -103,11 +157,62 @@ namespace vis
     bool SetVolume (std::string name);
     bool SetCurrentInputVolume (int id);
 
+    // Progressive loading
+    void SetProgressiveLoading (bool enabled, int preview_stride = 4, bool preview_average = false);
+    bool IsProgressiveLoadingEnabled ();
+    int GetPreviewStride ();
+    bool IsPreviewAveraged ();
+    bool IsCurrentVolumePreview ();
+    bool IsLoadingFullVolume ();
+    // Must be called at the thread that owns the gl context. Returns true
+    //  if the preview volume was replaced by the full resolution volume.
+    bool UpdateProgressiveVolume ();
+    // Latencies in milliseconds, measured from the start of the volume load
+    double GetPreviewLoadTime ();
+    double GetFullLoadTime ();
+
+    // Shared memory volumes
+    // . Publish the current volume and gradient into a named shared memory segment
+    bool PublishCurrentVolume (std::string segment_name);
+    // . Use a volume published by another process as the current volume (zero copy)
+    bool AttachSharedVolume (std::string segment_name);
+    bool IsSharedVolumePublished ();
+    bool IsSharedVolumeAttached ();
+
+    // Export the current structured volume, or a volume derived from it, as
+    //  "<path_prefix>.<bytes>.<width>x<height>x<depth>.raw" or "<path_prefix>.pvm"
+    bool ExportCurrentVolume (std::string path_prefix, EXPORT_FORMAT format, EXPORT_VOLUME volume);
+    std::vector<std::string> GetExportFormatStrList ();
+    std::vector<std::string> GetExportVolumeStrList ();
+
+    // In-situ ingest
+    void StartInSituIngest (std::string segment_name);
+    void StopInSituIngest ();
+    bool IsInSituIngestRunning ();
+    // Must be called at the thread that owns the gl context, never blocks.
+    //  Returns true if the current volume was replaced by a new frame. The
+    //  gradient is regenerated at most every IN_SITU_GRADIENT_INTERVAL_MS.
+    bool UpdateInSituVolume ();
+    vis::InSituIngestStats GetInSituIngestStats ();
+    // Time spent at UpdateInSituVolume to upload the last frame, in milliseconds
+    double GetInSituUploadTime ();
+    // . Local producer that streams synthetic volumes, used to test the ingest
+    bool StartInSituProducerStandIn (std::string segment_name, unsigned int width, unsigned int height,
+                                     unsigned int depth, double frames_per_second);
+    void StopInSituProducerStandIn ();
+    bool IsInSituProducerStandInRunning ();
+    unsigned long long GetInSituProducerStandInFrames ();
+
     bool PreviousTransferFunction ();
     bool NextTransferFunction ();
     bool SetTransferFunction (std::string name);
     bool SetCurrentTransferFunction (int id);
 
+    // Sobel-Feldman and finite differences gradients are generated through an
+    //  EncodedGradientField (16 bits normals), without the float gradient field
+    //  of the whole volume (default). Applied at the next gradient generation.
+    void SetEncodedGradients (bool encoded);
+    bool IsEncodedGradients ();
     bool UpdateStructuredGradientTexture ();
     int GetCurrentGradientGenerationTypeID ();
     int GetGradientIndex (DataManager::STRUCTURED_GRADIENT_TYPE sgt);
@@ -115,6 +220,30 @@ namespace vis
     std::string GetGradientName (DataManager::STRUCTURED_GRADIENT_TYPE sgt);
     std::string CurrentGradientName ();
     std::vector<std::string> GetGradientGenerationTypeStrList ();
+
+    // Density x gradient magnitude histogram of the current structured volume,
+    //  computed on demand with the operator of the current gradient type. After
+    //  a gradient type change, only the gradient magnitudes are recomputed.
+    // . computed in a background thread: returns nullptr until it is up to date
+    vis::DensityGradientHistogram* GetDensityGradientHistogram ();
+    bool IsComputingDensityGradientHistogram ();
+
+    // Disk cache of data derived from the volumes, shared with the renderers
+    vis::DerivedDataCache* GetDerivedDataCache ();
+
+    // Resources derived from the current volume and transfer function, shared
+    //  by the renderers. Each Acquire must be paired with a ReleaseDerivedResource.
+    vis::DerivedResourceRegistry* GetDerivedResourceRegistry ();
+    // . rgb and extinction texture of the current transfer function (GenerateTexture_1D_RGBt)
+    gl::Texture1D* AcquireTransferFunctionTexture ();
+    // . extinction SAT of the current volume and transfer function, computed on
+    //   the CPU (ComputeExtinctionSAT, with a 1-cell border), its offset is set
+    vis::SummedAreaTable3D<float>* AcquireExtinctionSAT (int cells_w, int cells_h, int cells_d);
+    // . texture of the extinction SAT (GenerateExtinctionSAT3DTex), uploaded
+    //   from "sat" (AcquireExtinctionSAT) when given instead of computed again
+    gl::Texture3D* AcquireExtinctionSAT3DTex (int cells_w, int cells_h, int cells_d,
+                                              vis::SummedAreaTable3D<float>* sat = nullptr);
+    void ReleaseDerivedResource (void* resource);
  
     std::vector<std::string>& GetUINameDatasetList ();
     std::vector<std::string>& GetUINameTransferFunctionList ();
@@ -125,11 +254,26 @@ namespace vis
   protected:
 #ifndef USE_DATA_PROVIDER
     void ReadStructuredDatasetsFromRes ();
+    bool ReadStructuredDatasetsFromCatalog ();
     void ReadTransferFunctionsFromRes ();
+    // Update the catalog entry of the loaded volume in background
+    void UpdateDatasetCatalogEntry (std::string path, vis::StructuredGridVolume* vol);
+    // Wait for the background catalog update, if any, before releasing its volume
+    void WaitDatasetCatalogUpdate ();
 #endif
 
     bool GenerateStructuredVolumeTexture ();
     bool GenerateStructuredGradientTexture ();
+    // Cache of the derived data of the current volume, nullptr for one-off
+    //  volumes (previews, in-situ frames and shared memory views)
+    vis::DerivedDataCache* GetCurrentVolumeDerivedDataCache ();
+
+    // Cancel the background full resolution read, if any, and discard it
+    void DiscardFullVolumeLoader ();
+    // Wait for the background histogram computation, if any, and release the volume
+    void DiscardDensityGradientHistogram ();
+    // Destroy the unreferenced derived resources if the volume changed
+    void DestroyOutdatedDerivedResources ();
 
     // Compute Shaders doesn't support rgb textures, so
     //  we bind 3 r textures, set the data in the shader,
@@ -155,8 +299,40 @@ namespace vis
 
     STRUCTURED_GRADIENT_TYPE curr_gradient_comp_model;
     gl::Texture3D* curr_gl_tex_structured_gradient;
+    bool m_encoded_gradients;
+
+    vis::DensityGradientHistogram m_density_gradient_histogram;
+    std::future<bool> m_density_gradient_histogram_task;
+
+    vis::DerivedDataCache m_derived_data_cache;
+    vis::DerivedResourceRegistry m_derived_resources;
+    // the current volume changed since the last derived resource request
+    bool m_volume_changed;
 
     std::string m_path_to_data;
+
+    // progressive loading
+    bool m_progressive_loading;
+    int m_preview_stride;
+    bool m_preview_average;
+    bool m_curr_volume_is_preview;
+    std::future<vis::StructuredGridVolume*> m_full_volume_loader;
+    // stops the background read between slabs (VolumeReader::SetCancelFlag)
+    std::atomic<bool> m_cancel_full_volume_loader;
+    std::chrono::steady_clock::time_point m_volume_load_start;
+    double m_preview_load_time;
+    double m_full_load_time;
+
+    // shared memory volumes
+    vis::SharedVolumeSegment m_shared_volume_publisher;
+    vis::SharedVolumeSegment m_shared_volume_attached;
+
+    // in-situ ingest
+    vis::InSituVolumeIngest m_insitu_ingest;
+    vis::InSituProducerStandIn m_insitu_producer;
+    double m_insitu_upload_time;
+    std::chrono::steady_clock::time_point m_insitu_gradient_start;
+    bool m_curr_volume_is_insitu;
     
 #ifdef USE_DATA_PROVIDER
     std::unique_ptr<DataProvider> m_data_provider;
@@ -167,6 +343,9 @@ namespace vis
 
     std::vector<std::string> ui_dataset_names;
     std::vector<std::string> ui_transferf_names;
+
+    vis::DatasetCatalog m_dataset_catalog;
+    std::future<void> m_dataset_catalog_task;
 #endif
   private:
 
@@ -0,0 +1,481 @@
+/**
+ * datasetcatalog.cpp
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#include <volvis_utils/datasetcatalog.h>
+#include <volvis_utils/reader.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <limits>
+
+namespace vis
+{
+  // Read up to "max_fields" "<...>" fields of "line" from "start", returns
+  //  the position after the last field read
+  static size_t ReadBracketFields (std::string line, size_t start, int max_fields, std::vector<std::string>* fields)
+  {
+    fields->clear();
+    size_t pos = start;
+    while ((int)fields->size() < max_fields)
+    {
+      size_t field_start = line.find('<', pos);
+      if (field_start == std::string::npos) break;
+      size_t field_end = line.find('>', field_start + 1);
+      if (field_end == std::string::npos) break;
+
+      fields->push_back(line.substr(field_start + 1, field_end - field_start - 1));
+      pos = field_end + 1;
+    }
+    return pos;
+  }
+
+  static std::string GetStorageTypeName (DataStorageSize data_storage_size)
+  {
+    if (data_storage_size == DataStorageSize::_8_BITS) return "uint8";
+    else if (data_storage_size == DataStorageSize::_16_BITS) return "uint16";
+    else if (data_storage_size == DataStorageSize::_NORMALIZED_F) return "float";
+    else if (data_storage_size == DataStorageSize::_NORMALIZED_D) return "double";
+    return "unknown";
+  }
+
+  template<typename T>
+  static void ComputeArrayInfo (const T* data, size_t n_voxels, double max_density, DatasetCatalogEntry* entry)
+  {
+    // Blocks of 1M voxels reduced in parallel, then combined in order
+    size_t block_size = size_t(1) << 20;
+    int n_blocks = (int)((n_voxels + block_size - 1) / block_size);
+    std::vector<double> block_min(n_blocks), block_max(n_blocks);
+    std::vector<double> block_sum(n_blocks), block_sum2(n_blocks);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int b = 0; b < n_blocks; b++)
+    {
+      size_t begin = size_t(b) * block_size;
+      size_t end = glm::min(begin + block_size, n_voxels);
+      double min_value = std::numeric_limits<double>::max();
+      double max_value = -std::numeric_limits<double>::max();
+      double sum = 0.0, sum2 = 0.0;
+      for (size_t i = begin; i < end; i++)
+      {
+        double v = double(data[i]) / max_density;
+        min_value = glm::min(min_value, v);
+        max_value = glm::max(max_value, v);
+        sum += v;
+        sum2 += v * v;
+      }
+      block_min[b] = min_value;
+      block_max[b] = max_value;
+      block_sum[b] = sum;
+      block_sum2[b] = sum2;
+    }
+
+    double min_value = std::numeric_limits<double>::max();
+    double max_value = -std::numeric_limits<double>::max();
+    double sum = 0.0, sum2 = 0.0;
+    for (int b = 0; b < n_blocks; b++)
+    {
+      min_value = glm::min(min_value, block_min[b]);
+      max_value = glm::max(max_value, block_max[b]);
+      sum += block_sum[b];
+      sum2 += block_sum2[b];
+    }
+
+    entry->min_value = (n_voxels > 0) ? min_value : 0.0;
+    entry->max_value = (n_voxels > 0) ? max_value : 0.0;
+    entry->mean_value = (n_voxels > 0) ? sum / double(n_voxels) : 0.0;
+    entry->stddev_value = (n_voxels > 0) ? glm::sqrt(glm::max(sum2 / double(n_voxels) - entry->mean_value * entry->mean_value, 0.0)) : 0.0;
+  }
+
+  DatasetCatalogEntry::DatasetCatalogEntry ()
+    : path("")
+    , name("")
+    , index(-1)
+    , mtime(0)
+    , file_size(0)
+    , width(0), height(0), depth(0)
+    , scale(1.0)
+    , type("unknown")
+    , hash(0)
+    , min_value(0.0), max_value(0.0)
+    , mean_value(0.0), stddev_value(0.0)
+  {
+  }
+
+  DatasetCatalog::DatasetCatalog ()
+    : m_catalog_filepath("")
+    , m_list_filepath("")
+    , m_list_mtime(0)
+    , m_list_file_size(0)
+    , m_refreshing(false)
+    , m_stop_refresh(false)
+    , m_n_updated_entries(0)
+  {
+  }
+
+  DatasetCatalog::~DatasetCatalog ()
+  {
+    m_stop_refresh = true;
+    WaitRefresh();
+  }
+
+  bool DatasetCatalog::Load (std::string catalog_filepath)
+  {
+    WaitRefresh();
+    m_catalog_filepath = catalog_filepath;
+
+    std::lock_guard<std::mutex> lock(m_entries_mutex);
+    m_entries.clear();
+    m_list_filepath = "";
+    m_list_mtime = 0;
+    m_list_file_size = 0;
+
+    std::ifstream f_catalog(catalog_filepath);
+    if (!f_catalog.is_open()) return false;
+
+    std::string line;
+    while (std::getline(f_catalog, line))
+    {
+      std::vector<std::string> fields;
+      size_t end_fields = ReadBracketFields(line, 0, 2, &fields);
+
+      if (line.find("#list") == 0)
+      {
+        if (fields.size() < 1) continue;
+        std::istringstream iss(line.substr(end_fields));
+        long long mtime;
+        unsigned long long file_size;
+        iss >> mtime >> file_size;
+        if (iss.fail()) continue;
+        m_list_filepath = fields[0];
+        m_list_mtime = mtime;
+        m_list_file_size = file_size;
+        continue;
+      }
+      if (fields.size() < 2) continue;
+
+      DatasetCatalogEntry entry;
+      entry.path = fields[0];
+      entry.name = fields[1];
+
+      std::istringstream iss(line.substr(end_fields));
+      int n_data_files = 0;
+      iss >> entry.index >> entry.mtime >> entry.file_size
+          >> entry.width >> entry.height >> entry.depth
+          >> entry.scale.x >> entry.scale.y >> entry.scale.z
+          >> entry.type >> entry.hash
+          >> entry.min_value >> entry.max_value >> entry.mean_value >> entry.stddev_value
+          >> n_data_files;
+      if (iss.fail() || n_data_files < 0) continue;
+
+      std::string data_files_str;
+      std::getline(iss, data_files_str);
+      ReadBracketFields(data_files_str, 0, n_data_files, &entry.data_files);
+      if ((int)entry.data_files.size() != n_data_files) continue;
+
+      m_entries[entry.path] = entry;
+    }
+    f_catalog.close();
+
+    printf("  - Dataset catalog: %d entries read from %s\n", (int)m_entries.size(), catalog_filepath.c_str());
+    return true;
+  }
+
+  bool DatasetCatalog::Save ()
+  {
+    if (m_catalog_filepath.empty()) return false;
+
+    std::lock_guard<std::mutex> lock(m_entries_mutex);
+
+    std::ofstream f_catalog(m_catalog_filepath);
+    if (!f_catalog.is_open())
+    {
+      printf("  - Dataset catalog: unable to write %s\n", m_catalog_filepath.c_str());
+      return false;
+    }
+
+    f_catalog.precision(17);
+    if (!m_list_filepath.empty())
+      f_catalog << "#list <" << m_list_filepath << "> " << m_list_mtime << " " << m_list_file_size << "\n";
+    for (std::map<std::string, DatasetCatalogEntry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+    {
+      const DatasetCatalogEntry& e = it->second;
+      f_catalog << "<" << e.path << "> <" << e.name << "> " << e.index << " " << e.mtime << " " << e.file_size << " "
+                << e.width << " " << e.height << " " << e.depth << " "
+                << e.scale.x << " " << e.scale.y << " " << e.scale.z << " "
+                << e.type << " " << e.hash << " "
+                << e.min_value << " " << e.max_value << " " << e.mean_value << " " << e.stddev_value << " "
+                << e.data_files.size();
+      for (int i = 0; i < (int)e.data_files.size(); i++)
+        f_catalog << " <" << e.data_files[i] << ">";
+      f_catalog << "\n";
+    }
+    f_catalog.close();
+
+    return true;
+  }
+
+  void DatasetCatalog::Refresh (std::string list_filepath, std::vector<std::string> dataset_paths,
+                                std::vector<std::string> dataset_names)
+  {
+    WaitRefresh();
+
+    // Status of the list when the datasets were read from it
+    long long list_mtime = 0;
+    unsigned long long list_file_size = 0;
+    GetFileStatus(list_filepath, &list_mtime, &list_file_size);
+    {
+      std::lock_guard<std::mutex> lock(m_entries_mutex);
+      m_list_filepath = list_filepath;
+      m_list_mtime = list_mtime;
+      m_list_file_size = list_file_size;
+    }
+
+    m_stop_refresh = false;
+    m_refreshing = true;
+    m_n_updated_entries = 0;
+    m_refresh_thread = std::thread(&DatasetCatalog::RefreshEntries, this, dataset_paths, dataset_names);
+  }
+
+  bool DatasetCatalog::IsRefreshing ()
+  {
+    return m_refreshing;
+  }
+
+  void DatasetCatalog::WaitRefresh ()
+  {
+    if (m_refresh_thread.joinable()) m_refresh_thread.join();
+  }
+
+  int DatasetCatalog::GetNumberOfUpdatedEntries ()
+  {
+    return m_n_updated_entries;
+  }
+
+  bool DatasetCatalog::GetEntry (std::string path, DatasetCatalogEntry* entry)
+  {
+    std::lock_guard<std::mutex> lock(m_entries_mutex);
+
+    std::map<std::string, DatasetCatalogEntry>::iterator it = m_entries.find(path);
+    if (it == m_entries.end()) return false;
+
+    *entry = it->second;
+    return true;
+  }
+
+  bool DatasetCatalog::IsStale (std::string path)
+  {
+    DatasetCatalogEntry entry;
+    if (!GetEntry(path, &entry)) return true;
+
+    long long mtime;
+    unsigned long long file_size;
+    if (!GetDatasetStatus(path, entry.data_files, &mtime, &file_size)) return true;
+
+    return entry.mtime != mtime || entry.file_size != file_size;
+  }
+
+  bool DatasetCatalog::GetListedEntries (std::string list_filepath, std::vector<DatasetCatalogEntry>* entries)
+  {
+    long long list_mtime;
+    unsigned long long list_file_size;
+    if (!GetFileStatus(list_filepath, &list_mtime, &list_file_size)) return false;
+
+    std::lock_guard<std::mutex> lock(m_entries_mutex);
+    if (m_list_filepath != list_filepath || m_list_mtime != list_mtime || m_list_file_size != list_file_size)
+      return false;
+
+    entries->clear();
+    for (std::map<std::string, DatasetCatalogEntry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+    {
+      if (it->second.index >= 0) entries->push_back(it->second);
+    }
+    std::sort(entries->begin(), entries->end(), [] (const DatasetCatalogEntry& a, const DatasetCatalogEntry& b) {
+      return a.index < b.index;
+    });
+
+    // Every listed dataset must have its entry
+    for (int i = 0; i < (int)entries->size(); i++)
+    {
+      if ((*entries)[i].index != i) return false;
+    }
+    return !entries->empty();
+  }
+
+  void DatasetCatalog::UpdateEntry (std::string path, StructuredGridVolume* vol)
+  {
+    if (!vol || !vol->GetArrayData()) return;
+
+    DatasetCatalogEntry entry;
+    bool found = GetEntry(path, &entry);
+    if (found && entry.hash != 0 && !IsStale(path)) return;
+
+    if (!found) entry.path = path;
+    if (!ReadEntryInfo(path, &entry)) return;
+    ComputeVolumeInfo(vol, &entry);
+
+    {
+      std::lock_guard<std::mutex> lock(m_entries_mutex);
+      // keep the name and position given by a concurrent refresh
+      std::map<std::string, DatasetCatalogEntry>::iterator it = m_entries.find(path);
+      if (it != m_entries.end())
+      {
+        entry.name = it->second.name;
+        entry.index = it->second.index;
+      }
+      m_entries[path] = entry;
+    }
+    Save();
+  }
+
+  bool DatasetCatalog::GetFileStatus (std::string path, long long* mtime, unsigned long long* file_size)
+  {
+    std::error_code ec;
+    std::filesystem::file_time_type ftime = std::filesystem::last_write_time(path, ec);
+    if (ec) return false;
+    std::uintmax_t fsize = std::filesystem::file_size(path, ec);
+    if (ec) return false;
+
+    *mtime = (long long)ftime.time_since_epoch().count();
+    *file_size = (unsigned long long)fsize;
+    return true;
+  }
+
+  bool DatasetCatalog::GetDatasetStatus (std::string path, std::vector<std::string> data_files,
+                                         long long* mtime, unsigned long long* file_size)
+  {
+    if (!GetFileStatus(path, mtime, file_size)) return false;
+
+    for (int i = 0; i < (int)data_files.size(); i++)
+    {
+      long long data_mtime;
+      unsigned long long data_file_size;
+      if (!GetFileStatus(data_files[i], &data_mtime, &data_file_size)) return false;
+
+      *mtime = glm::max(*mtime, data_mtime);
+      *file_size += data_file_size;
+    }
+    return true;
+  }
+
+  void DatasetCatalog::ComputeVolumeInfo (StructuredGridVolume* vol, DatasetCatalogEntry* entry)
+  {
+    entry->width = vol->GetWidth();
+    entry->height = vol->GetHeight();
+    entry->depth = vol->GetDepth();
+    entry->scale = vol->GetScale();
+    entry->hash = vol->GetContentHash();
+
+    entry->type = GetStorageTypeName(vol->GetDataStorageSize());
+
+    size_t n_voxels = size_t(vol->GetWidth()) * size_t(vol->GetHeight()) * size_t(vol->GetDepth());
+    if (vol->GetDataStorageSize() == DataStorageSize::_8_BITS)
+    {
+      ComputeArrayInfo(static_cast<unsigned char*>(vol->GetArrayData()), n_voxels, vol->GetMaxDensity(), entry);
+    }
+    else if (vol->GetDataStorageSize() == DataStorageSize::_16_BITS)
+    {
+      ComputeArrayInfo(static_cast<unsigned short*>(vol->GetArrayData()), n_voxels, vol->GetMaxDensity(), entry);
+    }
+    else if (vol->GetDataStorageSize() == DataStorageSize::_NORMALIZED_F)
+    {
+      ComputeArrayInfo(static_cast<float*>(vol->GetArrayData()), n_voxels, vol->GetMaxDensity(), entry);
+    }
+    else if (vol->GetDataStorageSize() == DataStorageSize::_NORMALIZED_D)
+    {
+      ComputeArrayInfo(static_cast<double*>(vol->GetArrayData()), n_voxels, vol->GetMaxDensity(), entry);
+    }
+  }
+
+  void DatasetCatalog::RefreshEntries (std::vector<std::string> dataset_paths, std::vector<std::string> dataset_names)
+  {
+    bool changed = false;
+
+    // Prune the datasets removed from the list
+    {
+      std::lock_guard<std::mutex> lock(m_entries_mutex);
+      std::map<std::string, DatasetCatalogEntry>::iterator it = m_entries.begin();
+      while (it != m_entries.end())
+      {
+        if (std::find(dataset_paths.begin(), dataset_paths.end(), it->first) == dataset_paths.end())
+        {
+          it = m_entries.erase(it);
+          changed = true;
+        }
+        else
+        {
+          ++it;
+        }
+      }
+    }
+
+    for (int i = 0; i < (int)dataset_paths.size() && !m_stop_refresh; i++)
+    {
+      if (!IsStale(dataset_paths[i]))
+      {
+        std::lock_guard<std::mutex> lock(m_entries_mutex);
+        DatasetCatalogEntry& entry = m_entries[dataset_paths[i]];
+        if (entry.index != i || entry.name != dataset_names[i])
+        {
+          entry.index = i;
+          entry.name = dataset_names[i];
+          changed = true;
+        }
+        continue;
+      }
+
+      DatasetCatalogEntry entry;
+      entry.path = dataset_paths[i];
+      entry.name = dataset_names[i];
+      entry.index = i;
+      if (!ReadEntryInfo(entry.path, &entry)) continue;
+
+      {
+        std::lock_guard<std::mutex> lock(m_entries_mutex);
+        // UpdateEntry may have filled the statistics of the same files meanwhile
+        std::map<std::string, DatasetCatalogEntry>::iterator it = m_entries.find(entry.path);
+        if (it != m_entries.end() && it->second.hash != 0
+          && it->second.mtime == entry.mtime && it->second.file_size == entry.file_size)
+        {
+          it->second.name = entry.name;
+          it->second.index = entry.index;
+        }
+        else
+        {
+          m_entries[entry.path] = entry;
+        }
+      }
+      m_n_updated_entries++;
+      changed = true;
+    }
+
+    if (changed) Save();
+    m_refreshing = false;
+  }
+
+  bool DatasetCatalog::ReadEntryInfo (std::string path, DatasetCatalogEntry* entry)
+  {
+    // Headers only: dimensions and type are unknown for formats that must
+    //  be decoded, until UpdateEntry
+    vis::VolumeReader vr;
+    StructuredVolumeInfo info;
+    bool read_info = vr.ReadStructuredVolumeInfo(path, &info);
+
+    entry->data_files = info.data_files;
+    if (!GetDatasetStatus(path, entry->data_files, &entry->mtime, &entry->file_size)) return false;
+
+    entry->width = info.width;
+    entry->height = info.height;
+    entry->depth = info.depth;
+    entry->scale = info.scale;
+    entry->type = read_info ? GetStorageTypeName(info.data_storage_size) : "unknown";
+    entry->hash = 0;
+    entry->min_value = entry->max_value = 0.0;
+    entry->mean_value = entry->stddev_value = 0.0;
+    return true;
+  }
+}
@@ -0,0 +1,130 @@
+/**
+ * datasetcatalog.h
+ *
+ * Persisted metadata index of the structured datasets, so the dataset list
+ *   can be shown without opening and decoding the volumes.
+ *
+ * Each entry stores the latest modification time and the total byte size of
+ *   the dataset files (the header and, for .nrrd and .dat, its data file),
+ *   which are used to detect stale entries. Missing or stale entries are
+ *   rebuilt in a background thread (Refresh) reading only the headers
+ *   (VolumeReader::ReadStructuredVolumeInfo), entries of removed datasets are
+ *   pruned, then the catalog is saved again. The hash and statistics of the
+ *   voxel values are filled when the volume is loaded (UpdateEntry, run in
+ *   background by the DataManager).
+ *
+ * The catalog also stores the list of datasets it was built from, so the
+ *   start-up listing can be read from the catalog while that list does not
+ *   change (GetListedEntries).
+ *
+ * Catalog file:
+ * #list <list path> mtime file_size
+ * <path> <name> index mtime file_size width height depth scalex scaley scalez type hash min max mean stddev n_data_files <data file 1> ...
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#ifndef VOL_VIS_UTILS_DATASET_CATALOG_H
+#define VOL_VIS_UTILS_DATASET_CATALOG_H
+
+#include <volvis_utils/structuredgridvolume.h>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vis
+{
+  class DatasetCatalogEntry
+  {
+  public:
+    DatasetCatalogEntry ();
+
+    std::string path;
+    std::string name;
+    // Position at the list of datasets
+    int index;
+    long long mtime;
+    unsigned long long file_size;
+
+    unsigned int width, height, depth;
+    glm::dvec3 scale;
+    std::string type;
+
+    // Content hash of the volume (StructuredGridVolume::GetContentHash),
+    //  0 until the volume is loaded
+    unsigned long long hash;
+
+    // Statistics of the normalized voxel values
+    double min_value, max_value;
+    double mean_value, stddev_value;
+
+    std::vector<std::string> data_files;
+  };
+
+  class DatasetCatalog
+  {
+  public:
+    DatasetCatalog ();
+    ~DatasetCatalog ();
+
+    // Read the persisted catalog, returns false if it does not exist
+    bool Load (std::string catalog_filepath);
+    bool Save ();
+
+    // Rebuild missing and stale entries of the datasets listed at
+    //  "list_filepath" in a background thread, and prune the others
+    void Refresh (std::string list_filepath, std::vector<std::string> dataset_paths,
+                  std::vector<std::string> dataset_names);
+    bool IsRefreshing ();
+    void WaitRefresh ();
+    // Number of entries rebuilt by the last Refresh
+    int GetNumberOfUpdatedEntries ();
+
+    // Returns true and fills "entry" if "path" is in the catalog, without
+    //  touching the dataset file (see IsStale)
+    bool GetEntry (std::string path, DatasetCatalogEntry* entry);
+    bool IsStale (std::string path);
+
+    // Entries in list order, false if the catalog was not built from the
+    //  current "list_filepath"
+    bool GetListedEntries (std::string list_filepath, std::vector<DatasetCatalogEntry>* entries);
+
+    // Fill the hash and statistics of "path" from its loaded volume, if the
+    //  entry is missing, stale or has no statistics yet. Only reads "vol", so
+    //  it can run in background while the volume is kept alive
+    void UpdateEntry (std::string path, StructuredGridVolume* vol);
+
+    static bool GetFileStatus (std::string path, long long* mtime, unsigned long long* file_size);
+    // Latest modification time and total size of "path" and "data_files"
+    static bool GetDatasetStatus (std::string path, std::vector<std::string> data_files,
+                                  long long* mtime, unsigned long long* file_size);
+    static void ComputeVolumeInfo (StructuredGridVolume* vol, DatasetCatalogEntry* entry);
+
+  protected:
+    void RefreshEntries (std::vector<std::string> dataset_paths, std::vector<std::string> dataset_names);
+    bool ReadEntryInfo (std::string path, DatasetCatalogEntry* entry);
+
+    std::string m_catalog_filepath;
+    std::map<std::string, DatasetCatalogEntry> m_entries;
+
+    // List of datasets the catalog was built from
+    std::string m_list_filepath;
+    long long m_list_mtime;
+    unsigned long long m_list_file_size;
+
+    std::mutex m_entries_mutex;
+    std::thread m_refresh_thread;
+    std::atomic<bool> m_refreshing;
+    std::atomic<bool> m_stop_refresh;
+    std::atomic<int> m_n_updated_entries;
+
+  private:
+
+  };
+}
+
+#endif
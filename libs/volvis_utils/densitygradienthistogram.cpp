@@ -0,0 +1,276 @@
+/**
+ * densitygradienthistogram.cpp
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#include <volvis_utils/densitygradienthistogram.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include <omp.h>
+
+namespace vis
+{
+  // Accumulate the joint histogram of slices [0, depth) into per-thread
+  //  histograms, then reduce them into "histogram"
+  template<typename T>
+  static void AccumulateJointHistogram (const T* values, float scale, const float* magnitudes,
+                                        size_t slice_size, int depth, int density_bins, int gradient_bins,
+                                        unsigned int* histogram)
+  {
+    const int n_bins = density_bins * gradient_bins;
+    const int n_threads = omp_get_max_threads();
+    // Zeroed: the parallel region may run with less than n_threads threads
+    unsigned int* thread_histograms = new unsigned int[size_t(n_threads) * n_bins]();
+
+#pragma omp parallel
+    {
+      unsigned int* local = thread_histograms + size_t(omp_get_thread_num()) * n_bins;
+
+#pragma omp for schedule(static)
+      for (int z = 0; z < depth; z++)
+      {
+        const T* density = values + size_t(z) * slice_size;
+        const float* magnitude = magnitudes + size_t(z) * slice_size;
+        for (size_t i = 0; i < slice_size; i++)
+        {
+          int db = std::min(std::max((int)((float)density[i] * scale * (float)density_bins), 0), density_bins - 1);
+          int gb = std::min(std::max((int)(magnitude[i] * (float)gradient_bins), 0), gradient_bins - 1);
+          local[db + gb * density_bins]++;
+        }
+      }
+    }
+
+#pragma omp parallel for
+    for (int b = 0; b < n_bins; b++)
+    {
+      unsigned int count = 0;
+      for (int t = 0; t < n_threads; t++)
+        count += thread_histograms[size_t(t) * n_bins + b];
+      histogram[b] = count;
+    }
+
+    delete[] thread_histograms;
+  }
+
+  DensityGradientHistogram::DensityGradientHistogram ()
+    : m_volume(nullptr)
+    , m_gradient_operator(GRADIENT_OPERATOR::SOBEL_FELDMAN)
+    , m_density_bins(256)
+    , m_gradient_bins(256)
+    , m_gradient_magnitude_volume(nullptr)
+    , m_max_gradient_magnitude(0.0f)
+    , m_max_count(0)
+    , m_gradient_magnitudes_outdated(true)
+    , m_density_histogram_outdated(true)
+    , m_histogram_outdated(true)
+    , m_gradient_magnitude_time(0.0)
+    , m_histogram_time(0.0)
+  {
+  }
+
+  DensityGradientHistogram::~DensityGradientHistogram ()
+  {
+    SetVolume(nullptr);
+  }
+
+  void DensityGradientHistogram::SetVolume (StructuredGridVolume* vol)
+  {
+    if (m_gradient_magnitude_volume) delete m_gradient_magnitude_volume;
+    m_gradient_magnitude_volume = nullptr;
+    m_max_gradient_magnitude = 0.0f;
+
+    m_volume = vol;
+    m_gradient_magnitudes_outdated = true;
+    m_density_histogram_outdated = true;
+    m_histogram_outdated = true;
+  }
+
+  void DensityGradientHistogram::SetGradientOperator (GRADIENT_OPERATOR gradient_operator)
+  {
+    if (gradient_operator == m_gradient_operator) return;
+
+    m_gradient_operator = gradient_operator;
+    m_gradient_magnitudes_outdated = true;
+    m_histogram_outdated = true;
+  }
+
+  void DensityGradientHistogram::SetNumberOfBins (int density_bins, int gradient_bins)
+  {
+    density_bins = std::max(density_bins, 1);
+    gradient_bins = std::max(gradient_bins, 1);
+    if (density_bins == m_density_bins && gradient_bins == m_gradient_bins) return;
+
+    m_density_bins = density_bins;
+    m_gradient_bins = gradient_bins;
+    m_density_histogram_outdated = true;
+    m_histogram_outdated = true;
+  }
+
+  bool DensityGradientHistogram::Update ()
+  {
+    if (!m_volume || !m_volume->GetArrayData()) return false;
+
+    if (m_gradient_magnitudes_outdated)
+      ComputeGradientMagnitudes();
+    if (m_histogram_outdated || m_density_histogram_outdated)
+      ComputeHistograms();
+
+    return true;
+  }
+
+  bool DensityGradientHistogram::IsUpToDate ()
+  {
+    return m_volume && !m_gradient_magnitudes_outdated && !m_density_histogram_outdated && !m_histogram_outdated;
+  }
+
+  StructuredGridVolume* DensityGradientHistogram::GetVolume ()
+  {
+    return m_volume;
+  }
+
+  GRADIENT_OPERATOR DensityGradientHistogram::GetGradientOperator ()
+  {
+    return m_gradient_operator;
+  }
+
+  int DensityGradientHistogram::GetNumberOfDensityBins ()
+  {
+    return m_density_bins;
+  }
+
+  int DensityGradientHistogram::GetNumberOfGradientBins ()
+  {
+    return m_gradient_bins;
+  }
+
+  StructuredGridVolume* DensityGradientHistogram::GetGradientMagnitudeVolume ()
+  {
+    return m_gradient_magnitude_volume;
+  }
+
+  float DensityGradientHistogram::GetMaxGradientMagnitude ()
+  {
+    return m_max_gradient_magnitude;
+  }
+
+  const std::vector<unsigned int>& DensityGradientHistogram::GetHistogram ()
+  {
+    return m_histogram;
+  }
+
+  unsigned int DensityGradientHistogram::GetCount (int density_bin, int gradient_bin)
+  {
+    if (density_bin < 0 || gradient_bin < 0 || density_bin >= m_density_bins || gradient_bin >= m_gradient_bins
+     || m_histogram.size() != size_t(m_density_bins) * size_t(m_gradient_bins))
+      return 0;
+    return m_histogram[density_bin + gradient_bin * m_density_bins];
+  }
+
+  unsigned int DensityGradientHistogram::GetMaxCount ()
+  {
+    return m_max_count;
+  }
+
+  const std::vector<unsigned int>& DensityGradientHistogram::GetDensityHistogram ()
+  {
+    return m_density_histogram;
+  }
+
+  const std::vector<unsigned int>& DensityGradientHistogram::GetGradientHistogram ()
+  {
+    return m_gradient_histogram;
+  }
+
+  double DensityGradientHistogram::GetGradientMagnitudeTime ()
+  {
+    return m_gradient_magnitude_time;
+  }
+
+  double DensityGradientHistogram::GetHistogramTime ()
+  {
+    return m_histogram_time;
+  }
+
+  void DensityGradientHistogram::ComputeGradientMagnitudes ()
+  {
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+    if (m_gradient_magnitude_volume) delete m_gradient_magnitude_volume;
+    m_gradient_magnitude_volume = new StructuredGridVolume(m_volume->GetName() + "_gradient_magnitude",
+      m_volume->GetWidth(), m_volume->GetHeight(), m_volume->GetDepth());
+    m_gradient_magnitude_volume->SetScale(m_volume->GetScaleX(), m_volume->GetScaleY(), m_volume->GetScaleZ());
+
+    size_t slice_size = size_t(m_volume->GetWidth()) * size_t(m_volume->GetHeight());
+    int depth = (int)m_volume->GetDepth();
+    float* magnitudes = new float[slice_size * size_t(depth)];
+    vis::ComputeGradientMagnitudes(m_volume, magnitudes, m_gradient_operator, &m_max_gradient_magnitude);
+
+    float inv_max = m_max_gradient_magnitude > 0.0f ? 1.0f / m_max_gradient_magnitude : 0.0f;
+#pragma omp parallel for
+    for (int z = 0; z < depth; z++)
+    {
+      float* slice = magnitudes + size_t(z) * slice_size;
+      for (size_t i = 0; i < slice_size; i++)
+        slice[i] *= inv_max;
+    }
+    m_gradient_magnitude_volume->SetArrayData(magnitudes, DataStorageSize::_NORMALIZED_F);
+
+    m_gradient_magnitudes_outdated = false;
+    m_histogram_outdated = true;
+    m_gradient_magnitude_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  }
+
+  void DensityGradientHistogram::ComputeHistograms ()
+  {
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+    size_t slice_size = size_t(m_volume->GetWidth()) * size_t(m_volume->GetHeight());
+    int depth = (int)m_volume->GetDepth();
+    const float* magnitudes = static_cast<const float*>(m_gradient_magnitude_volume->GetArrayData());
+    void* values = m_volume->GetArrayData();
+
+    m_histogram.assign(size_t(m_density_bins) * size_t(m_gradient_bins), 0u);
+    DataStorageSize dss = m_volume->GetDataStorageSize();
+    if (dss == DataStorageSize::_8_BITS)
+      AccumulateJointHistogram(static_cast<const unsigned char*>(values), (float)(1.0 / (256.0 - 1.0)), magnitudes,
+        slice_size, depth, m_density_bins, m_gradient_bins, m_histogram.data());
+    else if (dss == DataStorageSize::_16_BITS)
+      AccumulateJointHistogram(static_cast<const unsigned short*>(values), (float)(1.0 / (65536.0 - 1.0)), magnitudes,
+        slice_size, depth, m_density_bins, m_gradient_bins, m_histogram.data());
+    else if (dss == DataStorageSize::_NORMALIZED_F)
+      AccumulateJointHistogram(static_cast<const float*>(values), 1.0f, magnitudes,
+        slice_size, depth, m_density_bins, m_gradient_bins, m_histogram.data());
+    else if (dss == DataStorageSize::_NORMALIZED_D)
+      AccumulateJointHistogram(static_cast<const double*>(values), 1.0f, magnitudes,
+        slice_size, depth, m_density_bins, m_gradient_bins, m_histogram.data());
+
+    // Marginal histograms and max count
+    m_gradient_histogram.assign(m_gradient_bins, 0u);
+    m_max_count = 0;
+    for (int g = 0; g < m_gradient_bins; g++)
+    {
+      for (int d = 0; d < m_density_bins; d++)
+      {
+        unsigned int count = m_histogram[d + g * m_density_bins];
+        m_gradient_histogram[g] += count;
+        m_max_count = std::max(m_max_count, count);
+      }
+    }
+
+    // The density histogram does not depend on the gradient operator
+    if (m_density_histogram_outdated)
+    {
+      m_density_histogram.assign(m_density_bins, 0u);
+      for (int g = 0; g < m_gradient_bins; g++)
+        for (int d = 0; d < m_density_bins; d++)
+          m_density_histogram[d] += m_histogram[d + g * m_density_bins];
+    }
+
+    m_density_histogram_outdated = false;
+    m_histogram_outdated = false;
+    m_histogram_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  }
+}
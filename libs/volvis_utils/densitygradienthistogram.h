@@ -0,0 +1,96 @@
+/**
+ * densitygradienthistogram.h
+ *
+ * 2D joint histogram of density x gradient magnitude of a structured
+ *   volume, used to design transfer functions and to locate boundaries
+ *   (high gradient magnitude regions).
+ *
+ * Density bins cover [0, 1] (normalized values), gradient bins cover
+ *   [0, max gradient magnitude]. The histogram is accumulated in per-thread
+ *   histograms, reduced at the end.
+ *
+ * Computed data is kept until invalidated:
+ * . SetVolume          : everything
+ * . SetGradientOperator: gradient magnitudes and joint histogram (the
+ *                        density histogram is kept)
+ * . SetNumberOfBins    : histograms (the gradient magnitudes are kept)
+ * Update recomputes only the invalidated data.
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#ifndef VOL_VIS_UTILS_DENSITY_GRADIENT_HISTOGRAM_H
+#define VOL_VIS_UTILS_DENSITY_GRADIENT_HISTOGRAM_H
+
+#include <volvis_utils/structuredgridvolume.h>
+#include <volvis_utils/gradientfield.h>
+
+#include <vector>
+
+namespace vis
+{
+  class DensityGradientHistogram
+  {
+  public:
+    DensityGradientHistogram ();
+    ~DensityGradientHistogram ();
+
+    void SetVolume (StructuredGridVolume* vol);
+    void SetGradientOperator (GRADIENT_OPERATOR gradient_operator);
+    void SetNumberOfBins (int density_bins, int gradient_bins);
+
+    // Recompute the invalidated data, returns false without a volume
+    bool Update ();
+    bool IsUpToDate ();
+
+    StructuredGridVolume* GetVolume ();
+    GRADIENT_OPERATOR GetGradientOperator ();
+    int GetNumberOfDensityBins ();
+    int GetNumberOfGradientBins ();
+
+    // Gradient magnitudes divided by the max magnitude (float volume)
+    StructuredGridVolume* GetGradientMagnitudeVolume ();
+    float GetMaxGradientMagnitude ();
+
+    // Joint histogram: count of [density_bin + gradient_bin * density_bins]
+    const std::vector<unsigned int>& GetHistogram ();
+    unsigned int GetCount (int density_bin, int gradient_bin);
+    unsigned int GetMaxCount ();
+    // Marginal histograms
+    const std::vector<unsigned int>& GetDensityHistogram ();
+    const std::vector<unsigned int>& GetGradientHistogram ();
+
+    // Time of the last computation of each stage, in milliseconds
+    double GetGradientMagnitudeTime ();
+    double GetHistogramTime ();
+
+  protected:
+    void ComputeGradientMagnitudes ();
+    void ComputeHistograms ();
+
+    StructuredGridVolume* m_volume;
+    GRADIENT_OPERATOR m_gradient_operator;
+    int m_density_bins;
+    int m_gradient_bins;
+
+    StructuredGridVolume* m_gradient_magnitude_volume;
+    float m_max_gradient_magnitude;
+
+    std::vector<unsigned int> m_histogram;
+    std::vector<unsigned int> m_density_histogram;
+    std::vector<unsigned int> m_gradient_histogram;
+    unsigned int m_max_count;
+
+    bool m_gradient_magnitudes_outdated;
+    bool m_density_histogram_outdated;
+    bool m_histogram_outdated;
+
+    double m_gradient_magnitude_time;
+    double m_histogram_time;
+
+  private:
+
+  };
+}
+
+#endif
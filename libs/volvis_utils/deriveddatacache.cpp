@@ -0,0 +1,388 @@
+/**
+ * deriveddatacache.cpp
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#include <volvis_utils/deriveddatacache.h>
+#include <volvis_utils/preprocessinggraph.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace vis
+{
+  // File header, followed by the product
+  struct DerivedDataCacheHeader
+  {
+    char magic[8];
+    unsigned int format_version;
+    unsigned int reserved;
+    unsigned long long key;
+    unsigned long long size;
+  };
+  static const char DERIVED_DATA_CACHE_MAGIC[8] = { 'V', 'R', 'D', 'C', 'A', 'C', 'H', 'E' };
+  static const unsigned int DERIVED_DATA_CACHE_FORMAT_VERSION = 1;
+
+  DerivedDataCacheEntry::DerivedDataCacheEntry ()
+    : m_mapping(nullptr)
+    , m_mapping_size(0)
+#ifdef _WIN32
+    , m_file(nullptr)
+    , m_file_mapping(nullptr)
+#else
+    , m_fd(-1)
+#endif
+  {
+  }
+
+  DerivedDataCacheEntry::~DerivedDataCacheEntry ()
+  {
+    Release();
+  }
+
+  bool DerivedDataCacheEntry::Map (std::string path, unsigned long long key)
+  {
+    Release();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    m_file = file;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size))
+    {
+      Release();
+      return false;
+    }
+    m_mapping_size = (unsigned long long)file_size.QuadPart;
+    if (m_mapping_size < sizeof(DerivedDataCacheHeader))
+    {
+      Release();
+      return false;
+    }
+
+    m_file_mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (m_file_mapping)
+      m_mapping = (unsigned char*)MapViewOfFile((HANDLE)m_file_mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    m_fd = open(path.c_str(), O_RDONLY);
+    struct stat file_stat;
+    if (m_fd < 0 || fstat(m_fd, &file_stat) != 0)
+    {
+      Release();
+      return false;
+    }
+    m_mapping_size = (unsigned long long)file_stat.st_size;
+    if (m_mapping_size < sizeof(DerivedDataCacheHeader))
+    {
+      Release();
+      return false;
+    }
+
+    void* ptr = mmap(NULL, m_mapping_size, PROT_READ, MAP_SHARED, m_fd, 0);
+    m_mapping = (ptr == MAP_FAILED) ? nullptr : (unsigned char*)ptr;
+#endif
+    if (!m_mapping)
+    {
+      printf("  - Derived data cache: unable to map \"%s\"\n", path.c_str());
+      Release();
+      return false;
+    }
+
+    // Files from other versions, or partially written, are misses
+    const DerivedDataCacheHeader* header = (const DerivedDataCacheHeader*)m_mapping;
+    if (memcmp(header->magic, DERIVED_DATA_CACHE_MAGIC, sizeof(DERIVED_DATA_CACHE_MAGIC)) != 0
+      || header->format_version != DERIVED_DATA_CACHE_FORMAT_VERSION || header->key != key
+      || header->size != m_mapping_size - sizeof(DerivedDataCacheHeader))
+    {
+      Release();
+      return false;
+    }
+
+    return true;
+  }
+
+  void DerivedDataCacheEntry::Release ()
+  {
+#ifdef _WIN32
+    if (m_mapping) UnmapViewOfFile(m_mapping);
+    if (m_file_mapping) CloseHandle((HANDLE)m_file_mapping);
+    if (m_file) CloseHandle((HANDLE)m_file);
+    m_file_mapping = nullptr;
+    m_file = nullptr;
+#else
+    if (m_mapping) munmap(m_mapping, m_mapping_size);
+    if (m_fd >= 0) close(m_fd);
+    m_fd = -1;
+#endif
+    m_mapping = nullptr;
+    m_mapping_size = 0;
+  }
+
+  bool DerivedDataCacheEntry::IsMapped ()
+  {
+    return m_mapping != nullptr;
+  }
+
+  const void* DerivedDataCacheEntry::GetData ()
+  {
+    if (!m_mapping) return nullptr;
+    return m_mapping + sizeof(DerivedDataCacheHeader);
+  }
+
+  unsigned long long DerivedDataCacheEntry::GetSize ()
+  {
+    if (!m_mapping) return 0;
+    return m_mapping_size - sizeof(DerivedDataCacheHeader);
+  }
+
+  DerivedDataCache::DerivedDataCache ()
+    : m_directory("")
+    , m_enabled(true)
+    , m_max_size(4ull * 1024ull * 1024ull * 1024ull)
+    , m_hits(0)
+    , m_misses(0)
+  {
+  }
+
+  DerivedDataCache::~DerivedDataCache ()
+  {
+  }
+
+  void DerivedDataCache::SetDirectory (std::string path)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_directory = path;
+    if (m_directory.empty()) return;
+
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+    if (ec)
+    {
+      printf("  - Derived data cache: unable to create \"%s\"\n", m_directory.c_str());
+      m_directory = "";
+    }
+  }
+
+  std::string DerivedDataCache::GetDirectory ()
+  {
+    return m_directory;
+  }
+
+  void DerivedDataCache::SetEnabled (bool enabled)
+  {
+    m_enabled = enabled;
+  }
+
+  bool DerivedDataCache::IsEnabled ()
+  {
+    return m_enabled && !m_directory.empty();
+  }
+
+  void DerivedDataCache::SetMaxSize (unsigned long long bytes)
+  {
+    m_max_size = bytes;
+  }
+
+  unsigned long long DerivedDataCache::GetMaxSize ()
+  {
+    return m_max_size;
+  }
+
+  unsigned long long DerivedDataCache::GetSize ()
+  {
+    if (m_directory.empty()) return 0;
+
+    std::error_code ec;
+    unsigned long long size = 0;
+    for (std::filesystem::directory_iterator it(m_directory, ec), end; !ec && it != end; it.increment(ec))
+    {
+      if (it->path().extension() == DERIVED_DATA_CACHE_EXTENSION)
+      {
+        std::error_code size_ec;
+        std::uintmax_t file_size = it->file_size(size_ec);
+        if (!size_ec) size += (unsigned long long)file_size;
+      }
+    }
+    return size;
+  }
+
+  unsigned long long DerivedDataCache::GetKey (std::string algorithm, unsigned int version, unsigned long long inputs_hash)
+  {
+    unsigned long long key = PreProcessingGraph::HashBytes(algorithm.data(), algorithm.size());
+    key = PreProcessingGraph::HashValue(version, key);
+    return PreProcessingGraph::HashValue(inputs_hash, key);
+  }
+
+  bool DerivedDataCache::Load (std::string algorithm, unsigned long long key, DerivedDataCacheEntry* entry)
+  {
+    if (!IsEnabled()) return false;
+
+    std::string path = GetFilePath(algorithm, key);
+    if (!entry->Map(path, key))
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_misses++;
+      return false;
+    }
+
+    // Most recently used
+    std::error_code ec;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_hits++;
+    return true;
+  }
+
+  bool DerivedDataCache::Store (std::string algorithm, unsigned long long key, const void* data, unsigned long long size)
+  {
+    return Store(algorithm, key, std::vector<const void*>(1, data), std::vector<unsigned long long>(1, size));
+  }
+
+  bool DerivedDataCache::Store (std::string algorithm, unsigned long long key, std::vector<const void*> buffers,
+                                std::vector<unsigned long long> sizes)
+  {
+    if (!IsEnabled() || buffers.size() != sizes.size()) return false;
+
+    DerivedDataCacheHeader header;
+    memcpy(header.magic, DERIVED_DATA_CACHE_MAGIC, sizeof(DERIVED_DATA_CACHE_MAGIC));
+    header.format_version = DERIVED_DATA_CACHE_FORMAT_VERSION;
+    header.reserved = 0;
+    header.key = key;
+    header.size = 0;
+    for (int i = 0; i < (int)sizes.size(); i++)
+      header.size += sizes[i];
+
+    // Products larger than the whole cache are not stored
+    if (header.size + sizeof(DerivedDataCacheHeader) > m_max_size) return false;
+
+    // Written to a temporary file, then renamed: readers never map partial files
+    std::string path = GetFilePath(algorithm, key);
+    std::string tmp_path = path + ".tmp";
+    {
+      std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+      if (!file.is_open())
+      {
+        printf("  - Derived data cache: unable to write \"%s\"\n", tmp_path.c_str());
+        return false;
+      }
+      file.write((const char*)&header, sizeof(DerivedDataCacheHeader));
+      for (int i = 0; i < (int)buffers.size(); i++)
+        file.write((const char*)buffers[i], (std::streamsize)sizes[i]);
+      if (!file.good())
+      {
+        file.close();
+        std::error_code ec;
+        std::filesystem::remove(tmp_path, ec);
+        printf("  - Derived data cache: unable to write \"%s\"\n", tmp_path.c_str());
+        return false;
+      }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec)
+    {
+      std::filesystem::remove(tmp_path, ec);
+      return false;
+    }
+
+    Evict();
+    return true;
+  }
+
+  void DerivedDataCache::Evict ()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_directory.empty()) return;
+
+    typedef struct CachedFile {
+      std::filesystem::file_time_type time;
+      unsigned long long size;
+      std::filesystem::path path;
+    } CachedFile;
+
+    std::vector<CachedFile> files;
+    unsigned long long total_size = 0;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(m_directory, ec), end; !ec && it != end; it.increment(ec))
+    {
+      if (it->path().extension() != DERIVED_DATA_CACHE_EXTENSION) continue;
+
+      std::error_code file_ec;
+      CachedFile file;
+      file.path = it->path();
+      file.time = std::filesystem::last_write_time(file.path, file_ec);
+      file.size = (unsigned long long)std::filesystem::file_size(file.path, file_ec);
+      if (file_ec) continue;
+
+      files.push_back(file);
+      total_size += file.size;
+    }
+    if (total_size <= m_max_size) return;
+
+    // Least recently used first
+    std::sort(files.begin(), files.end(), [] (const CachedFile& a, const CachedFile& b) {
+      return a.time < b.time;
+    });
+    for (int i = 0; i < (int)files.size() && total_size > m_max_size; i++)
+    {
+      std::error_code remove_ec;
+      if (std::filesystem::remove(files[i].path, remove_ec))
+        total_size -= files[i].size;
+    }
+  }
+
+  void DerivedDataCache::Clear ()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_directory.empty()) return;
+
+    std::vector<std::filesystem::path> files;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(m_directory, ec), end; !ec && it != end; it.increment(ec))
+    {
+      if (it->path().extension() == DERIVED_DATA_CACHE_EXTENSION)
+        files.push_back(it->path());
+    }
+    for (int i = 0; i < (int)files.size(); i++)
+      std::filesystem::remove(files[i], ec);
+  }
+
+  unsigned long long DerivedDataCache::GetNumberOfHits ()
+  {
+    return m_hits;
+  }
+
+  unsigned long long DerivedDataCache::GetNumberOfMisses ()
+  {
+    return m_misses;
+  }
+
+  std::string DerivedDataCache::GetFilePath (std::string algorithm, unsigned long long key)
+  {
+    char key_str[17];
+    snprintf(key_str, sizeof(key_str), "%016llx", key);
+    return m_directory + "/" + algorithm + "_" + key_str + DERIVED_DATA_CACHE_EXTENSION;
+  }
+}
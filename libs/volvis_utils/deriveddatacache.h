@@ -0,0 +1,115 @@
+/**
+ * deriveddatacache.h
+ *
+ * Disk cache of data derived from the volumes (gradients, summed area
+ *   tables, super voxels, preintegration tables, ...), kept between runs.
+ *
+ * Each product is a file "<algorithm>_<key>.vrcache" at the cache directory,
+ *   where key hashes the version of the algorithm and its inputs: volume
+ *   content (StructuredGridVolume::GetContentHash), transfer function
+ *   hash and parameters. Products with unknown inputs (hash 0) must not be
+ *   cached.
+ *
+ * Hits are memory mapped (read only, no copies until used) and marked as
+ *   recently used through the file modification time. After each Store,
+ *   the least recently used files are removed until the cache fits its max
+ *   size.
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#ifndef VOL_VIS_UTILS_DERIVED_DATA_CACHE_H
+#define VOL_VIS_UTILS_DERIVED_DATA_CACHE_H
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define DERIVED_DATA_CACHE_EXTENSION ".vrcache"
+
+namespace vis
+{
+  // Read only mapping of a cached product, valid until released
+  class DerivedDataCacheEntry
+  {
+  public:
+    DerivedDataCacheEntry ();
+    ~DerivedDataCacheEntry ();
+
+    // Map "path", checking its header against "key"
+    bool Map (std::string path, unsigned long long key);
+    void Release ();
+
+    bool IsMapped ();
+    const void* GetData ();
+    unsigned long long GetSize ();
+
+  protected:
+    unsigned char* m_mapping;
+    unsigned long long m_mapping_size;
+
+#ifdef _WIN32
+    void* m_file;
+    void* m_file_mapping;
+#else
+    int m_fd;
+#endif
+
+  private:
+    DerivedDataCacheEntry (const DerivedDataCacheEntry&);
+    DerivedDataCacheEntry& operator= (const DerivedDataCacheEntry&);
+  };
+
+  class DerivedDataCache
+  {
+  public:
+    DerivedDataCache ();
+    ~DerivedDataCache ();
+
+    // Creates the directory if needed, an empty path disables the cache
+    void SetDirectory (std::string path);
+    std::string GetDirectory ();
+    void SetEnabled (bool enabled);
+    bool IsEnabled ();
+
+    void SetMaxSize (unsigned long long bytes);
+    unsigned long long GetMaxSize ();
+    // Size of all products at the cache directory
+    unsigned long long GetSize ();
+
+    // Key of a product of "algorithm" (bump "version" when its output changes),
+    //  from the hash of all its inputs
+    static unsigned long long GetKey (std::string algorithm, unsigned int version, unsigned long long inputs_hash);
+
+    // Map the product, false on a miss
+    bool Load (std::string algorithm, unsigned long long key, DerivedDataCacheEntry* entry);
+    // Store the product (one buffer, or several written contiguously), then
+    //  evict the least recently used products above the max size
+    bool Store (std::string algorithm, unsigned long long key, const void* data, unsigned long long size);
+    bool Store (std::string algorithm, unsigned long long key, std::vector<const void*> buffers,
+                std::vector<unsigned long long> sizes);
+
+    void Evict ();
+    void Clear ();
+
+    unsigned long long GetNumberOfHits ();
+    unsigned long long GetNumberOfMisses ();
+
+  protected:
+    std::string GetFilePath (std::string algorithm, unsigned long long key);
+
+    std::string m_directory;
+    bool m_enabled;
+    unsigned long long m_max_size;
+
+    unsigned long long m_hits;
+    unsigned long long m_misses;
+    // Products may be loaded and stored by preprocessing threads
+    std::mutex m_mutex;
+
+  private:
+
+  };
+}
+
+#endif
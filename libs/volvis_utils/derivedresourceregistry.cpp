@@ -0,0 +1,171 @@
+/**
+ * derivedresourceregistry.cpp
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#include <volvis_utils/derivedresourceregistry.h>
+
+#include <cstdio>
+
+namespace vis
+{
+  DerivedResourceRegistry::DerivedResourceRegistry ()
+    : memory_budget(size_t(1024) * 1024 * 1024)
+    , use_counter(0)
+    , hits(0)
+    , misses(0)
+  {
+  }
+
+  DerivedResourceRegistry::~DerivedResourceRegistry ()
+  {
+    for (int i = (int)resources.size() - 1; i >= 0; i--)
+    {
+      if (resources[i].references > 0)
+        printf("DerivedResourceRegistry: \"%s\" destroyed with %d references\n", resources[i].name.c_str(),
+          resources[i].references);
+      DestroyResource(i);
+    }
+  }
+
+  void* DerivedResourceRegistry::Acquire (std::string name, unsigned long long key, CreateFunction create,
+                                          DestroyFunction destroy)
+  {
+    if (key != 0)
+    {
+      for (int i = 0; i < (int)resources.size(); i++)
+      {
+        if (resources[i].key == key && resources[i].name == name)
+        {
+          resources[i].references++;
+          resources[i].last_use = ++use_counter;
+          hits++;
+          return resources[i].data;
+        }
+      }
+    }
+
+    misses++;
+    size_t memory_size = 0;
+    void* data = create(&memory_size);
+    if (data == nullptr) return nullptr;
+
+    Resource resource;
+    resource.name = name;
+    resource.key = key;
+    resource.data = data;
+    resource.destroy = destroy;
+    resource.memory_size = memory_size;
+    resource.references = 1;
+    resource.last_use = ++use_counter;
+    resources.push_back(resource);
+
+    Evict();
+    return data;
+  }
+
+  void DerivedResourceRegistry::Release (void* resource)
+  {
+    if (resource == nullptr) return;
+
+    for (int i = 0; i < (int)resources.size(); i++)
+    {
+      if (resources[i].data != resource) continue;
+
+      resources[i].references--;
+      // Not shared: nobody can acquire it again
+      if (resources[i].references <= 0 && resources[i].key == 0)
+        DestroyResource(i);
+      else
+        Evict();
+      return;
+    }
+    printf("DerivedResourceRegistry: released a resource that was not acquired\n");
+  }
+
+  void DerivedResourceRegistry::SetMemoryBudget (size_t bytes)
+  {
+    memory_budget = bytes;
+    Evict();
+  }
+
+  size_t DerivedResourceRegistry::GetMemoryBudget ()
+  {
+    return memory_budget;
+  }
+
+  size_t DerivedResourceRegistry::GetMemorySize ()
+  {
+    size_t memory_size = 0;
+    for (int i = 0; i < (int)resources.size(); i++)
+      memory_size += resources[i].memory_size;
+    return memory_size;
+  }
+
+  void DerivedResourceRegistry::Evict ()
+  {
+    size_t memory_size = GetMemorySize();
+    while (memory_size > memory_budget)
+    {
+      // Least recently used unreferenced resource
+      int lru = -1;
+      for (int i = 0; i < (int)resources.size(); i++)
+      {
+        if (resources[i].references > 0) continue;
+        if (lru == -1 || resources[i].last_use < resources[lru].last_use)
+          lru = i;
+      }
+      // Referenced resources are above the budget
+      if (lru == -1) return;
+
+      memory_size -= resources[lru].memory_size;
+      DestroyResource(lru);
+    }
+  }
+
+  void DerivedResourceRegistry::DestroyUnreferenced ()
+  {
+    for (int i = (int)resources.size() - 1; i >= 0; i--)
+    {
+      if (resources[i].references <= 0)
+        DestroyResource(i);
+    }
+  }
+
+  int DerivedResourceRegistry::GetNumberOfResources ()
+  {
+    return (int)resources.size();
+  }
+
+  std::string DerivedResourceRegistry::GetResourceName (int id)
+  {
+    return resources[id].name;
+  }
+
+  int DerivedResourceRegistry::GetNumberOfReferences (int id)
+  {
+    return resources[id].references;
+  }
+
+  size_t DerivedResourceRegistry::GetResourceMemorySize (int id)
+  {
+    return resources[id].memory_size;
+  }
+
+  unsigned long long DerivedResourceRegistry::GetNumberOfHits ()
+  {
+    return hits;
+  }
+
+  unsigned long long DerivedResourceRegistry::GetNumberOfMisses ()
+  {
+    return misses;
+  }
+
+  void DerivedResourceRegistry::DestroyResource (int id)
+  {
+    if (resources[id].destroy) resources[id].destroy(resources[id].data);
+    resources.erase(resources.begin() + id);
+  }
+}
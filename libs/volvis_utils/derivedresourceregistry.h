@@ -0,0 +1,95 @@
+/**
+ * derivedresourceregistry.h
+ *
+ * Resources derived from the current volume and transfer function (transfer
+ *   function textures, summed area tables, extinction pyramids, ...) shared
+ *   by the renderers.
+ *
+ * Resources are requested by name and by a key hashing their inputs: equal
+ *   requests return the same instance, with one more reference. Released
+ *   resources are kept unreferenced, so switching between renderers reuses
+ *   them, until the memory of the registry exceeds its budget: then the least
+ *   recently used unreferenced resources are destroyed.
+ *
+ * All calls must be made at the thread that owns the gl context.
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#ifndef VOL_VIS_UTILS_DERIVED_RESOURCE_REGISTRY_H
+#define VOL_VIS_UTILS_DERIVED_RESOURCE_REGISTRY_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace vis
+{
+  class DerivedResourceRegistry
+  {
+  public:
+    // Returns the new resource (nullptr on failure) and its memory size
+    typedef std::function<void* (size_t* memory_size)> CreateFunction;
+    typedef std::function<void (void* resource)> DestroyFunction;
+
+    DerivedResourceRegistry ();
+    ~DerivedResourceRegistry ();
+
+    // Resource "name" created from inputs "key", with a new reference. Key 0
+    //  (unknown inputs) creates a resource that is never shared.
+    void* Acquire (std::string name, unsigned long long key, CreateFunction create, DestroyFunction destroy);
+    template<typename T>
+    T* Acquire (std::string name, unsigned long long key, std::function<T* (size_t* memory_size)> create)
+    {
+      return static_cast<T*>(Acquire(name, key,
+        [create] (size_t* memory_size) -> void* { return create(memory_size); },
+        [] (void* resource) { delete static_cast<T*>(resource); }));
+    }
+    // Remove a reference of "resource", returned by Acquire
+    void Release (void* resource);
+
+    void SetMemoryBudget (size_t bytes);
+    size_t GetMemoryBudget ();
+    // Memory of all resources, referenced or not
+    size_t GetMemorySize ();
+
+    // Destroy the least recently used unreferenced resources above the budget
+    void Evict ();
+    void DestroyUnreferenced ();
+
+    int GetNumberOfResources ();
+    std::string GetResourceName (int id);
+    int GetNumberOfReferences (int id);
+    size_t GetResourceMemorySize (int id);
+
+    unsigned long long GetNumberOfHits ();
+    unsigned long long GetNumberOfMisses ();
+
+  protected:
+    class Resource
+    {
+    public:
+      std::string name;
+      unsigned long long key;
+      void* data;
+      DestroyFunction destroy;
+      size_t memory_size;
+      int references;
+      unsigned long long last_use;
+    };
+
+    void DestroyResource (int id);
+
+    std::vector<Resource> resources;
+    size_t memory_budget;
+    unsigned long long use_counter;
+
+    unsigned long long hits;
+    unsigned long long misses;
+
+  private:
+
+  };
+}
+
+#endif
@@ -0,0 +1,496 @@
+/**
+ * encodedgradientfield.cpp
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#include <volvis_utils/encodedgradientfield.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Number of slices of the float gradients buffer used by Build
+#define ENCODED_GRADIENT_FIELD_CHUNK_SLICES 16
+
+namespace vis
+{
+  // Quantized octahedral coordinates: [-1, 1] -> [1, 2^bits - 1]
+  template<typename T>
+  static inline T QuantizeOctahedral (float e, float half_range)
+  {
+    return (T)(int)std::floor(e * (half_range - 1.0f) + half_range + 0.5f);
+  }
+
+  template<typename T>
+  static inline float DequantizeOctahedral (T q, float half_range)
+  {
+    return ((float)q - half_range) / (half_range - 1.0f);
+  }
+
+  template<typename N, typename M>
+  static void EncodeGradients (const glm::vec3* gradients, size_t n_voxels, N* normals, M* magnitudes,
+                               float inv_max_magnitude)
+  {
+    const float half_range = float((size_t(1) << (sizeof(N) * 8)) / 2);
+    const float magnitude_range = magnitudes ? float((size_t(1) << (sizeof(M) * 8)) - 1) : 0.0f;
+
+#pragma omp parallel for schedule(static)
+    for (long long v = 0; v < (long long)n_voxels; v++)
+    {
+      glm::vec3 g = gradients[v];
+      float l1 = std::abs(g.x) + std::abs(g.y) + std::abs(g.z);
+      // null (and NaN) gradients
+      if (!(l1 > 0.0f))
+      {
+        normals[2 * v + 0] = N(0);
+        normals[2 * v + 1] = N(0);
+        if (magnitudes) magnitudes[v] = M(0);
+        continue;
+      }
+
+      glm::vec2 e = EncodedGradientField::OctahedralEncode(g * (1.0f / l1));
+      normals[2 * v + 0] = QuantizeOctahedral<N>(e.x, half_range);
+      normals[2 * v + 1] = QuantizeOctahedral<N>(e.y, half_range);
+      if (magnitudes)
+        magnitudes[v] = (M)(int)std::floor(std::min(glm::length(g) * inv_max_magnitude, 1.0f) * magnitude_range + 0.5f);
+    }
+  }
+
+  template<typename M>
+  static void QuantizeMagnitudes (const float* lengths, size_t n_voxels, M* magnitudes, float inv_max_magnitude)
+  {
+    const float magnitude_range = float((size_t(1) << (sizeof(M) * 8)) - 1);
+
+#pragma omp parallel for schedule(static)
+    for (long long v = 0; v < (long long)n_voxels; v++)
+    {
+      float l = lengths[v];
+      magnitudes[v] = (l > 0.0f) ? (M)(int)std::floor(std::min(l * inv_max_magnitude, 1.0f) * magnitude_range + 0.5f) : M(0);
+    }
+  }
+
+  template<typename N, typename M>
+  static inline glm::vec3 DecodeGradient (const N* normals, const M* magnitudes, size_t v, float magnitude_scale)
+  {
+    if (normals[2 * v + 0] == N(0) && normals[2 * v + 1] == N(0)) return glm::vec3(0.0f);
+
+    const float half_range = float((size_t(1) << (sizeof(N) * 8)) / 2);
+    glm::vec3 n = EncodedGradientField::OctahedralDecode(glm::vec2(DequantizeOctahedral(normals[2 * v + 0], half_range),
+                                                                   DequantizeOctahedral(normals[2 * v + 1], half_range)));
+    if (magnitudes) return n * ((float)magnitudes[v] * magnitude_scale);
+    return n;
+  }
+
+  template<typename N, typename M>
+  static void DecodeGradients (const N* normals, const M* magnitudes, size_t first, size_t n_voxels,
+                               float magnitude_scale, glm::vec3* gradients)
+  {
+#pragma omp parallel for schedule(static)
+    for (long long v = 0; v < (long long)n_voxels; v++)
+      gradients[v] = DecodeGradient(normals, magnitudes, first + size_t(v), magnitude_scale);
+  }
+
+  // Max gradient length of "n_slices" slices
+  static float MaxMagnitude (const glm::vec3* gradients, size_t slice_size, int n_slices)
+  {
+    float* slice_max = new float[n_slices];
+#pragma omp parallel for
+    for (int z = 0; z < n_slices; z++)
+    {
+      const glm::vec3* slice = gradients + size_t(z) * slice_size;
+      float m = 0.0f;
+      for (size_t i = 0; i < slice_size; i++)
+        m = std::max(m, slice[i].x * slice[i].x + slice[i].y * slice[i].y + slice[i].z * slice[i].z);
+      slice_max[z] = m;
+    }
+
+    float max_magnitude = 0.0f;
+    for (int z = 0; z < n_slices; z++)
+      max_magnitude = std::max(max_magnitude, slice_max[z]);
+    delete[] slice_max;
+
+    return std::sqrt(max_magnitude);
+  }
+
+  // Max value of "n_slices" slices of gradient lengths (NaN are ignored)
+  static float MaxLength (const float* lengths, size_t slice_size, int n_slices)
+  {
+    float* slice_max = new float[n_slices];
+#pragma omp parallel for
+    for (int z = 0; z < n_slices; z++)
+    {
+      const float* slice = lengths + size_t(z) * slice_size;
+      float m = 0.0f;
+      for (size_t i = 0; i < slice_size; i++)
+        if (slice[i] > m) m = slice[i];
+      slice_max[z] = m;
+    }
+
+    float max_length = 0.0f;
+    for (int z = 0; z < n_slices; z++)
+      max_length = std::max(max_length, slice_max[z]);
+    delete[] slice_max;
+
+    return max_length;
+  }
+
+  EncodedGradientField::EncodedGradientField ()
+    : m_width(0)
+    , m_height(0)
+    , m_depth(0)
+    , m_normal_bits(0)
+    , m_magnitude_bits(0)
+    , m_max_magnitude(0.0f)
+    , m_normals(nullptr)
+    , m_magnitudes(nullptr)
+  {
+  }
+
+  EncodedGradientField::~EncodedGradientField ()
+  {
+    Destroy();
+  }
+
+  bool EncodedGradientField::Build (StructuredGridVolume* vol, GRADIENT_OPERATOR gradient_operator,
+                                    int normal_bits, int magnitude_bits)
+  {
+    Destroy();
+    if (!vol || !vol->GetArrayData()) return false;
+    if ((normal_bits != 8 && normal_bits != 16) || (magnitude_bits != 0 && magnitude_bits != 8 && magnitude_bits != 16))
+      return false;
+
+    int width = (int)vol->GetWidth();
+    int height = (int)vol->GetHeight();
+    int depth = (int)vol->GetDepth();
+    size_t slice_size = size_t(width) * size_t(height);
+    size_t n_voxels = slice_size * size_t(depth);
+    int chunk_slices = std::min(ENCODED_GRADIENT_FIELD_CHUNK_SLICES, depth);
+
+    // Central differences are stored not normalized: the magnitude is optional
+    bool normalized = (gradient_operator == GRADIENT_OPERATOR::CENTRAL_DIFFERENCES && magnitude_bits == 0);
+
+    Allocate(width, height, depth, normal_bits, magnitude_bits);
+
+    // 1: encode the normals of each chunk, keeping the gradient lengths until
+    //    the max magnitude is known
+    float* lengths = (magnitude_bits > 0) ? new float[n_voxels] : nullptr;
+    glm::vec3* chunk = new glm::vec3[slice_size * chunk_slices];
+    for (int z = 0; z < depth; z += chunk_slices)
+    {
+      int z_end = std::min(z + chunk_slices, depth);
+      if (gradient_operator == GRADIENT_OPERATOR::CENTRAL_DIFFERENCES)
+        ComputeCentralDifferenceGradients(vol, chunk, 1, normalized, z, z_end);
+      else
+        ComputeGradients(vol, chunk, gradient_operator, z, z_end);
+
+      size_t first = slice_size * size_t(z);
+      size_t n_chunk = slice_size * size_t(z_end - z);
+      EncodeRange(chunk, first, n_chunk, false);
+
+      if (lengths)
+      {
+        float* chunk_lengths = lengths + first;
+#pragma omp parallel for schedule(static)
+        for (long long v = 0; v < (long long)n_chunk; v++)
+          chunk_lengths[v] = glm::length(chunk[v]);
+      }
+    }
+    delete[] chunk;
+
+    // 2: quantize the magnitudes, relative to the max magnitude
+    if (lengths)
+    {
+      m_max_magnitude = MaxLength(lengths, slice_size, depth);
+      float inv_max = m_max_magnitude > 0.0f ? 1.0f / m_max_magnitude : 0.0f;
+      if (magnitude_bits == 8)
+        QuantizeMagnitudes(lengths, n_voxels, static_cast<unsigned char*>(m_magnitudes), inv_max);
+      else
+        QuantizeMagnitudes(lengths, n_voxels, static_cast<unsigned short*>(m_magnitudes), inv_max);
+      delete[] lengths;
+    }
+
+    return true;
+  }
+
+  bool EncodedGradientField::Encode (const glm::vec3* gradients, int width, int height, int depth,
+                                     int normal_bits, int magnitude_bits)
+  {
+    Destroy();
+    if (!gradients || width <= 0 || height <= 0 || depth <= 0) return false;
+    if ((normal_bits != 8 && normal_bits != 16) || (magnitude_bits != 0 && magnitude_bits != 8 && magnitude_bits != 16))
+      return false;
+
+    size_t n_voxels = size_t(width) * size_t(height) * size_t(depth);
+
+    float max_magnitude = 0.0f;
+    if (magnitude_bits > 0)
+      max_magnitude = MaxMagnitude(gradients, size_t(width) * size_t(height), depth);
+
+    Allocate(width, height, depth, normal_bits, magnitude_bits);
+    if (magnitude_bits > 0) m_max_magnitude = max_magnitude;
+
+    EncodeRange(gradients, 0, n_voxels);
+    return true;
+  }
+
+  bool EncodedGradientField::SetEncodedData (const void* data, size_t size, int width, int height, int depth,
+                                             int normal_bits, int magnitude_bits)
+  {
+    Destroy();
+    if (!data || width <= 0 || height <= 0 || depth <= 0) return false;
+    if ((normal_bits != 8 && normal_bits != 16) || (magnitude_bits != 0 && magnitude_bits != 8 && magnitude_bits != 16))
+      return false;
+
+    size_t n_voxels = size_t(width) * size_t(height) * size_t(depth);
+    size_t normals_size = n_voxels * size_t(2 * normal_bits / 8);
+    size_t magnitudes_size = n_voxels * size_t(magnitude_bits / 8);
+    if (size != normals_size + magnitudes_size + sizeof(float)) return false;
+
+    Allocate(width, height, depth, normal_bits, magnitude_bits);
+
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    memcpy(m_normals, bytes, normals_size);
+    if (m_magnitudes) memcpy(m_magnitudes, bytes + normals_size, magnitudes_size);
+    memcpy(&m_max_magnitude, bytes + normals_size + magnitudes_size, sizeof(float));
+
+    return true;
+  }
+
+  void EncodedGradientField::GetEncodedData (std::vector<const void*>* buffers, std::vector<unsigned long long>* sizes)
+  {
+    buffers->clear();
+    sizes->clear();
+    if (!m_normals) return;
+
+    size_t n_voxels = size_t(m_width) * size_t(m_height) * size_t(m_depth);
+    buffers->push_back(m_normals);
+    sizes->push_back(n_voxels * size_t(2 * m_normal_bits / 8));
+    if (m_magnitudes)
+    {
+      buffers->push_back(m_magnitudes);
+      sizes->push_back(n_voxels * size_t(m_magnitude_bits / 8));
+    }
+    buffers->push_back(&m_max_magnitude);
+    sizes->push_back(sizeof(float));
+  }
+
+  void EncodedGradientField::Destroy ()
+  {
+    if (m_normal_bits == 8) delete[] static_cast<unsigned char*>(m_normals);
+    else if (m_normal_bits == 16) delete[] static_cast<unsigned short*>(m_normals);
+    if (m_magnitude_bits == 8) delete[] static_cast<unsigned char*>(m_magnitudes);
+    else if (m_magnitude_bits == 16) delete[] static_cast<unsigned short*>(m_magnitudes);
+
+    m_normals = nullptr;
+    m_magnitudes = nullptr;
+    m_width = m_height = m_depth = 0;
+    m_normal_bits = 0;
+    m_magnitude_bits = 0;
+    m_max_magnitude = 0.0f;
+  }
+
+  bool EncodedGradientField::IsBuilt ()
+  {
+    return m_normals != nullptr;
+  }
+
+  int EncodedGradientField::GetWidth ()
+  {
+    return m_width;
+  }
+
+  int EncodedGradientField::GetHeight ()
+  {
+    return m_height;
+  }
+
+  int EncodedGradientField::GetDepth ()
+  {
+    return m_depth;
+  }
+
+  int EncodedGradientField::GetNormalBits ()
+  {
+    return m_normal_bits;
+  }
+
+  int EncodedGradientField::GetMagnitudeBits ()
+  {
+    return m_magnitude_bits;
+  }
+
+  float EncodedGradientField::GetMaxMagnitude ()
+  {
+    return m_max_magnitude;
+  }
+
+  size_t EncodedGradientField::GetMemorySize ()
+  {
+    size_t n_voxels = size_t(m_width) * size_t(m_height) * size_t(m_depth);
+    return n_voxels * size_t(2 * m_normal_bits + m_magnitude_bits) / 8;
+  }
+
+  glm::vec3 EncodedGradientField::GetGradient (int x, int y, int z)
+  {
+    if (!m_normals || x < 0 || y < 0 || z < 0 || x >= m_width || y >= m_height || z >= m_depth)
+      return glm::vec3(0.0f);
+    return DecodeVoxel(size_t(x) + size_t(y) * m_width + size_t(z) * m_width * m_height);
+  }
+
+  glm::vec3 EncodedGradientField::GetNormal (int x, int y, int z)
+  {
+    glm::vec3 g = GetGradient(x, y, z);
+    float l = glm::length(g);
+    return l > 0.0f ? g / l : glm::vec3(0.0f);
+  }
+
+  float EncodedGradientField::GetMagnitude (int x, int y, int z)
+  {
+    return glm::length(GetGradient(x, y, z));
+  }
+
+  glm::vec3 EncodedGradientField::GetInterpolatedGradient (double x, double y, double z)
+  {
+    if (!m_normals) return glm::vec3(0.0f);
+
+    glm::dvec3 p = glm::clamp(glm::dvec3(x, y, z), glm::dvec3(0.0), glm::dvec3(m_width - 1, m_height - 1, m_depth - 1));
+    glm::ivec3 p0 = glm::ivec3(p);
+    glm::ivec3 p1 = glm::min(p0 + 1, glm::ivec3(m_width - 1, m_height - 1, m_depth - 1));
+    glm::vec3 d = glm::vec3(p - glm::dvec3(p0));
+
+    glm::vec3 c00 = glm::mix(GetGradient(p0.x, p0.y, p0.z), GetGradient(p1.x, p0.y, p0.z), d.x);
+    glm::vec3 c10 = glm::mix(GetGradient(p0.x, p1.y, p0.z), GetGradient(p1.x, p1.y, p0.z), d.x);
+    glm::vec3 c01 = glm::mix(GetGradient(p0.x, p0.y, p1.z), GetGradient(p1.x, p0.y, p1.z), d.x);
+    glm::vec3 c11 = glm::mix(GetGradient(p0.x, p1.y, p1.z), GetGradient(p1.x, p1.y, p1.z), d.x);
+
+    return glm::mix(glm::mix(c00, c10, d.y), glm::mix(c01, c11, d.y), d.z);
+  }
+
+  glm::vec3 EncodedGradientField::SampleGradient (glm::dvec3 tex_coord)
+  {
+    return GetInterpolatedGradient(tex_coord.x * m_width - 0.5, tex_coord.y * m_height - 0.5, tex_coord.z * m_depth - 0.5);
+  }
+
+  void EncodedGradientField::Decode (glm::vec3* gradients)
+  {
+    if (!m_normals || !gradients) return;
+    DecodeRange(gradients, 0, size_t(m_width) * size_t(m_height) * size_t(m_depth));
+  }
+
+  void EncodedGradientField::DecodeSlices (glm::vec3* gradients, int z_begin, int z_end)
+  {
+    if (!m_normals || !gradients) return;
+    z_begin = std::max(z_begin, 0);
+    z_end = std::min(z_end, m_depth);
+    if (z_begin >= z_end) return;
+
+    size_t slice_size = size_t(m_width) * size_t(m_height);
+    DecodeRange(gradients, slice_size * size_t(z_begin), slice_size * size_t(z_end - z_begin));
+  }
+
+  // "A Survey of Efficient Representations for Independent Unit Vectors"
+  //  Cigolle et al., JCGT 2014
+  glm::vec2 EncodedGradientField::OctahedralEncode (glm::vec3 n)
+  {
+    n = n * (1.0f / (std::abs(n.x) + std::abs(n.y) + std::abs(n.z)));
+    glm::vec2 e(n.x, n.y);
+    if (n.z < 0.0f)
+    {
+      e.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+      e.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return e;
+  }
+
+  glm::vec3 EncodedGradientField::OctahedralDecode (glm::vec2 e)
+  {
+    glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+    if (n.z < 0.0f)
+    {
+      n.x = (1.0f - std::abs(e.y)) * (e.x >= 0.0f ? 1.0f : -1.0f);
+      n.y = (1.0f - std::abs(e.x)) * (e.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return n * (1.0f / std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z));
+  }
+
+  void EncodedGradientField::Allocate (int width, int height, int depth, int normal_bits, int magnitude_bits)
+  {
+    size_t n_voxels = size_t(width) * size_t(height) * size_t(depth);
+
+    m_width = width;
+    m_height = height;
+    m_depth = depth;
+    m_normal_bits = normal_bits;
+    m_magnitude_bits = magnitude_bits;
+    m_max_magnitude = 1.0f;
+
+    if (normal_bits == 8) m_normals = new unsigned char[2 * n_voxels];
+    else                  m_normals = new unsigned short[2 * n_voxels];
+    if (magnitude_bits == 8)       m_magnitudes = new unsigned char[n_voxels];
+    else if (magnitude_bits == 16) m_magnitudes = new unsigned short[n_voxels];
+  }
+
+  void EncodedGradientField::EncodeRange (const glm::vec3* gradients, size_t first, size_t n_voxels,
+                                          bool encode_magnitudes)
+  {
+    float inv_max = m_max_magnitude > 0.0f ? 1.0f / m_max_magnitude : 0.0f;
+    if (m_normal_bits == 8)
+    {
+      unsigned char* normals = static_cast<unsigned char*>(m_normals) + 2 * first;
+      if (!encode_magnitudes || !m_magnitudes)
+        EncodeGradients(gradients, n_voxels, normals, (unsigned char*)nullptr, inv_max);
+      else if (m_magnitude_bits == 16)
+        EncodeGradients(gradients, n_voxels, normals, static_cast<unsigned short*>(m_magnitudes) + first, inv_max);
+      else
+        EncodeGradients(gradients, n_voxels, normals, m_magnitudes ? static_cast<unsigned char*>(m_magnitudes) + first : nullptr, inv_max);
+    }
+    else
+    {
+      unsigned short* normals = static_cast<unsigned short*>(m_normals) + 2 * first;
+      if (!encode_magnitudes || !m_magnitudes)
+        EncodeGradients(gradients, n_voxels, normals, (unsigned char*)nullptr, inv_max);
+      else if (m_magnitude_bits == 16)
+        EncodeGradients(gradients, n_voxels, normals, static_cast<unsigned short*>(m_magnitudes) + first, inv_max);
+      else
+        EncodeGradients(gradients, n_voxels, normals, m_magnitudes ? static_cast<unsigned char*>(m_magnitudes) + first : nullptr, inv_max);
+    }
+  }
+
+  void EncodedGradientField::DecodeRange (glm::vec3* gradients, size_t first, size_t n_voxels)
+  {
+    float scale = m_magnitude_bits > 0 ? m_max_magnitude / float((1 << m_magnitude_bits) - 1) : 1.0f;
+    if (m_normal_bits == 8)
+    {
+      const unsigned char* normals = static_cast<const unsigned char*>(m_normals);
+      if (m_magnitude_bits == 16)
+        DecodeGradients(normals, static_cast<const unsigned short*>(m_magnitudes), first, n_voxels, scale, gradients);
+      else
+        DecodeGradients(normals, static_cast<const unsigned char*>(m_magnitudes), first, n_voxels, scale, gradients);
+    }
+    else
+    {
+      const unsigned short* normals = static_cast<const unsigned short*>(m_normals);
+      if (m_magnitude_bits == 16)
+        DecodeGradients(normals, static_cast<const unsigned short*>(m_magnitudes), first, n_voxels, scale, gradients);
+      else
+        DecodeGradients(normals, static_cast<const unsigned char*>(m_magnitudes), first, n_voxels, scale, gradients);
+    }
+  }
+
+  glm::vec3 EncodedGradientField::DecodeVoxel (size_t id)
+  {
+    float scale = m_magnitude_bits > 0 ? m_max_magnitude / float((1 << m_magnitude_bits) - 1) : 1.0f;
+    if (m_normal_bits == 8)
+    {
+      const unsigned char* normals = static_cast<const unsigned char*>(m_normals);
+      if (m_magnitude_bits == 16)
+        return DecodeGradient(normals, static_cast<const unsigned short*>(m_magnitudes), id, scale);
+      return DecodeGradient(normals, static_cast<const unsigned char*>(m_magnitudes), id, scale);
+    }
+    const unsigned short* normals = static_cast<const unsigned short*>(m_normals);
+    if (m_magnitude_bits == 16)
+      return DecodeGradient(normals, static_cast<const unsigned short*>(m_magnitudes), id, scale);
+    return DecodeGradient(normals, static_cast<const unsigned char*>(m_magnitudes), id, scale);
+  }
+}
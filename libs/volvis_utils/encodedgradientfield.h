@@ -0,0 +1,106 @@
+/**
+ * encodedgradientfield.h
+ *
+ * Compact storage of gradient fields: the direction of each gradient is
+ *   stored with octahedral encoding (2 x 8 or 2 x 16 bits), and the
+ *   magnitude optionally with 8 or 16 bits, relative to the max magnitude.
+ *
+ * Octahedral coordinates are quantized to [1, 2^bits - 1], with the center
+ *   of the range at 0, so the axes are represented exactly. The code (0, 0)
+ *   is reserved to null gradients.
+ *
+ * Bytes per voxel: 2 (8 bits normals) to 6 (16 bits normals and magnitude),
+ *   against 12 for RGB float gradients.
+ *
+ * Build computes the gradients once, in chunks of slices, so the float
+ *   gradient field is never allocated for the whole volume. When magnitudes
+ *   are stored, the gradient lengths (4 bytes per voxel) are kept until the
+ *   max magnitude is known.
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#ifndef VOL_VIS_UTILS_ENCODED_GRADIENT_FIELD_H
+#define VOL_VIS_UTILS_ENCODED_GRADIENT_FIELD_H
+
+#include <volvis_utils/structuredgridvolume.h>
+#include <volvis_utils/gradientfield.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace vis
+{
+  class EncodedGradientField
+  {
+  public:
+    EncodedGradientField ();
+    ~EncodedGradientField ();
+
+    // normal_bits: 8 or 16, magnitude_bits: 0 (unit gradients), 8 or 16
+    bool Build (StructuredGridVolume* vol, GRADIENT_OPERATOR gradient_operator = GRADIENT_OPERATOR::SOBEL_FELDMAN,
+                int normal_bits = 16, int magnitude_bits = 8);
+    bool Encode (const glm::vec3* gradients, int width, int height, int depth,
+                 int normal_bits = 16, int magnitude_bits = 8);
+    // Encoded data in the layout of GetEncodedData: normals, magnitudes (if
+    //  stored) and the max magnitude (float)
+    bool SetEncodedData (const void* data, size_t size, int width, int height, int depth,
+                         int normal_bits, int magnitude_bits);
+    void GetEncodedData (std::vector<const void*>* buffers, std::vector<unsigned long long>* sizes);
+    void Destroy ();
+
+    bool IsBuilt ();
+    int GetWidth ();
+    int GetHeight ();
+    int GetDepth ();
+    int GetNormalBits ();
+    int GetMagnitudeBits ();
+    float GetMaxMagnitude ();
+    size_t GetMemorySize ();
+
+    // Decoded gradient: unit normal * magnitude (unit normal if the magnitude
+    //  is not stored, 0 for null gradients)
+    glm::vec3 GetGradient (int x, int y, int z);
+    glm::vec3 GetNormal (int x, int y, int z);
+    float GetMagnitude (int x, int y, int z);
+
+    // Trilinear interpolation of the decoded gradients, at voxel coordinates
+    //  (voxel centers at integer positions, clamped to the volume)
+    glm::vec3 GetInterpolatedGradient (double x, double y, double z);
+    // Same as a texture fetch: texture coordinates in [0, 1]
+    glm::vec3 SampleGradient (glm::dvec3 tex_coord);
+
+    // Decode all gradients, "gradients" must have width * height * depth values
+    void Decode (glm::vec3* gradients);
+    // Decode the slices [z_begin, z_end), "gradients" must have
+    //  width * height * (z_end - z_begin) values
+    void DecodeSlices (glm::vec3* gradients, int z_begin, int z_end);
+
+    // Unit vector -> octahedral coordinates in [-1, 1]^2, and back
+    static glm::vec2 OctahedralEncode (glm::vec3 n);
+    static glm::vec3 OctahedralDecode (glm::vec2 e);
+
+  protected:
+    void Allocate (int width, int height, int depth, int normal_bits, int magnitude_bits);
+    // Encode/decode "n_voxels" consecutive gradients, starting at voxel "first"
+    void EncodeRange (const glm::vec3* gradients, size_t first, size_t n_voxels, bool encode_magnitudes = true);
+    void DecodeRange (glm::vec3* gradients, size_t first, size_t n_voxels);
+    glm::vec3 DecodeVoxel (size_t id);
+
+    int m_width, m_height, m_depth;
+    int m_normal_bits;
+    int m_magnitude_bits;
+    float m_max_magnitude;
+
+    // 2 values per voxel, unsigned char or unsigned short
+    void* m_normals;
+    // 1 value per voxel, unsigned char or unsigned short (nullptr if not stored)
+    void* m_magnitudes;
+
+  private:
+
+  };
+}
+
+#endif
@@ -0,0 +1,641 @@
+/**
+ * gradientfield.cpp
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#include <volvis_utils/gradientfield.h>
+#include <volvis_utils/syntheticvolumegenerator.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <omp.h>
+
+// Tile size of the parallel loops: the rows of consecutive slices of a tile
+//  are reused by the neighbor slices while they are still in cache
+#define GRADIENT_FIELD_SLAB_DEPTH 8
+#define GRADIENT_FIELD_BLOCK_ROWS 32
+// Number of slices of the float gradients buffer used to compute derived fields
+#define GRADIENT_FIELD_CHUNK_SLICES 16
+
+namespace vis
+{
+  // Sample of the volume array, 0 outside the volume
+  template<typename T>
+  static inline float FetchValue (const T* values, int x, int y, int z, int width, int height, int depth)
+  {
+    if (x < 0 || y < 0 || z < 0 || x >= width || y >= height || z >= depth) return 0.0f;
+    return (float)values[size_t(x) + size_t(y) * width + size_t(z) * width * height];
+  }
+
+  static inline glm::vec3 FinishGradient (glm::vec3 g, bool normalized, float non_normalized_scale)
+  {
+    // NaN values of float volumes
+    if (g.x != g.x || g.y != g.y || g.z != g.z) return glm::vec3(0.0f);
+
+    if (!normalized) return g * non_normalized_scale;
+
+    float length2 = g.x * g.x + g.y * g.y + g.z * g.z;
+    if (length2 > 0.0f) return g * (1.0f / std::sqrt(length2));
+    return glm::vec3(0.0f);
+  }
+
+  template<typename T>
+  static void CentralDifferenceGradients (const T* values, float scale, int width, int height, int depth,
+                                          int n, bool normalized, int first_slice, int last_slice, glm::vec3* gradients)
+  {
+    const size_t stride_y = size_t(width);
+    const size_t stride_z = size_t(width) * size_t(height);
+    const float non_normalized_scale = 0.5f * (float)n;
+
+    int n_row_blocks = (height + GRADIENT_FIELD_BLOCK_ROWS - 1) / GRADIENT_FIELD_BLOCK_ROWS;
+    int n_slabs = (last_slice - first_slice + GRADIENT_FIELD_SLAB_DEPTH - 1) / GRADIENT_FIELD_SLAB_DEPTH;
+
+#pragma omp parallel for schedule(dynamic)
+    for (int tile = 0; tile < n_slabs * n_row_blocks; tile++)
+    {
+      int z_begin = first_slice + (tile / n_row_blocks) * GRADIENT_FIELD_SLAB_DEPTH;
+      int z_end = std::min(z_begin + GRADIENT_FIELD_SLAB_DEPTH, last_slice);
+      int y_begin = (tile % n_row_blocks) * GRADIENT_FIELD_BLOCK_ROWS;
+      int y_end = std::min(y_begin + GRADIENT_FIELD_BLOCK_ROWS, height);
+
+      for (int z = z_begin; z < z_end; z++)
+      {
+        for (int y = y_begin; y < y_end; y++)
+        {
+          const size_t row_offset = size_t(y) * stride_y + size_t(z) * stride_z;
+          glm::vec3* out = gradients + (row_offset - size_t(first_slice) * stride_z);
+
+          // Interior voxels of the row: x - n and x + n are the only samples to check
+          int x_begin = width, x_end = width;
+          if (y - n >= 0 && y + n < height && z - n >= 0 && z + n < depth)
+          {
+            x_begin = std::min(n, width);
+            x_end = std::max(width - n, x_begin);
+          }
+
+          for (int x = 0; x < x_begin; x++)
+          {
+            glm::vec3 g(FetchValue(values, x + n, y, z, width, height, depth) - FetchValue(values, x - n, y, z, width, height, depth),
+                        FetchValue(values, x, y + n, z, width, height, depth) - FetchValue(values, x, y - n, z, width, height, depth),
+                        FetchValue(values, x, y, z + n, width, height, depth) - FetchValue(values, x, y, z - n, width, height, depth));
+            out[x] = FinishGradient(g * scale, normalized, non_normalized_scale);
+          }
+
+          if (x_begin < x_end)
+          {
+            const T* row = values + row_offset;
+            const T* row_y0 = row - n * stride_y;
+            const T* row_y1 = row + n * stride_y;
+            const T* row_z0 = row - n * stride_z;
+            const T* row_z1 = row + n * stride_z;
+            for (int x = x_begin; x < x_end; x++)
+            {
+              glm::vec3 g((float)row[x + n] - (float)row[x - n],
+                          (float)row_y1[x] - (float)row_y0[x],
+                          (float)row_z1[x] - (float)row_z0[x]);
+              out[x] = FinishGradient(g * scale, normalized, non_normalized_scale);
+            }
+          }
+
+          for (int x = std::max(x_end, x_begin); x < width; x++)
+          {
+            glm::vec3 g(FetchValue(values, x + n, y, z, width, height, depth) - FetchValue(values, x - n, y, z, width, height, depth),
+                        FetchValue(values, x, y + n, z, width, height, depth) - FetchValue(values, x, y - n, z, width, height, depth),
+                        FetchValue(values, x, y, z + n, width, height, depth) - FetchValue(values, x, y, z - n, width, height, depth));
+            out[x] = FinishGradient(g * scale, normalized, non_normalized_scale);
+          }
+        }
+      }
+    }
+  }
+
+  bool ComputeCentralDifferenceGradients (StructuredGridVolume* vol, glm::vec3* gradients,
+                                          int sample_distance, bool normalized, int z_begin, int z_end)
+  {
+    if (!vol || !vol->GetArrayData() || !gradients || sample_distance < 1) return false;
+
+    int width = (int)vol->GetWidth();
+    int height = (int)vol->GetHeight();
+    int depth = (int)vol->GetDepth();
+    void* values = vol->GetArrayData();
+
+    if (z_end < 0) z_end = depth;
+    if (z_begin < 0 || z_begin >= z_end || z_end > depth) return false;
+
+    // Same normalization as GetNormalizedSample
+    DataStorageSize dss = vol->GetDataStorageSize();
+    if (dss == DataStorageSize::_8_BITS)
+      CentralDifferenceGradients(static_cast<const unsigned char*>(values), (float)(1.0 / (256.0 - 1.0)),
+        width, height, depth, sample_distance, normalized, z_begin, z_end, gradients);
+    else if (dss == DataStorageSize::_16_BITS)
+      CentralDifferenceGradients(static_cast<const unsigned short*>(values), (float)(1.0 / (65536.0 - 1.0)),
+        width, height, depth, sample_distance, normalized, z_begin, z_end, gradients);
+    else if (dss == DataStorageSize::_NORMALIZED_F)
+      CentralDifferenceGradients(static_cast<const float*>(values), 1.0f,
+        width, height, depth, sample_distance, normalized, z_begin, z_end, gradients);
+    else if (dss == DataStorageSize::_NORMALIZED_D)
+      CentralDifferenceGradients(static_cast<const double*>(values), 1.0f,
+        width, height, depth, sample_distance, normalized, z_begin, z_end, gradients);
+    else
+      return false;
+
+    return true;
+  }
+
+  // Separable Sobel-Feldman operator, with smoothing [1 2 1] and derivative
+  //  [1 0 -1] (value before minus value after):
+  //   x: D(x) S(y) S(z), y: S(x) D(y) S(z), z: S(x) S(y) D(z)
+  // Each slice is first filtered in x and y, then the filtered slices z - 1,
+  //  z and z + 1 are combined. "A" is the accumulation type: integers for 8
+  //  and 16 bits values (exact sums), float for float and double values.
+  template<typename T, typename A>
+  static void SobelFeldmanGradients (const T* values, float scale, int width, int height, int depth,
+                                     int first_slice, int last_slice, glm::vec3* gradients)
+  {
+    const size_t slice_size = size_t(width) * size_t(height);
+    int n_slabs = (last_slice - first_slice + GRADIENT_FIELD_SLAB_DEPTH - 1) / GRADIENT_FIELD_SLAB_DEPTH;
+
+#pragma omp parallel
+    {
+      // x filtered slice
+      A* smooth_x = new A[slice_size];
+      A* derivative_x = new A[slice_size];
+      // xy filtered slices z - 1, z and z + 1 (ring buffer)
+      //  ss: S(x) S(y), ds: D(x) S(y), sd: S(x) D(y)
+      A* ss[3]; A* ds[3]; A* sd[3];
+      for (int i = 0; i < 3; i++)
+      {
+        ss[i] = new A[slice_size];
+        ds[i] = new A[slice_size];
+        sd[i] = new A[slice_size];
+      }
+
+#pragma omp for schedule(dynamic)
+      for (int slab = 0; slab < n_slabs; slab++)
+      {
+        int z_begin = first_slice + slab * GRADIENT_FIELD_SLAB_DEPTH;
+        int z_end = std::min(z_begin + GRADIENT_FIELD_SLAB_DEPTH, last_slice);
+
+        for (int z = z_begin - 1; z <= z_end; z++)
+        {
+          int r = (z + 3) % 3;
+          // slices outside the volume are 0
+          if (z < 0 || z >= depth)
+          {
+            std::fill(ss[r], ss[r] + slice_size, A(0));
+            std::fill(ds[r], ds[r] + slice_size, A(0));
+            std::fill(sd[r], sd[r] + slice_size, A(0));
+          }
+          else
+          {
+            const T* slice = values + size_t(z) * slice_size;
+            for (int y = 0; y < height; y++)
+            {
+              const T* in = slice + size_t(y) * width;
+              A* sx = smooth_x + size_t(y) * width;
+              A* dx = derivative_x + size_t(y) * width;
+              if (width == 1)
+              {
+                sx[0] = A(2) * A(in[0]);
+                dx[0] = A(0);
+                continue;
+              }
+              sx[0] = A(2) * A(in[0]) + A(in[1]);
+              dx[0] = -A(in[1]);
+              for (int x = 1; x < width - 1; x++)
+              {
+                sx[x] = A(in[x - 1]) + A(2) * A(in[x]) + A(in[x + 1]);
+                dx[x] = A(in[x - 1]) - A(in[x + 1]);
+              }
+              sx[width - 1] = A(in[width - 2]) + A(2) * A(in[width - 1]);
+              dx[width - 1] = A(in[width - 2]);
+            }
+
+            for (int y = 0; y < height; y++)
+            {
+              const A* sx0 = y > 0 ? smooth_x + size_t(y - 1) * width : nullptr;
+              const A* dx0 = y > 0 ? derivative_x + size_t(y - 1) * width : nullptr;
+              const A* sx1 = smooth_x + size_t(y) * width;
+              const A* dx1 = derivative_x + size_t(y) * width;
+              const A* sx2 = y < height - 1 ? smooth_x + size_t(y + 1) * width : nullptr;
+              const A* dx2 = y < height - 1 ? derivative_x + size_t(y + 1) * width : nullptr;
+
+              A* out_ss = ss[r] + size_t(y) * width;
+              A* out_ds = ds[r] + size_t(y) * width;
+              A* out_sd = sd[r] + size_t(y) * width;
+              for (int x = 0; x < width; x++)
+              {
+                out_ss[x] = A(2) * sx1[x];
+                out_ds[x] = A(2) * dx1[x];
+                out_sd[x] = A(0);
+              }
+              if (sx0)
+              {
+                for (int x = 0; x < width; x++)
+                {
+                  out_ss[x] += sx0[x];
+                  out_ds[x] += dx0[x];
+                  out_sd[x] += sx0[x];
+                }
+              }
+              if (sx2)
+              {
+                for (int x = 0; x < width; x++)
+                {
+                  out_ss[x] += sx2[x];
+                  out_ds[x] += dx2[x];
+                  out_sd[x] -= sx2[x];
+                }
+              }
+            }
+          }
+
+          // slices z - 2, z - 1 and z are ready: write slice z - 1
+          int zo = z - 1;
+          if (zo < z_begin) continue;
+
+          const A* ss0 = ss[(zo + 2) % 3]; const A* ss2 = ss[r];
+          const A* ds0 = ds[(zo + 2) % 3]; const A* ds1 = ds[(zo + 3) % 3]; const A* ds2 = ds[r];
+          const A* sd0 = sd[(zo + 2) % 3]; const A* sd1 = sd[(zo + 3) % 3]; const A* sd2 = sd[r];
+          glm::vec3* out = gradients + size_t(zo - first_slice) * slice_size;
+          for (size_t i = 0; i < slice_size; i++)
+          {
+            out[i] = glm::vec3((float)(ds0[i] + A(2) * ds1[i] + ds2[i]),
+                               (float)(sd0[i] + A(2) * sd1[i] + sd2[i]),
+                               (float)(ss0[i] - ss2[i])) * scale;
+          }
+        }
+      }
+
+      delete[] smooth_x;
+      delete[] derivative_x;
+      for (int i = 0; i < 3; i++)
+      {
+        delete[] ss[i];
+        delete[] ds[i];
+        delete[] sd[i];
+      }
+    }
+  }
+
+  bool ComputeSobelFeldmanGradients (StructuredGridVolume* vol, glm::vec3* gradients, int z_begin, int z_end)
+  {
+    if (!vol || !vol->GetArrayData() || !gradients) return false;
+
+    int width = (int)vol->GetWidth();
+    int height = (int)vol->GetHeight();
+    int depth = (int)vol->GetDepth();
+    void* values = vol->GetArrayData();
+
+    if (z_end < 0) z_end = depth;
+    if (z_begin < 0 || z_begin >= z_end || z_end > depth) return false;
+
+    DataStorageSize dss = vol->GetDataStorageSize();
+    if (dss == DataStorageSize::_8_BITS)
+      SobelFeldmanGradients<unsigned char, int>(static_cast<const unsigned char*>(values), (float)(1.0 / (256.0 - 1.0)),
+        width, height, depth, z_begin, z_end, gradients);
+    else if (dss == DataStorageSize::_16_BITS)
+      SobelFeldmanGradients<unsigned short, int>(static_cast<const unsigned short*>(values), (float)(1.0 / (65536.0 - 1.0)),
+        width, height, depth, z_begin, z_end, gradients);
+    else if (dss == DataStorageSize::_NORMALIZED_F)
+      SobelFeldmanGradients<float, float>(static_cast<const float*>(values), 1.0f,
+        width, height, depth, z_begin, z_end, gradients);
+    else if (dss == DataStorageSize::_NORMALIZED_D)
+      SobelFeldmanGradients<double, float>(static_cast<const double*>(values), 1.0f,
+        width, height, depth, z_begin, z_end, gradients);
+    else
+      return false;
+
+    return true;
+  }
+
+  bool ComputeGradients (StructuredGridVolume* vol, glm::vec3* gradients, GRADIENT_OPERATOR gradient_operator,
+                         int z_begin, int z_end)
+  {
+    if (gradient_operator == GRADIENT_OPERATOR::SOBEL_FELDMAN)
+      return ComputeSobelFeldmanGradients(vol, gradients, z_begin, z_end);
+    return ComputeCentralDifferenceGradients(vol, gradients, 1, false, z_begin, z_end);
+  }
+
+  bool ComputeGradientMagnitudes (StructuredGridVolume* vol, float* magnitudes, GRADIENT_OPERATOR gradient_operator,
+                                  float* max_magnitude)
+  {
+    if (!vol || !vol->GetArrayData() || !magnitudes) return false;
+
+    int depth = (int)vol->GetDepth();
+    size_t slice_size = size_t(vol->GetWidth()) * size_t(vol->GetHeight());
+    int chunk_slices = std::min(GRADIENT_FIELD_CHUNK_SLICES, depth);
+    glm::vec3* chunk = new glm::vec3[slice_size * chunk_slices];
+    // max squared magnitude of each slice
+    float* slice_max = new float[depth];
+
+    for (int z = 0; z < depth; z += chunk_slices)
+    {
+      int z_end = std::min(z + chunk_slices, depth);
+      ComputeGradients(vol, chunk, gradient_operator, z, z_end);
+
+#pragma omp parallel for
+      for (int k = z; k < z_end; k++)
+      {
+        const glm::vec3* in = chunk + size_t(k - z) * slice_size;
+        float* out = magnitudes + size_t(k) * slice_size;
+        float m = 0.0f;
+        for (size_t i = 0; i < slice_size; i++)
+        {
+          float l2 = in[i].x * in[i].x + in[i].y * in[i].y + in[i].z * in[i].z;
+          out[i] = std::sqrt(l2);
+          m = std::max(m, l2);
+        }
+        slice_max[k] = m;
+      }
+    }
+
+    if (max_magnitude)
+    {
+      float m = 0.0f;
+      for (int z = 0; z < depth; z++)
+        m = std::max(m, slice_max[z]);
+      *max_magnitude = std::sqrt(m);
+    }
+
+    delete[] chunk;
+    delete[] slice_max;
+    return true;
+  }
+
+  // In place running sum mean along the rows of a plane: row "i" (of
+  //  "row_width" values, at "i * row_stride") receives the mean of the rows
+  //  [i - radius, i + radius] inside the plane. The original values of the
+  //  last radius + 1 rows are kept in "ring" (ring buffer), "sum" must have
+  //  "row_width" values.
+  static void BoxFilterRows (glm::vec3* plane, int length, int row_width, size_t row_stride, int radius,
+                             glm::vec3* ring, glm::dvec3* sum)
+  {
+    for (int x = 0; x < row_width; x++)
+      sum[x] = glm::dvec3(0.0);
+    for (int i = 0; i <= std::min(radius, length - 1); i++)
+    {
+      const glm::vec3* row = plane + size_t(i) * row_stride;
+      for (int x = 0; x < row_width; x++)
+        sum[x] += glm::dvec3(row[x]);
+    }
+
+    for (int i = 0; i < length; i++)
+    {
+      glm::vec3* row = plane + size_t(i) * row_stride;
+      glm::vec3* original_row = ring + size_t(i % (radius + 1)) * row_width;
+      double inv_count = 1.0 / double(std::min(i + radius, length - 1) - std::max(i - radius, 0) + 1);
+      for (int x = 0; x < row_width; x++)
+      {
+        original_row[x] = row[x];
+        row[x] = glm::vec3(sum[x] * inv_count);
+      }
+
+      // rows after i are still original values
+      if (i + radius + 1 < length)
+      {
+        const glm::vec3* next_row = plane + size_t(i + radius + 1) * row_stride;
+        for (int x = 0; x < row_width; x++)
+          sum[x] += glm::dvec3(next_row[x]);
+      }
+      if (i - radius >= 0)
+      {
+        const glm::vec3* prev_row = ring + size_t((i - radius) % (radius + 1)) * row_width;
+        for (int x = 0; x < row_width; x++)
+          sum[x] -= glm::dvec3(prev_row[x]);
+      }
+    }
+  }
+
+  bool SmoothGradients (glm::vec3* gradients, int width, int height, int depth, int radius, int n_passes, bool renormalize)
+  {
+    if (!gradients || width <= 0 || height <= 0 || depth <= 0 || radius < 0) return false;
+
+    const size_t slice_size = size_t(width) * size_t(height);
+    for (int pass = 0; pass < n_passes && radius > 0; pass++)
+    {
+#pragma omp parallel
+      {
+        glm::vec3* ring = new glm::vec3[size_t(radius + 1) * width];
+        glm::dvec3* sum = new glm::dvec3[width];
+
+        // x: each row is a plane of single voxel rows
+#pragma omp for schedule(static)
+        for (int row = 0; row < height * depth; row++)
+          BoxFilterRows(gradients + size_t(row) * width, width, 1, 1, radius, ring, sum);
+
+        // y: rows of each slice
+#pragma omp for schedule(dynamic)
+        for (int z = 0; z < depth; z++)
+          BoxFilterRows(gradients + size_t(z) * slice_size, height, width, size_t(width), radius, ring, sum);
+
+        // z: row y of each slice
+#pragma omp for schedule(dynamic)
+        for (int y = 0; y < height; y++)
+          BoxFilterRows(gradients + size_t(y) * width, depth, width, slice_size, radius, ring, sum);
+
+        delete[] ring;
+        delete[] sum;
+      }
+    }
+
+    if (renormalize)
+    {
+#pragma omp parallel for
+      for (int z = 0; z < depth; z++)
+      {
+        glm::vec3* slice = gradients + size_t(z) * slice_size;
+        for (size_t i = 0; i < slice_size; i++)
+          slice[i] = FinishGradient(slice[i], true, 1.0f);
+      }
+    }
+
+    return true;
+  }
+
+  bool ComputeCentralDifferenceGradientsReference (StructuredGridVolume* vol, glm::vec3* gradients,
+                                                   int sample_distance, bool normalized)
+  {
+    if (!vol || !vol->GetArrayData() || !gradients || sample_distance < 1) return false;
+
+    int width = vol->GetWidth();
+    int height = vol->GetHeight();
+    int depth = vol->GetDepth();
+
+    int n = sample_distance;
+    glm::dvec3 s1, s2;
+    size_t index = 0;
+    for (int z = 0; z < depth; z++)
+    {
+      for (int y = 0; y < height; y++)
+      {
+        for (int x = 0; x < width; x++)
+        {
+          s1.x = vol->GetNormalizedSample(x - n, y, z);
+          s2.x = vol->GetNormalizedSample(x + n, y, z);
+          s1.y = vol->GetNormalizedSample(x, y - n, z);
+          s2.y = vol->GetNormalizedSample(x, y + n, z);
+          s1.z = vol->GetNormalizedSample(x, y, z - n);
+          s2.z = vol->GetNormalizedSample(x, y, z + n);
+
+          glm::dvec3 s2s1 = (s2 - s1);
+
+          if (normalized)
+            s2s1 = glm::normalize<double>(s2s1);
+          else
+            s2s1 = s2s1 / 2.0 * (double)n;
+
+          if (s2s1.x != s2s1.x) //lm.IsNaN
+            s2s1 = glm::dvec3(0);
+
+          gradients[index++] = glm::vec3(s2s1);
+        }
+      }
+    }
+
+    return true;
+  }
+
+  bool ComputeSobelFeldmanGradientsReference (StructuredGridVolume* vol, glm::vec3* gradients)
+  {
+    if (!vol || !vol->GetArrayData() || !gradients) return false;
+
+    int width = vol->GetWidth();
+    int height = vol->GetHeight();
+    int depth = vol->GetDepth();
+
+    for (int z = 0; z < depth; z++)
+    {
+      for (int y = 0; y < height; y++)
+      {
+        for (int x = 0; x < width; x++)
+        {
+          glm::dvec3 sg(0.0);
+          for (int v1 = -1; v1 <= 1; v1++)
+          {
+            for (int v2 = -1; v2 <= 1; v2++)
+            {
+              sg.z += ((double)vol->GetNormalizedSample(x + v1, y + v2, z - 1)) * (4.0 / pow(2.0, glm::abs(v1) + glm::abs(v2)))
+                + ((double)vol->GetNormalizedSample(x + v1, y + v2, z + 1)) * (-4.0 / pow(2.0, glm::abs(v1) + glm::abs(v2)));
+
+              sg.y += ((double)vol->GetNormalizedSample(x + v1, y - 1, z + v2)) * (4.0 / pow(2.0, glm::abs(v1) + glm::abs(v2)))
+                + ((double)vol->GetNormalizedSample(x + v1, y + 1, z + v2)) * (-4.0 / pow(2.0, glm::abs(v1) + glm::abs(v2)));
+
+              sg.x += ((double)vol->GetNormalizedSample(x - 1, y + v2, z + v1)) * (4.0 / pow(2.0, glm::abs(v1) + glm::abs(v2)))
+                + ((double)vol->GetNormalizedSample(x + 1, y + v2, z + v1)) * (-4.0 / pow(2.0, glm::abs(v1) + glm::abs(v2)));
+            }
+          }
+
+          gradients[x + (y * width) + (size_t(z) * width * height)] = glm::vec3(sg);
+        }
+      }
+    }
+
+    return true;
+  }
+
+  // Max abs difference between two gradient fields, relative to the max
+  //  component of the reference field (absolute if it is smaller than 1)
+  static double GradientFieldError (const glm::vec3* reference, const glm::vec3* gradients, size_t n_voxels)
+  {
+    double max_error = 0.0, max_value = 1.0;
+    for (size_t v = 0; v < n_voxels; v++)
+    {
+      for (int c = 0; c < 3; c++)
+      {
+        max_error = std::max(max_error, (double)std::abs(reference[v][c] - gradients[v][c]));
+        max_value = std::max(max_value, (double)std::abs(reference[v][c]));
+      }
+    }
+    return max_error / max_value;
+  }
+
+  bool ValidateGradientComputation (StructuredGridVolume* vol, double tolerance)
+  {
+    if (!vol || !vol->GetArrayData()) return false;
+
+    printf("Started  -> Validate Gradient Computation\n");
+    size_t n_voxels = size_t(vol->GetWidth()) * size_t(vol->GetHeight()) * size_t(vol->GetDepth());
+    glm::vec3* reference = new glm::vec3[n_voxels];
+    glm::vec3* gradients = new glm::vec3[n_voxels];
+
+    bool valid = true;
+    const char* names[3] = { "Central Differences (normalized)", "Central Differences", "Sobel-Feldman" };
+    for (int t = 0; t < 3; t++)
+    {
+      if (t == 2)
+      {
+        ComputeSobelFeldmanGradientsReference(vol, reference);
+        ComputeSobelFeldmanGradients(vol, gradients);
+      }
+      else
+      {
+        ComputeCentralDifferenceGradientsReference(vol, reference, 1, t == 0);
+        ComputeCentralDifferenceGradients(vol, gradients, 1, t == 0);
+      }
+
+      double error = GradientFieldError(reference, gradients, n_voxels);
+      printf("  - %s: max error %g %s\n", names[t], error, error <= tolerance ? "OK" : "FAILED");
+      valid = valid && error <= tolerance;
+    }
+
+    delete[] reference;
+    delete[] gradients;
+    printf("Finished -> Validate Gradient Computation\n");
+    return valid;
+  }
+
+  void BenchmarkGradientComputation (std::vector<unsigned int> volume_sizes, int n_repetitions)
+  {
+    printf("Started  -> Benchmark Gradient Computation\n");
+    printf("  - Threads: %d\n", omp_get_max_threads());
+    n_repetitions = std::max(n_repetitions, 1);
+
+    SyntheticVolumeGenerator generator;
+    for (size_t i = 0; i < volume_sizes.size(); i++)
+    {
+      unsigned int s = volume_sizes[i];
+      StructuredGridVolume* vol = generator.Generate(SyntheticVolumeGenerator::MODEL::GAUSSIAN_BLOBS, s, s, s);
+      if (!vol) continue;
+
+      size_t n_voxels = size_t(s) * size_t(s) * size_t(s);
+      glm::vec3* reference = new glm::vec3[n_voxels];
+      glm::vec3* gradients = new glm::vec3[n_voxels];
+
+      // central differences and Sobel-Feldman: reference and parallel times
+      double times[2][2] = { { 0.0, 0.0 }, { 0.0, 0.0 } };
+      double errors[2] = { 0.0, 0.0 };
+      for (int t = 0; t < 2; t++)
+      {
+        for (int r = 0; r < n_repetitions; r++)
+        {
+          std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+          if (t == 0) ComputeCentralDifferenceGradientsReference(vol, reference);
+          else        ComputeSobelFeldmanGradientsReference(vol, reference);
+          std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+          if (t == 0) ComputeCentralDifferenceGradients(vol, gradients);
+          else        ComputeSobelFeldmanGradients(vol, gradients);
+          std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+          times[t][0] += std::chrono::duration<double, std::milli>(t1 - t0).count() / double(n_repetitions);
+          times[t][1] += std::chrono::duration<double, std::milli>(t2 - t1).count() / double(n_repetitions);
+        }
+        errors[t] = GradientFieldError(reference, gradients, n_voxels);
+      }
+
+      printf("  - %dx%dx%d\n", s, s, s);
+      const char* names[2] = { "Central Differences", "Sobel-Feldman      " };
+      for (int t = 0; t < 2; t++)
+        printf("    %s: reference %.2f ms, parallel %.2f ms, speedup %.2fx, max error %g\n", names[t],
+          times[t][0], times[t][1], times[t][1] > 0.0 ? times[t][0] / times[t][1] : 0.0, errors[t]);
+
+      delete[] reference;
+      delete[] gradients;
+      delete vol;
+    }
+
+    printf("Finished -> Benchmark Gradient Computation\n");
+  }
+}
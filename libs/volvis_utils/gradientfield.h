@@ -0,0 +1,88 @@
+/**
+ * gradientfield.h
+ *
+ * CPU computation of gradient fields of structured volumes, written directly
+ *   as RGB floats (the upload format of the gradient textures).
+ *
+ * The volume is split into tiles of GRADIENT_FIELD_SLAB_DEPTH slices by
+ *   GRADIENT_FIELD_BLOCK_ROWS rows, computed in parallel. Voxel values are
+ *   read from the volume array with a single scale factor per data storage
+ *   size, and the differences are accumulated in float. Rows whose
+ *   neighborhood is inside the volume are computed without bounds checks,
+ *   samples outside the volume are 0 (same as GetNormalizedSample).
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#ifndef VOL_VIS_UTILS_GRADIENT_FIELD_H
+#define VOL_VIS_UTILS_GRADIENT_FIELD_H
+
+#include <volvis_utils/structuredgridvolume.h>
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace vis
+{
+  enum GRADIENT_OPERATOR : unsigned int
+  {
+    CENTRAL_DIFFERENCES = 0,
+    SOBEL_FELDMAN       = 1,
+  };
+
+  // Central differences, "gradients" must have width * height * depth values.
+  // . normalized: unit length gradients (0 where the gradient is null)
+  // . not normalized: (s(x + n) - s(x - n)) / 2 * n, as GenerateGradientTexture
+  // . [z_begin, z_end): compute only these slices, "gradients" starts at
+  //   slice z_begin (z_end = -1: up to the last slice)
+  bool ComputeCentralDifferenceGradients (StructuredGridVolume* vol, glm::vec3* gradients,
+                                          int sample_distance = 1, bool normalized = true,
+                                          int z_begin = 0, int z_end = -1);
+
+  // Scalar implementation using GetNormalizedSample in double precision,
+  //  used as reference to validate and benchmark the parallel one
+  bool ComputeCentralDifferenceGradientsReference (StructuredGridVolume* vol, glm::vec3* gradients,
+                                                   int sample_distance = 1, bool normalized = true);
+
+  // Sobel-Feldman operator (3x3x3, not normalized), computed as a separable
+  //  filter: smoothing [1 2 1] along two axes and derivative [1 0 -1] along
+  //  the third one. 8 and 16 bits volumes are filtered with integer sums.
+  // https://en.wikipedia.org/wiki/Sobel_operator
+  bool ComputeSobelFeldmanGradients (StructuredGridVolume* vol, glm::vec3* gradients,
+                                     int z_begin = 0, int z_end = -1);
+
+  // Direct 3x3x3 evaluation, used as reference
+  bool ComputeSobelFeldmanGradientsReference (StructuredGridVolume* vol, glm::vec3* gradients);
+
+  // Not normalized gradients of the given operator, for slices [z_begin, z_end)
+  bool ComputeGradients (StructuredGridVolume* vol, glm::vec3* gradients, GRADIENT_OPERATOR gradient_operator,
+                         int z_begin = 0, int z_end = -1);
+
+  // Gradient magnitudes of the whole volume, computed in chunks of slices
+  //  ("magnitudes" must have width * height * depth values). "max_magnitude"
+  //  receives the max magnitude, if not null.
+  bool ComputeGradientMagnitudes (StructuredGridVolume* vol, float* magnitudes, GRADIENT_OPERATOR gradient_operator,
+                                  float* max_magnitude = nullptr);
+
+  // Smooth a gradient field in place: each gradient receives the mean of the
+  //  (2 * radius + 1)^3 neighborhood inside the volume. Computed as separable
+  //  running sums along x, y and z (O(1) per voxel for any radius), keeping
+  //  only radius + 1 rows per thread. "n_passes" box filters in sequence
+  //  approximate a gaussian filter (3 passes: sigma^2 = radius * (radius + 1)).
+  // . renormalize: unit length output (0 where the mean is null)
+  bool SmoothGradients (glm::vec3* gradients, int width, int height, int depth, int radius,
+                        int n_passes = 1, bool renormalize = true);
+
+  // Compare the parallel gradients against the reference implementations.
+  //  Returns true if the max error, relative to the max gradient component
+  //  (absolute below 1), is at most "tolerance" for every operator.
+  bool ValidateGradientComputation (StructuredGridVolume* vol, double tolerance = 1e-5);
+
+  // Compare the reference and parallel central differences and Sobel-Feldman
+  //  on synthetic volumes of size^3 voxels (8 bits), for each size of "volume_sizes"
+  void BenchmarkGradientComputation (std::vector<unsigned int> volume_sizes = { 64, 128, 256 },
+                                     int n_repetitions = 3);
+}
+
+#endif
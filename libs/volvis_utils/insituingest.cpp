@@ -0,0 +1,242 @@
+/**
+ * insituingest.cpp
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#include <volvis_utils/insituingest.h>
+#include <volvis_utils/sharedvolume.h>
+
+#include <algorithm>
+
+// Interval between attempts to attach to the ring buffer
+#define IN_SITU_ATTACH_INTERVAL_MS 100
+// Interval between checks for new frames
+#define IN_SITU_POLL_INTERVAL_US 500
+// Weight of the newest latency in the average latency
+#define IN_SITU_LATENCY_AVERAGE_WEIGHT 0.1
+
+namespace vis
+{
+  InSituIngestStats::InSituIngestStats ()
+    : frames_received(0)
+    , frames_displayed(0)
+    , frames_dropped(0)
+    , torn_reads(0)
+    , last_frame_id(0)
+    , last_latency(0.0)
+    , average_latency(0.0)
+    , max_latency(0.0)
+    , received_frames_per_second(0.0)
+    , received_megabytes_per_second(0.0)
+  {
+  }
+
+  InSituVolumeIngest::InSituVolumeIngest ()
+    : m_segment_name("")
+    , m_running(false)
+    , m_attached(false)
+    , m_pending_volume(nullptr)
+    , m_pending_timestamp(0)
+    , m_rate_window_frames(0)
+    , m_rate_window_bytes(0)
+  {
+  }
+
+  InSituVolumeIngest::~InSituVolumeIngest ()
+  {
+    Stop();
+  }
+
+  void InSituVolumeIngest::Start (std::string segment_name)
+  {
+    Stop();
+
+    m_segment_name = segment_name;
+    m_stats = InSituIngestStats();
+    m_rate_window_start = std::chrono::steady_clock::now();
+    m_rate_window_frames = 0;
+    m_rate_window_bytes = 0;
+
+    m_running = true;
+    m_consumer_thread = std::thread(&InSituVolumeIngest::ConsumeFrames, this);
+  }
+
+  void InSituVolumeIngest::Stop ()
+  {
+    m_running = false;
+    if (m_consumer_thread.joinable()) m_consumer_thread.join();
+    m_attached = false;
+
+    std::lock_guard<std::mutex> lock(m_pending_mutex);
+    if (m_pending_volume) delete m_pending_volume;
+    m_pending_volume = nullptr;
+  }
+
+  bool InSituVolumeIngest::IsRunning ()
+  {
+    return m_running;
+  }
+
+  bool InSituVolumeIngest::IsAttached ()
+  {
+    return m_attached;
+  }
+
+  std::string InSituVolumeIngest::GetSegmentName ()
+  {
+    return m_segment_name;
+  }
+
+  StructuredGridVolume* InSituVolumeIngest::TakeLatestVolume ()
+  {
+    // Never wait for the consumer thread
+    std::unique_lock<std::mutex> lock(m_pending_mutex, std::try_to_lock);
+    if (!lock.owns_lock() || !m_pending_volume) return nullptr;
+
+    StructuredGridVolume* vol = m_pending_volume;
+    m_pending_volume = nullptr;
+
+    double latency = double((long long)(VolumeRingBuffer::GetTimestampNow() - m_pending_timestamp)) * 1e-6;
+    m_stats.frames_displayed++;
+    m_stats.last_latency = latency;
+    m_stats.max_latency = std::max(m_stats.max_latency, latency);
+    if (m_stats.frames_displayed == 1)
+      m_stats.average_latency = latency;
+    else
+      m_stats.average_latency += (latency - m_stats.average_latency) * IN_SITU_LATENCY_AVERAGE_WEIGHT;
+
+    return vol;
+  }
+
+  InSituIngestStats InSituVolumeIngest::GetStats ()
+  {
+    std::lock_guard<std::mutex> lock(m_pending_mutex);
+    return m_stats;
+  }
+
+  void InSituVolumeIngest::ConsumeFrames ()
+  {
+    VolumeRingBuffer ring_buffer;
+    printf("  - In-situ ingest: waiting for ring buffer \"%s\"\n", m_segment_name.c_str());
+    while (m_running && !ring_buffer.Attach(m_segment_name))
+      std::this_thread::sleep_for(std::chrono::milliseconds(IN_SITU_ATTACH_INTERVAL_MS));
+    m_attached = ring_buffer.IsAttached();
+
+    while (m_running)
+    {
+      VolumeRingFrameHeader frame;
+      unsigned long long n_dropped = 0;
+      StructuredGridVolume* vol = ring_buffer.ReadLatestFrame(&frame, &n_dropped);
+      if (!vol)
+      {
+        std::this_thread::sleep_for(std::chrono::microseconds(IN_SITU_POLL_INTERVAL_US));
+        continue;
+      }
+
+      std::lock_guard<std::mutex> lock(m_pending_mutex);
+      // The render thread did not take the previous frame yet
+      if (m_pending_volume)
+      {
+        delete m_pending_volume;
+        n_dropped++;
+      }
+      m_pending_volume = vol;
+      m_pending_timestamp = frame.timestamp_ns;
+
+      m_stats.frames_received++;
+      m_stats.frames_dropped += n_dropped;
+      m_stats.torn_reads = ring_buffer.GetNumberOfTornReads();
+      m_stats.last_frame_id = frame.frame_id;
+
+      m_rate_window_frames++;
+      m_rate_window_bytes += frame.bytes;
+      double window = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_rate_window_start).count();
+      if (window >= 1.0)
+      {
+        m_stats.received_frames_per_second = double(m_rate_window_frames) / window;
+        m_stats.received_megabytes_per_second = double(m_rate_window_bytes) / (1024.0 * 1024.0 * window);
+        m_rate_window_start = std::chrono::steady_clock::now();
+        m_rate_window_frames = 0;
+        m_rate_window_bytes = 0;
+      }
+    }
+
+    ring_buffer.Release();
+  }
+
+  InSituProducerStandIn::InSituProducerStandIn ()
+    : m_running(false)
+    , m_n_pushed_frames(0)
+  {
+  }
+
+  InSituProducerStandIn::~InSituProducerStandIn ()
+  {
+    Stop();
+  }
+
+  bool InSituProducerStandIn::Start (std::string segment_name, SyntheticVolumeGenerator::MODEL model,
+                                     unsigned int width, unsigned int height, unsigned int depth,
+                                     DataStorageSize dss, double frames_per_second,
+                                     unsigned int n_slots, int n_distinct_frames)
+  {
+    Stop();
+
+    unsigned long long frame_bytes = (unsigned long long)width * height * depth * SharedVolumeSegment::GetStorageByteSize(dss);
+    if (frame_bytes == 0 || !m_ring_buffer.Create(segment_name, n_slots, frame_bytes))
+      return false;
+
+    // Frames are generated once, so the frame rate is not bounded by the generator
+    SyntheticVolumeGenerator generator;
+    for (int i = 0; i < std::max(n_distinct_frames, 1); i++)
+    {
+      generator.SetSeed((unsigned int)i);
+      m_frames.push_back(generator.Generate(model, width, height, depth, dss));
+    }
+
+    m_n_pushed_frames = 0;
+    m_running = true;
+    m_producer_thread = std::thread(&InSituProducerStandIn::ProduceFrames, this, frames_per_second);
+    return true;
+  }
+
+  void InSituProducerStandIn::Stop ()
+  {
+    m_running = false;
+    if (m_producer_thread.joinable()) m_producer_thread.join();
+
+    m_ring_buffer.Release();
+    for (int i = 0; i < (int)m_frames.size(); i++)
+      delete m_frames[i];
+    m_frames.clear();
+  }
+
+  bool InSituProducerStandIn::IsRunning ()
+  {
+    return m_running;
+  }
+
+  unsigned long long InSituProducerStandIn::GetNumberOfPushedFrames ()
+  {
+    return m_n_pushed_frames;
+  }
+
+  void InSituProducerStandIn::ProduceFrames (double frames_per_second)
+  {
+    std::chrono::steady_clock::time_point next_frame = std::chrono::steady_clock::now();
+    std::chrono::duration<double> frame_interval(frames_per_second > 0.0 ? 1.0 / frames_per_second : 0.0);
+
+    while (m_running)
+    {
+      m_ring_buffer.PushFrame(m_frames[m_n_pushed_frames % m_frames.size()]);
+      m_n_pushed_frames++;
+
+      if (frames_per_second > 0.0)
+      {
+        next_frame += std::chrono::duration_cast<std::chrono::steady_clock::duration>(frame_interval);
+        std::this_thread::sleep_until(next_frame);
+      }
+    }
+  }
+}
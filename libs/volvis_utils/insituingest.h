@@ -0,0 +1,135 @@
+/**
+ * insituingest.h
+ *
+ * In-situ ingest of simulation timesteps through a VolumeRingBuffer.
+ *
+ * . InSituVolumeIngest: consumer thread that attaches to the ring buffer
+ *   (retrying until the producer creates it), copies the latest complete
+ *   frame and keeps it as the pending volume. The render thread takes the
+ *   pending volume without blocking (TakeLatestVolume). If a newer frame
+ *   arrives before the pending one is taken, the pending one is dropped.
+ *
+ * . InSituProducerStandIn: local producer that streams synthetic volumes
+ *   into a ring buffer, used in place of a simulation process to test the
+ *   ingest path.
+ *
+ * Counters:
+ * . received : frames copied out of the ring buffer
+ * . displayed: frames taken by the render thread
+ * . dropped  : frames skipped at the ring buffer or replaced while pending
+ * . latency  : producer timestamp -> taken by the render thread
+ * . rates    : frames/s and MB/s received over the last second
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#ifndef VOL_VIS_UTILS_IN_SITU_INGEST_H
+#define VOL_VIS_UTILS_IN_SITU_INGEST_H
+
+#include <volvis_utils/volumeringbuffer.h>
+#include <volvis_utils/syntheticvolumegenerator.h>
+#include <volvis_utils/structuredgridvolume.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vis
+{
+  class InSituIngestStats
+  {
+  public:
+    InSituIngestStats ();
+
+    unsigned long long frames_received;
+    unsigned long long frames_displayed;
+    unsigned long long frames_dropped;
+    unsigned long long torn_reads;
+
+    unsigned long long last_frame_id;
+    // milliseconds
+    double last_latency;
+    double average_latency;
+    double max_latency;
+
+    double received_frames_per_second;
+    double received_megabytes_per_second;
+  };
+
+  class InSituVolumeIngest
+  {
+  public:
+    InSituVolumeIngest ();
+    ~InSituVolumeIngest ();
+
+    void Start (std::string segment_name);
+    void Stop ();
+
+    bool IsRunning ();
+    bool IsAttached ();
+    std::string GetSegmentName ();
+
+    // Returns the latest received volume, or nullptr if there is no new
+    //  volume. The caller owns the returned volume.
+    StructuredGridVolume* TakeLatestVolume ();
+
+    InSituIngestStats GetStats ();
+
+  protected:
+    void ConsumeFrames ();
+
+    std::string m_segment_name;
+    std::thread m_consumer_thread;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_attached;
+
+    // pending volume, accessed by both threads
+    std::mutex m_pending_mutex;
+    StructuredGridVolume* m_pending_volume;
+    unsigned long long m_pending_timestamp;
+
+    InSituIngestStats m_stats;
+    std::chrono::steady_clock::time_point m_rate_window_start;
+    unsigned long long m_rate_window_frames;
+    unsigned long long m_rate_window_bytes;
+
+  private:
+
+  };
+
+  class InSituProducerStandIn
+  {
+  public:
+    InSituProducerStandIn ();
+    ~InSituProducerStandIn ();
+
+    // Stream "n_distinct_frames" synthetic volumes in a loop, at most
+    //  "frames_per_second" frames per second (0: as fast as possible)
+    bool Start (std::string segment_name, SyntheticVolumeGenerator::MODEL model,
+                unsigned int width, unsigned int height, unsigned int depth,
+                DataStorageSize dss = DataStorageSize::_8_BITS, double frames_per_second = 10.0,
+                unsigned int n_slots = 4, int n_distinct_frames = 8);
+    void Stop ();
+
+    bool IsRunning ();
+    unsigned long long GetNumberOfPushedFrames ();
+
+  protected:
+    void ProduceFrames (double frames_per_second);
+
+    VolumeRingBuffer m_ring_buffer;
+    std::vector<StructuredGridVolume*> m_frames;
+
+    std::thread m_producer_thread;
+    std::atomic<bool> m_running;
+    std::atomic<unsigned long long> m_n_pushed_frames;
+
+  private:
+
+  };
+}
+
+#endif
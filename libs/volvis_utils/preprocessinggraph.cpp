@@ -0,0 +1,312 @@
+#include "preprocessinggraph.h"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <cstdio>
+
+namespace vis
+{
+  PreProcessingGraph::PreProcessingGraph ()
+    : next_version(1)
+    , last_evaluate_time(0.0)
+    , last_evaluate_builds(0)
+  {
+  }
+
+  PreProcessingGraph::~PreProcessingGraph ()
+  {
+    DestroyAll();
+  }
+
+  int PreProcessingGraph::AddNode (std::string name, std::vector<int> dependencies, KeyFunction key,
+                                   BuildFunction build, DestroyFunction destroy, MemoryFunction memory,
+                                   bool thread_safe)
+  {
+    for (int i = 0; i < (int)dependencies.size(); i++)
+    {
+      if (dependencies[i] < 0 || dependencies[i] >= (int)nodes.size())
+      {
+        printf("PreProcessingGraph: node \"%s\" depends on a node that was not added\n", name.c_str());
+        return -1;
+      }
+    }
+
+    Node node;
+    node.name = name;
+    node.dependencies = dependencies;
+    node.key = key;
+    node.build = build;
+    node.destroy = destroy;
+    node.memory = memory;
+    node.thread_safe = thread_safe;
+    node.built = false;
+    node.built_key = 0;
+    node.version = 0;
+    node.build_time = 0.0;
+    node.n_builds = 0;
+    nodes.push_back(node);
+
+    return (int)nodes.size() - 1;
+  }
+
+  void PreProcessingGraph::Clear ()
+  {
+    DestroyAll();
+    nodes.clear();
+  }
+
+  bool PreProcessingGraph::Evaluate (int node)
+  {
+    if (node < 0 || node >= (int)nodes.size()) return false;
+
+    std::vector<bool> needed(nodes.size(), false);
+    needed[node] = true;
+    return EvaluateNodes(needed);
+  }
+
+  bool PreProcessingGraph::EvaluateAll ()
+  {
+    return EvaluateNodes(std::vector<bool>(nodes.size(), true));
+  }
+
+  bool PreProcessingGraph::EvaluateNodes (std::vector<bool> needed)
+  {
+    // Dependencies of the needed nodes: ids are in topological order
+    for (int i = (int)nodes.size() - 1; i >= 0; i--)
+    {
+      if (!needed[i]) continue;
+      for (int d = 0; d < (int)nodes[i].dependencies.size(); d++)
+        needed[nodes[i].dependencies[d]] = true;
+    }
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    last_evaluate_builds = 0;
+
+    std::vector<bool> done(nodes.size(), false);
+    bool success = true;
+    while (success)
+    {
+      // Wave: needed nodes whose dependencies are ready
+      std::vector<int> wave;
+      for (int i = 0; i < (int)nodes.size(); i++)
+      {
+        if (!needed[i] || done[i]) continue;
+        bool ready = true;
+        for (int d = 0; d < (int)nodes[i].dependencies.size() && ready; d++)
+          ready = done[nodes[i].dependencies[d]];
+        if (ready) wave.push_back(i);
+      }
+      if (wave.empty()) break;
+
+      // Dependencies of the wave are final: keys can be checked now
+      std::vector<int> outdated;
+      std::vector<unsigned long long> outdated_keys;
+      for (int w = 0; w < (int)wave.size(); w++)
+      {
+        int i = wave[w];
+        unsigned long long input_key = GetInputKey(i);
+        if (!nodes[i].built || input_key == 0 || input_key != nodes[i].built_key)
+        {
+          outdated.push_back(i);
+          outdated_keys.push_back(input_key);
+        }
+        done[i] = true;
+      }
+
+      // Thread safe nodes are built in background while the others are
+      //  built at this thread
+      std::vector<std::future<bool>> background;
+      std::vector<int> background_nodes;
+      for (int o = 0; o < (int)outdated.size(); o++)
+      {
+        int i = outdated[o];
+        if (nodes[i].thread_safe && outdated.size() > 1)
+        {
+          unsigned long long input_key = outdated_keys[o];
+          background.push_back(std::async(std::launch::async, [this, i, input_key] () {
+            return BuildNode(i, input_key);
+          }));
+          background_nodes.push_back(i);
+        }
+      }
+      for (int o = 0; o < (int)outdated.size(); o++)
+      {
+        int i = outdated[o];
+        if (std::find(background_nodes.begin(), background_nodes.end(), i) != background_nodes.end()) continue;
+        if (!BuildNode(i, outdated_keys[o])) success = false;
+      }
+      for (int b = 0; b < (int)background.size(); b++)
+      {
+        if (!background[b].get()) success = false;
+      }
+
+      // Versions are given after the wave, independent of the order of the
+      //  background builds
+      for (int o = 0; o < (int)outdated.size(); o++)
+      {
+        if (nodes[outdated[o]].built)
+          nodes[outdated[o]].version = next_version++;
+      }
+
+      last_evaluate_builds += (int)outdated.size();
+    }
+
+    last_evaluate_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return success;
+  }
+
+  bool PreProcessingGraph::IsUpToDate (int node)
+  {
+    if (node < 0 || node >= (int)nodes.size() || !nodes[node].built) return false;
+
+    for (int d = 0; d < (int)nodes[node].dependencies.size(); d++)
+    {
+      if (!IsUpToDate(nodes[node].dependencies[d]))
+        return false;
+    }
+
+    unsigned long long input_key = GetInputKey(node);
+    return input_key != 0 && input_key == nodes[node].built_key;
+  }
+
+  void PreProcessingGraph::Invalidate (int node)
+  {
+    if (node < 0 || node >= (int)nodes.size()) return;
+    nodes[node].built_key = 0;
+  }
+
+  void PreProcessingGraph::Destroy (int node)
+  {
+    if (node < 0 || node >= (int)nodes.size() || !nodes[node].built) return;
+
+    if (nodes[node].destroy) nodes[node].destroy();
+    nodes[node].built = false;
+    nodes[node].built_key = 0;
+  }
+
+  void PreProcessingGraph::DestroyAll ()
+  {
+    for (int i = (int)nodes.size() - 1; i >= 0; i--)
+      Destroy(i);
+  }
+
+  void PreProcessingGraph::DestroyOutdated ()
+  {
+    // Dependents first: their state depends on the versions of the dependencies
+    std::vector<bool> outdated(nodes.size(), false);
+    for (int i = 0; i < (int)nodes.size(); i++)
+      outdated[i] = nodes[i].built && !IsUpToDate(i);
+
+    for (int i = (int)nodes.size() - 1; i >= 0; i--)
+    {
+      if (outdated[i])
+        Destroy(i);
+    }
+  }
+
+  int PreProcessingGraph::GetNumberOfNodes ()
+  {
+    return (int)nodes.size();
+  }
+
+  std::string PreProcessingGraph::GetNodeName (int node)
+  {
+    return nodes[node].name;
+  }
+
+  bool PreProcessingGraph::IsBuilt (int node)
+  {
+    return nodes[node].built;
+  }
+
+  double PreProcessingGraph::GetBuildTime (int node)
+  {
+    return nodes[node].build_time;
+  }
+
+  int PreProcessingGraph::GetNumberOfBuilds (int node)
+  {
+    return nodes[node].n_builds;
+  }
+
+  size_t PreProcessingGraph::GetMemorySize (int node)
+  {
+    if (!nodes[node].built || !nodes[node].memory) return 0;
+    return nodes[node].memory();
+  }
+
+  double PreProcessingGraph::GetLastEvaluateTime ()
+  {
+    return last_evaluate_time;
+  }
+
+  int PreProcessingGraph::GetLastEvaluateBuilds ()
+  {
+    return last_evaluate_builds;
+  }
+
+  void PreProcessingGraph::PrintReport ()
+  {
+    size_t total_memory = 0;
+    printf("PreProcessingGraph: %d nodes\n", (int)nodes.size());
+    for (int i = 0; i < (int)nodes.size(); i++)
+    {
+      size_t memory = GetMemorySize(i);
+      total_memory += memory;
+      printf(". %-32s %s %10.2f ms %10.2f MB %4d builds\n", nodes[i].name.c_str(),
+        nodes[i].built ? (IsUpToDate(i) ? "up to date" : "outdated  ") : "empty     ",
+        nodes[i].build_time, double(memory) / (1024.0 * 1024.0), nodes[i].n_builds);
+    }
+    printf(". Total %.2f MB, last evaluate %d builds in %.2f ms\n", double(total_memory) / (1024.0 * 1024.0),
+      last_evaluate_builds, last_evaluate_time);
+  }
+
+  unsigned long long PreProcessingGraph::HashBytes (const void* bytes, size_t size, unsigned long long hash)
+  {
+    const unsigned char* b = static_cast<const unsigned char*>(bytes);
+    for (size_t i = 0; i < size; i++)
+    {
+      hash ^= (unsigned long long)b[i];
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+
+  unsigned long long PreProcessingGraph::GetInputKey (int node)
+  {
+    unsigned long long key = nodes[node].key ? nodes[node].key() : PRE_PROCESSING_GRAPH_HASH_SEED;
+    if (key == 0) return 0;
+
+    for (int d = 0; d < (int)nodes[node].dependencies.size(); d++)
+    {
+      const Node& dependency = nodes[nodes[node].dependencies[d]];
+      if (!dependency.built) return 0;
+      key = HashValue(dependency.version, key);
+    }
+    return key == 0 ? 1 : key;
+  }
+
+  bool PreProcessingGraph::BuildNode (int node, unsigned long long input_key)
+  {
+    Node& n = nodes[node];
+    if (n.built && n.destroy) n.destroy();
+    n.built = false;
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    bool success = n.build ? n.build() : true;
+    n.build_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    if (!success)
+    {
+      printf("PreProcessingGraph: failed to build \"%s\"\n", n.name.c_str());
+      n.built_key = 0;
+      return false;
+    }
+
+    n.built = true;
+    n.built_key = input_key;
+    n.n_builds++;
+    return true;
+  }
+}
@@ -0,0 +1,126 @@
+/**
+ * preprocessinggraph.h
+ *
+ * Dependency graph of the preprocessing stages of a renderer (super voxels,
+ *   preintegration tables, summed area tables, ...).
+ *
+ * Each node declares:
+ * . key         : hash of its external inputs (volume, transfer function,
+ *                 parameters), 0 if the inputs cannot be hashed (the node is
+ *                 then always rebuilt)
+ * . dependencies: nodes whose products it reads, added before it (so the
+ *                 node ids are already in topological order)
+ * . build, destroy and memory functions of its product
+ *
+ * Products are rebuilt lazily at Evaluate, only when the key changed or a
+ *   dependency was rebuilt. Outdated nodes are built in waves: nodes whose
+ *   dependencies are ready are built together, the thread safe ones (no gl
+ *   calls) in background threads while the others are built at the calling
+ *   thread, which must own the gl context.
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#ifndef VOL_VIS_UTILS_PRE_PROCESSING_GRAPH_H
+#define VOL_VIS_UTILS_PRE_PROCESSING_GRAPH_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#define PRE_PROCESSING_GRAPH_HASH_SEED 14695981039346656037ULL
+
+namespace vis
+{
+  class PreProcessingGraph
+  {
+  public:
+    typedef std::function<unsigned long long ()> KeyFunction;
+    typedef std::function<bool ()> BuildFunction;
+    typedef std::function<void ()> DestroyFunction;
+    typedef std::function<size_t ()> MemoryFunction;
+
+    PreProcessingGraph ();
+    ~PreProcessingGraph ();
+
+    // Returns the id of the node, -1 if a dependency does not exist
+    int AddNode (std::string name, std::vector<int> dependencies, KeyFunction key,
+                 BuildFunction build, DestroyFunction destroy, MemoryFunction memory,
+                 bool thread_safe = false);
+    void Clear ();
+
+    // Rebuild the outdated nodes needed by "node", returns false if any build failed
+    bool Evaluate (int node);
+    bool EvaluateAll ();
+
+    // Up to date if built with the current key and dependencies
+    bool IsUpToDate (int node);
+    // Force the rebuild of "node" (and so of its dependents) at the next Evaluate
+    void Invalidate (int node);
+
+    void Destroy (int node);
+    void DestroyAll ();
+    // Destroy only the products that would be rebuilt at the next Evaluate
+    void DestroyOutdated ();
+
+    int GetNumberOfNodes ();
+    std::string GetNodeName (int node);
+    bool IsBuilt (int node);
+    // Time of the last build, in milliseconds
+    double GetBuildTime (int node);
+    int GetNumberOfBuilds (int node);
+    size_t GetMemorySize (int node);
+    // Time spent at the last Evaluate building nodes, and how many were built
+    double GetLastEvaluateTime ();
+    int GetLastEvaluateBuilds ();
+
+    void PrintReport ();
+
+    // FNV-1a, used to build the node keys
+    static unsigned long long HashBytes (const void* bytes, size_t size,
+                                         unsigned long long hash = PRE_PROCESSING_GRAPH_HASH_SEED);
+    template<typename T>
+    static unsigned long long HashValue (const T& value, unsigned long long hash = PRE_PROCESSING_GRAPH_HASH_SEED)
+    {
+      return HashBytes(&value, sizeof(T), hash);
+    }
+
+  protected:
+    class Node
+    {
+    public:
+      std::string name;
+      std::vector<int> dependencies;
+      KeyFunction key;
+      BuildFunction build;
+      DestroyFunction destroy;
+      MemoryFunction memory;
+      bool thread_safe;
+
+      bool built;
+      // Input key of the current product, and a unique version for each build
+      unsigned long long built_key;
+      unsigned long long version;
+
+      double build_time;
+      int n_builds;
+    };
+
+    // Key of the node combined with the versions of its dependencies, 0 if unknown
+    unsigned long long GetInputKey (int node);
+    // Build, in waves, the outdated "needed" nodes and their dependencies
+    bool EvaluateNodes (std::vector<bool> needed);
+    bool BuildNode (int node, unsigned long long input_key);
+
+    std::vector<Node> nodes;
+    unsigned long long next_version;
+
+    double last_evaluate_time;
+    int last_evaluate_builds;
+
+  private:
+
+  };
+}
+
+#endif
@@ -7,15 +7,23 @@
 #include <file_utils/pvm.h>
 #include <file_utils/pvm_old.h>
 #include <file_utils/rawloader.h>
+#include <file_utils/chunkedvolume.h>
 
 #include <fstream>
 #include <array>
 
+#include <omp.h>
+
 #include <volvis_utils/transferfunction1d.h>
+#include <volvis_utils/syntheticvolumegenerator.h>
+
+// Slices read at once by the cancellable raw data reads
+#define RAW_READ_SLAB_SLICES 16
 
 namespace vis
 {
   VolumeReader::VolumeReader ()
+    : m_cancel(nullptr)
   {
 
   }
@@ -54,15 +62,479 @@ namespace vis
     else if (extension.compare("dat") == 0) {
       ret = readdat(filepath);
     }
+    else if (extension.compare("cvol") == 0) {
+      ret = readcvol(filepath);
+    }
+    else if (extension.compare("proc") == 0) {
+      ret = readproc(filepath);
+    }
+    if (ret && IsCancelled())
+    {
+      delete ret;
+      ret = nullptr;
+    }
+    printf("DONE\n");
+
+    return ret;
+  }
+
+  StructuredGridVolume* VolumeReader::ReadStructuredVolumePreview (std::string filepath, int stride, bool average)
+  {
+    if (!IsPreviewSupported(filepath)) return nullptr;
+
+    int found = filepath.find_last_of('.');
+    std::string extension = filepath.substr(size_t(found + 1));
+    stride = glm::max(stride, 1);
+
+    StructuredGridVolume* ret = nullptr;
+    printf(". Reading Structured Grid Volume... ");
+    if (extension.compare("raw") == 0) {
+      ret = readraw(filepath, stride, average);
+    }
+    else if (extension.compare("nrrd") == 0) {
+      ret = readnrrd(filepath, stride, average);
+    }
+    else if (extension.compare("nhrd") == 0) {
+      ret = readnhrd(filepath, stride, average);
+    }
+    else if (extension.compare("dat") == 0) {
+      ret = readdat(filepath, stride, average);
+    }
     printf("DONE\n");
 
     return ret;
   }
 
-  void VolumeReader::SetArrayDataFromRawFile (std::string filepath, StructuredGridVolume* sg, int bytes_per_value)
+  void VolumeReader::SetCancelFlag (std::atomic<bool>* cancel)
+  {
+    m_cancel = cancel;
+  }
+
+  bool VolumeReader::IsCancelled ()
+  {
+    return m_cancel != nullptr && *m_cancel;
+  }
+
+  bool VolumeReader::IsPreviewSupported (std::string filepath)
+  {
+    int found = filepath.find_last_of('.');
+    std::string extension = filepath.substr(size_t(found + 1));
+
+    return extension.compare("raw") == 0 || extension.compare("nrrd") == 0
+        || extension.compare("nhrd") == 0 || extension.compare("dat") == 0;
+  }
+
+  static void* NewChunkedVolumeArray (unsigned int bytes_per_voxel, size_t n_voxels, vis::DataStorageSize* data_tp)
+  {
+    if (bytes_per_voxel == sizeof(unsigned char))
+    {
+      *data_tp = vis::DataStorageSize::_8_BITS;
+      return new unsigned char[n_voxels];
+    }
+    else if (bytes_per_voxel == sizeof(unsigned short))
+    {
+      *data_tp = vis::DataStorageSize::_16_BITS;
+      return new unsigned short[n_voxels];
+    }
+    else if (bytes_per_voxel == sizeof(float))
+    {
+      *data_tp = vis::DataStorageSize::_NORMALIZED_F;
+      return new float[n_voxels];
+    }
+    *data_tp = vis::DataStorageSize::UNKNOWN;
+    return nullptr;
+  }
+
+  // Header of the raw based formats (.raw, .nrrd, .nhrd, .dat)
+  struct RawVolumeHeader
+  {
+    std::string name;
+    std::string data_file;
+    glm::ivec3 resolution;
+    glm::dvec3 scale;
+    int bytes_per_value;
+  };
+
+  // .raw: "<name>.<bytes per value>.<width>x<height>x<depth>.raw"
+  static bool ReadRawFileNameHeader (std::string filepath, RawVolumeHeader* header)
+  {
+    int foundinit = filepath.find_last_of('\\');
+    std::string filename = filepath.substr(foundinit + 1);
+
+    int foundfp = filename.find_last_of('.');
+    filename = filename.substr(0, foundfp);
+
+    int foundsizes = filename.find_last_of('.');
+    std::string t_filesizes = filename.substr(foundsizes + 1, filename.size() - foundsizes);
+
+    filename = filename.substr(0, filename.find_last_of('.'));
+
+    int foundbytesize = filename.find_last_of('.');
+    std::string t_filebytesize = filename.substr(foundbytesize + 1, filename.size() - foundbytesize);
+
+    // Read the Volume Sizes
+    int foundd = t_filesizes.find_last_of('x');
+    header->resolution.z = atoi(t_filesizes.substr(foundd + 1, t_filesizes.size() - foundd).c_str());
+
+    t_filesizes = t_filesizes.substr(0, t_filesizes.find_last_of('x'));
+
+    int foundh = t_filesizes.find_last_of('x');
+    header->resolution.y = atoi(t_filesizes.substr(foundh + 1, t_filesizes.size() - foundh).c_str());
+
+    t_filesizes = t_filesizes.substr(0, t_filesizes.find_last_of('x'));
+
+    int foundw = t_filesizes.find_last_of('x');
+    header->resolution.x = atoi(t_filesizes.substr(foundw + 1, t_filesizes.size() - foundw).c_str());
+
+    // Byte Size
+    header->bytes_per_value = atoi(t_filebytesize.c_str());
+
+    header->name = filename;
+    header->data_file = filepath;
+    header->scale = glm::dvec3(1.0);
+
+    return header->resolution.x > 0 && header->resolution.y > 0 && header->resolution.z > 0;
+  }
+
+  static void SplitHeaderFilePath (std::string filepath, std::string* path, std::string* name)
+  {
+    *path = filepath;
+    *name = filepath;
+    int t1 = filepath.find_last_of('\\');
+    int t2 = filepath.find_last_of('/');
+    int t = glm::max(t1, t2);
+    if (t > -1) {
+      *path = filepath.substr(0, t);
+      *name = filepath.substr(t + 1);
+    }
+  }
+
+  static std::vector<int> ReadHeaderIntegers (std::string content)
+  {
+    std::vector<int> values;
+    while (content.find(' ') != std::string::npos) {
+      std::string size_l = content.substr(0, content.find(' '));
+      values.push_back(std::atoi(size_l.c_str()));
+      content = content.substr(content.find(' ') + 1);
+    }
+    values.push_back(std::atoi(content.c_str()));
+    return values;
+  }
+
+  // .nrrd and .nhrd header, with a separated data file
+  static bool ReadNrrdHeader (std::string filepath, RawVolumeHeader* header, bool print_lines)
+  {
+    std::ifstream iffile(filepath.c_str());
+    if (!iffile.is_open()) return false;
+
+    std::string path;
+    SplitHeaderFilePath(filepath, &path, &header->name);
+
+    std::string version;
+    std::getline(iffile, version);
+
+    std::string type;
+    std::string data_file;
+    header->resolution = glm::ivec3(0);
+    header->scale = glm::dvec3(1.0);
+
+    // read keys
+    while (!iffile.eof()) {
+      std::string line;
+      std::getline(iffile, line);
+
+      if (print_lines) std::cout << line << std::endl;
+
+      if (line.find_first_of('#') == 0) continue;
+
+      std::string key = line.substr(0, line.find_first_of(':'));
+      std::string content = line.substr(line.find_first_of(":") + 1);
+
+      // skip ' ' and '\t'
+      int count_skip = 0;
+      while (content[count_skip] == ' ' || content[count_skip] == '\t') {
+        count_skip += 1;
+      }
+      content = content.substr(count_skip);
+
+      if (key.find("type") == 0) {
+        type = content;
+      }
+      else if (key.find("sizes") == 0) {
+        std::vector<int> vec_resolution = ReadHeaderIntegers(content);
+        if (vec_resolution.size() >= 3)
+          header->resolution = glm::ivec3(vec_resolution[0], vec_resolution[1], vec_resolution[2]);
+      }
+      else if (key.find("data file") == 0) {
+        data_file = content;
+      }
+    }
+    iffile.close();
+
+    header->data_file = path + "/" + data_file;
+
+    header->bytes_per_value = 1;
+    if ((int)type.find("uint8") > -1) {
+      header->bytes_per_value = sizeof(unsigned char);
+    }
+    if ((int)type.find("uint16") > -1) {
+      header->bytes_per_value = sizeof(unsigned short);
+    }
+
+    return true;
+  }
+
+  // .dat header (zurich datasets), with a separated data file
+  static bool ReadDatHeader (std::string filepath, RawVolumeHeader* header, bool print_lines)
+  {
+    std::ifstream iffile(filepath.c_str());
+    if (!iffile.is_open()) return false;
+
+    std::string path;
+    SplitHeaderFilePath(filepath, &path, &header->name);
+
+    std::string objectfilename;
+    std::string format;
+    header->resolution = glm::ivec3(0);
+    header->scale = glm::dvec3(1.0);
+
+    // read keys
+    while (!iffile.eof()) {
+      std::string line;
+      std::getline(iffile, line);
+
+      if (print_lines) std::cout << line << std::endl;
+
+      std::string key = line.substr(0, line.find_first_of(':'));
+      std::string content = line.substr(line.find_first_of(":") + 1);
+
+      // skip ' ' and '\t'
+      int count_skip = 0;
+      while (content[count_skip] == ' ' || content[count_skip] == '\t') {
+        count_skip += 1;
+      }
+      content = content.substr(count_skip);
+
+      if (key.find("ObjectFileName") == 0) {
+        objectfilename = content;
+      }
+      else if (key.find("Resolution") == 0) {
+        std::vector<int> vec_resolution = ReadHeaderIntegers(content);
+        if (vec_resolution.size() >= 3)
+          header->resolution = glm::ivec3(vec_resolution[0], vec_resolution[1], vec_resolution[2]);
+      }
+      else if (key.find("SliceThickness") == 0) {
+        std::string str_slicethickness = content;
+
+        std::vector<float> vec_thickness;
+        while (str_slicethickness.find(' ') != std::string::npos) {
+          std::string size_l = str_slicethickness.substr(0, str_slicethickness.find(' '));
+          vec_thickness.push_back(std::stof(size_l.c_str()));
+          str_slicethickness = str_slicethickness.substr(str_slicethickness.find(' ') + 1);
+        }
+        vec_thickness.push_back(std::stof(str_slicethickness.c_str()));
+
+        header->scale = glm::dvec3(glm::vec3(vec_thickness[0], vec_thickness[1], vec_thickness[2]));
+      }
+      else if (key.find("Format") == 0) {
+        format = content;
+      }
+    }
+    iffile.close();
+
+    header->data_file = path + "/" + objectfilename;
+
+    header->bytes_per_value = 1;
+    if ((int)format.find("UCHAR") > -1) {       // 8 bits
+      header->bytes_per_value = sizeof(unsigned char);
+    }
+    else if ((int)format.find("USHORT") > -1) { // 16 bits
+      header->bytes_per_value = sizeof(unsigned short);
+    }
+
+    return true;
+  }
+
+  // .proc descriptor: model, size, type and the generator parameters
+  static bool ReadProcDescriptor (std::string filepath, SyntheticVolumeGenerator* generator,
+                                  SyntheticVolumeGenerator::MODEL* model, glm::uvec3* resolution,
+                                  vis::DataStorageSize* data_tp)
+  {
+    std::ifstream iffile(filepath.c_str());
+    if (!iffile.is_open()) return false;
+
+    *model = SyntheticVolumeGenerator::MODEL::NONE_MODEL;
+    *resolution = glm::uvec3(0);
+    *data_tp = vis::DataStorageSize::_8_BITS;
+
+    std::string key;
+    while (iffile >> key)
+    {
+      if (key.compare("model") == 0) {
+        std::string model_name;
+        iffile >> model_name;
+        *model = SyntheticVolumeGenerator::GetModelFromName(model_name);
+      }
+      else if (key.compare("size") == 0) {
+        iffile >> resolution->x >> resolution->y >> resolution->z;
+      }
+      else if (key.compare("type") == 0) {
+        std::string type;
+        iffile >> type;
+        if (type.compare("uint8") == 0) *data_tp = vis::DataStorageSize::_8_BITS;
+        else if (type.compare("uint16") == 0) *data_tp = vis::DataStorageSize::_16_BITS;
+        else if (type.compare("float") == 0) *data_tp = vis::DataStorageSize::_NORMALIZED_F;
+        else if (type.compare("double") == 0) *data_tp = vis::DataStorageSize::_NORMALIZED_D;
+      }
+      else if (key.compare("seed") == 0) {
+        unsigned int seed;
+        iffile >> seed;
+        generator->SetSeed(seed);
+      }
+      else if (key.compare("elements") == 0) {
+        int n_elements;
+        iffile >> n_elements;
+        generator->SetNumberOfElements(n_elements);
+      }
+      else if (key.compare("frequency") == 0) {
+        double frequency;
+        iffile >> frequency;
+        generator->SetFrequency(frequency);
+      }
+    }
+    iffile.close();
+
+    return true;
+  }
+
+  bool VolumeReader::ReadStructuredVolumeInfo (std::string filepath, StructuredVolumeInfo* info)
+  {
+    int found = filepath.find_last_of('.');
+    std::string extension = filepath.substr(size_t(found + 1));
+
+    info->data_files.clear();
+
+    RawVolumeHeader header;
+    bool read_header = false;
+    if (extension.compare("raw") == 0) {
+      read_header = ReadRawFileNameHeader(filepath, &header);
+    }
+    else if (extension.compare("nrrd") == 0 || extension.compare("nhrd") == 0) {
+      read_header = ReadNrrdHeader(filepath, &header, false);
+      if (read_header) info->data_files.push_back(header.data_file);
+    }
+    else if (extension.compare("dat") == 0) {
+      read_header = ReadDatHeader(filepath, &header, false);
+      if (read_header) info->data_files.push_back(header.data_file);
+    }
+    else if (extension.compare("cvol") == 0) {
+      // only the header and the chunk index are read
+      ChunkedVolumeFile cvol;
+      if (!cvol.Open(filepath.c_str())) return false;
+      cvol.GetDimensions(&info->width, &info->height, &info->depth);
+      cvol.GetScale(&info->scale.x, &info->scale.y, &info->scale.z);
+      info->data_storage_size = vis::GetStorageSizeType(size_t(cvol.GetBytesPerVoxel()));
+      return true;
+    }
+    else if (extension.compare("proc") == 0) {
+      // the procedural volume is not generated
+      SyntheticVolumeGenerator generator;
+      SyntheticVolumeGenerator::MODEL model;
+      glm::uvec3 resolution;
+      vis::DataStorageSize data_tp;
+      if (!ReadProcDescriptor(filepath, &generator, &model, &resolution, &data_tp)) return false;
+      info->width = resolution.x;
+      info->height = resolution.y;
+      info->depth = resolution.z;
+      info->scale = glm::dvec3(1.0);
+      info->data_storage_size = data_tp;
+      return true;
+    }
+    if (!read_header) return false;
+
+    info->width = header.resolution.x;
+    info->height = header.resolution.y;
+    info->depth = header.resolution.z;
+    info->scale = header.scale;
+    info->data_storage_size = vis::GetStorageSizeType(size_t(header.bytes_per_value));
+    return true;
+  }
+
+  StructuredGridVolume* VolumeReader::ReadChunkedVolumeRegion (std::string filepath, glm::uvec3 region_min, glm::uvec3 region_max)
+  {
+    ChunkedVolumeFile cvol;
+    if (!cvol.Open(filepath.c_str())) return nullptr;
+
+    // Inverted or out of range bounds would wrap the unsigned region size
+    if (!cvol.IsRegionValid(region_min.x, region_min.y, region_min.z, region_max.x, region_max.y, region_max.z))
+    {
+      printf("  - Invalid .cvol region [%u %u %u] - [%u %u %u]: %s\n", region_min.x, region_min.y, region_min.z,
+        region_max.x, region_max.y, region_max.z, filepath.c_str());
+      return nullptr;
+    }
+
+    double scalex, scaley, scalez;
+    cvol.GetScale(&scalex, &scaley, &scalez);
+
+    glm::uvec3 size = region_max - region_min;
+    vis::DataStorageSize data_tp;
+    void* scalar_values = NewChunkedVolumeArray(cvol.GetBytesPerVoxel(), size_t(size.x) * size_t(size.y) * size_t(size.z), &data_tp);
+    if (!scalar_values) return nullptr;
+
+    StructuredGridVolume* sg_ret = new StructuredGridVolume(filepath, size.x, size.y, size.z);
+    sg_ret->SetScale(scalex, scaley, scalez);
+    sg_ret->SetArrayData(scalar_values, data_tp);
+
+    if (!cvol.ReadRegion(region_min.x, region_min.y, region_min.z, region_max.x, region_max.y, region_max.z, scalar_values))
+    {
+      delete sg_ret;
+      return nullptr;
+    }
+
+    return sg_ret;
+  }
+
+  // Read "n_slices" slices of "slice_bytes" from the beginning of a raw file,
+  //  RAW_READ_SLAB_SLICES at a time, stopping if "cancel" is set
+  static bool ReadRawSlabs (std::string filepath, char* data, size_t slice_bytes, int n_slices, std::atomic<bool>* cancel)
+  {
+    std::ifstream iffile(filepath.c_str(), std::ios::binary);
+    if (!iffile.is_open()) return false;
+
+    for (int z = 0; z < n_slices; z += RAW_READ_SLAB_SLICES)
+    {
+      if (*cancel) return false;
+
+      int nz = glm::min(RAW_READ_SLAB_SLICES, n_slices - z);
+      if (!iffile.read(data + size_t(z) * slice_bytes, std::streamsize(slice_bytes * size_t(nz))))
+        return false;
+    }
+    return true;
+  }
+
+  bool VolumeReader::SetArrayDataFromRawFile (std::string filepath, StructuredGridVolume* sg, int bytes_per_value)
   {
     int fw = sg->GetWidth(), fh = sg->GetHeight(), fd = sg->GetDepth();
 
+    // Cancellable reads go straight to the volume array, slab by slab
+    if (m_cancel)
+    {
+      size_t n_slice_voxels = size_t(fw) * size_t(fh);
+      if (bytes_per_value == sizeof(unsigned short))
+        sg->SetArrayData(new unsigned short[n_slice_voxels * size_t(fd)], vis::DataStorageSize::_16_BITS);
+      else if (bytes_per_value == sizeof(unsigned char))
+        sg->SetArrayData(new unsigned char[n_slice_voxels * size_t(fd)], vis::DataStorageSize::_8_BITS);
+      else
+        return false;
+
+      if (!ReadRawSlabs(filepath, static_cast<char*>(sg->GetArrayData()), n_slice_voxels * size_t(bytes_per_value), fd, m_cancel))
+      {
+        if (!IsCancelled()) printf("  - Error on reading raw data: %s\n", filepath.c_str());
+        return false;
+      }
+      return true;
+    }
+
     IRAWLoader rawLoader = IRAWLoader(filepath, bytes_per_value, fw * fh * fd, bytes_per_value);
 
     vis::DataStorageSize data_tp;
@@ -95,6 +567,114 @@ namespace vis
 
     // We won't delete the scalar_values, because it will be stored at structured grid volume...
     sg->SetArrayData(scalar_values, data_tp);
+    return true;
+  }
+
+  template<typename T>
+  static bool ReadReducedRawData (std::ifstream& iffile, T* out_data, int fw, int fh, int fd, int stride, bool average)
+  {
+    int rw = (fw + stride - 1) / stride;
+    int rh = (fh + stride - 1) / stride;
+    int rd = (fd + stride - 1) / stride;
+
+    size_t slice_size = size_t(fw) * size_t(fh);
+    int slices_per_read = average ? stride : 1;
+
+    T* slices = new T[slice_size * size_t(slices_per_read)];
+    for (int rz = 0; rz < rd; rz++)
+    {
+      int z0 = rz * stride;
+      int nz = glm::min(slices_per_read, fd - z0);
+
+      // only the slices used by the current reduced slice are read
+      iffile.seekg(std::streamoff(z0) * std::streamoff(slice_size * sizeof(T)), std::ios::beg);
+      if (!iffile.read(reinterpret_cast<char*>(slices), std::streamsize(slice_size * size_t(nz) * sizeof(T))))
+      {
+        delete[] slices;
+        return false;
+      }
+
+#pragma omp parallel for
+      for (int ry = 0; ry < rh; ry++)
+      {
+        int y0 = ry * stride;
+        for (int rx = 0; rx < rw; rx++)
+        {
+          int x0 = rx * stride;
+          size_t out_id = size_t(rx) + size_t(ry) * size_t(rw) + size_t(rz) * size_t(rw) * size_t(rh);
+          if (!average)
+          {
+            out_data[out_id] = slices[size_t(x0) + size_t(y0) * size_t(fw)];
+          }
+          else
+          {
+            int y1 = glm::min(y0 + stride, fh), x1 = glm::min(x0 + stride, fw);
+            double sum = 0.0;
+            for (int z = 0; z < nz; z++)
+              for (int y = y0; y < y1; y++)
+                for (int x = x0; x < x1; x++)
+                  sum += double(slices[size_t(x) + size_t(y) * size_t(fw) + size_t(z) * slice_size]);
+            out_data[out_id] = T(sum / double(nz * (y1 - y0) * (x1 - x0)) + 0.5);
+          }
+        }
+      }
+    }
+    delete[] slices;
+
+    return true;
+  }
+
+  StructuredGridVolume* VolumeReader::ReadReducedRawFile (std::string filepath, std::string name, int fw, int fh, int fd,
+                                                          int bytes_per_value, glm::dvec3 scale, int stride, bool average)
+  {
+    int rw = (fw + stride - 1) / stride;
+    int rh = (fh + stride - 1) / stride;
+    int rd = (fd + stride - 1) / stride;
+
+    printf("  - Preview Stride  : %d (%s)\n", stride, average ? "averaged" : "decimated");
+
+    std::ifstream iffile(filepath.c_str(), std::ios::in | std::ios::binary);
+    if (!iffile.is_open())
+    {
+      printf("  - Error on opening raw data file: %s\n", filepath.c_str());
+      return nullptr;
+    }
+
+    vis::DataStorageSize data_tp = vis::DataStorageSize::UNKNOWN;
+    void* scalar_values = nullptr;
+    bool read_ok = false;
+    if (bytes_per_value == sizeof(unsigned short))
+    {
+      data_tp = vis::DataStorageSize::_16_BITS;
+      unsigned short* us_scalar_values = new unsigned short[size_t(rw) * size_t(rh) * size_t(rd)];
+      read_ok = ReadReducedRawData(iffile, us_scalar_values, fw, fh, fd, stride, average);
+      scalar_values = us_scalar_values;
+    }
+    else if (bytes_per_value == sizeof(unsigned char))
+    {
+      data_tp = vis::DataStorageSize::_8_BITS;
+      unsigned char* uc_scalar_values = new unsigned char[size_t(rw) * size_t(rh) * size_t(rd)];
+      read_ok = ReadReducedRawData(iffile, uc_scalar_values, fw, fh, fd, stride, average);
+      scalar_values = uc_scalar_values;
+    }
+    iffile.close();
+
+    if (!read_ok)
+    {
+      printf("  - Error on reading raw data file: %s\n", filepath.c_str());
+      if (data_tp == vis::DataStorageSize::_16_BITS) delete[] static_cast<unsigned short*>(scalar_values);
+      else delete[] static_cast<unsigned char*>(scalar_values);
+      return nullptr;
+    }
+
+    StructuredGridVolume* sg_ret = new StructuredGridVolume(name, rw, rh, rd);
+    // keep the same physical extent of the full resolution volume
+    sg_ret->SetScale(scale.x * double(fw) / double(rw),
+                     scale.y * double(fh) / double(rh),
+                     scale.z * double(fd) / double(rd));
+    sg_ret->SetArrayData(scalar_values, data_tp);
+
+    return sg_ret;
   }
 
   StructuredGridVolume* VolumeReader::readpvm (std::string filename)
@@ -159,7 +739,7 @@ namespace vis
     return ret;
   }
 
-  StructuredGridVolume* VolumeReader::readraw (std::string filepath)
+  StructuredGridVolume* VolumeReader::readraw (std::string filepath, int stride, bool average)
   {
     StructuredGridVolume* sg_ret = nullptr;
 
@@ -169,46 +749,31 @@ namespace vis
     std::ifstream iffile(filepath.c_str());
     if (iffile.is_open())
     {
-      int foundinit = filepath.find_last_of('\\');
-      std::string filename = filepath.substr(foundinit + 1);
-      printf("  - File .raw: %s\n", filename.c_str());
-
-      int foundfp = filename.find_last_of('.');
-      filename = filename.substr(0, foundfp);
-
-      int foundsizes = filename.find_last_of('.');
-      std::string t_filesizes = filename.substr(foundsizes + 1, filename.size() - foundsizes);
-
-      filename = filename.substr(0, filename.find_last_of('.'));
-
-      int foundbytesize = filename.find_last_of('.');
-      std::string t_filebytesize = filename.substr(foundbytesize + 1, filename.size() - foundbytesize);
-
-      int fw, fh, fd;
-      int bytes_per_value;
+      printf("  - File .raw: %s\n", filepath.substr(filepath.find_last_of('\\') + 1).c_str());
 
-      // Read the Volume Sizes
-      int foundd = t_filesizes.find_last_of('x');
-      fd = atoi(t_filesizes.substr(foundd + 1, t_filesizes.size() - foundd).c_str());
+      RawVolumeHeader header;
+      ReadRawFileNameHeader(filepath, &header);
+      std::string filename = header.name;
+      int fw = header.resolution.x, fh = header.resolution.y, fd = header.resolution.z;
+      int bytes_per_value = header.bytes_per_value;
 
-      t_filesizes = t_filesizes.substr(0, t_filesizes.find_last_of('x'));
-
-      int foundh = t_filesizes.find_last_of('x');
-      fh = atoi(t_filesizes.substr(foundh + 1, t_filesizes.size() - foundh).c_str());
-
-      t_filesizes = t_filesizes.substr(0, t_filesizes.find_last_of('x'));
-
-      int foundw = t_filesizes.find_last_of('x');
-      fw = atoi(t_filesizes.substr(foundw + 1, t_filesizes.size() - foundw).c_str());
-
-      // Byte Size
-      bytes_per_value = atoi(t_filebytesize.c_str());
-
-      sg_ret = new StructuredGridVolume(filename, fw, fh, fd);
-      sg_ret->SetScale(1.0, 1.0, 1.0);
-      sg_ret->SetName(filepath);
+      if (stride > 1)
+      {
+        sg_ret = ReadReducedRawFile(filepath, filename, fw, fh, fd, bytes_per_value, glm::dvec3(1.0), stride, average);
+        if (sg_ret) sg_ret->SetName(filepath);
+      }
+      else
+      {
+        sg_ret = new StructuredGridVolume(filename, fw, fh, fd);
+        sg_ret->SetScale(1.0, 1.0, 1.0);
+        sg_ret->SetName(filepath);
 
-      SetArrayDataFromRawFile(filepath, sg_ret, bytes_per_value);
+        if (!SetArrayDataFromRawFile(filepath, sg_ret, bytes_per_value))
+        {
+          delete sg_ret;
+          sg_ret = nullptr;
+        }
+      }
 
       printf("  - Volume Name     : %s\n", filepath.c_str());
       printf("  - Volume Size     : [%d, %d, %d]\n", fw, fh, fd);
@@ -370,118 +935,35 @@ namespace vis
     return sg_ret;
   }
 
-  StructuredGridVolume* VolumeReader::readnrrd (std::string filepath)
+  StructuredGridVolume* VolumeReader::readnrrd (std::string filepath, int stride, bool average)
   {
     StructuredGridVolume* sg_ret = nullptr;
 
     printf("Started  -> Read Volume From .nrrd File\n");
     printf("  - File .nrrd Path: %s\n", filepath.c_str());
 
-    std::string path = filepath;
-    std::string name = filepath;
-    int t1 = filepath.find_last_of('\\');
-    int t2 = filepath.find_last_of('/');
-    int t = glm::max(t1, t2);
-    if (t > -1) {
-      path = filepath.substr(0, t);
-      name = filepath.substr(t + 1);
-    }
-
-    std::ifstream iffile(filepath.c_str());
-    if (iffile.is_open()) {
-      std::string version;
-      std::getline(iffile, version);
-
-      std::string type;
-      std::string dimension;
-      std::string space;
-      glm::ivec3 resolution;
-      std::array<glm::vec3, 3> space_directions;
-      glm::vec3 slicethickness(1, 1, 1);
-      std::string kinds;
-      std::string endian;
-      std::string encoding;
-      std::string space_origin;
-      std::string data_file;
-
-      // read keys
-      while (!iffile.eof()) {
-        std::string line;
-        std::getline(iffile, line);
-      
-        std::cout << line << std::endl;
-        
-        if (line.find_first_of('#') == 0) continue;
-
-        std::string key = line.substr(0, line.find_first_of(':'));
-        std::string content = line.substr(line.find_first_of(":") + 1);
-
-        // skip ' ' and '\t'
-        int count_skip = 0;
-        while (content[count_skip] == ' ' || content[count_skip] == '\t') {
-          count_skip += 1;
-        }
-        content = content.substr(count_skip);
-
-        if (key.find("type") == 0) {
-          type = content;
-        }
-        else if (key.find("dimension") == 0) {
-          dimension = content;
-        }
-        else if (key.find("space") == 0) {
-          space = content;
-        }
-        else if (key.find("sizes") == 0) {
-          std::string str_resolution = content;
-
-          std::vector<int> vec_resolution;
-          while (str_resolution.find(' ') != std::string::npos) {
-            std::string size_l = str_resolution.substr(0, str_resolution.find(' '));
-            vec_resolution.push_back(std::atoi(size_l.c_str()));
-            str_resolution = str_resolution.substr(str_resolution.find(' ') + 1);
-          }
-          vec_resolution.push_back(std::atoi(str_resolution.c_str()));
-
-          resolution = glm::ivec3(vec_resolution[0], vec_resolution[1], vec_resolution[2]);
-        }
-        else if (key.find("space directions") == 0) {
-          space_directions[0] = glm::vec3(1, 0, 0);
-          space_directions[1] = glm::vec3(0, 1, 0);
-          space_directions[2] = glm::vec3(0, 0, 1);
-        }
-        else if (key.find("kinds") == 0) {
-          kinds = content;
-        }
-        else if (key.find("endian") == 0) {
-          endian = content;
-        }
-        else if (key.find("encoding") == 0) {
-          encoding = content;
-        }
-        else if (key.find("space origin") == 0) {
-          space_origin = content;
-        }
-        else if (key.find("data file") == 0) {
-          data_file = content;
-        }
+    RawVolumeHeader header;
+    if (ReadNrrdHeader(filepath, &header, true)) {
+      std::string name = header.name;
+      std::string volume_data_array_file = header.data_file;
+      glm::ivec3 resolution = header.resolution;
+      glm::dvec3 slicethickness = header.scale;
+      int bytes_per_value = header.bytes_per_value;
+
+      if (stride > 1) {
+        sg_ret = ReadReducedRawFile(volume_data_array_file, name, resolution.x, resolution.y, resolution.z,
+                                    bytes_per_value, glm::dvec3(slicethickness), stride, average);
       }
-      iffile.close();
-
-      sg_ret = new StructuredGridVolume(name, resolution.x, resolution.y, resolution.z);
-      sg_ret->SetScale(slicethickness.x, slicethickness.y, slicethickness.z);
-
-      std::string volume_data_array_file = path + "/" + data_file;
+      else {
+        sg_ret = new StructuredGridVolume(name, resolution.x, resolution.y, resolution.z);
+        sg_ret->SetScale(slicethickness.x, slicethickness.y, slicethickness.z);
 
-      int bytes_per_value = 1;
-      if ((int)type.find("uint8") > -1) {
-        bytes_per_value = sizeof(unsigned char);
-      }
-      if ((int)type.find("uint16") > -1) {
-        bytes_per_value = sizeof(unsigned short);
+        if (!SetArrayDataFromRawFile(volume_data_array_file, sg_ret, bytes_per_value))
+        {
+          delete sg_ret;
+          sg_ret = nullptr;
+        }
       }
-
-      SetArrayDataFromRawFile(volume_data_array_file, sg_ret, bytes_per_value);
     }
     else {
       printf("Finished -> Error on opening .nrrd file\n");
@@ -490,138 +972,123 @@ namespace vis
     return sg_ret;
   }
 
-  StructuredGridVolume* VolumeReader::readnhrd (std::string filepath)
+  StructuredGridVolume* VolumeReader::readnhrd (std::string filepath, int stride, bool average)
   {
-    return readnrrd(filepath);
+    return readnrrd(filepath, stride, average);
   }
 
-  StructuredGridVolume* VolumeReader::readdat (std::string filepath)
+  StructuredGridVolume* VolumeReader::readdat (std::string filepath, int stride, bool average)
   {
     StructuredGridVolume* sg_ret = nullptr;
 
     printf("Started  -> Read Volume From .dat File\n");
     printf("  - File .dat Path: %s\n", filepath.c_str());
 
-    std::ifstream iffile(filepath.c_str());
-    if (iffile.is_open()) {
-      std::string path = filepath;
-      std::string name = filepath;
-      int t1 = filepath.find_last_of('\\');
-      int t2 = filepath.find_last_of('/');
-      int t = glm::max(t1, t2);
-      if (t > -1) {
-        path = filepath.substr(0, t);
-        name = filepath.substr(t+1);
+    RawVolumeHeader header;
+    if (ReadDatHeader(filepath, &header, true)) {
+      std::string name = header.name;
+      std::string volume_data_array_file = header.data_file;
+      glm::ivec3 resolution = header.resolution;
+      glm::dvec3 slicethickness = header.scale;
+      int bytes_per_value = header.bytes_per_value;
+
+      if (stride > 1) {
+        sg_ret = ReadReducedRawFile(volume_data_array_file, name, resolution.x, resolution.y, resolution.z,
+                                    bytes_per_value, glm::dvec3(slicethickness), stride, average);
       }
-      
-      std::string objectfilename;
-      std::string taggedfilename;
-      glm::ivec3 resolution;
-      glm::vec3 slicethickness(1.0,1.0,1.0);
-      std::string format;
-      int nbrtags;
-      std::string objecttype;
-      std::string objectmodel;
-      std::string gridtype;
-      std::string modality;
-      int timestep;
-      
-      // read keys
-      while (!iffile.eof()) {
-        std::string line;
-        std::getline(iffile, line);
-      
-        std::cout << line << std::endl;
-        
-        std::string key = line.substr(0, line.find_first_of(':'));
-        std::string content = line.substr(line.find_first_of(":") + 1);
-
-        // skip ' ' and '\t'
-        int count_skip = 0;
-        while (content[count_skip] == ' ' || content[count_skip] == '\t') {
-          count_skip += 1;
-        }
-        content = content.substr(count_skip);
+      else {
+        sg_ret = new StructuredGridVolume(name, resolution.x, resolution.y, resolution.z);
+        sg_ret->SetScale(slicethickness.x, slicethickness.y, slicethickness.z);
 
-        if (key.find("ObjectFileName") == 0) {
-          objectfilename = content;
-        }
-        else if (key.find("TaggedFileName") == 0) {
-          taggedfilename = content;
+        if (!SetArrayDataFromRawFile(volume_data_array_file, sg_ret, bytes_per_value))
+        {
+          delete sg_ret;
+          sg_ret = nullptr;
         }
-        else if (key.find("Resolution") == 0) {
-          std::string str_resolution = content;
-          
-          std::vector<int> vec_resolution;
-          while (str_resolution.find(' ') != std::string::npos) {
-            std::string size_l = str_resolution.substr(0, str_resolution.find(' '));
-            vec_resolution.push_back(std::atoi(size_l.c_str()));
-            str_resolution = str_resolution.substr(str_resolution.find(' ') + 1);
-          }
-          vec_resolution.push_back(std::atoi(str_resolution.c_str()));
+      }
+    }
+    else {
+      printf("Finished -> Error on opening .dat file\n");
+    }
 
-          resolution = glm::ivec3(vec_resolution[0], vec_resolution[1], vec_resolution[2]);
-        }
-        else if (key.find("SliceThickness") == 0) {
-          std::string str_slicethickness = content;
-
-          std::vector<float> vec_thickness;
-          while (str_slicethickness.find(' ') != std::string::npos) {
-            std::string size_l = str_slicethickness.substr(0, str_slicethickness.find(' '));
-            vec_thickness.push_back(std::stof(size_l.c_str()));
-            str_slicethickness = str_slicethickness.substr(str_slicethickness.find(' ') + 1);
-          }
-          vec_thickness.push_back(std::stof(str_slicethickness.c_str()));
+    return sg_ret;
+  }
 
-          slicethickness = glm::vec3(vec_thickness[0], vec_thickness[1], vec_thickness[2]);
-        }
-        else if (key.find("Format") == 0) {
-          format = content;
-        }
-        // TODO
-        else if (key.find("NbrTags") == 0) {
-          //int nbrtags;
-        }
-        // TODO
-        else if (key.find("ObjectType") == 0) {
-          //std::string objecttype;
-        }
-        // TODO
-        else if (key.find("ObjectModel") == 0) {
-         // std::string objectmodel;
-        }
-        // TODO
-        else if (key.find("GridType") == 0) {
-          //std::string gridtype;
-        }
-        // TODO
-        else if (key.find("Modality") == 0) {
-          //std::string modality;
-        }
-        // TODO
-        else if (key.find("TimeStep") == 0) {
-          //int timestep;
-        }
-      }
-      iffile.close();
+  StructuredGridVolume* VolumeReader::readcvol (std::string filepath)
+  {
+    StructuredGridVolume* sg_ret = nullptr;
 
-      sg_ret = new StructuredGridVolume(name, resolution.x, resolution.y, resolution.z);
-      sg_ret->SetScale(slicethickness.x, slicethickness.y, slicethickness.z);
-      
-      std::string volume_data_array_file = path + "/" + objectfilename;
+    printf("Started  -> Read Volume From .cvol File\n");
+    printf("  - File .cvol Path: %s\n", filepath.c_str());
+
+    ChunkedVolumeFile cvol;
+    if (cvol.Open(filepath.c_str()))
+    {
+      unsigned int width, height, depth;
+      double scalex, scaley, scalez;
+      cvol.GetDimensions(&width, &height, &depth);
+      cvol.GetScale(&scalex, &scaley, &scalez);
 
-      int bytes_per_value = 1;
-      if ((int)format.find("UCHAR") > -1) {       // 8 bits
-        bytes_per_value = sizeof(unsigned char);
+      vis::DataStorageSize data_tp;
+      void* scalar_values = NewChunkedVolumeArray(cvol.GetBytesPerVoxel(), size_t(width) * size_t(height) * size_t(depth), &data_tp);
+
+      sg_ret = new StructuredGridVolume(filepath, width, height, depth);
+      sg_ret->SetScale(scalex, scaley, scalez);
+      sg_ret->SetName(filepath);
+      // The array is owned by the volume, even if the decoding fails
+      sg_ret->SetArrayData(scalar_values, data_tp);
+
+      if (!cvol.ReadVolume(scalar_values))
+      {
+        delete sg_ret;
+        sg_ret = nullptr;
+        printf("Finished -> Error on decoding .cvol file\n");
       }
-      else if ((int)format.find("USHORT") > -1) { // 16 bits
-        bytes_per_value = sizeof(unsigned short);
+      else
+      {
+        unsigned int ncx, ncy, ncz;
+        cvol.GetNumberOfChunks(&ncx, &ncy, &ncz);
+
+        printf("  - Volume Name     : %s\n", filepath.c_str());
+        printf("  - Volume Size     : [%d, %d, %d]\n", width, height, depth);
+        printf("  - Chunks          : [%d, %d, %d] of %d^3\n", ncx, ncy, ncz, cvol.GetChunkSize());
+        printf("  - Compressed Size : %llu bytes\n", cvol.GetCompressedSize());
+        printf("Finished -> Read Volume From .cvol File\n");
       }
+    }
+    else {
+      printf("Finished -> Error on opening .cvol file\n");
+    }
+
+    return sg_ret;
+  }
+
+  StructuredGridVolume* VolumeReader::readproc (std::string filepath)
+  {
+    StructuredGridVolume* sg_ret = nullptr;
+
+    printf("Started  -> Read Volume From .proc File\n");
+    printf("  - File .proc Path: %s\n", filepath.c_str());
 
-      SetArrayDataFromRawFile(volume_data_array_file, sg_ret, bytes_per_value);
+    SyntheticVolumeGenerator generator;
+    SyntheticVolumeGenerator::MODEL model;
+    glm::uvec3 resolution;
+    vis::DataStorageSize data_tp;
+    if (ReadProcDescriptor(filepath, &generator, &model, &resolution, &data_tp))
+    {
+      sg_ret = generator.Generate(model, resolution.x, resolution.y, resolution.z, data_tp);
+      if (sg_ret)
+      {
+        sg_ret->SetName(filepath);
+        printf("Finished -> Read Volume From .proc File\n");
+      }
+      else
+      {
+        printf("Finished -> Error on .proc file parameters\n");
+      }
     }
     else {
-      printf("Finished -> Error on opening .dat file\n");
+      printf("Finished -> Error on opening .proc file\n");
     }
 
     return sg_ret;
@@ -3,6 +3,10 @@
  * - VolumeReader:
  *  .pvm
  *  .raw
+ *  .cvol (chunked volume, see file_utils/chunkedvolume.h)
+ *  .proc (procedural volume, see volvis_utils/syntheticvolumegenerator.h)
+ *  . raw based formats (.raw, .nrrd, .nhrd, .dat) can also be read as
+ *    a reduced preview volume
  *
  * - TransferFunctionReader:
  *  .tf1d
@@ -17,10 +21,25 @@
 #include <volvis_utils/unstructuredgridvolume.h>
 #include <volvis_utils/transferfunction.h>
 
+#include <atomic>
 #include <iostream>
+#include <vector>
 
 namespace vis
 {
+  // Header information of a structured volume, read without its voxel data
+  class StructuredVolumeInfo
+  {
+  public:
+    StructuredVolumeInfo () : width(0), height(0), depth(0), scale(1.0), data_storage_size(DataStorageSize::UNKNOWN) {}
+
+    unsigned int width, height, depth;
+    glm::dvec3 scale;
+    DataStorageSize data_storage_size;
+    // Files read besides the volume file (data files of .nrrd, .nhrd and .dat)
+    std::vector<std::string> data_files;
+  };
+
   class VolumeReader
   {
   public:
@@ -29,12 +48,38 @@ namespace vis
 
     StructuredGridVolume* ReadStructuredVolume (std::string filepath);
 
-    void SetArrayDataFromRawFile (std::string filepath, StructuredGridVolume* sg, int bytes_per_value);
+    // Read a decimated version of the volume, reducing each axis by "stride".
+    // . average == false: picks every stride-th voxel, only reading the
+    //   required slices from disk.
+    // . average == true: each output voxel is the mean of a stride^3 block.
+    // Returns nullptr if the format does not support preview reading.
+    StructuredGridVolume* ReadStructuredVolumePreview (std::string filepath, int stride, bool average = false);
+    bool IsPreviewSupported (std::string filepath);
+
+    // Read only the header of the volume (.raw, .nrrd, .nhrd, .dat, .cvol and
+    //  .proc). Returns false for formats that must be decoded (.pvm, .syn).
+    bool ReadStructuredVolumeInfo (std::string filepath, StructuredVolumeInfo* info);
+
+    // Read only the region [region_min, region_max) of a .cvol file,
+    //  decoding just the chunks that intersect the region.
+    StructuredGridVolume* ReadChunkedVolumeRegion (std::string filepath, glm::uvec3 region_min, glm::uvec3 region_max);
+
+    // Returns false if the data could not be read or the read was cancelled
+    bool SetArrayDataFromRawFile (std::string filepath, StructuredGridVolume* sg, int bytes_per_value);
+
+    // Flag checked between the slabs of raw data reads, so a background read
+    //  can be stopped: ReadStructuredVolume returns nullptr once it is set
+    void SetCancelFlag (std::atomic<bool>* cancel);
+    bool IsCancelled ();
 
   protected:
+    StructuredGridVolume* ReadReducedRawFile (std::string filepath, std::string name, int fw, int fh, int fd,
+                                              int bytes_per_value, glm::dvec3 scale, int stride, bool average);
+
     StructuredGridVolume* readpvm (std::string filename);
     StructuredGridVolume* readpvmold (std::string filename);
-    StructuredGridVolume* readraw (std::string filepath);
+    // "stride" above 1 reads a reduced preview (ReadStructuredVolumePreview)
+    StructuredGridVolume* readraw (std::string filepath, int stride = 1, bool average = false);
     StructuredGridVolume* readsyn (std::string filepath);
     /**
      * http://teem.sourceforge.net/nrrd/format.html
@@ -58,14 +103,20 @@ namespace vis
      * NRRD0004: added "thicknesses:" and "sample units" fields, general space and orientation information ("space:", "space dimension:", "space directions:", "space origin:", and "space units:" fields) , and the ability for the "data file:" field to identify multiple data files.
      * NRRD0005: added "measurement frame:" field (should have been figured out for NRRD0004).
      */
-    StructuredGridVolume* readnrrd (std::string filepath);
+    StructuredGridVolume* readnrrd (std::string filepath, int stride = 1, bool average = false);
     // File structure from open scivis datasets, equal to nrrd
-    StructuredGridVolume* readnhrd (std::string filepath);
+    StructuredGridVolume* readnhrd (std::string filepath, int stride = 1, bool average = false);
     // File structure from zurich datasets
-    StructuredGridVolume* readdat (std::string filepath);
+    StructuredGridVolume* readdat (std::string filepath, int stride = 1, bool average = false);
+    // Chunked and compressed volume
+    StructuredGridVolume* readcvol (std::string filepath);
+    // Procedural volume descriptor
+    StructuredGridVolume* readproc (std::string filepath);
 
     UnstructuredGridVolume* readunsvol (std::string filepath);
 
+    std::atomic<bool>* m_cancel;
+
   private:
 
   };
@@ -0,0 +1,181 @@
+/**
+ * sharedmemory.cpp
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#include <volvis_utils/sharedmemory.h>
+
+#include <cstdio>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace vis
+{
+  SharedMemorySegment::SharedMemorySegment ()
+    : m_name("")
+    , m_size(0)
+    , m_data(nullptr)
+    , m_creator(false)
+#ifdef _WIN32
+    , m_file_mapping(nullptr)
+#else
+    , m_shm_fd(-1)
+#endif
+  {
+  }
+
+  SharedMemorySegment::~SharedMemorySegment ()
+  {
+    Release();
+  }
+
+  bool SharedMemorySegment::Create (std::string name, unsigned long long size)
+  {
+    Release();
+    m_name = name;
+
+#ifdef _WIN32
+    std::string mapping_name = "Local\\" + name;
+    m_file_mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+      (DWORD)(size >> 32), (DWORD)(size & 0xFFFFFFFFull), mapping_name.c_str());
+    if (!m_file_mapping || GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+      printf("  - Shared memory: unable to create segment \"%s\"\n", name.c_str());
+      Release();
+      return false;
+    }
+
+    m_data = (unsigned char*)MapViewOfFile((HANDLE)m_file_mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+#else
+    std::string shm_name = "/" + name;
+    m_shm_fd = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (m_shm_fd < 0)
+    {
+      printf("  - Shared memory: unable to create segment \"%s\"\n", name.c_str());
+      Release();
+      return false;
+    }
+    // From here, the segment name is removed at Release
+    m_creator = true;
+
+    if (ftruncate(m_shm_fd, (off_t)size) != 0)
+    {
+      printf("  - Shared memory: unable to allocate segment \"%s\"\n", name.c_str());
+      Release();
+      return false;
+    }
+
+    void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_shm_fd, 0);
+    m_data = (ptr == MAP_FAILED) ? nullptr : (unsigned char*)ptr;
+#endif
+    if (!m_data)
+    {
+      printf("  - Shared memory: unable to map segment \"%s\"\n", name.c_str());
+      Release();
+      return false;
+    }
+
+    m_size = size;
+    m_creator = true;
+    return true;
+  }
+
+  bool SharedMemorySegment::Open (std::string name, bool read_only)
+  {
+    Release();
+    m_name = name;
+
+#ifdef _WIN32
+    std::string mapping_name = "Local\\" + name;
+    m_file_mapping = OpenFileMappingA(read_only ? FILE_MAP_READ : FILE_MAP_ALL_ACCESS, FALSE, mapping_name.c_str());
+    if (!m_file_mapping)
+    {
+      Release();
+      return false;
+    }
+
+    m_data = (unsigned char*)MapViewOfFile((HANDLE)m_file_mapping, read_only ? FILE_MAP_READ : FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (m_data)
+    {
+      MEMORY_BASIC_INFORMATION mem_info;
+      VirtualQuery(m_data, &mem_info, sizeof(mem_info));
+      m_size = mem_info.RegionSize;
+    }
+#else
+    std::string shm_name = "/" + name;
+    m_shm_fd = shm_open(shm_name.c_str(), read_only ? O_RDONLY : O_RDWR, 0);
+    struct stat shm_stat;
+    if (m_shm_fd < 0 || fstat(m_shm_fd, &shm_stat) != 0)
+    {
+      Release();
+      return false;
+    }
+    m_size = (unsigned long long)shm_stat.st_size;
+
+    void* ptr = mmap(NULL, m_size, read_only ? PROT_READ : (PROT_READ | PROT_WRITE), MAP_SHARED, m_shm_fd, 0);
+    m_data = (ptr == MAP_FAILED) ? nullptr : (unsigned char*)ptr;
+#endif
+    if (!m_data)
+    {
+      printf("  - Shared memory: unable to map segment \"%s\"\n", name.c_str());
+      Release();
+      return false;
+    }
+
+    return true;
+  }
+
+  void SharedMemorySegment::Release ()
+  {
+#ifdef _WIN32
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_file_mapping) CloseHandle((HANDLE)m_file_mapping);
+    m_file_mapping = nullptr;
+#else
+    if (m_data) munmap(m_data, m_size);
+    if (m_shm_fd >= 0) close(m_shm_fd);
+    if (m_creator) shm_unlink(("/" + m_name).c_str());
+    m_shm_fd = -1;
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_name = "";
+    m_creator = false;
+  }
+
+  bool SharedMemorySegment::IsMapped ()
+  {
+    return m_data != nullptr;
+  }
+
+  bool SharedMemorySegment::IsCreator ()
+  {
+    return m_creator && m_data != nullptr;
+  }
+
+  std::string SharedMemorySegment::GetName ()
+  {
+    return m_name;
+  }
+
+  unsigned long long SharedMemorySegment::GetSize ()
+  {
+    return m_size;
+  }
+
+  unsigned char* SharedMemorySegment::GetData ()
+  {
+    return m_data;
+  }
+}
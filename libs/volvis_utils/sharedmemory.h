@@ -0,0 +1,57 @@
+/**
+ * sharedmemory.h
+ *
+ * Named shared memory segment, used to share data between processes
+ *   running on the same node.
+ *
+ * . POSIX: shm_open/mmap ("/<name>")
+ * . Windows: named file mapping (CreateFileMapping/MapViewOfFile)
+ *
+ * The creator of the segment removes its name at Release/destruction.
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#ifndef VOL_VIS_UTILS_SHARED_MEMORY_H
+#define VOL_VIS_UTILS_SHARED_MEMORY_H
+
+#include <string>
+
+namespace vis
+{
+  class SharedMemorySegment
+  {
+  public:
+    SharedMemorySegment ();
+    ~SharedMemorySegment ();
+
+    // Create a new segment, fails if "name" already exists
+    bool Create (std::string name, unsigned long long size);
+    // Map an existing segment, returns false (quietly) if it does not exist
+    bool Open (std::string name, bool read_only = true);
+    void Release ();
+
+    bool IsMapped ();
+    bool IsCreator ();
+    std::string GetName ();
+    unsigned long long GetSize ();
+    unsigned char* GetData ();
+
+  protected:
+    std::string m_name;
+    unsigned long long m_size;
+    unsigned char* m_data;
+    bool m_creator;
+
+#ifdef _WIN32
+    void* m_file_mapping;
+#else
+    int m_shm_fd;
+#endif
+
+  private:
+
+  };
+}
+
+#endif
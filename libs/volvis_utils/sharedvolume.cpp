@@ -0,0 +1,196 @@
+/**
+ * sharedvolume.cpp
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#include <volvis_utils/sharedvolume.h>
+
+#include <atomic>
+#include <cstring>
+
+#define SHARED_VOLUME_MAGIC "VOLSHM1"
+#define SHARED_VOLUME_VERSION 1
+#define SHARED_VOLUME_ALIGNMENT 64
+
+namespace vis
+{
+  static unsigned long long AlignOffset (unsigned long long offset)
+  {
+    return (offset + SHARED_VOLUME_ALIGNMENT - 1) / SHARED_VOLUME_ALIGNMENT * SHARED_VOLUME_ALIGNMENT;
+  }
+
+  SharedVolumeSegment::SharedVolumeSegment ()
+  {
+  }
+
+  SharedVolumeSegment::~SharedVolumeSegment ()
+  {
+    Release();
+  }
+
+  bool SharedVolumeSegment::Publish (std::string segment_name, StructuredGridVolume* vol,
+                                     const std::vector<DerivedBlock>& derived_blocks)
+  {
+    Release();
+
+    unsigned long long voxel_bytes = GetStorageByteSize(vol ? vol->GetDataStorageSize() : DataStorageSize::UNKNOWN);
+    if (!vol || !vol->GetArrayData() || voxel_bytes == 0 || derived_blocks.size() > SHARED_VOLUME_MAX_DERIVED_BLOCKS)
+    {
+      printf("  - Shared volume: invalid volume to publish\n");
+      return false;
+    }
+
+    // Segment layout
+    SharedVolumeHeader header;
+    memset(&header, 0, sizeof(SharedVolumeHeader));
+    memcpy(header.magic, SHARED_VOLUME_MAGIC, sizeof(SHARED_VOLUME_MAGIC));
+    header.version = SHARED_VOLUME_VERSION;
+    header.ready = 0;
+    header.width = vol->GetWidth();
+    header.height = vol->GetHeight();
+    header.depth = vol->GetDepth();
+    header.data_storage_size = (uint32_t)vol->GetDataStorageSize();
+    header.scale[0] = vol->GetScaleX();
+    header.scale[1] = vol->GetScaleY();
+    header.scale[2] = vol->GetScaleZ();
+    header.volume_offset = AlignOffset(sizeof(SharedVolumeHeader));
+    header.volume_bytes = (unsigned long long)header.width * header.height * header.depth * voxel_bytes;
+
+    unsigned long long offset = AlignOffset(header.volume_offset + header.volume_bytes);
+    header.n_derived_blocks = (uint32_t)derived_blocks.size();
+    for (size_t i = 0; i < derived_blocks.size(); i++)
+    {
+      strncpy(header.derived[i].name, derived_blocks[i].name.c_str(), SHARED_VOLUME_BLOCK_NAME_SIZE - 1);
+      header.derived[i].offset = offset;
+      header.derived[i].bytes = derived_blocks[i].bytes;
+      header.derived[i].width = derived_blocks[i].width;
+      header.derived[i].height = derived_blocks[i].height;
+      header.derived[i].depth = derived_blocks[i].depth;
+      header.derived[i].components = derived_blocks[i].components;
+      offset = AlignOffset(offset + derived_blocks[i].bytes);
+    }
+
+    if (!m_segment.Create(segment_name, offset))
+      return false;
+
+    // Copy data, then mark the segment as ready
+    unsigned char* segment_ptr = m_segment.GetData();
+    memcpy(segment_ptr, &header, sizeof(SharedVolumeHeader));
+    memcpy(segment_ptr + header.volume_offset, vol->GetArrayData(), header.volume_bytes);
+    for (size_t i = 0; i < derived_blocks.size(); i++)
+      memcpy(segment_ptr + header.derived[i].offset, derived_blocks[i].data, derived_blocks[i].bytes);
+
+    std::atomic_thread_fence(std::memory_order_release);
+    reinterpret_cast<SharedVolumeHeader*>(segment_ptr)->ready = 1;
+
+    printf("  - Shared volume: published \"%s\" (%.2f MB)\n", segment_name.c_str(), double(m_segment.GetSize()) / (1024.0 * 1024.0));
+    return true;
+  }
+
+  bool SharedVolumeSegment::Attach (std::string segment_name)
+  {
+    Release();
+
+    if (!m_segment.Open(segment_name, true))
+    {
+      printf("  - Shared volume: unable to open segment \"%s\"\n", segment_name.c_str());
+      return false;
+    }
+
+    unsigned long long segment_size = m_segment.GetSize();
+    const SharedVolumeHeader* header = GetHeader();
+    bool valid = segment_size >= sizeof(SharedVolumeHeader)
+      && memcmp(header->magic, SHARED_VOLUME_MAGIC, sizeof(SHARED_VOLUME_MAGIC)) == 0
+      && header->version == SHARED_VOLUME_VERSION
+      && header->ready == 1
+      && header->volume_offset + header->volume_bytes <= segment_size
+      && header->n_derived_blocks <= SHARED_VOLUME_MAX_DERIVED_BLOCKS;
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    for (unsigned int i = 0; valid && i < header->n_derived_blocks; i++)
+      valid = header->derived[i].offset + header->derived[i].bytes <= segment_size;
+
+    if (!valid)
+    {
+      printf("  - Shared volume: \"%s\" is not a valid or complete volume segment\n", segment_name.c_str());
+      Release();
+      return false;
+    }
+
+    printf("  - Shared volume: attached to \"%s\" [%d, %d, %d]\n", segment_name.c_str(), header->width, header->height, header->depth);
+    return true;
+  }
+
+  void SharedVolumeSegment::Release ()
+  {
+    m_segment.Release();
+  }
+
+  bool SharedVolumeSegment::IsPublisher ()
+  {
+    return m_segment.IsCreator();
+  }
+
+  bool SharedVolumeSegment::IsAttached ()
+  {
+    return m_segment.IsMapped() && !m_segment.IsCreator();
+  }
+
+  std::string SharedVolumeSegment::GetSegmentName ()
+  {
+    return m_segment.GetName();
+  }
+
+  unsigned long long SharedVolumeSegment::GetSegmentSize ()
+  {
+    return m_segment.GetSize();
+  }
+
+  StructuredGridVolume* SharedVolumeSegment::CreateVolumeView ()
+  {
+    const SharedVolumeHeader* header = GetHeader();
+    if (!header) return nullptr;
+
+    StructuredGridVolume* vol = new StructuredGridVolume(m_segment.GetName(), header->width, header->height, header->depth);
+    vol->SetScale(header->scale[0], header->scale[1], header->scale[2]);
+    vol->SetArrayData(m_segment.GetData() + header->volume_offset, (DataStorageSize)header->data_storage_size, false);
+
+    return vol;
+  }
+
+  const void* SharedVolumeSegment::GetDerivedData (std::string name, unsigned int* width, unsigned int* height,
+                                                   unsigned int* depth, unsigned int* components)
+  {
+    const SharedVolumeHeader* header = GetHeader();
+    if (!header) return nullptr;
+
+    for (unsigned int i = 0; i < header->n_derived_blocks; i++)
+    {
+      if (name.compare(0, SHARED_VOLUME_BLOCK_NAME_SIZE, header->derived[i].name) == 0)
+      {
+        if (width) *width = header->derived[i].width;
+        if (height) *height = header->derived[i].height;
+        if (depth) *depth = header->derived[i].depth;
+        if (components) *components = header->derived[i].components;
+        return m_segment.GetData() + header->derived[i].offset;
+      }
+    }
+    return nullptr;
+  }
+
+  unsigned long long SharedVolumeSegment::GetStorageByteSize (DataStorageSize dss)
+  {
+    if (dss == DataStorageSize::_8_BITS) return sizeof(unsigned char);
+    else if (dss == DataStorageSize::_16_BITS) return sizeof(unsigned short);
+    else if (dss == DataStorageSize::_NORMALIZED_F) return sizeof(float);
+    else if (dss == DataStorageSize::_NORMALIZED_D) return sizeof(double);
+    return 0;
+  }
+
+  const SharedVolumeHeader* SharedVolumeSegment::GetHeader ()
+  {
+    if (!m_segment.IsMapped()) return nullptr;
+    return reinterpret_cast<const SharedVolumeHeader*>(m_segment.GetData());
+  }
+}
@@ -0,0 +1,109 @@
+/**
+ * sharedvolume.h
+ *
+ * Publish a decoded structured volume (plus derived data, such as gradients)
+ *   into a named shared memory segment, so other render processes on the
+ *   same node can attach to it read-only, without copying the data.
+ *
+ * Segment layout:
+ *   <SharedVolumeHeader> <volume values> <derived block 0> ... <derived block n>
+ * Each data block starts at a 64 bytes aligned offset. The "ready" flag of
+ *   the header is only set after all data is copied.
+ *
+ * The publisher keeps the segment alive until Release/destruction. On POSIX,
+ *   processes that are already attached keep their mapping after that.
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#ifndef VOL_VIS_UTILS_SHARED_VOLUME_H
+#define VOL_VIS_UTILS_SHARED_VOLUME_H
+
+#include <volvis_utils/structuredgridvolume.h>
+#include <volvis_utils/sharedmemory.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define SHARED_VOLUME_MAX_DERIVED_BLOCKS 8
+#define SHARED_VOLUME_BLOCK_NAME_SIZE 32
+
+namespace vis
+{
+  struct SharedDerivedBlockHeader
+  {
+    char name[SHARED_VOLUME_BLOCK_NAME_SIZE];
+    uint64_t offset;
+    uint64_t bytes;
+    uint32_t width, height, depth;
+    uint32_t components;
+  };
+
+  struct SharedVolumeHeader
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t ready;
+    uint32_t width, height, depth;
+    uint32_t data_storage_size;
+    double scale[3];
+    uint64_t volume_offset;
+    uint64_t volume_bytes;
+    uint32_t n_derived_blocks;
+    uint32_t reserved;
+    SharedDerivedBlockHeader derived[SHARED_VOLUME_MAX_DERIVED_BLOCKS];
+  };
+
+  class SharedVolumeSegment
+  {
+  public:
+    // Derived data to be published along the volume (e.g. "gradient", float rgb)
+    struct DerivedBlock
+    {
+      std::string name;
+      const void* data;
+      unsigned long long bytes;
+      unsigned int width, height, depth;
+      unsigned int components;
+    };
+
+    SharedVolumeSegment ();
+    ~SharedVolumeSegment ();
+
+    // Create the segment "segment_name" and copy the volume and derived data
+    bool Publish (std::string segment_name, StructuredGridVolume* vol,
+                  const std::vector<DerivedBlock>& derived_blocks = std::vector<DerivedBlock>());
+
+    // Map an existing segment read-only
+    bool Attach (std::string segment_name);
+
+    // Unmap the segment. The publisher also removes the segment name.
+    void Release ();
+
+    bool IsPublisher ();
+    bool IsAttached ();
+    std::string GetSegmentName ();
+    unsigned long long GetSegmentSize ();
+
+    // Volume that points to the shared values (zero copy, read-only). It does
+    //  not own the array, and must be deleted before Release.
+    StructuredGridVolume* CreateVolumeView ();
+
+    // Returns nullptr if there is no derived block with the given name
+    const void* GetDerivedData (std::string name, unsigned int* width = nullptr, unsigned int* height = nullptr,
+                                unsigned int* depth = nullptr, unsigned int* components = nullptr);
+
+    static unsigned long long GetStorageByteSize (DataStorageSize dss);
+
+  protected:
+    const SharedVolumeHeader* GetHeader ();
+
+    SharedMemorySegment m_segment;
+
+  private:
+
+  };
+}
+
+#endif
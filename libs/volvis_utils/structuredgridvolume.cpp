@@ -4,6 +4,16 @@
 #include <string>
 #include <cstdlib>
 #include <fstream>
+#include <climits>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#include <file_utils/pvm.h>
+#include <volvis_utils/gradientfield.h>
+#include <volvis_utils/preprocessinggraph.h>
+
+#include <omp.h>
 
 namespace vis
 {
@@ -21,6 +31,8 @@ namespace vis
     , m_grid_center(glm::dvec3(0.0))
     , m_data_storage_size(DataStorageSize::UNKNOWN)
     , m_voxel_values(nullptr)
+    , m_owns_voxel_values(true)
+    , m_content_hash(0)
   {}
   
   StructuredGridVolume::~StructuredGridVolume ()
@@ -68,6 +80,7 @@ namespace vis
     m_scalex = sx;
     m_scaley = sy;
     m_scalez = sz;
+    m_content_hash = 0;
   }
   
   glm::dvec3 StructuredGridVolume::GetGridCenterPoint ()
@@ -107,10 +120,12 @@ namespace vis
     return (x < 0 || y < 0 || z < 0 || x >= GetWidth() || y >= GetHeight() || z >= GetDepth());
   }
 
-  void StructuredGridVolume::SetArrayData (void* input_vol_data, DataStorageSize dss)
+  void StructuredGridVolume::SetArrayData (void* input_vol_data, DataStorageSize dss, bool owns_data)
   {
     m_data_storage_size = dss;
     m_voxel_values = input_vol_data;
+    m_owns_voxel_values = owns_data;
+    m_content_hash = 0;
   }
 
   void* StructuredGridVolume::GetArrayData ()
@@ -118,6 +133,11 @@ namespace vis
     return m_voxel_values;
   }
 
+  DataStorageSize StructuredGridVolume::GetDataStorageSize ()
+  {
+    return m_data_storage_size;
+  }
+
   double StructuredGridVolume::GetNormalizedSample (int x, int y, int z)
   {
     if (m_voxel_values == nullptr
@@ -201,6 +221,22 @@ namespace vis
     return c;
   }
 
+  void StructuredGridVolume::SetNormalizedSample (int x, int y, int z, double value)
+  {
+    if (m_voxel_values == nullptr || IsOutOfBoundary(x, y, z)) return;
+
+    size_t id = size_t(x) + (size_t(y) * GetWidth()) + (size_t(z) * GetWidth() * GetHeight());
+    value = glm::clamp(value, 0.0, 1.0);
+    if (m_data_storage_size == DataStorageSize::_8_BITS)
+      static_cast<unsigned char*>(m_voxel_values)[id] = (unsigned char)(value * (256.0 - 1.0) + 0.5);
+    else if (m_data_storage_size == DataStorageSize::_16_BITS)
+      static_cast<unsigned short*>(m_voxel_values)[id] = (unsigned short)(value * (65536.0 - 1.0) + 0.5);
+    else if (m_data_storage_size == DataStorageSize::_NORMALIZED_F)
+      static_cast<float*>(m_voxel_values)[id] = (float)value;
+    else if (m_data_storage_size == DataStorageSize::_NORMALIZED_D)
+      static_cast<double*>(m_voxel_values)[id] = value;
+  }
+
   unsigned long long StructuredGridVolume::CheckSum ()
   {
     unsigned long long csum = 0;
@@ -230,6 +266,65 @@ namespace vis
     return csum;
   }
 
+  unsigned long long StructuredGridVolume::GetContentHash ()
+  {
+    if (m_content_hash != 0) return m_content_hash;
+
+    size_t bytes_per_voxel = 0;
+    if (m_data_storage_size == DataStorageSize::_8_BITS)
+      bytes_per_voxel = sizeof(unsigned char);
+    else if (m_data_storage_size == DataStorageSize::_16_BITS)
+      bytes_per_voxel = sizeof(unsigned short);
+    else if (m_data_storage_size == DataStorageSize::_NORMALIZED_F)
+      bytes_per_voxel = sizeof(float);
+    else if (m_data_storage_size == DataStorageSize::_NORMALIZED_D)
+      bytes_per_voxel = sizeof(double);
+    if (!m_voxel_values || bytes_per_voxel == 0) return 0;
+
+    // Blocks of 1 MB hashed in parallel (FNV-1a over 64 bits words), then
+    //  combined in order
+    const unsigned char* bytes = static_cast<const unsigned char*>(m_voxel_values);
+    size_t n_bytes = size_t(m_width) * size_t(m_height) * size_t(m_depth) * bytes_per_voxel;
+    size_t block_size = size_t(1) << 20;
+    int n_blocks = (int)((n_bytes + block_size - 1) / block_size);
+    std::vector<unsigned long long> block_hashes(n_blocks);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int b = 0; b < n_blocks; b++)
+    {
+      size_t begin = size_t(b) * block_size;
+      size_t end = glm::min(begin + block_size, n_bytes);
+      unsigned long long hash = 14695981039346656037ULL;
+      size_t i = begin;
+      for (; i + sizeof(unsigned long long) <= end; i += sizeof(unsigned long long))
+      {
+        unsigned long long word;
+        memcpy(&word, bytes + i, sizeof(unsigned long long));
+        hash ^= word;
+        hash *= 1099511628211ULL;
+      }
+      for (; i < end; i++)
+      {
+        hash ^= (unsigned long long)bytes[i];
+        hash *= 1099511628211ULL;
+      }
+      block_hashes[b] = hash;
+    }
+
+    unsigned int header[4] = { m_width, m_height, m_depth, (unsigned int)m_data_storage_size };
+    double scales[3] = { m_scalex, m_scaley, m_scalez };
+    unsigned long long hash = PreProcessingGraph::HashBytes(header, sizeof(header));
+    hash = PreProcessingGraph::HashBytes(scales, sizeof(scales), hash);
+    hash = PreProcessingGraph::HashBytes(block_hashes.data(), block_hashes.size() * sizeof(unsigned long long), hash);
+    m_content_hash = (hash == 0) ? 1 : hash;
+    return m_content_hash;
+  }
+
+  void StructuredGridVolume::InvalidateContentHash ()
+  {
+    m_content_hash = 0;
+  }
+
   double StructuredGridVolume::GetMaxDensity ()
   {
     if (m_data_storage_size == DataStorageSize::_8_BITS)
@@ -250,12 +345,235 @@ namespace vis
     }
     return 0.0;
   }
-  
+
+  std::string StructuredGridVolume::ExportRawFile (std::string path_prefix)
+  {
+    size_t bytes_per_voxel = 0;
+    if (m_data_storage_size == DataStorageSize::_8_BITS)
+      bytes_per_voxel = sizeof(unsigned char);
+    else if (m_data_storage_size == DataStorageSize::_16_BITS)
+      bytes_per_voxel = sizeof(unsigned short);
+    else if (m_data_storage_size == DataStorageSize::_NORMALIZED_F)
+      bytes_per_voxel = sizeof(float);
+    else if (m_data_storage_size == DataStorageSize::_NORMALIZED_D)
+      bytes_per_voxel = sizeof(double);
+    if (!m_voxel_values || bytes_per_voxel == 0) return "";
+
+    std::string filepath = path_prefix + "." + std::to_string(bytes_per_voxel) + "."
+      + std::to_string(m_width) + "x" + std::to_string(m_height) + "x" + std::to_string(m_depth)
+      + ".raw";
+
+    std::ofstream offile(filepath.c_str(), std::ios::out | std::ios::binary);
+    if (!offile.is_open())
+    {
+      printf("  - Error on opening raw file: %s\n", filepath.c_str());
+      return "";
+    }
+
+    size_t n_bytes = size_t(m_width) * size_t(m_height) * size_t(m_depth) * bytes_per_voxel;
+    offile.write(static_cast<const char*>(m_voxel_values), std::streamsize(n_bytes));
+    bool ok = offile.good();
+    offile.close();
+
+    if (!ok)
+    {
+      printf("  - Error on writing raw file: %s\n", filepath.c_str());
+      return "";
+    }
+    return filepath;
+  }
+
+  bool StructuredGridVolume::ExportPVMFile (std::string filepath, bool dds_compressed, unsigned int n_segments)
+  {
+    if (!m_voxel_values || m_data_storage_size == DataStorageSize::UNKNOWN) return false;
+
+    printf("Started  -> Export Volume To .pvm File\n");
+    printf("  - File .pvm Path: %s\n", filepath.c_str());
+
+    size_t n_voxels = size_t(m_width) * size_t(m_height) * size_t(m_depth);
+    unsigned int components = (m_data_storage_size == DataStorageSize::_8_BITS) ? 1 : 2;
+    // The PVM/DDS writer uses 32 bits byte counts
+    if (n_voxels * components + 1024 > size_t(UINT_MAX))
+    {
+      printf("Finished -> Error: volume is too large for a .pvm file\n");
+      return false;
+    }
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+    // 16 bits values are stored as read by Pvm (least significant byte first)
+    unsigned char* pvm_values = static_cast<unsigned char*>(m_voxel_values);
+    unsigned short* quantized_values = nullptr;
+    if (m_data_storage_size == DataStorageSize::_NORMALIZED_F || m_data_storage_size == DataStorageSize::_NORMALIZED_D)
+    {
+      quantized_values = new unsigned short[n_voxels];
+#pragma omp parallel for
+      for (int z = 0; z < (int)m_depth; z++)
+        for (int y = 0; y < (int)m_height; y++)
+          for (int x = 0; x < (int)m_width; x++)
+            quantized_values[x + (y * m_width) + (size_t(z) * m_width * m_height)] =
+              (unsigned short)(glm::clamp(GetNormalizedSample(x, y, z), 0.0, 1.0) * 65535.0 + 0.5);
+      pvm_values = reinterpret_cast<unsigned char*>(quantized_values);
+    }
+
+    if (n_segments == 0) n_segments = (omp_get_max_threads() > 1) ? (unsigned int)omp_get_max_threads() * 4 : 1;
+
+    DDSV3 ddswriter;
+    bool ret = ddswriter.writePVMvolume(filepath.c_str(), pvm_values, m_width, m_height, m_depth, components,
+      (float)m_scalex, (float)m_scaley, (float)m_scalez, NULL, NULL, NULL, NULL, dds_compressed, n_segments);
+
+    if (quantized_values) delete[] quantized_values;
+
+    printf("  - DDS Compression: %s (%d segments)\n", dds_compressed ? "yes" : "no", dds_compressed ? n_segments : 0);
+    printf("  - Time: %.2f ms\n", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+    if (!ret)
+      printf("Finished -> Error on writing .pvm file\n");
+    else
+      printf("Finished -> Export Volume To .pvm File\n");
+
+    return ret;
+  }
+
+  StructuredGridVolume* StructuredGridVolume::CreateResampledVolume (unsigned int width, unsigned int height, unsigned int depth)
+  {
+    if (!m_voxel_values || width == 0 || height == 0 || depth == 0) return nullptr;
+
+    StructuredGridVolume* ret = CreateDerivedVolume(GetName() + "_resampled", width, height, depth);
+    if (!ret) return nullptr;
+
+    // voxel centers of the new grid, in voxel coordinates of this grid
+    glm::dvec3 ratio = glm::dvec3((double)m_width / (double)width, (double)m_height / (double)height, (double)m_depth / (double)depth);
+    glm::dvec3 max_coord = glm::dvec3(m_width - 1, m_height - 1, m_depth - 1);
+
+#pragma omp parallel for
+    for (int z = 0; z < (int)depth; z++)
+    {
+      for (int y = 0; y < (int)height; y++)
+      {
+        for (int x = 0; x < (int)width; x++)
+        {
+          glm::dvec3 p = glm::clamp((glm::dvec3(x, y, z) + 0.5) * ratio - 0.5, glm::dvec3(0.0), max_coord);
+          glm::ivec3 p0 = glm::ivec3(p);
+          glm::ivec3 p1 = glm::min(p0 + 1, glm::ivec3(max_coord));
+          glm::dvec3 d = p - glm::dvec3(p0);
+
+          double c00 = GetNormalizedSample(p0.x, p0.y, p0.z) * (1.0 - d.x) + GetNormalizedSample(p1.x, p0.y, p0.z) * d.x;
+          double c10 = GetNormalizedSample(p0.x, p1.y, p0.z) * (1.0 - d.x) + GetNormalizedSample(p1.x, p1.y, p0.z) * d.x;
+          double c01 = GetNormalizedSample(p0.x, p0.y, p1.z) * (1.0 - d.x) + GetNormalizedSample(p1.x, p0.y, p1.z) * d.x;
+          double c11 = GetNormalizedSample(p0.x, p1.y, p1.z) * (1.0 - d.x) + GetNormalizedSample(p1.x, p1.y, p1.z) * d.x;
+
+          double c0 = c00 * (1.0 - d.y) + c10 * d.y;
+          double c1 = c01 * (1.0 - d.y) + c11 * d.y;
+
+          ret->SetNormalizedSample(x, y, z, c0 * (1.0 - d.z) + c1 * d.z);
+        }
+      }
+    }
+    ret->InvalidateContentHash();
+
+    return ret;
+  }
+
+  // Running sum box filter along one axis, replicating the border values
+  static void BoxFilterAxis (const double* in, double* out, int width, int height, int depth, int axis, int radius)
+  {
+    int length = (axis == 0) ? width : ((axis == 1) ? height : depth);
+    size_t stride = (axis == 0) ? 1 : ((axis == 1) ? size_t(width) : size_t(width) * size_t(height));
+    int n_lines = (axis == 0) ? height * depth : ((axis == 1) ? width * depth : width * height);
+    double inv_size = 1.0 / double(2 * radius + 1);
+
+#pragma omp parallel for
+    for (int line = 0; line < n_lines; line++)
+    {
+      size_t start;
+      if (axis == 0)      start = size_t(line) * width;
+      else if (axis == 1) start = size_t(line % width) + size_t(line / width) * width * height;
+      else                start = size_t(line);
+
+      double sum = 0.0;
+      for (int k = -radius; k <= radius; k++)
+        sum += in[start + glm::clamp(k, 0, length - 1) * stride];
+
+      for (int i = 0; i < length; i++)
+      {
+        out[start + i * stride] = sum * inv_size;
+        sum += in[start + glm::clamp(i + radius + 1, 0, length - 1) * stride]
+             - in[start + glm::clamp(i - radius, 0, length - 1) * stride];
+      }
+    }
+  }
+
+  StructuredGridVolume* StructuredGridVolume::CreateFilteredVolume (int radius)
+  {
+    if (!m_voxel_values || radius < 1) return nullptr;
+
+    StructuredGridVolume* ret = CreateDerivedVolume(GetName() + "_filtered", m_width, m_height, m_depth);
+    if (!ret) return nullptr;
+
+    size_t n_voxels = size_t(m_width) * size_t(m_height) * size_t(m_depth);
+    double* values = new double[n_voxels];
+    double* tmp_values = new double[n_voxels];
+
+#pragma omp parallel for
+    for (int z = 0; z < (int)m_depth; z++)
+      for (int y = 0; y < (int)m_height; y++)
+        for (int x = 0; x < (int)m_width; x++)
+          values[x + (y * m_width) + (size_t(z) * m_width * m_height)] = GetNormalizedSample(x, y, z);
+
+    BoxFilterAxis(values, tmp_values, m_width, m_height, m_depth, 0, radius);
+    BoxFilterAxis(tmp_values, values, m_width, m_height, m_depth, 1, radius);
+    BoxFilterAxis(values, tmp_values, m_width, m_height, m_depth, 2, radius);
+
+#pragma omp parallel for
+    for (int z = 0; z < (int)m_depth; z++)
+      for (int y = 0; y < (int)m_height; y++)
+        for (int x = 0; x < (int)m_width; x++)
+          ret->SetNormalizedSample(x, y, z, tmp_values[x + (y * m_width) + (size_t(z) * m_width * m_height)]);
+    ret->InvalidateContentHash();
+
+    delete[] values;
+    delete[] tmp_values;
+
+    return ret;
+  }
+
+  StructuredGridVolume* StructuredGridVolume::CreateGradientMagnitudeVolume ()
+  {
+    if (!m_voxel_values) return nullptr;
+
+    StructuredGridVolume* ret = CreateDerivedVolume(GetName() + "_gradient_magnitude", m_width, m_height, m_depth);
+    if (!ret) return nullptr;
+
+    size_t n_voxels = size_t(m_width) * size_t(m_height) * size_t(m_depth);
+    float* magnitudes = new float[n_voxels];
+    float max_magnitude = 0.0f;
+    ComputeGradientMagnitudes(this, magnitudes, GRADIENT_OPERATOR::CENTRAL_DIFFERENCES, &max_magnitude);
+    double inv_max = max_magnitude > 0.0f ? 1.0 / (double)max_magnitude : 0.0;
+
+#pragma omp parallel for
+    for (int z = 0; z < (int)m_depth; z++)
+      for (int y = 0; y < (int)m_height; y++)
+        for (int x = 0; x < (int)m_width; x++)
+          ret->SetNormalizedSample(x, y, z, magnitudes[x + (y * m_width) + (size_t(z) * m_width * m_height)] * inv_max);
+    ret->InvalidateContentHash();
+
+    delete[] magnitudes;
+
+    return ret;
+  }
+
   /////////////////////
   // Private Methods //
   /////////////////////
   void StructuredGridVolume::DestroyData ()
   {
+    m_content_hash = 0;
+    if (!m_owns_voxel_values)
+    {
+      m_voxel_values = nullptr;
+      return;
+    }
+
     if (m_data_storage_size == DataStorageSize::_8_BITS)
     {
       unsigned char* array_vls = static_cast<unsigned char*>(m_voxel_values);
@@ -281,4 +599,30 @@ namespace vis
       m_voxel_values = nullptr;
     }
   }
-}
\ No newline at end of file
+
+  StructuredGridVolume* StructuredGridVolume::CreateDerivedVolume (std::string name, unsigned int width, unsigned int height, unsigned int depth)
+  {
+    size_t n_voxels = size_t(width) * size_t(height) * size_t(depth);
+
+    void* values = nullptr;
+    if (m_data_storage_size == DataStorageSize::_8_BITS)
+      values = new unsigned char[n_voxels];
+    else if (m_data_storage_size == DataStorageSize::_16_BITS)
+      values = new unsigned short[n_voxels];
+    else if (m_data_storage_size == DataStorageSize::_NORMALIZED_F)
+      values = new float[n_voxels];
+    else if (m_data_storage_size == DataStorageSize::_NORMALIZED_D)
+      values = new double[n_voxels];
+    else
+      return nullptr;
+
+    StructuredGridVolume* ret = new StructuredGridVolume(name, width, height, depth);
+    ret->SetArrayData(values, m_data_storage_size);
+    // keep the extent of the volume
+    ret->SetScale(m_scalex * (double)m_width / (double)width,
+                  m_scaley * (double)m_height / (double)height,
+                  m_scalez * (double)m_depth / (double)depth);
+
+    return ret;
+  }
+}
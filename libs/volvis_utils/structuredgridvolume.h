@@ -44,7 +44,7 @@ namespace vis
                           unsigned int width  = 0,
                           unsigned int height = 0,
                           unsigned int depth  = 0);
-    ~StructuredGridVolume ();
+    virtual ~StructuredGridVolume ();
   
     unsigned int GetWidth ();
     unsigned int GetHeight ();
@@ -63,18 +63,48 @@ namespace vis
 
     bool IsOutOfBoundary (int x, int y, int z);
   
-    void SetArrayData (void* input_vol_data, DataStorageSize dss);
+    // If "owns_data" is false, the array is not deleted with the volume
+    void SetArrayData (void* input_vol_data, DataStorageSize dss, bool owns_data = true);
     void* GetArrayData ();
+    DataStorageSize GetDataStorageSize ();
 
     double GetNormalizedSample (int x, int y, int z);
     double GetNormalizedInterpolatedSample (double x, double y, double z);
+    // Store a normalized [0, 1] value, quantized to the data storage size
+    void SetNormalizedSample (int x, int y, int z, double value);
 
     unsigned long long CheckSum ();
+    // Hash of the extent, data storage size and voxel values, used as key of
+    //  derived data (DerivedDataCache). Computed once, and reset by SetArrayData
+    //  and SetScale: call InvalidateContentHash after SetNormalizedSample or after
+    //  writing to the array returned by GetArrayData. 0 if there is no data.
+    unsigned long long GetContentHash ();
+    void InvalidateContentHash ();
 
     double GetMaxDensity ();
 
+    // Export the voxel values as "<path_prefix>.<bytes>.<width>x<height>x<depth>.raw",
+    //  the name convention read by VolumeReader. Returns the written file path,
+    //  or an empty string on failure.
+    std::string ExportRawFile (std::string path_prefix);
+    // Export as .pvm. 8 and 16 bits volumes are written as stored, float and
+    //  double volumes are quantized to 16 bits. DDS compression is computed in
+    //  parallel over "n_segments" independent segments (0: 4 per thread).
+    bool ExportPVMFile (std::string filepath, bool dds_compressed = true, unsigned int n_segments = 0);
+
+    // Derived volumes, with the same data storage size
+    // . trilinear resampling, keeping the extent of the volume
+    StructuredGridVolume* CreateResampledVolume (unsigned int width, unsigned int height, unsigned int depth);
+    // . mean of the (2 * radius + 1)^3 neighborhood (separable box filter)
+    StructuredGridVolume* CreateFilteredVolume (int radius = 1);
+    // . central differences gradient magnitude, normalized by the max magnitude
+    StructuredGridVolume* CreateGradientMagnitudeVolume ();
+
   protected:
     virtual void DestroyData ();
+
+    // Empty volume (allocated) with the same data storage size and extent
+    StructuredGridVolume* CreateDerivedVolume (std::string name, unsigned int width, unsigned int height, unsigned int depth);
   
   private: 
   
@@ -85,6 +115,9 @@ namespace vis
   
     DataStorageSize m_data_storage_size;
     void* m_voxel_values;
+    bool m_owns_voxel_values;
+
+    unsigned long long m_content_hash;
   };
 }
 
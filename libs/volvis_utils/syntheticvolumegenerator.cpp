@@ -0,0 +1,287 @@
+/**
+ * syntheticvolumegenerator.cpp
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#include <volvis_utils/syntheticvolumegenerator.h>
+
+#include <random>
+#include <chrono>
+
+#include <omp.h>
+
+#include <glm/gtc/constants.hpp>
+
+#define SYNTHETIC_NOISE_OCTAVES (4)
+
+namespace vis
+{
+  // Uniform value in [a, b), independent from the standard library distributions
+  static double UniformValue (std::mt19937& rng, double a, double b)
+  {
+    return a + (b - a) * (double(rng()) / 4294967296.0);
+  }
+
+  // Components are drawn in a fixed order (function argument order is unspecified)
+  static glm::dvec3 UniformPoint (std::mt19937& rng, double a, double b)
+  {
+    glm::dvec3 p;
+    p.x = UniformValue(rng, a, b);
+    p.y = UniformValue(rng, a, b);
+    p.z = UniformValue(rng, a, b);
+    return p;
+  }
+
+  SyntheticVolumeGenerator::SyntheticVolumeGenerator (unsigned int seed)
+    : m_seed(seed)
+    , m_n_elements(8)
+    , m_frequency(8.0)
+  {
+  }
+
+  SyntheticVolumeGenerator::~SyntheticVolumeGenerator ()
+  {
+    m_elements.clear();
+  }
+
+  void SyntheticVolumeGenerator::SetSeed (unsigned int seed)
+  {
+    m_seed = seed;
+  }
+
+  unsigned int SyntheticVolumeGenerator::GetSeed ()
+  {
+    return m_seed;
+  }
+
+  void SyntheticVolumeGenerator::SetNumberOfElements (int n_elements)
+  {
+    m_n_elements = glm::max(n_elements, 1);
+  }
+
+  int SyntheticVolumeGenerator::GetNumberOfElements ()
+  {
+    return m_n_elements;
+  }
+
+  void SyntheticVolumeGenerator::SetFrequency (double frequency)
+  {
+    m_frequency = glm::max(frequency, 1.0);
+  }
+
+  double SyntheticVolumeGenerator::GetFrequency ()
+  {
+    return m_frequency;
+  }
+
+  StructuredGridVolume* SyntheticVolumeGenerator::Generate (MODEL model, unsigned int width, unsigned int height, unsigned int depth,
+                                                            DataStorageSize dss)
+  {
+    if (model == MODEL::NONE_MODEL || dss == DataStorageSize::UNKNOWN || width == 0 || height == 0 || depth == 0)
+      return nullptr;
+
+    printf("Started  -> Generate Synthetic Volume\n");
+    printf("  - Model       : %s\n", GetModelName(model).c_str());
+    printf("  - Volume Size : [%d, %d, %d]\n", width, height, depth);
+    printf("  - Seed        : %u\n", m_seed);
+    auto t_start = std::chrono::steady_clock::now();
+
+    BuildElements(model);
+
+    size_t n_voxels = size_t(width) * size_t(height) * size_t(depth);
+    void* scalar_values = nullptr;
+    if (dss == DataStorageSize::_8_BITS)
+      scalar_values = new unsigned char[n_voxels];
+    else if (dss == DataStorageSize::_16_BITS)
+      scalar_values = new unsigned short[n_voxels];
+    else if (dss == DataStorageSize::_NORMALIZED_F)
+      scalar_values = new float[n_voxels];
+    else if (dss == DataStorageSize::_NORMALIZED_D)
+      scalar_values = new double[n_voxels];
+
+#pragma omp parallel for schedule(dynamic)
+    for (int z = 0; z < int(depth); z++)
+    {
+      double pz = (double(z) + 0.5) / double(depth);
+
+      // Only the spheres that intersect the current slice are evaluated
+      std::vector<int> candidates;
+      for (int e = 0; e < int(m_elements.size()); e++)
+        if (model != MODEL::SPARSE_SPHERES || glm::abs(m_elements[e].center.z - pz) <= m_elements[e].radius)
+          candidates.push_back(e);
+
+      for (unsigned int y = 0; y < height; y++)
+      {
+        double py = (double(y) + 0.5) / double(height);
+        for (unsigned int x = 0; x < width; x++)
+        {
+          double v = glm::clamp(EvaluateSample(model, glm::dvec3((double(x) + 0.5) / double(width), py, pz), candidates), 0.0, 1.0);
+
+          size_t id = size_t(x) + size_t(y) * size_t(width) + size_t(z) * size_t(width) * size_t(height);
+          if (dss == DataStorageSize::_8_BITS)
+            static_cast<unsigned char*>(scalar_values)[id] = (unsigned char)(v * 255.0 + 0.5);
+          else if (dss == DataStorageSize::_16_BITS)
+            static_cast<unsigned short*>(scalar_values)[id] = (unsigned short)(v * 65535.0 + 0.5);
+          else if (dss == DataStorageSize::_NORMALIZED_F)
+            static_cast<float*>(scalar_values)[id] = (float)v;
+          else
+            static_cast<double*>(scalar_values)[id] = v;
+        }
+      }
+    }
+
+    StructuredGridVolume* ret = new StructuredGridVolume(GetModelName(model), width, height, depth);
+    ret->SetScale(1.0, 1.0, 1.0);
+    ret->SetArrayData(scalar_values, dss);
+
+    printf("  - Time        : %.2f ms\n", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t_start).count());
+    printf("Finished -> Generate Synthetic Volume\n");
+
+    return ret;
+  }
+
+  std::string SyntheticVolumeGenerator::WriteRawFile (StructuredGridVolume* vol, std::string path_prefix)
+  {
+    if (!vol || !vol->GetArrayData()) return "";
+    return vol->ExportRawFile(path_prefix);
+  }
+
+  std::string SyntheticVolumeGenerator::GetModelName (MODEL model)
+  {
+    if (model == MODEL::GAUSSIAN_BLOBS) return "gaussian_blobs";
+    else if (model == MODEL::NOISE) return "noise";
+    else if (model == MODEL::SPARSE_SPHERES) return "sparse_spheres";
+    else if (model == MODEL::SHELLS) return "shells";
+    else if (model == MODEL::CHECKERBOARD) return "checkerboard";
+    return "none";
+  }
+
+  SyntheticVolumeGenerator::MODEL SyntheticVolumeGenerator::GetModelFromName (std::string name)
+  {
+    for (unsigned int m = 0; m < MODEL::NONE_MODEL; m++)
+      if (GetModelName(MODEL(m)).compare(name) == 0)
+        return MODEL(m);
+    return MODEL::NONE_MODEL;
+  }
+
+  void SyntheticVolumeGenerator::BuildElements (MODEL model)
+  {
+    m_elements.clear();
+
+    std::mt19937 rng(m_seed);
+    if (model == MODEL::GAUSSIAN_BLOBS)
+    {
+      for (int i = 0; i < m_n_elements; i++)
+      {
+        Element e;
+        e.center = UniformPoint(rng, 0.15, 0.85);
+        e.radius = UniformValue(rng, 0.04, 0.12);
+        e.value = UniformValue(rng, 0.4, 1.0);
+        m_elements.push_back(e);
+      }
+    }
+    else if (model == MODEL::SPARSE_SPHERES)
+    {
+      for (int i = 0; i < m_n_elements; i++)
+      {
+        Element e;
+        e.center = UniformPoint(rng, 0.05, 0.95);
+        e.radius = UniformValue(rng, 0.01, 0.06);
+        e.value = UniformValue(rng, 0.2, 1.0);
+        m_elements.push_back(e);
+      }
+    }
+    else if (model == MODEL::SHELLS)
+    {
+      Element e;
+      e.center = glm::dvec3(0.5) + UniformPoint(rng, -0.05, 0.05);
+      e.radius = 0.45;
+      e.value = 1.0;
+      m_elements.push_back(e);
+    }
+  }
+
+  double SyntheticVolumeGenerator::EvaluateSample (MODEL model, const glm::dvec3& p, const std::vector<int>& candidates)
+  {
+    if (model == MODEL::GAUSSIAN_BLOBS)
+    {
+      double v = 0.0;
+      for (int i = 0; i < int(candidates.size()); i++)
+      {
+        const Element& e = m_elements[candidates[i]];
+        glm::dvec3 d = p - e.center;
+        v += e.value * glm::exp(-glm::dot(d, d) / (2.0 * e.radius * e.radius));
+      }
+      return v;
+    }
+    else if (model == MODEL::NOISE)
+    {
+      double v = 0.0, amplitude = 1.0, total_amplitude = 0.0, frequency = m_frequency;
+      for (unsigned int o = 0; o < SYNTHETIC_NOISE_OCTAVES; o++)
+      {
+        v += amplitude * ValueNoise(p * frequency, o);
+        total_amplitude += amplitude;
+        amplitude *= 0.5;
+        frequency *= 2.0;
+      }
+      return v / total_amplitude;
+    }
+    else if (model == MODEL::SPARSE_SPHERES)
+    {
+      double v = 0.0;
+      for (int i = 0; i < int(candidates.size()); i++)
+      {
+        const Element& e = m_elements[candidates[i]];
+        glm::dvec3 d = p - e.center;
+        if (glm::dot(d, d) <= e.radius * e.radius)
+          v = glm::max(v, e.value);
+      }
+      return v;
+    }
+    else if (model == MODEL::SHELLS)
+    {
+      const Element& e = m_elements[0];
+      double r = glm::length(p - e.center) / e.radius;
+      if (r > 1.0) return 0.0;
+      return 0.5 + 0.5 * glm::cos(2.0 * glm::pi<double>() * double(m_n_elements) * r);
+    }
+    else if (model == MODEL::CHECKERBOARD)
+    {
+      int cx = int(p.x * m_frequency), cy = int(p.y * m_frequency), cz = int(p.z * m_frequency);
+      return ((cx + cy + cz) % 2 == 0) ? 1.0 : 0.0;
+    }
+    return 0.0;
+  }
+
+  double SyntheticVolumeGenerator::ValueNoise (const glm::dvec3& p, unsigned int octave)
+  {
+    glm::dvec3 fp = glm::floor(p);
+    int x0 = int(fp.x), y0 = int(fp.y), z0 = int(fp.z);
+
+    // smoothstep weights
+    glm::dvec3 t = p - fp;
+    t = t * t * (3.0 - 2.0 * t);
+
+    double c00 = glm::mix(LatticeValue(x0, y0    , z0    , octave), LatticeValue(x0 + 1, y0    , z0    , octave), t.x);
+    double c10 = glm::mix(LatticeValue(x0, y0 + 1, z0    , octave), LatticeValue(x0 + 1, y0 + 1, z0    , octave), t.x);
+    double c01 = glm::mix(LatticeValue(x0, y0    , z0 + 1, octave), LatticeValue(x0 + 1, y0    , z0 + 1, octave), t.x);
+    double c11 = glm::mix(LatticeValue(x0, y0 + 1, z0 + 1, octave), LatticeValue(x0 + 1, y0 + 1, z0 + 1, octave), t.x);
+
+    return glm::mix(glm::mix(c00, c10, t.y), glm::mix(c01, c11, t.y), t.z);
+  }
+
+  double SyntheticVolumeGenerator::LatticeValue (int x, int y, int z, unsigned int octave)
+  {
+    // integer hash of the lattice point, octave and seed
+    unsigned int h = m_seed * 0x9E3779B1u;
+    h ^= (unsigned int)x * 0x85EBCA77u;
+    h ^= (unsigned int)y * 0xC2B2AE3Du;
+    h ^= (unsigned int)z * 0x27D4EB2Fu;
+    h ^= octave * 0x165667B1u;
+    h ^= h >> 15; h *= 0x2C1B3C6Du;
+    h ^= h >> 12; h *= 0x297A2D39u;
+    h ^= h >> 15;
+    return double(h) / 4294967295.0;
+  }
+}
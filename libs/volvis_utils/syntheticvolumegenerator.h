@@ -0,0 +1,100 @@
+/**
+ * syntheticvolumegenerator.h
+ *
+ * Procedural generation of synthetic structured volumes, computed in memory
+ *   and in parallel. The output only depends on the model parameters and the
+ *   seed, so the same volume can be generated again at any resolution.
+ *
+ * Models:
+ * . GAUSSIAN_BLOBS: sum of "elements" gaussian blobs
+ * . NOISE         : fractal value noise, with base "frequency"
+ * . SPARSE_SPHERES: "elements" solid spheres with random density
+ * . SHELLS        : "elements" concentric spherical shells
+ * . CHECKERBOARD  : "frequency" cells per axis
+ *
+ * Descriptor files (.proc), read by VolumeReader, with one key per line:
+ *   model gaussian_blobs | noise | sparse_spheres | shells | checkerboard
+ *   size <width> <height> <depth>
+ *   type uint8 | uint16 | float | double
+ *   seed <unsigned int>
+ *   elements <int>
+ *   frequency <double>
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#ifndef VOL_VIS_UTILS_SYNTHETIC_VOLUME_GENERATOR_H
+#define VOL_VIS_UTILS_SYNTHETIC_VOLUME_GENERATOR_H
+
+#include <volvis_utils/structuredgridvolume.h>
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace vis
+{
+  class SyntheticVolumeGenerator
+  {
+  public:
+    enum MODEL : unsigned int
+    {
+      GAUSSIAN_BLOBS = 0,
+      NOISE          = 1,
+      SPARSE_SPHERES = 2,
+      SHELLS         = 3,
+      CHECKERBOARD   = 4,
+      NONE_MODEL     = 5,
+    };
+
+    SyntheticVolumeGenerator (unsigned int seed = 0);
+    ~SyntheticVolumeGenerator ();
+
+    void SetSeed (unsigned int seed);
+    unsigned int GetSeed ();
+
+    // Number of blobs, spheres or shells
+    void SetNumberOfElements (int n_elements);
+    int GetNumberOfElements ();
+
+    // Base noise frequency or number of checkerboard cells per axis
+    void SetFrequency (double frequency);
+    double GetFrequency ();
+
+    StructuredGridVolume* Generate (MODEL model, unsigned int width, unsigned int height, unsigned int depth,
+                                    DataStorageSize dss = DataStorageSize::_8_BITS);
+
+    // Write the volume as "<path_prefix>.<bytes>.<width>x<height>x<depth>.raw",
+    //  the name convention read by VolumeReader. Returns the written file path,
+    //  or an empty string on failure.
+    static std::string WriteRawFile (StructuredGridVolume* vol, std::string path_prefix);
+
+    static std::string GetModelName (MODEL model);
+    static MODEL GetModelFromName (std::string name);
+
+  protected:
+    struct Element
+    {
+      glm::dvec3 center;
+      double radius;
+      double value;
+    };
+
+    void BuildElements (MODEL model);
+    double EvaluateSample (MODEL model, const glm::dvec3& p, const std::vector<int>& candidates);
+    double ValueNoise (const glm::dvec3& p, unsigned int octave);
+    double LatticeValue (int x, int y, int z, unsigned int octave);
+
+    unsigned int m_seed;
+    int m_n_elements;
+    double m_frequency;
+
+    std::vector<Element> m_elements;
+
+  private:
+
+  };
+}
+
+#endif
@@ -59,6 +59,20 @@ namespace vis
     virtual float GetExt (double value, double max_input_value = -1.0) { return -1.0; }
     virtual float GetExtN (double normalized_value) { return -1.0; }
 
+    // Extinction of "n_values" evenly spaced normalized values [0, 1]:
+    //  lut[i] = GetExtN(i / (n_values - 1))
+    virtual void GetExtinctionLookupTable (int n_values, float* lut)
+    {
+      for (int i = 0; i < n_values; i++)
+        lut[i] = GetExtN(n_values > 1 ? double(i) / double(n_values - 1) : 0.0);
+    }
+
+    // Hash of everything that defines the extinction (alpha) channel, equal
+    //  hashes give equal GetExtN. 0 if unknown (derived data must be rebuilt).
+    virtual unsigned long long GetExtinctionHash () { return 0; }
+    // Hash of colors and extinction, equal hashes give equal Get. 0 if unknown.
+    virtual unsigned long long GetHash () { return 0; }
+
     virtual gl::Texture1D* GenerateTexture_1D_RGBA () { return NULL; }
     virtual gl::Texture1D* GenerateTexture_1D_RGBt () { return NULL; }
     
@@ -4,6 +4,7 @@
 
 #include <fstream>
 #include <cstdlib>
+#include <algorithm>
 
 namespace vis
 {
@@ -196,6 +197,70 @@ namespace vis
     return val;
   }
 
+  void TransferFunction1D::GetExtinctionLookupTable (int n_values, float* lut)
+  {
+    if (!m_built)
+      Build();
+
+    // Same interpolation of Get, evaluated directly in the built table
+    for (int i = 0; i < n_values; i++)
+    {
+      double value = n_values > 1 ? double(i) * (double(max_density) / double(n_values - 1)) : 0.0;
+      int i0 = std::min((int)value, max_density);
+      int i1 = std::min(i0 + 1, max_density);
+      double t = value - (double)i0;
+
+      float val = (float)((1.0 - t) * m_transferfunction[i0].a + t * m_transferfunction[i1].a);
+      if (!extinction_coef_type)
+        val = MaterialOpacityToExtinction(val);
+      lut[i] = val;
+    }
+  }
+
+  unsigned long long TransferFunction1D::GetExtinctionHash ()
+  {
+    // FNV-1a over the alpha control points and the alpha interpretation
+    unsigned long long hash = 14695981039346656037ULL;
+    auto add = [&hash] (const void* bytes, size_t size) {
+      const unsigned char* b = static_cast<const unsigned char*>(bytes);
+      for (size_t i = 0; i < size; i++)
+      {
+        hash ^= (unsigned long long)b[i];
+        hash *= 1099511628211ULL;
+      }
+    };
+    add(&max_density, sizeof(max_density));
+    add(&extinction_coef_type, sizeof(extinction_coef_type));
+    for (int i = 0; i < (int)m_cpt_alpha.size(); i++)
+    {
+      add(&m_cpt_alpha[i].m_color.a, sizeof(float));
+      add(&m_cpt_alpha[i].m_isoValue, sizeof(int));
+    }
+    return hash;
+  }
+
+  unsigned long long TransferFunction1D::GetHash ()
+  {
+    // Extinction hash, then FNV-1a over the rgb control points
+    unsigned long long hash = GetExtinctionHash();
+    for (int i = 0; i < (int)m_cpt_rgb.size(); i++)
+    {
+      const unsigned char* b = reinterpret_cast<const unsigned char*>(&m_cpt_rgb[i].m_color);
+      for (size_t k = 0; k < 3 * sizeof(float); k++)
+      {
+        hash ^= (unsigned long long)b[k];
+        hash *= 1099511628211ULL;
+      }
+      b = reinterpret_cast<const unsigned char*>(&m_cpt_rgb[i].m_isoValue);
+      for (size_t k = 0; k < sizeof(int); k++)
+      {
+        hash ^= (unsigned long long)b[k];
+        hash *= 1099511628211ULL;
+      }
+    }
+    return hash == 0 ? 1 : hash;
+  }
+
   void TransferFunction1D::PrintControlPoints ()
   {
     printf ("Print Transfer Function: Control Points\n");
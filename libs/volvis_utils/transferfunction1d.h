@@ -44,6 +44,10 @@ namespace vis
     virtual float GetExt (double value, double max_input_value = -1.0);
     virtual float GetExtN (double normalized_value);
 
+    virtual void GetExtinctionLookupTable (int n_values, float* lut);
+    virtual unsigned long long GetExtinctionHash ();
+    virtual unsigned long long GetHash ();
+
     virtual gl::Texture1D* GenerateTexture_1D_RGBA ();
     virtual gl::Texture1D* GenerateTexture_1D_RGBt ();
 
@@ -19,7 +19,7 @@ namespace vis
   {
   public:
     UnstructuredGridVolume (std::string name = "Unknown");
-    ~UnstructuredGridVolume ();
+    virtual ~UnstructuredGridVolume ();
   
     virtual glm::dvec3 GetGridCenterPoint ();
     virtual glm::dvec3 GetGridBBoxMin ();
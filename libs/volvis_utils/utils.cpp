@@ -1,13 +1,24 @@
 #include "utils.h"
 
 #include <vis_utils/summedareatable.h>
+#include <volvis_utils/reader.h>
+#include <volvis_utils/gradientfield.h>
+#include <volvis_utils/cubicsplinevolume.h>
+#include <volvis_utils/preprocessinggraph.h>
+#include <volvis_utils/syntheticvolumegenerator.h>
+#include <file_utils/chunkedvolume.h>
 #include <iostream>
 #include <random>
 #include <fstream>
+#include <chrono>
+#include <algorithm>
 
 #define TEXTURE_FILTER GL_LINEAR        // GL_NEAREST         //
 #define TEXTURE_WRAP   GL_CLAMP_TO_EDGE // GL_CLAMP_TO_BORDER // 
 
+// Number of slices decoded per upload by GenerateEncodedGradientTexture
+#define ENCODED_GRADIENT_UPLOAD_SLICES 16
+
 namespace vis
 {
   struct GLFloat4 {
@@ -146,93 +157,51 @@ namespace vis
   gl::Texture3D* GenerateGradientTexture(StructuredGridVolume* vol, int gradient_sample_size,
     int filter_nxnxn, bool normalized_gradient,
     int init_x, int init_y, int init_z,
-    int last_x, int last_y, int last_z)
+    int last_x, int last_y, int last_z, DerivedDataCache* cache)
   {
     int width = vol->GetWidth();
     int height = vol->GetHeight();
     int depth = vol->GetDepth();
-
-    //1
-    //Generation of gradients
-    int n = gradient_sample_size;
-    glm::dvec3* gradients = new glm::dvec3[width * height * depth];
-    glm::dvec3 s1, s2;
-    int index = 0;
-    for (int z = 0; z < depth; z++)
+    size_t n_gradients = size_t(width) * size_t(height) * size_t(depth);
+    int filter_radius = (filter_nxnxn - 1) / 2;
+
+    //0
+    //Gradients of the same volume and parameters computed at previous runs
+    DerivedDataCacheEntry cached_gradients;
+    unsigned long long cache_key = 0;
+    if (cache && cache->IsEnabled() && vol->GetContentHash() != 0)
     {
-      for (int y = 0; y < height; y++)
-      {
-        for (int x = 0; x < width; x++)
-        {
-          s1.x = vol->GetNormalizedSample(x - n, y, z);
-          s2.x = vol->GetNormalizedSample(x + n, y, z);
-          s1.y = vol->GetNormalizedSample(x, y - n, z);
-          s2.y = vol->GetNormalizedSample(x, y + n, z);
-          s1.z = vol->GetNormalizedSample(x, y, z - n);
-          s2.z = vol->GetNormalizedSample(x, y, z + n);
-
-          glm::dvec3 s2s1 = (s2 - s1);
-
-          if (normalized_gradient)
-          {
-            s2s1 = glm::normalize<double>(s2s1);
-          }
-          else
-          {
-            s2s1.x = s2s1.x / 2.0f * (float)gradient_sample_size;
-            s2s1.y = s2s1.y / 2.0f * (float)gradient_sample_size;
-            s2s1.z = s2s1.z / 2.0f * (float)gradient_sample_size;
-          }
-
-          gradients[index] = s2s1;
-
-          if (gradients[index].x != gradients[index].x) //lm.IsNaN
-            gradients[index] = glm::dvec3(0);
-
-          index++;
-        }
-      }
+      int params[3] = { gradient_sample_size, filter_radius, normalized_gradient ? 1 : 0 };
+      cache_key = DerivedDataCache::GetKey("gradient_central_differences", 1,
+        PreProcessingGraph::HashBytes(params, sizeof(params), vol->GetContentHash()));
+      if (!cache->Load("gradient_central_differences", cache_key, &cached_gradients)
+        || cached_gradients.GetSize() != n_gradients * sizeof(glm::vec3))
+        cached_gradients.Release();
     }
 
-    //2
-    //Filtering
-    n = filter_nxnxn;
-    index = 0;
-    if (n > 0)
+    glm::vec3* gradients = nullptr;
+    if (cached_gradients.IsMapped())
+    {
+      gradients = (glm::vec3*)cached_gradients.GetData();
+    }
+    else
     {
-      for (int z = 0; z < depth; z++)
+      //1
+      //Generation of gradients, already in the texture upload format
+      gradients = new glm::vec3[n_gradients];
+      if (!ComputeCentralDifferenceGradients(vol, gradients, gradient_sample_size, normalized_gradient))
       {
-        for (int y = 0; y < height; y++)
-        {
-          for (int x = 0; x < width; x++)
-          {
-            int fn = (n - 1) / 2;
-
-            glm::dvec3 average = glm::dvec3(0);
-            int num = 0;
-            for (int k = z - fn; k <= z + fn; k++)
-            {
-              for (int j = y - fn; j <= y + fn; j++)
-              {
-                for (int i = x - fn; i <= x + fn; i++)
-                {
-                  if (!vol->IsOutOfBoundary(i, j, k))
-                  {
-                    average += gradients[x + (y * width) + (z * width * height)];
-                    num++;
-                  }
-                }
-              }
-            }
+        delete[] gradients;
+        return NULL;
+      }
 
-            average = average / (double)num;
-            if (average.x != 0.0f && average.y != 0.0f && average.z != 0.0f)
-              average = glm::normalize<double>(average);
+      //2
+      //Filtering: mean of the filter_nxnxn neighborhood, always renormalized
+      if (filter_radius > 0)
+        SmoothGradients(gradients, width, height, depth, filter_radius, 1, true);
 
-            gradients[index++] = average;
-          }
-        }
-      }
+      if (cache_key != 0)
+        cache->Store("gradient_central_differences", cache_key, gradients, n_gradients * sizeof(glm::vec3));
     }
 
     //3
@@ -253,15 +222,22 @@ namespace vis
     int size_x = abs(last_x - init_x);
     int size_y = abs(last_y - init_y);
     int size_z = abs(last_z - init_z);
-    glm::vec3* gradients_values = new glm::vec3[size_x*size_y*size_z];
 
-    for (int k = 0; k < size_z; k++)
+    // The whole volume is uploaded without copies
+    glm::vec3* gradients_values = gradients;
+    if (init_x != 0 || init_y != 0 || init_z != 0 || size_x != width || size_y != height || size_z != depth)
     {
-      for (int j = 0; j < size_y; j++)
+      gradients_values = new glm::vec3[size_t(size_x) * size_t(size_y) * size_t(size_z)];
+#pragma omp parallel for
+      for (int k = 0; k < size_z; k++)
       {
-        for (int i = 0; i < size_x; i++)
+        for (int j = 0; j < size_y; j++)
         {
-          gradients_values[i + (j * size_x) + (k * size_x * size_y)] = gradients[(i + init_x) + ((j + init_y) * width) + ((k + init_z) * width * height)];
+          for (int i = 0; i < size_x; i++)
+          {
+            gradients_values[i + (j * size_x) + (size_t(k) * size_x * size_y)] =
+              gradients[(i + init_x) + ((j + init_y) * width) + (size_t(k + init_z) * width * height)];
+          }
         }
       }
     }
@@ -277,59 +253,47 @@ namespace vis
     tex3d_gradient->SetData((GLvoid*)gradients_values, GL_RGB32F, GL_RGB, GL_FLOAT);
 #endif
 
-    delete[] gradients_values;
-    delete[] gradients;
+    if (gradients_values != gradients) delete[] gradients_values;
+    if (!cached_gradients.IsMapped()) delete[] gradients;
 
     return tex3d_gradient;
   }
 
   // https://en.wikipedia.org/wiki/Sobel_operator  
-  gl::Texture3D* GenerateSobelFeldmanGradientTexture(StructuredGridVolume* vol)
+  gl::Texture3D* GenerateSobelFeldmanGradientTexture(StructuredGridVolume* vol, DerivedDataCache* cache)
   {
     int width = vol->GetWidth();
     int height = vol->GetHeight();
     int depth = vol->GetDepth();
+    size_t n_gradients = size_t(width) * size_t(height) * size_t(depth);
 
-    int n = 1;
-    glm::dvec3* gradients = new glm::dvec3[width * height * depth];
-    for (int z = 0; z < depth; z++)
+    DerivedDataCacheEntry cached_gradients;
+    unsigned long long cache_key = 0;
+    if (cache && cache->IsEnabled() && vol->GetContentHash() != 0)
     {
-      for (int y = 0; y < height; y++)
-      {
-        for (int x = 0; x < width; x++)
-        {
-          glm::dvec3 sg(0.0);
-          for (int v1 = -1; v1 <= 1; v1++)
-          {
-            for (int v2 = -1; v2 <= 1; v2++)
-            {
-              sg.z += ((double)vol->GetNormalizedSample(x + v1, y + v2, z - 1)) * (4.0 / pow(2.0, glm::abs(v1) + glm::abs(v2)))
-                + ((double)vol->GetNormalizedSample(x + v1, y + v2, z + 1)) * (-4.0 / pow(2.0, glm::abs(v1) + glm::abs(v2)));
-
-              sg.y += ((double)vol->GetNormalizedSample(x + v1, y - 1, z + v2)) * (4.0 / pow(2.0, glm::abs(v1) + glm::abs(v2)))
-                + ((double)vol->GetNormalizedSample(x + v1, y + 1, z + v2)) * (-4.0 / pow(2.0, glm::abs(v1) + glm::abs(v2)));
-
-              sg.x += ((double)vol->GetNormalizedSample(x - 1, y + v2, z + v1)) * (4.0 / pow(2.0, glm::abs(v1) + glm::abs(v2)))
-                + ((double)vol->GetNormalizedSample(x + 1, y + v2, z + v1)) * (-4.0 / pow(2.0, glm::abs(v1) + glm::abs(v2)));
-            }
-          }
-
-          // not normalized (for tests...)
-          gradients[x + (y * width) + (z * width * height)] = sg;
-        }
-      }
+      cache_key = DerivedDataCache::GetKey("gradient_sobel_feldman", 1, vol->GetContentHash());
+      if (!cache->Load("gradient_sobel_feldman", cache_key, &cached_gradients)
+        || cached_gradients.GetSize() != n_gradients * sizeof(glm::vec3))
+        cached_gradients.Release();
     }
 
-    glm::vec3* gradients_values = new glm::vec3[width * height * depth];
-    for (int k = 0; k < depth; k++)
+    // not normalized (for tests...)
+    glm::vec3* gradients_values = nullptr;
+    if (cached_gradients.IsMapped())
     {
-      for (int j = 0; j < height; j++)
+      gradients_values = (glm::vec3*)cached_gradients.GetData();
+    }
+    else
+    {
+      gradients_values = new glm::vec3[n_gradients];
+      if (!ComputeSobelFeldmanGradients(vol, gradients_values))
       {
-        for (int i = 0; i < width; i++)
-        {
-          gradients_values[i + (j * width) + (k * width * height)] = gradients[i + (j * width) + (k * width * height)];
-        }
+        delete[] gradients_values;
+        return NULL;
       }
+
+      if (cache_key != 0)
+        cache->Store("gradient_sobel_feldman", cache_key, gradients_values, n_gradients * sizeof(glm::vec3));
     }
 
     //4
@@ -343,12 +307,103 @@ namespace vis
     tex3d_gradient->SetData((GLvoid*)gradients_values, GL_RGB32F, GL_RGB, GL_FLOAT);
 #endif
 
-    delete[] gradients_values;
-    delete[] gradients;
+    if (!cached_gradients.IsMapped()) delete[] gradients_values;
+
+    return tex3d_gradient;
+  }
+
+  gl::Texture3D* GenerateEncodedGradientTexture (StructuredGridVolume* vol, GRADIENT_OPERATOR gradient_operator,
+    int normal_bits, int magnitude_bits, DerivedDataCache* cache)
+  {
+    EncodedGradientField field;
+
+    DerivedDataCacheEntry cached_field;
+    unsigned long long cache_key = 0;
+    if (cache && cache->IsEnabled() && vol->GetContentHash() != 0)
+    {
+      int params[3] = { (int)gradient_operator, normal_bits, magnitude_bits };
+      cache_key = DerivedDataCache::GetKey("gradient_encoded", 1,
+        PreProcessingGraph::HashBytes(params, sizeof(params), vol->GetContentHash()));
+      if (cache->Load("gradient_encoded", cache_key, &cached_field))
+        field.SetEncodedData(cached_field.GetData(), (size_t)cached_field.GetSize(),
+          vol->GetWidth(), vol->GetHeight(), vol->GetDepth(), normal_bits, magnitude_bits);
+      cached_field.Release();
+    }
+
+    if (!field.IsBuilt())
+    {
+      if (!field.Build(vol, gradient_operator, normal_bits, magnitude_bits))
+        return NULL;
+
+      if (cache_key != 0)
+      {
+        std::vector<const void*> buffers;
+        std::vector<unsigned long long> sizes;
+        field.GetEncodedData(&buffers, &sizes);
+        cache->Store("gradient_encoded", cache_key, buffers, sizes);
+      }
+    }
+
+    return GenerateEncodedGradientTexture(&field);
+  }
+
+  gl::Texture3D* GenerateEncodedGradientTexture (EncodedGradientField* field)
+  {
+    if (!field || !field->IsBuilt()) return NULL;
+
+    int width = field->GetWidth();
+    int height = field->GetHeight();
+    int depth = field->GetDepth();
+
+    gl::Texture3D* tex3d_gradient = new gl::Texture3D(width, height, depth);
+    tex3d_gradient->GenerateTexture(TEXTURE_FILTER, TEXTURE_FILTER, TEXTURE_WRAP, TEXTURE_WRAP, TEXTURE_WRAP);
+
+#ifdef USE_16F_INTERNAL_FORMAT
+    tex3d_gradient->SetData(NULL, GL_RGB16F, GL_RGB, GL_FLOAT);
+#else
+    tex3d_gradient->SetData(NULL, GL_RGB32F, GL_RGB, GL_FLOAT);
+#endif
+
+    int chunk_slices = std::min(ENCODED_GRADIENT_UPLOAD_SLICES, depth);
+    glm::vec3* chunk = new glm::vec3[size_t(width) * size_t(height) * size_t(chunk_slices)];
+    for (int z = 0; z < depth; z += chunk_slices)
+    {
+      int z_end = std::min(z + chunk_slices, depth);
+      field->DecodeSlices(chunk, z, z_end);
+      tex3d_gradient->SetSubData((GLvoid*)chunk, 0, 0, z, width, height, z_end - z, GL_RGB, GL_FLOAT);
+    }
+    delete[] chunk;
 
     return tex3d_gradient;
   }
 
+  gl::Texture3D* GenerateCubicSplineCoefficientTexture (StructuredGridVolume* vol, IMAGE_FILTER_KERNEL kernel)
+  {
+    if (!vol) return NULL;
+
+    int width = vol->GetWidth();
+    int height = vol->GetHeight();
+    int depth = vol->GetDepth();
+
+    GLfloat* coefficients = new GLfloat[size_t(width) * size_t(height) * size_t(depth)];
+    if (!ComputeCubicSplineCoefficients(vol, coefficients, kernel))
+    {
+      delete[] coefficients;
+      return NULL;
+    }
+
+    // Mirrored repeat is the same border extension used by the prefilter
+    gl::Texture3D* tex3d_coefficients = new gl::Texture3D(width, height, depth);
+    tex3d_coefficients->GenerateTexture(GL_LINEAR, GL_LINEAR, GL_MIRRORED_REPEAT, GL_MIRRORED_REPEAT, GL_MIRRORED_REPEAT);
+    // Coefficients are not limited to [0, 1]: always 32 bits floats
+    tex3d_coefficients->SetData((GLvoid*)coefficients, GL_R32F, GL_RED, GL_FLOAT);
+    gl::ExitOnGLError("ERROR: After SetData");
+
+    delete[] coefficients;
+
+    return tex3d_coefficients;
+  }
+
   gl::Texture2D* GenerateNoiseTexture(float maxvalue, int w, int h)
   {
     std::default_random_engine generator;
@@ -372,82 +427,194 @@ namespace vis
 
   void GenerateSyntheticVolumetricModels(int d, float s)
   {
-    std::ofstream gaussianvol_file;
-    gaussianvol_file.open("synthetic_gaussianvol_file.syn");
-    if (gaussianvol_file.is_open())
+    // Single gaussian at the center of the volume, written as a .raw file
+    unsigned char* gaussianvol_data = new unsigned char[size_t(d) * size_t(d) * size_t(d)];
+#pragma omp parallel for
+    for (int z = 0; z < d; z++)
     {
-      gaussianvol_file << d << " " << d << " " << d << "\n";
-      for (int x = 0; x < d; x++)
+      for (int y = 0; y < d; y++)
       {
-        for (int y = 0; y < d; y++)
+        for (int x = 0; x < d; x++)
         {
-          for (int z = 0; z < d; z++)
-          {
-            float dx = x - (d / 2);
-            float dy = y - (d / 2);
-            float dz = z - (d / 2);
-            float val = glm::exp(-(dx*dx + dy * dy + dz * dz) / (2.0f * s * s));
-            gaussianvol_file << "0 " << x << " " << y << " " << z << " " << int(val * 255.0f) << "\n";
-          }
+          float dx = x - (d / 2);
+          float dy = y - (d / 2);
+          float dz = z - (d / 2);
+          float val = glm::exp(-(dx*dx + dy * dy + dz * dz) / (2.0f * s * s));
+          gaussianvol_data[size_t(x) + size_t(y) * d + size_t(z) * d * d] = (unsigned char)(int(val * 255.0f));
         }
       }
-      gaussianvol_file.close();
     }
+
+    StructuredGridVolume gaussianvol("synthetic_gaussianvol_file", d, d, d);
+    gaussianvol.SetArrayData(gaussianvol_data, DataStorageSize::_8_BITS);
+    SyntheticVolumeGenerator::WriteRawFile(&gaussianvol, "synthetic_gaussianvol_file");
   }
 
-  gl::Texture3D* GenerateExtinctionSAT3DTex(StructuredGridVolume* vol, TransferFunction* tf)
+  template<typename T>
+  static void RemapThroughLookupTable (const T* values, const float* lut, size_t slice_size, int depth,
+                                       float* extinction)
   {
-    // 1
-    // First, sample the initial "grid" and build SAT
-    vis::SummedAreaTable3D<double> sat3d(vol->GetWidth(), vol->GetHeight(), vol->GetDepth());
-    for (int x = 0; x < vol->GetWidth(); x++)
+#pragma omp parallel for schedule(static)
+    for (int z = 0; z < depth; z++)
     {
-      for (int y = 0; y < vol->GetHeight(); y++)
+      const T* in = values + size_t(z) * slice_size;
+      float* out = extinction + size_t(z) * slice_size;
+      for (size_t i = 0; i < slice_size; i++)
+        out[i] = lut[in[i]];
+    }
+  }
+
+  bool ComputeExtinctionVolume (StructuredGridVolume* vol, TransferFunction* tf, float* extinction)
+  {
+    if (!vol || !tf || !extinction || !vol->GetArrayData()) return false;
+
+    int w = vol->GetWidth(), h = vol->GetHeight(), d = vol->GetDepth();
+    size_t slice_size = size_t(w) * size_t(h);
+
+    DataStorageSize dss = vol->GetDataStorageSize();
+    if (dss == DataStorageSize::_8_BITS || dss == DataStorageSize::_16_BITS)
+    {
+      int n_values = dss == DataStorageSize::_8_BITS ? 256 : 65536;
+      float* lut = new float[n_values];
+      tf->GetExtinctionLookupTable(n_values, lut);
+      if (dss == DataStorageSize::_8_BITS)
+        RemapThroughLookupTable(static_cast<const unsigned char*>(vol->GetArrayData()), lut, slice_size, d, extinction);
+      else
+        RemapThroughLookupTable(static_cast<const unsigned short*>(vol->GetArrayData()), lut, slice_size, d, extinction);
+      delete[] lut;
+      return true;
+    }
+
+    // Float volumes: one transfer function evaluation per voxel
+    // . builds the transfer function before the parallel loop
+    tf->GetExtN(0.0);
+#pragma omp parallel for schedule(static)
+    for (int z = 0; z < d; z++)
+      for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+          extinction[x + (y * w) + (size_t(z) * slice_size)] = tf->GetExtN(vol->GetNormalizedSample(x, y, z));
+    return true;
+  }
+
+  bool ComputeExtinctionSAT (StructuredGridVolume* vol, TransferFunction* tf,
+    int cells_w, int cells_h, int cells_d, float* sat, DerivedDataCache* cache)
+  {
+    if (!vol || !tf || !sat || !vol->GetArrayData()) return false;
+    if (cells_w < 1 || cells_h < 1 || cells_d < 1 || cells_w > (int)vol->GetWidth()
+      || cells_h > (int)vol->GetHeight() || cells_d > (int)vol->GetDepth())
+      return false;
+
+    int sat_w = cells_w + 2;
+    int sat_h = cells_h + 2;
+    int sat_d = cells_d + 2;
+    size_t sat_size = size_t(sat_w) * size_t(sat_h) * size_t(sat_d);
+
+    // SAT of the same volume, transfer function and resolution computed at
+    //  previous runs
+    unsigned long long cache_key = 0;
+    if (cache && cache->IsEnabled() && vol->GetContentHash() != 0 && tf->GetExtinctionHash() != 0)
+    {
+      int dims[3] = { cells_w, cells_h, cells_d };
+      unsigned long long inputs = PreProcessingGraph::HashValue(tf->GetExtinctionHash(), vol->GetContentHash());
+      cache_key = DerivedDataCache::GetKey("ebs_extinction_sat", 2, PreProcessingGraph::HashBytes(dims, sizeof(dims), inputs));
+
+      DerivedDataCacheEntry cached_sat;
+      if (cache->Load("ebs_extinction_sat", cache_key, &cached_sat) && cached_sat.GetSize() == sat_size * sizeof(float))
       {
-        for (int z = 0; z < vol->GetDepth(); z++)
-        {
-          double val = tf->GetExt(vol->GetNormalizedSample(x, y, z), true);
-          sat3d.SetValue(val, x, y, z);
-        }
+        const float* cached_data = static_cast<const float*>(cached_sat.GetData());
+        std::copy(cached_data, cached_data + sat_size, sat);
+        return true;
       }
     }
-    sat3d.BuildSAT();
-
-    // 2
-    // Then, we must create and generate the 3D texture
-    GLfloat* diff_mat = new GLfloat[vol->GetWidth() * vol->GetHeight() * vol->GetDepth()];
-    double* sat_data = sat3d.GetData();
 
-    //*
-    for (int i = 0; i < vol->GetWidth() * vol->GetHeight() * vol->GetDepth(); i++)
-      diff_mat[i] = (GLfloat)sat_data[i];
-    // */
+    float* extinction = new float[size_t(cells_w) * size_t(cells_h) * size_t(cells_d)];
+    DownsampleExtinctionVolume(vol, tf, cells_w, cells_h, cells_d, extinction);
+    // Sums are kept in voxel units, independent of the SAT resolution
+    double voxels_per_cell = (double(vol->GetWidth()) / cells_w) * (double(vol->GetHeight()) / cells_h)
+                           * (double(vol->GetDepth()) / cells_d);
 
-    /*
-    for (int x = 0; x < vol->GetWidth(); x++)
+    // Accumulated in double, written directly as float (texture data)
+    double total = 0.0;
+    for (int z = 0; z < sat_d; z++)
     {
-      for (int y = 0; y < vol->GetHeight(); y++)
+      for (int y = 0; y < sat_h; y++)
       {
-        for (int z = 0; z < vol->GetDepth(); z++)
+        for (int x = 0; x < sat_w; x++)
         {
-          int i = x + (y * vol->GetWidth()) + (z * vol->GetWidth() * vol->GetHeight());
-          double sd = sat_data[i] / double((x+1)*(y+1)*(z+1));
-          diff_mat[i] = sd;
+          double val;
+          // Adding borders to handle precision issues
+          //
+          // 0 0 0 0 0 0     0 S S S S S
+          // 0         0     0         S
+          // 0         0 --> 0         S
+          // 0         0     0         S
+          // 0 0 0 0 0 0     0 0 0 0 0 0
+          //
+          if (x == 0 || y == 0 || z == 0 || x == sat_w - 1 || y == sat_h - 1 || z == sat_d - 1)
+            val = 0.0f;
+          else
+          {
+            val = extinction[(x - 1) + (y - 1) * cells_w + size_t(z - 1) * cells_w * cells_h] * voxels_per_cell;
+          }
+          sat[x + y * sat_w + size_t(z) * sat_w * sat_h] = (float)val;
+          total += val;
         }
       }
     }
-    // */
+    delete[] extinction;
+    // Sums of (value - mean): the far corner is close to zero and box sums keep
+    //  the float precision of their own size
+    BuildFloatSummedAreaTable3D(sat, sat_w, sat_h, sat_d, (float)(total / double(sat_size)));
+
+    if (cache_key != 0)
+      cache->Store("ebs_extinction_sat", cache_key, sat, sat_size * sizeof(float));
+    return true;
+  }
+
+  double GetExtinctionSATOffset (const float* sat)
+  {
+    // zero border value: 0 - offset
+    return -(double)sat[0];
+  }
+
+  gl::Texture3D* GenerateExtinctionSAT3DTex (StructuredGridVolume* vol, TransferFunction* tf,
+    int cells_w, int cells_h, int cells_d, DerivedDataCache* cache)
+  {
+    if (!vol || !tf) return NULL;
+
+    // 1
+    // SAT resolution, then the SAT itself
+    cells_w = (cells_w <= 0) ? (int)vol->GetWidth()  : std::min(cells_w, (int)vol->GetWidth());
+    cells_h = (cells_h <= 0) ? (int)vol->GetHeight() : std::min(cells_h, (int)vol->GetHeight());
+    cells_d = (cells_d <= 0) ? (int)vol->GetDepth()  : std::min(cells_d, (int)vol->GetDepth());
+    int sat_w = cells_w + 2, sat_h = cells_h + 2, sat_d = cells_d + 2;
+
+    GLfloat* sat_data = new GLfloat[size_t(sat_w) * size_t(sat_h) * size_t(sat_d)];
+    if (!ComputeExtinctionSAT(vol, tf, cells_w, cells_h, cells_d, sat_data, cache))
+    {
+      delete[] sat_data;
+      return NULL;
+    }
 
-    gl::Texture3D* tex3d_sat = new gl::Texture3D(vol->GetWidth(), vol->GetHeight(), vol->GetDepth());
+    // 2
+    // Then, we must create and generate the 3D texture
+    gl::Texture3D* tex3d_sat = new gl::Texture3D(sat_w, sat_h, sat_d);
     tex3d_sat->GenerateTexture(GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+    tex3d_sat->SetData((GLvoid*)sat_data, GL_R32F, GL_RED, GL_FLOAT);
 
-#ifdef USE_16F_INTERNAL_FORMAT
-    tex3d_sat->SetData((GLvoid*)diff_mat, GL_R16F, GL_RED, GL_FLOAT);
-#else
-    tex3d_sat->SetData((GLvoid*)diff_mat, GL_R32F, GL_RED, GL_FLOAT);
-#endif
+    delete[] sat_data;
 
-    delete[] diff_mat;
+    gl::ExitOnGLError("volrend/utils.cpp - GenerateExtinctionSAT3DTex()");
+    return tex3d_sat;
+  }
+
+  gl::Texture3D* GenerateExtinctionSAT3DTex (SummedAreaTable3D<float>* sat)
+  {
+    if (!sat) return NULL;
+
+    gl::Texture3D* tex3d_sat = new gl::Texture3D(sat->w, sat->h, sat->d);
+    tex3d_sat->GenerateTexture(GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+    tex3d_sat->SetData((GLvoid*)sat->GetData(), GL_R32F, GL_RED, GL_FLOAT);
 
     gl::ExitOnGLError("volrend/utils.cpp - GenerateExtinctionSAT3DTex()");
     return tex3d_sat;
@@ -455,38 +622,425 @@ namespace vis
 
   gl::Texture3D* GenerateScalarFieldSAT3DTex (StructuredGridVolume* vol)
   {
+    int w = vol->GetWidth(), h = vol->GetHeight(), d = vol->GetDepth();
+
     // 1
     // First, sample the initial "grid" and build SAT
-    vis::SummedAreaTable3D<double> sat3d(vol->GetWidth(), vol->GetHeight(), vol->GetDepth());
-    for (int x = 0; x < vol->GetWidth(); x++)
+    GLfloat* sat_data = new GLfloat[size_t(w) * size_t(h) * size_t(d)];
+    for (int z = 0; z < d; z++)
+      for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+          sat_data[x + (y * w) + (size_t(z) * w * h)] = (GLfloat)vol->GetNormalizedSample(x, y, z);
+    vis::BuildFloatSummedAreaTable3D(sat_data, w, h, d);
+
+    // 2
+    // Then, we must create and generate the 3D texture
+    gl::Texture3D* tex3d_sat = new gl::Texture3D(w, h, d);
+    tex3d_sat->GenerateTexture(GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+
+    tex3d_sat->SetData((GLvoid*)sat_data, GL_R32F, GL_RED, GL_FLOAT);
+
+    delete[] sat_data;
+
+    gl::ExitOnGLError("volrend/utils.cpp - GenerateScalarFieldSAT3DTex()");
+    return tex3d_sat;
+
+  }
+
+  void BenchmarkExtinctionSAT (StructuredGridVolume* vol, TransferFunction* tf, int n_queries)
+  {
+    if (!vol || !tf) return;
+    printf("Started  -> Benchmark Extinction SAT\n");
+
+    int w = vol->GetWidth(), h = vol->GetHeight(), d = vol->GetDepth();
+    size_t n_voxels = size_t(w) * size_t(h) * size_t(d);
+    float* extinction = new float[n_voxels];
+    ComputeExtinctionVolume(vol, tf, extinction);
+
+    // Reference: double SAT
+    auto t0 = std::chrono::steady_clock::now();
+    vis::SummedAreaTable3D<double> sat_double(w, h, d);
+    double* double_data = sat_double.GetData();
+    for (size_t i = 0; i < n_voxels; i++) double_data[i] = (double)extinction[i];
+    sat_double.BuildSAT();
+    auto t1 = std::chrono::steady_clock::now();
+
+    // Float SAT of the plain values
+    float* sat_float = new float[n_voxels];
+    std::copy(extinction, extinction + n_voxels, sat_float);
+    vis::BuildFloatSummedAreaTable3D(sat_float, w, h, d);
+    auto t2 = std::chrono::steady_clock::now();
+
+    // Float SAT of (value - mean), as uploaded to the GPU (ComputeExtinctionSAT)
+    float mean = (float)(sat_double.GetValue(w - 1, h - 1, d - 1) / double(n_voxels));
+    float* sat_centered = new float[n_voxels];
+    std::copy(extinction, extinction + n_voxels, sat_centered);
+    vis::BuildFloatSummedAreaTable3D(sat_centered, w, h, d, mean);
+
+    // Random boxes
+    std::default_random_engine generator;
+    std::uniform_int_distribution<int> rx(0, w - 1), ry(0, h - 1), rz(0, d - 1);
+    auto float_query = [&](const float* sat, int x0, int y0, int z0, int x1, int y1, int z1) -> double {
+      auto value = [&](int x, int y, int z) -> double {
+        if (x < 0 || y < 0 || z < 0) return 0.0;
+        return (double)sat[x + (y * w) + (size_t(z) * w * h)];
+      };
+      return value(x1, y1, z1)
+        - value(x0 - 1, y1, z1) - value(x1, y0 - 1, z1) - value(x1, y1, z0 - 1)
+        + value(x0 - 1, y0 - 1, z1) + value(x0 - 1, y1, z0 - 1) + value(x1, y0 - 1, z0 - 1)
+        - value(x0 - 1, y0 - 1, z0 - 1);
+    };
+    double max_err_float = 0.0, max_rel_float = 0.0;
+    double max_err_centered = 0.0, max_rel_centered = 0.0;
+    for (int i = 0; i < n_queries; i++)
     {
-      for (int y = 0; y < vol->GetHeight(); y++)
+      int x0 = rx(generator), x1 = rx(generator);
+      int y0 = ry(generator), y1 = ry(generator);
+      int z0 = rz(generator), z1 = rz(generator);
+      if (x0 > x1) std::swap(x0, x1);
+      if (y0 > y1) std::swap(y0, y1);
+      if (z0 > z1) std::swap(z0, z1);
+
+      double ref = sat_double.Query(x0, y0, z0, x1, y1, z1);
+      double vf = float_query(sat_float, x0, y0, z0, x1, y1, z1);
+      double vc = float_query(sat_centered, x0, y0, z0, x1, y1, z1)
+        + (double)mean * double(x1 - x0 + 1) * double(y1 - y0 + 1) * double(z1 - z0 + 1);
+
+      max_err_float = std::max(max_err_float, std::abs(vf - ref));
+      max_err_centered = std::max(max_err_centered, std::abs(vc - ref));
+      if (ref > 0.0)
       {
-        for (int z = 0; z < vol->GetDepth(); z++)
+        max_rel_float = std::max(max_rel_float, std::abs(vf - ref) / ref);
+        max_rel_centered = std::max(max_rel_centered, std::abs(vc - ref) / ref);
+      }
+    }
+
+    double mb = 1.0 / (1024.0 * 1024.0);
+    printf("  - Volume Size: [%d, %d, %d], %d box queries\n", w, h, d, n_queries);
+    printf("  - Double SAT : %.1f MB (+ %.1f MB float upload copy), %.2f ms\n",
+      double(n_voxels * sizeof(double)) * mb, double(n_voxels * sizeof(float)) * mb,
+      std::chrono::duration<double, std::milli>(t1 - t0).count());
+    printf("  - Float SAT  : %.1f MB, %.2f ms, max error %g (relative %g)\n",
+      double(n_voxels * sizeof(float)) * mb,
+      std::chrono::duration<double, std::milli>(t2 - t1).count(), max_err_float, max_rel_float);
+    printf("  - Float SAT (value - mean %g): max error %g (relative %g)\n",
+      mean, max_err_centered, max_rel_centered);
+
+    delete[] sat_centered;
+    delete[] sat_float;
+    delete[] extinction;
+    printf("Finished -> Benchmark Extinction SAT\n");
+  }
+
+  // Box filter weights of each input voxel into n_out cells of n_in / n_out
+  //  voxels: voxel i goes to cell "cell[i]" with weight "w0[i]" and to the
+  //  next cell with weight "w1[i]" (weights are divided by the cell length)
+  static void BoxFilterWeights (int n_in, int n_out, std::vector<int>& cell,
+                                std::vector<double>& w0, std::vector<double>& w1)
+  {
+    double c = double(n_in) / double(n_out);
+    cell.resize(n_in); w0.resize(n_in); w1.resize(n_in);
+    for (int i = 0; i < n_in; i++)
+    {
+      int o = std::min((int)(double(i) / c), n_out - 1);
+      double b = double(o + 1) * c;
+      cell[i] = o;
+      if (b >= double(i + 1) || o == n_out - 1)
+      {
+        w0[i] = 1.0 / c;
+        w1[i] = 0.0;
+      }
+      else
+      {
+        w0[i] = (b - double(i)) / c;
+        w1[i] = (double(i + 1) - b) / c;
+      }
+    }
+  }
+
+  bool DownsampleExtinctionVolume (StructuredGridVolume* vol, TransferFunction* tf,
+    int out_w, int out_h, int out_d, float* extinction)
+  {
+    if (!vol || !tf || !extinction) return false;
+
+    int w = vol->GetWidth(), h = vol->GetHeight(), d = vol->GetDepth();
+    out_w = std::max(1, std::min(out_w, w));
+    out_h = std::max(1, std::min(out_h, h));
+    out_d = std::max(1, std::min(out_d, d));
+    if (out_w == w && out_h == h && out_d == d)
+      return ComputeExtinctionVolume(vol, tf, extinction);
+
+    std::vector<int> cx, cy, cz;
+    std::vector<double> wx0, wx1, wy0, wy1, wz0, wz1;
+    BoxFilterWeights(w, out_w, cx, wx0, wx1);
+    BoxFilterWeights(h, out_h, cy, wy0, wy1);
+    BoxFilterWeights(d, out_d, cz, wz0, wz1);
+
+    // Input slices of each output slice
+    std::vector<int> z_first(out_d, d), z_last(out_d, -1);
+    for (int z = 0; z < d; z++)
+    {
+      z_first[cz[z]] = std::min(z_first[cz[z]], z);
+      z_last[cz[z]] = std::max(z_last[cz[z]], z);
+      if (wz1[z] > 0.0)
+      {
+        z_first[cz[z] + 1] = std::min(z_first[cz[z] + 1], z);
+        z_last[cz[z] + 1] = std::max(z_last[cz[z] + 1], z);
+      }
+    }
+
+    // Extinction at full resolution (lookup table remap)
+    float* voxel_extinction = new float[size_t(w) * size_t(h) * size_t(d)];
+    ComputeExtinctionVolume(vol, tf, voxel_extinction);
+
+    size_t out_slice_size = size_t(out_w) * size_t(out_h);
+#pragma omp parallel
+    {
+      std::vector<double> row(out_w), cells(out_slice_size);
+#pragma omp for schedule(dynamic)
+      for (int oz = 0; oz < out_d; oz++)
+      {
+        std::fill(cells.begin(), cells.end(), 0.0);
+        for (int z = z_first[oz]; z <= z_last[oz]; z++)
         {
-          double val = (double)vol->GetNormalizedSample(x, y, z);
-          sat3d.SetValue(val, x, y, z);
+          double wz = (cz[z] == oz) ? wz0[z] : wz1[z];
+          for (int y = 0; y < h; y++)
+          {
+            std::fill(row.begin(), row.end(), 0.0);
+            const float* in = voxel_extinction + size_t(z) * w * h + size_t(y) * w;
+            for (int x = 0; x < w; x++)
+            {
+              double e = (double)in[x];
+              row[cx[x]] += wx0[x] * e;
+              if (wx1[x] > 0.0) row[cx[x] + 1] += wx1[x] * e;
+            }
+            double* c0 = cells.data() + size_t(cy[y]) * out_w;
+            for (int x = 0; x < out_w; x++)
+              c0[x] += wy0[y] * wz * row[x];
+            if (wy1[y] > 0.0)
+            {
+              double* c1 = c0 + out_w;
+              for (int x = 0; x < out_w; x++)
+                c1[x] += wy1[y] * wz * row[x];
+            }
+          }
         }
+        float* out = extinction + size_t(oz) * out_slice_size;
+        for (size_t i = 0; i < out_slice_size; i++)
+          out[i] = (float)cells[i];
       }
     }
-    sat3d.BuildSAT();
 
-    // 2
-    // Then, we must create and generate the 3D texture
-    GLfloat* diff_mat = new GLfloat[vol->GetWidth() * vol->GetHeight() * vol->GetDepth()];
-    double* sat_data = sat3d.GetData();
-    for (int i = 0; i < vol->GetWidth() * vol->GetHeight() * vol->GetDepth(); i++)
-      diff_mat[i] = (GLfloat)sat_data[i];
+    delete[] voxel_extinction;
+    return true;
+  }
 
-    gl::Texture3D* tex3d_sat = new gl::Texture3D(vol->GetWidth(), vol->GetHeight(), vol->GetDepth());
-    tex3d_sat->GenerateTexture(GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+  void BenchmarkReducedExtinctionSAT (StructuredGridVolume* vol, TransferFunction* tf,
+    int sat_w, int sat_h, int sat_d, int n_queries)
+  {
+    if (!vol || !tf) return;
+    printf("Started  -> Benchmark Reduced Extinction SAT\n");
+
+    int w = vol->GetWidth(), h = vol->GetHeight(), d = vol->GetDepth();
+    sat_w = std::max(1, std::min(sat_w, w));
+    sat_h = std::max(1, std::min(sat_h, h));
+    sat_d = std::max(1, std::min(sat_d, d));
+
+    // Full resolution: reference box sums
+    auto t0 = std::chrono::steady_clock::now();
+    size_t n_voxels = size_t(w) * size_t(h) * size_t(d);
+    float* full_extinction = new float[n_voxels];
+    ComputeExtinctionVolume(vol, tf, full_extinction);
+    vis::SummedAreaTable3D<double> sat_full(w, h, d);
+    double* full_data = sat_full.GetData();
+    for (size_t i = 0; i < n_voxels; i++) full_data[i] = (double)full_extinction[i];
+    delete[] full_extinction;
+    sat_full.BuildSAT();
+    auto t1 = std::chrono::steady_clock::now();
+
+    // Reduced resolution: sums in voxel units (mean * voxels per cell)
+    size_t n_cells = size_t(sat_w) * size_t(sat_h) * size_t(sat_d);
+    float* extinction = new float[n_cells];
+    DownsampleExtinctionVolume(vol, tf, sat_w, sat_h, sat_d, extinction);
+    glm::dvec3 cell_size(double(w) / sat_w, double(h) / sat_h, double(d) / sat_d);
+    double voxels_per_cell = cell_size.x * cell_size.y * cell_size.z;
+    vis::SummedAreaTable3D<double> sat_reduced(sat_w, sat_h, sat_d);
+    double* reduced_data = sat_reduced.GetData();
+    for (size_t i = 0; i < n_cells; i++)
+      reduced_data[i] = (double)extinction[i] * voxels_per_cell;
+    sat_reduced.BuildSAT();
+    auto t2 = std::chrono::steady_clock::now();
+
+    // Same SAT as stored for the renderer: float, 1-cell border, value - mean
+    vis::SummedAreaTable3D<float> sat_stored(sat_w + 2, sat_h + 2, sat_d + 2);
+    ComputeExtinctionSAT(vol, tf, sat_w, sat_h, sat_d, sat_stored.GetData());
+    sat_stored.SetOffset(GetExtinctionSATOffset(sat_stored.GetData()));
 
-    tex3d_sat->SetData((GLvoid*)diff_mat, GL_R32F, GL_RED, GL_FLOAT);
+    std::default_random_engine generator;
+    std::uniform_int_distribution<int> rx(0, w - 1), ry(0, h - 1), rz(0, d - 1);
+    std::uniform_int_distribution<int> rr(1, std::max(1, std::max(w, std::max(h, d)) / 8));
+    double max_err = 0.0, sum_rel = 0.0, max_rel = 0.0;
+    double max_err_stored = 0.0, sum_rel_stored = 0.0, max_rel_stored = 0.0;
+    int n_rel = 0;
+    for (int i = 0; i < n_queries; i++)
+    {
+      int r = rr(generator);
+      int cxq = rx(generator), cyq = ry(generator), czq = rz(generator);
+      int x0 = std::max(cxq - r, 0), x1 = std::min(cxq + r, w - 1);
+      int y0 = std::max(cyq - r, 0), y1 = std::min(cyq + r, h - 1);
+      int z0 = std::max(czq - r, 0), z1 = std::min(czq + r, d - 1);
+
+      double ref = sat_full.Query(x0, y0, z0, x1, y1, z1);
+      // Box in cell units (trilinear prefix sums, exact for the box filtered extinction)
+      glm::dvec3 p0 = glm::dvec3(x0, y0, z0) / cell_size;
+      glm::dvec3 p1 = glm::dvec3(x1 + 1, y1 + 1, z1 + 1) / cell_size;
+      double est = sat_reduced.QueryFractional(p0.x, p0.y, p0.z, p1.x, p1.y, p1.z);
+      double est_stored = sat_stored.QueryFractional(p0.x + 1.0, p0.y + 1.0, p0.z + 1.0,
+                                                     p1.x + 1.0, p1.y + 1.0, p1.z + 1.0);
+
+      double err = std::abs(est - ref);
+      double err_stored = std::abs(est_stored - ref);
+      max_err = std::max(max_err, err);
+      max_err_stored = std::max(max_err_stored, err_stored);
+      if (ref > 1e-6)
+      {
+        sum_rel += err / ref;
+        max_rel = std::max(max_rel, err / ref);
+        sum_rel_stored += err_stored / ref;
+        max_rel_stored = std::max(max_rel_stored, err_stored / ref);
+        n_rel++;
+      }
+    }
 
-    delete[] diff_mat;
+    double mb = 1.0 / (1024.0 * 1024.0);
+    size_t full_bytes = size_t(w + 2) * size_t(h + 2) * size_t(d + 2) * sizeof(float);
+    size_t reduced_bytes = size_t(sat_w + 2) * size_t(sat_h + 2) * size_t(sat_d + 2) * sizeof(float);
+    printf("  - Volume Size   : [%d, %d, %d], %d box queries\n", w, h, d, n_queries);
+    printf("  - Full SAT      : %.1f MB texture, %.2f ms\n", double(full_bytes) * mb,
+      std::chrono::duration<double, std::milli>(t1 - t0).count());
+    printf("  - Reduced SAT   : [%d, %d, %d], %.1f MB texture, %.2f ms\n", sat_w, sat_h, sat_d,
+      double(reduced_bytes) * mb, std::chrono::duration<double, std::milli>(t2 - t1).count());
+    printf("  - Box Sum Error : max %g, mean relative %g, max relative %g\n", max_err,
+      n_rel > 0 ? sum_rel / n_rel : 0.0, max_rel);
+    printf("  - Stored (float): max %g, mean relative %g, max relative %g\n", max_err_stored,
+      n_rel > 0 ? sum_rel_stored / n_rel : 0.0, max_rel_stored);
+
+    delete[] extinction;
+    printf("Finished -> Benchmark Reduced Extinction SAT\n");
+  }
 
-    gl::ExitOnGLError("volrend/utils.cpp - GenerateScalarFieldSAT3DTex()");
-    return tex3d_sat;
+  bool WriteChunkedVolume (StructuredGridVolume* vol, std::string output_filepath, unsigned int chunk_size)
+  {
+    if (!vol || !vol->GetArrayData()) return false;
+
+    unsigned int bytes_per_voxel = 0;
+    if (vol->GetDataStorageSize() == DataStorageSize::_8_BITS)
+      bytes_per_voxel = sizeof(unsigned char);
+    else if (vol->GetDataStorageSize() == DataStorageSize::_16_BITS)
+      bytes_per_voxel = sizeof(unsigned short);
+    else if (vol->GetDataStorageSize() == DataStorageSize::_NORMALIZED_F)
+      bytes_per_voxel = sizeof(float);
+    else
+    {
+      printf("  - Storage type not supported by .cvol files\n");
+      return false;
+    }
+
+    return ChunkedVolumeFile::Write(output_filepath.c_str(), vol->GetArrayData(),
+      vol->GetWidth(), vol->GetHeight(), vol->GetDepth(), bytes_per_voxel,
+      vol->GetScaleX(), vol->GetScaleY(), vol->GetScaleZ(), chunk_size);
+  }
+
+  bool ConvertToChunkedVolume (std::string input_filepath, std::string output_filepath, unsigned int chunk_size)
+  {
+    vis::VolumeReader vr;
+    StructuredGridVolume* vol = vr.ReadStructuredVolume(input_filepath);
+    if (!vol) return false;
+
+    bool ret = WriteChunkedVolume(vol, output_filepath, chunk_size);
+    delete vol;
+
+    return ret;
+  }
+
+  bool ConvertToPVMFile (std::string input_filepath, std::string output_filepath, bool dds_compressed)
+  {
+    vis::VolumeReader vr;
+    StructuredGridVolume* vol = vr.ReadStructuredVolume(input_filepath);
+    if (!vol) return false;
+
+    bool ret = vol->ExportPVMFile(output_filepath, dds_compressed);
+    delete vol;
+
+    return ret;
+  }
+
+  int ConvertToPVMFiles (std::vector<std::string> input_filepaths, bool dds_compressed)
+  {
+    int n_converted = 0;
+    for (size_t i = 0; i < input_filepaths.size(); i++)
+    {
+      std::string output_filepath = input_filepaths[i].substr(0, input_filepaths[i].find_last_of('.')) + ".pvm";
+      if (output_filepath.compare(input_filepaths[i]) == 0)
+      {
+        printf("  - Skipping %s: input is already a .pvm file\n", input_filepaths[i].c_str());
+        continue;
+      }
+      if (ConvertToPVMFile(input_filepaths[i], output_filepath, dds_compressed))
+        n_converted++;
+    }
+    return n_converted;
+  }
+
+  void BenchmarkChunkedVolume (std::string input_filepath, unsigned int chunk_size)
+  {
+    printf("Started  -> Benchmark Chunked Volume\n");
+    vis::VolumeReader vr;
+
+    auto t0 = std::chrono::steady_clock::now();
+    StructuredGridVolume* in_vol = vr.ReadStructuredVolume(input_filepath);
+    auto t1 = std::chrono::steady_clock::now();
+    if (!in_vol)
+    {
+      printf("Finished -> Error on reading input volume\n");
+      return;
+    }
+
+    std::string cvol_filepath = input_filepath + ".cvol";
+    bool written = WriteChunkedVolume(in_vol, cvol_filepath, chunk_size);
+    auto t2 = std::chrono::steady_clock::now();
+    if (!written)
+    {
+      delete in_vol;
+      printf("Finished -> Error on writing .cvol file\n");
+      return;
+    }
 
+    StructuredGridVolume* cvol_vol = vr.ReadStructuredVolume(cvol_filepath);
+    auto t3 = std::chrono::steady_clock::now();
+
+    // Region of interest: central block with half of the resolution per axis
+    glm::uvec3 vsize(in_vol->GetWidth(), in_vol->GetHeight(), in_vol->GetDepth());
+    glm::uvec3 roi_min = vsize / 4u;
+    glm::uvec3 roi_max = glm::max(roi_min + vsize / 2u, roi_min + 1u);
+    StructuredGridVolume* roi_vol = vr.ReadChunkedVolumeRegion(cvol_filepath, roi_min, roi_max);
+    auto t4 = std::chrono::steady_clock::now();
+
+    ChunkedVolumeFile cvol;
+    cvol.Open(cvol_filepath.c_str());
+    unsigned long long raw_bytes = (unsigned long long)vsize.x * vsize.y * vsize.z * cvol.GetBytesPerVoxel();
+
+    printf("  - Input Read       : %.2f ms\n", std::chrono::duration<double, std::milli>(t1 - t0).count());
+    printf("  - .cvol Write      : %.2f ms\n", std::chrono::duration<double, std::milli>(t2 - t1).count());
+    printf("  - .cvol Read       : %.2f ms\n", std::chrono::duration<double, std::milli>(t3 - t2).count());
+    printf("  - .cvol ROI Read   : %.2f ms (1/8 of the volume)\n", std::chrono::duration<double, std::milli>(t4 - t3).count());
+    printf("  - Raw Size         : %llu bytes\n", raw_bytes);
+    printf("  - .cvol Size       : %llu bytes (%.2f%%)\n", cvol.GetCompressedSize(), 100.0 * double(cvol.GetCompressedSize()) / double(raw_bytes));
+    printf("  - Checksum         : %s\n", (cvol_vol && cvol_vol->CheckSum() == in_vol->CheckSum()) ? "OK" : "FAILED");
+
+    if (roi_vol) delete roi_vol;
+    if (cvol_vol) delete cvol_vol;
+    delete in_vol;
+    printf("Finished -> Benchmark Chunked Volume\n");
   }
-}
\ No newline at end of file
+}
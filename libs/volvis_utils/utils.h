@@ -8,10 +8,16 @@
 #include <gl_utils/texture2d.h>
 #include <volvis_utils/transferfunction.h>
 #include <volvis_utils/structuredgridvolume.h>
+#include <volvis_utils/deriveddatacache.h>
+#include <volvis_utils/encodedgradientfield.h>
 #include <vis_utils/summedareatable.h>
+#include <vis_utils/filters/utils.hpp>
 
 #include <glm/glm.hpp>
 
+#include <string>
+#include <vector>
+
 #define USE_16F_INTERNAL_FORMAT
 
 namespace vis
@@ -47,6 +53,9 @@ namespace vis
 
   gl::Texture3D* GenerateRTexture (StructuredGridVolume* vol, VIS_UTILS_DATA_TYPE vdatatype);
 
+  // Central differences gradients
+  // . filter_nxnxn: mean of the n x n x n neighborhood (n = 2 * r + 1 > 1)
+  // . cache: if not null, the gradients of the whole volume are read from / stored at it
   gl::Texture3D* GenerateGradientTexture (StructuredGridVolume* vol,
     int gradient_sample_size = 1,
     int filter_nxnxn = 0,
@@ -56,21 +65,97 @@ namespace vis
     int init_z = -1,
     int last_x = -1,
     int last_y = -1,
-    int last_z = -1);
+    int last_z = -1,
+    DerivedDataCache* cache = nullptr);
 
   // https://en.wikipedia.org/wiki/Sobel_operator  
-  gl::Texture3D* GenerateSobelFeldmanGradientTexture (StructuredGridVolume* vol);
+  gl::Texture3D* GenerateSobelFeldmanGradientTexture (StructuredGridVolume* vol, DerivedDataCache* cache = nullptr);
+
+  // Gradients built as an EncodedGradientField and uploaded in chunks of
+  //  slices, so the float gradient field is never allocated for the whole
+  //  volume. Same texture format as GenerateGradientTexture.
+  // . magnitude_bits: 0 for unit gradients
+  // . cache: if not null, the encoded gradients are read from / stored at it
+  gl::Texture3D* GenerateEncodedGradientTexture (StructuredGridVolume* vol, GRADIENT_OPERATOR gradient_operator,
+    int normal_bits = 16, int magnitude_bits = 16, DerivedDataCache* cache = nullptr);
+  gl::Texture3D* GenerateEncodedGradientTexture (EncodedGradientField* field);
+
+  // Cubic spline coefficients (see CubicSplineVolume), with linear filtering
+  //  and mirrored repeat, to be sampled with 8 trilinear fetches
+  // . kernel: K4_CARDINAL_BSPLINE_3 or K4_CARDINAL_OMOMS3
+  gl::Texture3D* GenerateCubicSplineCoefficientTexture (StructuredGridVolume* vol,
+    IMAGE_FILTER_KERNEL kernel = IMAGE_FILTER_KERNEL::K4_CARDINAL_BSPLINE_3);
 
   //https://stackoverflow.com/questions/1972172/interpolating-a-scalar-field-in-a-3d-space
   //https://www.ncbi.nlm.nih.gov/pmc/articles/PMC3719212/
 
   gl::Texture2D* GenerateNoiseTexture (float maxvalue, int w, int h);
 
+  // Writes "synthetic_gaussianvol_file.1.<d>x<d>x<d>.raw"
+  // . see SyntheticVolumeGenerator for other procedural models
   void GenerateSyntheticVolumetricModels (int d = 120, float s = 30.0f);
 
-  gl::Texture3D* GenerateExtinctionSAT3DTex (StructuredGridVolume* vol, TransferFunction* tf);
+  // Extinction coefficient of each voxel ("extinction" has width * height * depth
+  //  values), computed in parallel. 8 and 16 bits volumes are remapped through
+  //  an extinction lookup table indexed by the voxel value.
+  bool ComputeExtinctionVolume (StructuredGridVolume* vol, TransferFunction* tf, float* extinction);
+
+  // Extinction SAT of cells_w x cells_h x cells_d cells, each one with the mean
+  //  extinction of the voxels it covers (DownsampleExtinctionVolume), summed in
+  //  voxel units. A border of zeros is added on each side: "sat" has
+  //  (cells_w + 2) x (cells_h + 2) x (cells_d + 2) values.
+  // . the mean value is subtracted before the sums (BuildFloatSummedAreaTable3D):
+  //   the border value at the origin holds -mean (GetExtinctionSATOffset), box
+  //   sums must add mean * number of cells
+  // . cells must be in [1, volume size]
+  // . cache: if not null, the SAT is read from / stored at it
+  bool ComputeExtinctionSAT (StructuredGridVolume* vol, TransferFunction* tf,
+    int cells_w, int cells_h, int cells_d, float* sat, DerivedDataCache* cache = nullptr);
+
+  // Offset subtracted from the values of a ComputeExtinctionSAT table
+  double GetExtinctionSATOffset (const float* sat);
+
+  // R32F texture of ComputeExtinctionSAT, cells are clamped to the volume size
+  //  (0: volume resolution)
+  gl::Texture3D* GenerateExtinctionSAT3DTex (StructuredGridVolume* vol, TransferFunction* tf,
+    int cells_w = 0, int cells_h = 0, int cells_d = 0, DerivedDataCache* cache = nullptr);
+  // R32F texture of a SAT already computed on the CPU (same layout of
+  //  ComputeExtinctionSAT), without computing it again
+  gl::Texture3D* GenerateExtinctionSAT3DTex (SummedAreaTable3D<float>* sat);
 
   gl::Texture3D* GenerateScalarFieldSAT3DTex (StructuredGridVolume* vol);
+
+  // Compare box queries of the extinction SAT in double and float (texture
+  //  data), printing errors, memory and times
+  void BenchmarkExtinctionSAT (StructuredGridVolume* vol, TransferFunction* tf, int n_queries = 100000);
+
+  // Mean extinction coefficient of out_w x out_h x out_d cells evenly covering
+  //  the volume (box filter, partial voxels weighted by their overlap), so the
+  //  total extinction is preserved. Sizes are clamped to the volume size.
+  // . "extinction" must have out_w * out_h * out_d values
+  bool DownsampleExtinctionVolume (StructuredGridVolume* vol, TransferFunction* tf,
+    int out_w, int out_h, int out_d, float* extinction);
+
+  // Compare box sums of the full resolution extinction against the ones of a
+  //  sat_w x sat_h x sat_d downsampled SAT (trilinear interpolation of the
+  //  prefix sums, as the shaders do), printing errors, memory and times
+  void BenchmarkReducedExtinctionSAT (StructuredGridVolume* vol, TransferFunction* tf,
+    int sat_w, int sat_h, int sat_d, int n_queries = 100000);
+
+  // Chunked volume format (.cvol)
+  // . 8 bits, 16 bits and float volumes are supported
+  bool WriteChunkedVolume (StructuredGridVolume* vol, std::string output_filepath, unsigned int chunk_size = 64);
+  // Convert any volume read by VolumeReader
+  bool ConvertToChunkedVolume (std::string input_filepath, std::string output_filepath, unsigned int chunk_size = 64);
+  // Compare read times and sizes of the input file (.raw, .pvm, ...) against
+  //  its .cvol conversion, written at "<input_filepath>.cvol"
+  void BenchmarkChunkedVolume (std::string input_filepath, unsigned int chunk_size = 64);
+
+  // PVM export (.pvm)
+  // . convert any volume read by VolumeReader, optionally DDS compressed
+  bool ConvertToPVMFile (std::string input_filepath, std::string output_filepath, bool dds_compressed = true);
+  // . convert a list of volumes, each one written as "<input_filepath without extension>.pvm"
+  int ConvertToPVMFiles (std::vector<std::string> input_filepaths, bool dds_compressed = true);
 }
 
 #endif
@@ -0,0 +1,259 @@
+/**
+ * volumeringbuffer.cpp
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#include <volvis_utils/volumeringbuffer.h>
+#include <volvis_utils/sharedvolume.h>
+
+#include <chrono>
+#include <cstring>
+
+#define VOLUME_RING_BUFFER_MAGIC "VOLRING"
+#define VOLUME_RING_BUFFER_VERSION 1
+#define VOLUME_RING_BUFFER_ALIGNMENT 64
+// Number of attempts to copy the latest frame before giving up until the next call
+#define VOLUME_RING_BUFFER_READ_ATTEMPTS 4
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared ring buffer requires lock-free 64 bits atomics");
+
+namespace vis
+{
+  static unsigned long long AlignOffset (unsigned long long offset)
+  {
+    return (offset + VOLUME_RING_BUFFER_ALIGNMENT - 1) / VOLUME_RING_BUFFER_ALIGNMENT * VOLUME_RING_BUFFER_ALIGNMENT;
+  }
+
+  VolumeRingBuffer::VolumeRingBuffer ()
+    : m_last_read_frame(-1)
+    , m_n_torn_reads(0)
+  {
+  }
+
+  VolumeRingBuffer::~VolumeRingBuffer ()
+  {
+    Release();
+  }
+
+  bool VolumeRingBuffer::Create (std::string segment_name, unsigned int n_slots, unsigned long long slot_capacity)
+  {
+    Release();
+    if (n_slots < 2 || slot_capacity == 0)
+    {
+      printf("  - Volume ring buffer: at least 2 slots are required\n");
+      return false;
+    }
+
+    unsigned long long slots_offset = AlignOffset(sizeof(VolumeRingBufferHeader));
+    unsigned long long slot_stride = AlignOffset(AlignOffset(sizeof(VolumeRingSlotHeader)) + slot_capacity);
+    if (!m_segment.Create(segment_name, slots_offset + slot_stride * n_slots))
+      return false;
+
+    // New segments are zero filled: all sequences start at 0 (empty slot)
+    VolumeRingBufferHeader* header = GetHeader();
+    memcpy(header->magic, VOLUME_RING_BUFFER_MAGIC, sizeof(VOLUME_RING_BUFFER_MAGIC));
+    header->version = VOLUME_RING_BUFFER_VERSION;
+    header->n_slots = n_slots;
+    header->slot_capacity = slot_capacity;
+    header->slot_stride = slot_stride;
+    header->slots_offset = slots_offset;
+    for (unsigned int i = 0; i < n_slots; i++)
+      GetSlot(i)->sequence.store(0, std::memory_order_relaxed);
+    header->n_published_frames.store(0, std::memory_order_release);
+
+    printf("  - Volume ring buffer: created \"%s\" (%d slots, %.2f MB)\n", segment_name.c_str(),
+      n_slots, double(m_segment.GetSize()) / (1024.0 * 1024.0));
+    return true;
+  }
+
+  bool VolumeRingBuffer::PushFrame (StructuredGridVolume* vol)
+  {
+    if (!vol) return false;
+    return PushFrame(vol->GetArrayData(), vol->GetWidth(), vol->GetHeight(), vol->GetDepth(), vol->GetDataStorageSize(),
+      glm::dvec3(vol->GetScaleX(), vol->GetScaleY(), vol->GetScaleZ()));
+  }
+
+  bool VolumeRingBuffer::PushFrame (const void* values, unsigned int width, unsigned int height, unsigned int depth,
+                                    DataStorageSize dss, glm::dvec3 scale)
+  {
+    if (!IsProducer() || !values) return false;
+
+    VolumeRingBufferHeader* header = GetHeader();
+    unsigned long long bytes = (unsigned long long)width * height * depth * SharedVolumeSegment::GetStorageByteSize(dss);
+    if (bytes == 0 || bytes > header->slot_capacity)
+    {
+      printf("  - Volume ring buffer: frame does not fit in the slot capacity\n");
+      return false;
+    }
+
+    unsigned long long frame_id = header->n_published_frames.load(std::memory_order_relaxed);
+    unsigned long long slot_id = frame_id % header->n_slots;
+    VolumeRingSlotHeader* slot = GetSlot(slot_id);
+
+    // Mark the slot as being written before touching its data
+    slot->sequence.store(2 * frame_id + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->frame.frame_id = frame_id;
+    slot->frame.timestamp_ns = GetTimestampNow();
+    slot->frame.width = width;
+    slot->frame.height = height;
+    slot->frame.depth = depth;
+    slot->frame.data_storage_size = (uint32_t)dss;
+    slot->frame.scale[0] = scale.x;
+    slot->frame.scale[1] = scale.y;
+    slot->frame.scale[2] = scale.z;
+    slot->frame.bytes = bytes;
+    memcpy(GetSlotData(slot_id), values, bytes);
+
+    slot->sequence.store(2 * (frame_id + 1), std::memory_order_release);
+    header->n_published_frames.store(frame_id + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  bool VolumeRingBuffer::Attach (std::string segment_name)
+  {
+    Release();
+
+    if (!m_segment.Open(segment_name, true))
+      return false;
+
+    VolumeRingBufferHeader* header = GetHeader();
+    bool valid = m_segment.GetSize() >= sizeof(VolumeRingBufferHeader)
+      && memcmp(header->magic, VOLUME_RING_BUFFER_MAGIC, sizeof(VOLUME_RING_BUFFER_MAGIC)) == 0
+      && header->version == VOLUME_RING_BUFFER_VERSION
+      && header->n_slots >= 2
+      && header->slots_offset + header->slot_stride * header->n_slots <= m_segment.GetSize();
+    if (!valid)
+    {
+      printf("  - Volume ring buffer: \"%s\" is not a valid ring buffer segment\n", segment_name.c_str());
+      Release();
+      return false;
+    }
+
+    printf("  - Volume ring buffer: attached to \"%s\"\n", segment_name.c_str());
+    return true;
+  }
+
+  StructuredGridVolume* VolumeRingBuffer::ReadLatestFrame (VolumeRingFrameHeader* frame_header,
+                                                           unsigned long long* n_dropped_frames)
+  {
+    if (!IsAttached()) return nullptr;
+    VolumeRingBufferHeader* header = GetHeader();
+
+    for (int attempt = 0; attempt < VOLUME_RING_BUFFER_READ_ATTEMPTS; attempt++)
+    {
+      unsigned long long n_frames = header->n_published_frames.load(std::memory_order_acquire);
+      if (n_frames == 0 || (long long)n_frames - 1 <= m_last_read_frame) return nullptr;
+
+      unsigned long long frame_id = n_frames - 1;
+      unsigned long long slot_id = frame_id % header->n_slots;
+      VolumeRingSlotHeader* slot = GetSlot(slot_id);
+
+      // The slot was already reused by a newer frame: try again
+      unsigned long long sequence = slot->sequence.load(std::memory_order_acquire);
+      if (sequence != 2 * (frame_id + 1))
+      {
+        m_n_torn_reads++;
+        continue;
+      }
+
+      VolumeRingFrameHeader frame = slot->frame;
+      unsigned long long bytes_per_value = SharedVolumeSegment::GetStorageByteSize((DataStorageSize)frame.data_storage_size);
+      if (bytes_per_value == 0 || frame.bytes > header->slot_capacity
+       || frame.bytes != (unsigned long long)frame.width * frame.height * frame.depth * bytes_per_value)
+      {
+        m_n_torn_reads++;
+        continue;
+      }
+
+      StructuredGridVolume* vol = new StructuredGridVolume(m_segment.GetName(), frame.width, frame.height, frame.depth);
+      vol->SetScale(frame.scale[0], frame.scale[1], frame.scale[2]);
+
+      size_t n_values = size_t(frame.width) * frame.height * frame.depth;
+      DataStorageSize dss = (DataStorageSize)frame.data_storage_size;
+      void* values = nullptr;
+      if (dss == DataStorageSize::_8_BITS) values = new unsigned char[n_values];
+      else if (dss == DataStorageSize::_16_BITS) values = new unsigned short[n_values];
+      else if (dss == DataStorageSize::_NORMALIZED_F) values = new float[n_values];
+      else values = new double[n_values];
+      vol->SetArrayData(values, dss);
+
+      memcpy(values, GetSlotData(slot_id), frame.bytes);
+
+      // Check if the producer started to rewrite the slot during the copy
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot->sequence.load(std::memory_order_relaxed) != sequence)
+      {
+        delete vol;
+        m_n_torn_reads++;
+        continue;
+      }
+
+      if (n_dropped_frames) *n_dropped_frames = (unsigned long long)((long long)frame_id - m_last_read_frame - 1);
+      if (frame_header) *frame_header = frame;
+      m_last_read_frame = (long long)frame_id;
+
+      return vol;
+    }
+
+    return nullptr;
+  }
+
+  unsigned long long VolumeRingBuffer::GetNumberOfTornReads ()
+  {
+    return m_n_torn_reads;
+  }
+
+  void VolumeRingBuffer::Release ()
+  {
+    m_segment.Release();
+    m_last_read_frame = -1;
+    m_n_torn_reads = 0;
+  }
+
+  bool VolumeRingBuffer::IsProducer ()
+  {
+    return m_segment.IsCreator();
+  }
+
+  bool VolumeRingBuffer::IsAttached ()
+  {
+    return m_segment.IsMapped() && !m_segment.IsCreator();
+  }
+
+  std::string VolumeRingBuffer::GetSegmentName ()
+  {
+    return m_segment.GetName();
+  }
+
+  unsigned long long VolumeRingBuffer::GetNumberOfPublishedFrames ()
+  {
+    if (!m_segment.IsMapped()) return 0;
+    return GetHeader()->n_published_frames.load(std::memory_order_acquire);
+  }
+
+  unsigned long long VolumeRingBuffer::GetTimestampNow ()
+  {
+    return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  }
+
+  VolumeRingBufferHeader* VolumeRingBuffer::GetHeader ()
+  {
+    return reinterpret_cast<VolumeRingBufferHeader*>(m_segment.GetData());
+  }
+
+  VolumeRingSlotHeader* VolumeRingBuffer::GetSlot (unsigned long long slot)
+  {
+    VolumeRingBufferHeader* header = GetHeader();
+    return reinterpret_cast<VolumeRingSlotHeader*>(m_segment.GetData() + header->slots_offset + slot * header->slot_stride);
+  }
+
+  unsigned char* VolumeRingBuffer::GetSlotData (unsigned long long slot)
+  {
+    return reinterpret_cast<unsigned char*>(GetSlot(slot)) + AlignOffset(sizeof(VolumeRingSlotHeader));
+  }
+}
@@ -0,0 +1,115 @@
+/**
+ * volumeringbuffer.h
+ *
+ * Lock-free single producer ring buffer of volume frames (header + voxel
+ *   values), stored in a named shared memory segment. Used to stream
+ *   timesteps from a running simulation into the renderer.
+ *
+ * Segment layout:
+ *   <VolumeRingBufferHeader> <slot 0> ... <slot n-1>
+ *   slot: <VolumeRingSlotHeader> <voxel values, up to "slot_capacity" bytes>
+ *
+ * The producer never waits for the consumers: frame "f" is always written
+ *   into slot "f % n_slots", overwriting the oldest frame. Each slot has a
+ *   sequence counter (seqlock), which is odd while the slot is being written
+ *   and 2 * (frame_id + 1) when frame_id is complete. Consumers only read the
+ *   latest published frame, copy it, and check the sequence again to discard
+ *   frames that were overwritten during the copy. Skipped frames are counted
+ *   as dropped.
+ *
+ * Timestamps are taken from the system clock (nanoseconds since epoch),
+ *   so they can be compared between processes of the same node.
+ *
+ * Leonardo Quatrin Campagnolo
+ * . campagnolo.lq@gmail.com
+**/
+#ifndef VOL_VIS_UTILS_VOLUME_RING_BUFFER_H
+#define VOL_VIS_UTILS_VOLUME_RING_BUFFER_H
+
+#include <volvis_utils/structuredgridvolume.h>
+#include <volvis_utils/sharedmemory.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace vis
+{
+  struct VolumeRingFrameHeader
+  {
+    uint64_t frame_id;
+    uint64_t timestamp_ns;
+    uint32_t width, height, depth;
+    uint32_t data_storage_size;
+    double scale[3];
+    uint64_t bytes;
+  };
+
+  struct VolumeRingSlotHeader
+  {
+    std::atomic<uint64_t> sequence;
+    VolumeRingFrameHeader frame;
+  };
+
+  struct VolumeRingBufferHeader
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t n_slots;
+    uint64_t slot_capacity;
+    uint64_t slot_stride;
+    uint64_t slots_offset;
+    // number of completely written frames
+    std::atomic<uint64_t> n_published_frames;
+  };
+
+  class VolumeRingBuffer
+  {
+  public:
+    VolumeRingBuffer ();
+    ~VolumeRingBuffer ();
+
+    // Producer: create the segment with "n_slots" slots of "slot_capacity" bytes
+    bool Create (std::string segment_name, unsigned int n_slots, unsigned long long slot_capacity);
+    // Producer: write the volume into the next slot, never blocks
+    bool PushFrame (StructuredGridVolume* vol);
+    bool PushFrame (const void* values, unsigned int width, unsigned int height, unsigned int depth,
+                    DataStorageSize dss, glm::dvec3 scale = glm::dvec3(1.0));
+
+    // Consumer: map an existing ring buffer read-only
+    bool Attach (std::string segment_name);
+    // Consumer: returns a copy of the latest complete frame, or nullptr if
+    //  no frame was published after the last returned one. "frame_header"
+    //  receives the frame header, "n_dropped_frames" the number of frames
+    //  skipped since the last returned one.
+    StructuredGridVolume* ReadLatestFrame (VolumeRingFrameHeader* frame_header = nullptr,
+                                           unsigned long long* n_dropped_frames = nullptr);
+    // Consumer: number of copies discarded because the slot was overwritten
+    unsigned long long GetNumberOfTornReads ();
+
+    void Release ();
+
+    bool IsProducer ();
+    bool IsAttached ();
+    std::string GetSegmentName ();
+    unsigned long long GetNumberOfPublishedFrames ();
+
+    static unsigned long long GetTimestampNow ();
+
+  protected:
+    VolumeRingBufferHeader* GetHeader ();
+    VolumeRingSlotHeader* GetSlot (unsigned long long slot);
+    unsigned char* GetSlotData (unsigned long long slot);
+
+    SharedMemorySegment m_segment;
+
+    // consumer state
+    long long m_last_read_frame;
+    unsigned long long m_n_torn_reads;
+
+  private:
+
+  };
+}
+
+#endif